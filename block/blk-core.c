@@ -221,12 +221,42 @@ void blk_dump_rq_flags(struct request *rq, char *msg)
 EXPORT_SYMBOL(blk_dump_rq_flags);
 
 #ifdef CONFIG_BLK_IO_VOLUME
+/* interval to fold the per-cpu I/O volume of blk-mq queue while it is busy */
+#define BLK_IO_VOL_FOLD_INTERVAL	msecs_to_jiffies(10)
+
+static void blk_queue_io_vol_work(struct work_struct *work);
+
+void blk_queue_init_io_vol(struct request_queue *q)
+{
+	/* blk-mq queues just do not count I/O volume without it */
+	q->blk_io_vol_pcpu = alloc_percpu(struct block_io_volume_pcpu);
+	INIT_DELAYED_WORK(&q->io_vol_work, blk_queue_io_vol_work);
+}
+
+void blk_queue_exit_io_vol(struct request_queue *q)
+{
+	cancel_delayed_work_sync(&q->io_vol_work);
+	free_percpu(q->blk_io_vol_pcpu);
+	q->blk_io_vol_pcpu = NULL;
+}
+
 void blk_queue_reset_io_vol(struct request_queue *q)
 {
 	struct block_io_volume *vol;
-	int idx;
+	int idx, cpu;
 
 	spin_lock_irq(q->queue_lock);
+	if (q->blk_io_vol_pcpu) {
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(q->blk_io_vol_pcpu, cpu), 0,
+			       sizeof(struct block_io_volume_pcpu));
+#ifdef CONFIG_BLK_TURBO_WRITE
+		/* the next fold takes the issued bytes from zero again */
+		if (q->tw)
+			q->tw->mq_issued_bytes = 0;
+#endif
+	}
+
 	for (idx = 0; idx < BLK_MAX_IO_VOLS; idx++) {
 		vol = &(q->blk_io_vol[idx]);
 
@@ -249,104 +279,225 @@ void blk_queue_reset_io_vol(struct request_queue *q)
 	spin_unlock_irq(q->queue_lock);
 }
 
+static void blk_io_vol_update_peak(struct block_io_volume *vol)
+{
+	if (vol->queuing_rqs > vol->peak_rqs)
+		vol->peak_rqs = vol->queuing_rqs;
+	if (vol->queuing_bytes > vol->peak_bytes)
+		vol->peak_bytes = vol->queuing_bytes;
+}
+
+/* I/O session finishes when last I/O is outgoing from queue */
+static void blk_io_vol_end_session(struct block_io_volume *vol)
+{
+	int idx;
+
+	if (vol->peak_rqs >= 16) {
+		/*
+		 * count up index
+		 * 0 : 16 <= vol->peak_rqs < 32
+		 * 1 : 32 <= vol->peak_rqs < 64
+		 * 2 : 64 <= vol->peak_rqs < 128
+		 * 3 : 128 <= vol->peak_rqs
+		 */
+		idx = fls(vol->peak_rqs >> 5);
+		idx = (idx < 4) ? idx : 3;
+		vol->peak_rqs_cnt[idx]++;
+	}
+
+	if (vol->peak_bytes >= (1 << 23)) {
+		/*
+		 * count up index
+		 * 0 : 8MB <= vol->peak_bytes < 16MB
+		 * 1 : 16MB <= vol->peak_bytes < 32MB
+		 * 2 : 32MB <= vol->peak_bytes < 64MB
+		 * 3 : 64MB <= vol->peak_bytes
+		 */
+		idx = fls(vol->peak_bytes >> 24);
+		idx = (idx < 4) ? idx : 3;
+		vol->peak_bytes_cnt[idx]++;
+	}
+
+	vol->peak_rqs = 0;
+	vol->peak_bytes = 0;
+}
+
+/*
+ * blk-mq queues update the counters of the current cpu without queue_lock.
+ * io_vol_work is kicked when I/O comes in, and it folds the counters and
+ * runs the turbo write state machine until the queue gets idle.
+ */
+static void blk_mq_io_vol_acct(struct request_queue *q, int op,
+	int rqs, long long bytes)
+{
+	if (!q->blk_io_vol_pcpu)
+		return;
+
+	this_cpu_add(q->blk_io_vol_pcpu->queuing_rqs[op], rqs);
+	this_cpu_add(q->blk_io_vol_pcpu->queuing_bytes[op], bytes);
+
+	if ((rqs > 0 || bytes > 0) && !delayed_work_pending(&q->io_vol_work))
+		queue_delayed_work(kblockd_workqueue, &q->io_vol_work,
+				   BLK_IO_VOL_FOLD_INTERVAL);
+}
+
 /* should be called with queue_lock held */
-void blk_queue_io_vol_add(struct request_queue *q, int opf, long long bytes)
+void blk_queue_io_vol_fold(struct request_queue *q)
 {
 	struct block_io_volume *vol;
-	int op = opf & REQ_OP_MASK;
+	struct block_io_volume_pcpu *pvol;
+	long long bytes, issued = 0;
+	int op, rqs, cpu;
 
-	if (q->mq_ops)
+	lockdep_assert_held(q->queue_lock);
+
+	if (!q->mq_ops || !q->blk_io_vol_pcpu)
 		return;
 
-	lockdep_assert_held(q->queue_lock);
+	for (op = 0; op < BLK_MAX_IO_VOLS; op++) {
+		rqs = 0;
+		bytes = 0;
+		for_each_possible_cpu(cpu) {
+			pvol = per_cpu_ptr(q->blk_io_vol_pcpu, cpu);
+			rqs += READ_ONCE(pvol->queuing_rqs[op]);
+			bytes += READ_ONCE(pvol->queuing_bytes[op]);
+			if (op == REQ_OP_WRITE)
+				issued += READ_ONCE(pvol->issued_bytes);
+		}
 
-	if ((bytes > 0) && ((op == REQ_OP_READ) || (op == REQ_OP_WRITE))) {
 		vol = &(q->blk_io_vol[op]);
+		vol->queuing_rqs = rqs;
+		vol->queuing_bytes = bytes;
 
-		vol->queuing_rqs++;
-		vol->queuing_bytes += bytes;
+		blk_io_vol_update_peak(vol);
+		if (vol->queuing_rqs == 0)
+			blk_io_vol_end_session(vol);
+	}
 
-		if (vol->queuing_rqs > vol->peak_rqs)
-			vol->peak_rqs = vol->queuing_rqs;
-		if (vol->queuing_bytes > vol->peak_bytes)
-			vol->peak_bytes = vol->queuing_bytes;
+#ifdef CONFIG_BLK_TURBO_WRITE
+	if (q->tw) {
+		if (q->tw->state != TW_OFF)
+			q->tw->curr_issued_kb +=
+				(issued - q->tw->mq_issued_bytes) / 1024;
+		q->tw->mq_issued_bytes = issued;
 	}
+#endif
 }
 
-/* should be called with queue_lock held */
-void blk_queue_io_vol_del(struct request_queue *q, int opf, long long bytes)
+static void blk_queue_io_vol_work(struct work_struct *work)
+{
+	struct request_queue *q = container_of(to_delayed_work(work),
+					struct request_queue, io_vol_work);
+	bool busy;
+
+	spin_lock_irq(q->queue_lock);
+	blk_queue_io_vol_fold(q);
+
+	blk_update_tw_state(q,
+			blk_io_vol_rqs(q, REQ_OP_WRITE),
+			blk_io_vol_bytes(q, REQ_OP_WRITE));
+
+	busy = q->blk_io_vol[REQ_OP_READ].queuing_rqs ||
+		q->blk_io_vol[REQ_OP_WRITE].queuing_rqs;
+#ifdef CONFIG_BLK_TURBO_WRITE
+	/* keep running to turn turbo write off after the I/O ends */
+	if (q->tw && q->tw->state != TW_OFF)
+		busy = true;
+#endif
+	spin_unlock_irq(q->queue_lock);
+
+	if (busy && !blk_queue_dying(q))
+		queue_delayed_work(kblockd_workqueue, &q->io_vol_work,
+				   BLK_IO_VOL_FOLD_INTERVAL);
+}
+
+void blk_mq_io_vol_add(struct request *rq)
+{
+	rq->rq_flags |= RQF_IO_VOL;
+	blk_queue_io_vol_add(rq->q, rq->cmd_flags, blk_rq_bytes(rq));
+}
+
+void blk_mq_io_vol_del(struct request *rq)
+{
+	if (!(rq->rq_flags & RQF_IO_VOL))
+		return;
+
+	rq->rq_flags &= ~RQF_IO_VOL;
+	blk_queue_io_vol_del(rq->q, rq->cmd_flags, blk_rq_bytes(rq));
+}
+
+/* should be called with queue_lock held unless q is blk-mq */
+void blk_queue_io_vol_add(struct request_queue *q, int opf, long long bytes)
 {
 	struct block_io_volume *vol;
 	int op = opf & REQ_OP_MASK;
-	int idx;
 
-	if (q->mq_ops)
+	if ((bytes <= 0) || ((op != REQ_OP_READ) && (op != REQ_OP_WRITE)))
 		return;
 
+	if (q->mq_ops) {
+		blk_mq_io_vol_acct(q, op, 1, bytes);
+		return;
+	}
+
 	lockdep_assert_held(q->queue_lock);
 
-	if ((bytes > 0) && ((op == REQ_OP_READ) || (op == REQ_OP_WRITE))) {
-		vol = &(q->blk_io_vol[op]);
+	vol = &(q->blk_io_vol[op]);
 
-		vol->queuing_rqs--;
-		vol->queuing_bytes -= bytes;
+	vol->queuing_rqs++;
+	vol->queuing_bytes += bytes;
 
-		if (vol->queuing_rqs == 0) {
-			if (vol->peak_rqs >= 16) {
-				/*
-				 * count up index
-				 * 0 : 16 <= vol->peak_rqs < 32
-				 * 1 : 32 <= vol->peak_rqs < 64
-				 * 2 : 64 <= vol->peak_rqs < 128
-				 * 3 : 128 <= vol->peak_rqs
-				 */
-				idx = fls(vol->peak_rqs >> 5);
-				idx = (idx < 4) ? idx : 3;
-				vol->peak_rqs_cnt[idx]++;
-			}
+	blk_io_vol_update_peak(vol);
+}
 
-			if (vol->peak_bytes >= (1 << 23)) {
-				/*
-				 * count up index
-				 * 0 : 8MB <= vol->peak_bytes < 16MB
-				 * 1 : 16MB <= vol->peak_bytes < 32MB
-				 * 2 : 32MB <= vol->peak_bytes < 64MB
-				 * 3 : 64MB <= vol->peak_bytes
-				 */
-				idx = fls(vol->peak_bytes >> 24);
-				idx = (idx < 4) ? idx : 3;
-				vol->peak_bytes_cnt[idx]++;
-			}
+/* should be called with queue_lock held unless q is blk-mq */
+void blk_queue_io_vol_del(struct request_queue *q, int opf, long long bytes)
+{
+	struct block_io_volume *vol;
+	int op = opf & REQ_OP_MASK;
 
-			vol->peak_rqs = 0;
-			vol->peak_bytes = 0;
-		}
+	if ((bytes <= 0) || ((op != REQ_OP_READ) && (op != REQ_OP_WRITE)))
+		return;
+
+	if (q->mq_ops) {
+		blk_mq_io_vol_acct(q, op, -1, -bytes);
+		return;
 	}
+
+	lockdep_assert_held(q->queue_lock);
+
+	vol = &(q->blk_io_vol[op]);
+
+	vol->queuing_rqs--;
+	vol->queuing_bytes -= bytes;
+
+	if (vol->queuing_rqs == 0)
+		blk_io_vol_end_session(vol);
 }
 
-/* should be called with queue_lock held */
+/* should be called with queue_lock held unless q is blk-mq */
 void blk_queue_io_vol_merge(struct request_queue *q,
 	int opf, int rqs, long long bytes)
 {
 	struct block_io_volume *vol;
 	int op = opf & REQ_OP_MASK;
 
-	if (q->mq_ops)
+	if ((op != REQ_OP_READ) && (op != REQ_OP_WRITE))
 		return;
 
+	if (q->mq_ops) {
+		blk_mq_io_vol_acct(q, op, rqs, bytes);
+		return;
+	}
+
 	lockdep_assert_held(q->queue_lock);
 
-	if ((op == REQ_OP_READ) || (op == REQ_OP_WRITE)) {
-		vol = &(q->blk_io_vol[op]);
+	vol = &(q->blk_io_vol[op]);
 
-		vol->queuing_rqs += rqs;
-		vol->queuing_bytes += bytes;
+	vol->queuing_rqs += rqs;
+	vol->queuing_bytes += bytes;
 
-		if (vol->queuing_rqs > vol->peak_rqs)
-			vol->peak_rqs = vol->queuing_rqs;
-		if (vol->queuing_bytes > vol->peak_bytes)
-			vol->peak_bytes = vol->queuing_bytes;
-	}
+	blk_io_vol_update_peak(vol);
 }
 #endif /* CONFIG_BLK_IO_VOLUME */
 
@@ -401,6 +552,7 @@ int blk_alloc_turbo_write(struct request_queue *q)
 
 	return 0;
 }
+EXPORT_SYMBOL_GPL(blk_alloc_turbo_write);
 
 void blk_free_turbo_write(struct request_queue *q)
 {
@@ -414,6 +566,7 @@ void blk_free_turbo_write(struct request_queue *q)
 	q->tw = NULL;
 	spin_unlock_irq(q->queue_lock);
 }
+EXPORT_SYMBOL_GPL(blk_free_turbo_write);
 
 int blk_register_tw_try_on_fn(struct request_queue *q, blk_tw_try_on_fn *fn)
 {
@@ -428,6 +581,7 @@ int blk_register_tw_try_on_fn(struct request_queue *q, blk_tw_try_on_fn *fn)
 
 	return 0;
 }
+EXPORT_SYMBOL_GPL(blk_register_tw_try_on_fn);
 
 int blk_register_tw_try_off_fn(struct request_queue *q, blk_tw_try_off_fn *fn)
 {
@@ -442,6 +596,7 @@ int blk_register_tw_try_off_fn(struct request_queue *q, blk_tw_try_off_fn *fn)
 
 	return 0;
 }
+EXPORT_SYMBOL_GPL(blk_register_tw_try_off_fn);
 
 int blk_reset_tw_state(struct request_queue *q)
 {
@@ -456,6 +611,7 @@ int blk_reset_tw_state(struct request_queue *q)
 
 	return 0;
 }
+EXPORT_SYMBOL_GPL(blk_reset_tw_state);
 
 static void blk_update_tw_stats(struct blk_turbo_write *tw)
 {
@@ -536,11 +692,18 @@ void blk_update_tw_state(struct request_queue *q,
 	}
 }
 
-/* should be called with queue_lock held */
+/* should be called with queue_lock held unless q is blk-mq */
 void blk_account_tw_io(struct request_queue *q, int opf, int bytes)
 {
 	struct blk_turbo_write	*tw = q->tw;
 
+	/* folded into curr_issued_kb by blk_queue_io_vol_fold() */
+	if (q->mq_ops) {
+		if (q->blk_io_vol_pcpu && op_is_write(opf))
+			this_cpu_add(q->blk_io_vol_pcpu->issued_bytes, bytes);
+		return;
+	}
+
 	lockdep_assert_held(q->queue_lock);
 
 	if (!tw)
@@ -997,6 +1160,7 @@ void blk_cleanup_queue(struct request_queue *q)
 	queue_flag_set(QUEUE_FLAG_DEAD, q);
 	spin_unlock_irq(lock);
 
+	blk_queue_exit_io_vol(q);
 	blk_queue_reset_io_vol(q);
 	blk_free_turbo_write(q);
 
@@ -1241,6 +1405,7 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	if (blkcg_init_queue(q))
 		goto fail_ref;
 
+	blk_queue_init_io_vol(q);
 	blk_queue_reset_io_vol(q);
 
 #ifdef CONFIG_BLK_TURBO_WRITE
@@ -774,6 +774,8 @@ static struct request *attempt_merge(struct request_queue *q,
 	 */
 	blk_account_io_merge(next);
 	blk_queue_io_vol_merge(q, next->cmd_flags, -1, 0);
+	/* the bytes of 'next' are counted in 'req' from now on */
+	next->rq_flags &= ~RQF_IO_VOL;
 
 	req->ioprio = ioprio_best(req->ioprio, next->ioprio);
 	if (blk_rq_cpu_valid(next))
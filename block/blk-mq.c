@@ -497,6 +497,8 @@ void blk_mq_free_request(struct request *rq)
 	if (rq->rq_flags & RQF_MQ_INFLIGHT)
 		atomic_dec(&hctx->nr_active);
 
+	blk_mq_io_vol_del(rq);
+
 	wbt_done(q->rq_wb, &rq->issue_stat);
 
 	clear_bit(REQ_ATOM_STARTED, &rq->atomic_flags);
@@ -614,6 +616,9 @@ void blk_mq_start_request(struct request *rq)
 
 	blk_add_timer(rq);
 
+	blk_mq_io_vol_del(rq);
+	blk_account_tw_io(q, rq->cmd_flags, blk_rq_bytes(rq));
+
 	/*
 	 * Ensure that ->deadline is visible before set the started
 	 * flag and clear the completed flag.
@@ -661,6 +666,9 @@ static void __blk_mq_requeue_request(struct request *rq)
 	if (test_and_clear_bit(REQ_ATOM_STARTED, &rq->atomic_flags)) {
 		if (q->dma_drain_size && blk_rq_bytes(rq))
 			rq->nr_phys_segments--;
+
+		blk_account_tw_io(q, rq->cmd_flags, -blk_rq_bytes(rq));
+		blk_mq_io_vol_add(rq);
 	}
 }
 
@@ -1543,6 +1551,7 @@ static void blk_mq_bio_to_request(struct request *rq, struct bio *bio)
 	blk_init_request_from_bio(rq, bio);
 
 	blk_account_io_start(rq, true);
+	blk_mq_io_vol_add(rq);
 }
 
 static inline bool hctx_allow_merges(struct blk_mq_hw_ctx *hctx)
@@ -1647,6 +1656,7 @@ static blk_qc_t blk_mq_make_request(struct request_queue *q, struct bio *bio)
 	struct request *same_queue_rq = NULL;
 	blk_qc_t cookie;
 	unsigned int wb_acct;
+	unsigned int opf, nr_bytes;
 
 	blk_queue_bounce(q, &bio);
 
@@ -1655,12 +1665,20 @@ static blk_qc_t blk_mq_make_request(struct request_queue *q, struct bio *bio)
 	if (!bio_integrity_prep(bio))
 		return BLK_QC_T_NONE;
 
+	/* the bio may be completed once it is merged */
+	opf = bio->bi_opf;
+	nr_bytes = bio->bi_iter.bi_size;
+
 	if (!is_flush_fua && !blk_queue_nomerges(q) &&
-	    blk_attempt_plug_merge(q, bio, &request_count, &same_queue_rq))
+	    blk_attempt_plug_merge(q, bio, &request_count, &same_queue_rq)) {
+		blk_queue_io_vol_merge(q, opf, 0, nr_bytes);
 		return BLK_QC_T_NONE;
+	}
 
-	if (blk_mq_sched_bio_merge(q, bio))
+	if (blk_mq_sched_bio_merge(q, bio)) {
+		blk_queue_io_vol_merge(q, opf, 0, nr_bytes);
 		return BLK_QC_T_NONE;
+	}
 
 	wb_acct = wbt_wait(q->rq_wb, bio, NULL);
 
@@ -699,6 +699,12 @@ static struct queue_sysfs_entry throtl_sample_time_entry = {
 #ifdef CONFIG_BLK_IO_VOLUME
 static ssize_t queue_io_vol_show(struct request_queue *q, char *page)
 {
+	if (q->mq_ops) {
+		spin_lock_irq(q->queue_lock);
+		blk_queue_io_vol_fold(q);
+		spin_unlock_irq(q->queue_lock);
+	}
+
 	/* not protect with lock (just for data monitoring) */
 	return sprintf(page, "%d,%lld,%d,%lld\n",
 			q->blk_io_vol[REQ_OP_READ].queuing_rqs,
@@ -143,6 +143,8 @@ static inline void blk_clear_rq_complete(struct request *rq)
 }
 
 #ifdef CONFIG_BLK_IO_VOLUME
+void blk_queue_init_io_vol(struct request_queue *q);
+void blk_queue_exit_io_vol(struct request_queue *q);
 void blk_queue_reset_io_vol(struct request_queue *q);
 void blk_queue_io_vol_add(struct request_queue *q,
 	int opf, long long bytes);
@@ -150,11 +152,19 @@ void blk_queue_io_vol_del(struct request_queue *q,
 	int opf, long long bytes);
 void blk_queue_io_vol_merge(struct request_queue *q,
 	int opf, int rqs, long long bytes);
+void blk_queue_io_vol_fold(struct request_queue *q);
+void blk_mq_io_vol_add(struct request *rq);
+void blk_mq_io_vol_del(struct request *rq);
 #else
+#define blk_queue_init_io_vol(q)			do {} while (0)
+#define blk_queue_exit_io_vol(q)			do {} while (0)
 #define blk_queue_reset_io_vol(q)			do {} while (0)
 #define blk_queue_io_vol_add(q, opf, bytes)		do {} while (0)
 #define blk_queue_io_vol_del(q, opf, bytes)		do {} while (0)
 #define blk_queue_io_vol_merge(q, opf, rqs, bytes)	do {} while (0)
+#define blk_queue_io_vol_fold(q)			do {} while (0)
+#define blk_mq_io_vol_add(rq)				do {} while (0)
+#define blk_mq_io_vol_del(rq)				do {} while (0)
 #endif
 
 /*
@@ -245,6 +245,39 @@ static bool g_use_per_node_hctx;
 module_param_named(use_per_node_hctx, g_use_per_node_hctx, bool, S_IRUGO);
 MODULE_PARM_DESC(use_per_node_hctx, "Use per-node allocation for hardware context queues. Default: false");
 
+#ifdef CONFIG_BLK_TURBO_WRITE
+static bool g_turbo_write;
+module_param_named(turbo_write, g_turbo_write, bool, S_IRUGO);
+MODULE_PARM_DESC(turbo_write, "Log turbo write on/off requests of block layer. Default: false");
+
+static void null_tw_try_on(struct request_queue *q)
+{
+	struct nullb *nullb = q->queuedata;
+
+	pr_info("null_blk: %s: turbo write on\n", nullb->disk_name);
+}
+
+static void null_tw_try_off(struct request_queue *q)
+{
+	struct nullb *nullb = q->queuedata;
+
+	pr_info("null_blk: %s: turbo write off\n", nullb->disk_name);
+}
+
+static void null_init_turbo_write(struct nullb *nullb)
+{
+	if (!g_turbo_write || blk_alloc_turbo_write(nullb->q))
+		return;
+
+	blk_register_tw_try_on_fn(nullb->q, null_tw_try_on);
+	blk_register_tw_try_off_fn(nullb->q, null_tw_try_off);
+}
+#else
+static void null_init_turbo_write(struct nullb *nullb)
+{
+}
+#endif
+
 static struct nullb_device *null_alloc_dev(void);
 static void null_free_dev(struct nullb_device *dev);
 static void null_del_dev(struct nullb *nullb);
@@ -1904,6 +1937,8 @@ static int null_add_dev(struct nullb_device *dev)
 
 	sprintf(nullb->disk_name, "nullb%d", nullb->index);
 
+	null_init_turbo_write(nullb);
+
 	if (dev->use_lightnvm)
 		rv = null_nvm_register(nullb);
 	else
@@ -13,6 +13,7 @@
  *
  */
 
+#include <linux/cpu_pm.h>
 #include <linux/cpufreq.h>
 #include <linux/cpufreq_times.h>
 #include <linux/hashtable.h>
@@ -51,12 +52,16 @@ struct uid_entry {
  * @offset: start of these freqs' stats in task time_in_state array
  * @max_state: number of entries in freq_table
  * @last_index: index in freq_table of last frequency switched to
+ * @first_cpu: first cpu of the policy
+ * @related_cpus: cpus sharing this policy
  * @freq_table: list of available frequencies
  */
 struct cpu_freqs {
 	unsigned int offset;
 	unsigned int max_state;
 	unsigned int last_index;
+	unsigned int first_cpu;
+	struct cpumask related_cpus;
 	unsigned int freq_table[0];
 };
 
@@ -64,6 +69,80 @@ static struct cpu_freqs *all_freqs[NR_CPUS];
 
 static unsigned int next_offset;
 
+#define UID_DELTA_NR	16
+
+/**
+ * struct uid_delta - time accounted to a uid but not yet folded
+ * @uid: uid the time belongs to
+ * @state: index in uid_entry->time_in_state
+ * @active_idx: index in concurrent_times->active
+ * @policy_idx: index in concurrent_times->policy
+ * @time: accumulated cputime in ns
+ */
+struct uid_delta {
+	uid_t uid;
+	unsigned int state;
+	unsigned int active_idx;
+	unsigned int policy_idx;
+	u64 time;
+};
+
+/*
+ * Per-cpu buffer of pending uid deltas. The lock is only taken remotely
+ * when the deltas are folded into uid_hash_table by a reader.
+ */
+struct uid_delta_buf {
+	spinlock_t lock;
+	unsigned int nr;
+	struct uid_delta deltas[UID_DELTA_NR];
+};
+
+static DEFINE_PER_CPU(struct uid_delta_buf, uid_delta_bufs);
+
+#ifdef CONFIG_CPU_PM
+/* cpus staying in the idle loop, updated at idle entry and exit */
+static struct cpumask idle_cpus;
+
+static int cpufreq_times_cpu_pm_notifier(struct notifier_block *nb,
+					 unsigned long cmd, void *v)
+{
+	switch (cmd) {
+	case CPU_PM_ENTER_PREPARE:
+		cpumask_set_cpu(smp_processor_id(), &idle_cpus);
+		break;
+	case CPU_PM_EXIT_POST:
+		cpumask_clear_cpu(smp_processor_id(), &idle_cpus);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_times_cpu_pm_nb = {
+	.notifier_call = cpufreq_times_cpu_pm_notifier,
+};
+
+static unsigned int nr_active_cpus(const struct cpumask *cpus)
+{
+	struct cpumask active;
+
+	cpumask_andnot(&active, cpus, &idle_cpus);
+	return cpumask_weight(&active);
+}
+#else
+static unsigned int nr_active_cpus(const struct cpumask *cpus)
+{
+	unsigned int cnt = 0;
+	int cpu;
+
+	for_each_cpu(cpu, cpus)
+		if (!idle_cpu(cpu))
+			++cnt;
+
+	return cnt;
+}
+#endif /* CONFIG_CPU_PM */
+
 
 /* Caller must hold rcu_read_lock() */
 static struct uid_entry *find_uid_entry_rcu(uid_t uid)
@@ -137,6 +216,89 @@ static struct uid_entry *find_or_register_uid_locked(uid_t uid)
 	return uid_entry;
 }
 
+/* Caller must hold buf->lock */
+static void uid_delta_fold_locked(struct uid_delta_buf *buf)
+{
+	struct uid_entry *uid_entry;
+	struct uid_delta *delta;
+	unsigned int i;
+
+	if (!buf->nr)
+		return;
+
+	spin_lock(&uid_lock);
+	for (i = 0; i < buf->nr; i++) {
+		delta = &buf->deltas[i];
+
+		uid_entry = find_or_register_uid_locked(delta->uid);
+		if (!uid_entry)
+			continue;
+
+		if (delta->state < uid_entry->max_state)
+			uid_entry->time_in_state[delta->state] += delta->time;
+		atomic64_add(delta->time,
+			&uid_entry->concurrent_times->active[delta->active_idx]);
+		atomic64_add(delta->time,
+			&uid_entry->concurrent_times->policy[delta->policy_idx]);
+	}
+	spin_unlock(&uid_lock);
+
+	buf->nr = 0;
+}
+
+/* Fold pending deltas of all cpus into uid_hash_table */
+static void uid_delta_fold_all(void)
+{
+	struct uid_delta_buf *buf;
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		buf = &per_cpu(uid_delta_bufs, cpu);
+
+		spin_lock_irqsave(&buf->lock, flags);
+		uid_delta_fold_locked(buf);
+		spin_unlock_irqrestore(&buf->lock, flags);
+	}
+}
+
+static void uid_delta_add(uid_t uid, unsigned int state,
+	unsigned int active_idx, unsigned int policy_idx, u64 cputime)
+{
+	struct uid_delta_buf *buf;
+	struct uid_delta *delta;
+	unsigned long flags;
+	unsigned int i;
+
+	local_irq_save(flags);
+	buf = this_cpu_ptr(&uid_delta_bufs);
+	spin_lock(&buf->lock);
+
+	/* The same uids are usually accounted on consecutive ticks */
+	for (i = 0; i < buf->nr; i++) {
+		delta = &buf->deltas[i];
+		if (delta->uid == uid && delta->state == state &&
+		    delta->active_idx == active_idx &&
+		    delta->policy_idx == policy_idx) {
+			delta->time += cputime;
+			goto out;
+		}
+	}
+
+	if (buf->nr == UID_DELTA_NR)
+		uid_delta_fold_locked(buf);
+
+	delta = &buf->deltas[buf->nr++];
+	delta->uid = uid;
+	delta->state = state;
+	delta->active_idx = active_idx;
+	delta->policy_idx = policy_idx;
+	delta->time = cputime;
+out:
+	spin_unlock(&buf->lock);
+	local_irq_restore(flags);
+}
+
 static int single_uid_time_in_state_show(struct seq_file *m, void *ptr)
 {
 	struct uid_entry *uid_entry;
@@ -146,6 +308,8 @@ static int single_uid_time_in_state_show(struct seq_file *m, void *ptr)
 	if (uid == overflowuid)
 		return -EINVAL;
 
+	uid_delta_fold_all();
+
 	rcu_read_lock();
 
 	uid_entry = find_uid_entry_rcu(uid);
@@ -169,6 +333,9 @@ static void *uid_seq_start(struct seq_file *seq, loff_t *pos)
 	if (*pos >= HASH_SIZE(uid_hash_table))
 		return NULL;
 
+	if (!*pos)
+		uid_delta_fold_all();
+
 	return &uid_hash_table[*pos];
 }
 
@@ -398,14 +565,10 @@ void cpufreq_acct_update_power(struct task_struct *p, u64 cputime)
 {
 	unsigned long flags;
 	unsigned int state;
-	unsigned int active_cpu_cnt = 0;
-	unsigned int policy_cpu_cnt = 0;
-	unsigned int policy_first_cpu;
-	struct uid_entry *uid_entry;
+	unsigned int active_cpu_cnt;
+	unsigned int policy_cpu_cnt;
 	struct cpu_freqs *freqs = all_freqs[task_cpu(p)];
-	struct cpufreq_policy *policy;
 	uid_t uid = from_kuid_munged(current_user_ns(), task_uid(p));
-	int cpu = 0;
 
 	if (!freqs || is_idle_task(p) || p->flags & PF_EXITING)
 		return;
@@ -418,47 +581,12 @@ void cpufreq_acct_update_power(struct task_struct *p, u64 cputime)
 		p->time_in_state[state] += cputime;
 	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
 
-	spin_lock_irqsave(&uid_lock, flags);
-	uid_entry = find_or_register_uid_locked(uid);
-	if (uid_entry && state < uid_entry->max_state)
-		uid_entry->time_in_state[state] += cputime;
-	spin_unlock_irqrestore(&uid_lock, flags);
+	/* The cpu running p is active even if it has not left idle yet */
+	active_cpu_cnt = max(nr_active_cpus(cpu_possible_mask), 1U);
+	policy_cpu_cnt = max(nr_active_cpus(&freqs->related_cpus), 1U);
 
-	rcu_read_lock();
-	uid_entry = find_uid_entry_rcu(uid);
-	if (!uid_entry) {
-		rcu_read_unlock();
-		return;
-	}
-
-	for_each_possible_cpu(cpu)
-		if (!idle_cpu(cpu))
-			++active_cpu_cnt;
-
-	atomic64_add(cputime,
-		     &uid_entry->concurrent_times->active[active_cpu_cnt - 1]);
-
-	policy = cpufreq_cpu_get(task_cpu(p));
-	if (!policy) {
-		/*
-		 * This CPU may have just come up and not have a cpufreq policy
-		 * yet.
-		 */
-		rcu_read_unlock();
-		return;
-	}
-
-	for_each_cpu(cpu, policy->related_cpus)
-		if (!idle_cpu(cpu))
-			++policy_cpu_cnt;
-
-	policy_first_cpu = cpumask_first(policy->related_cpus);
-	cpufreq_cpu_put(policy);
-
-	atomic64_add(cputime,
-		     &uid_entry->concurrent_times->policy[policy_first_cpu +
-							  policy_cpu_cnt - 1]);
-	rcu_read_unlock();
+	uid_delta_add(uid, state, active_cpu_cnt - 1,
+		      freqs->first_cpu + policy_cpu_cnt - 1, cputime);
 }
 
 static int cpufreq_times_get_index(struct cpu_freqs *freqs, unsigned int freq)
@@ -514,6 +642,9 @@ void cpufreq_times_create_policy(struct cpufreq_policy *policy)
 	if (index >= 0)
 		WRITE_ONCE(freqs->last_index, index);
 
+	freqs->first_cpu = cpumask_first(policy->related_cpus);
+	cpumask_copy(&freqs->related_cpus, policy->related_cpus);
+
 	freqs->offset = next_offset;
 	WRITE_ONCE(next_offset, freqs->offset + count);
 	for_each_cpu(cpu, policy->related_cpus)
@@ -534,6 +665,9 @@ void cpufreq_task_times_remove_uids(uid_t uid_start, uid_t uid_end)
 	struct hlist_node *tmp;
 	unsigned long flags;
 
+	/* Otherwise pending deltas would register the removed uids again */
+	uid_delta_fold_all();
+
 	spin_lock_irqsave(&uid_lock, flags);
 
 	for (; uid_start <= uid_end; uid_start++) {
@@ -627,6 +761,15 @@ static const struct file_operations concurrent_policy_time_fops = {
 
 static int __init cpufreq_times_init(void)
 {
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu(uid_delta_bufs, cpu).lock);
+
+#ifdef CONFIG_CPU_PM
+	cpu_pm_register_notifier(&cpufreq_times_cpu_pm_nb);
+#endif
+
 	proc_create_data("uid_time_in_state", 0444, NULL,
 			 &uid_time_in_state_fops, NULL);
 
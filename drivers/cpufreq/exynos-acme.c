@@ -21,6 +21,7 @@
 #include <linux/cpu_cooling.h>
 #include <linux/suspend.h>
 #include <linux/ems.h>
+#include <uapi/linux/sched/types.h>
 
 #include <soc/samsung/cal-if.h>
 #include <soc/samsung/ect_parser.h>
@@ -489,6 +490,9 @@ static int __exynos_cpufreq_suspend(struct exynos_cpufreq_domain *domain)
 	pm_qos_update_request(&domain->min_qos_req, freq);
 	pm_qos_update_request(&domain->max_qos_req, freq);
 
+	/* Requests queued so far must not scale after domain is disabled */
+	kthread_flush_work(&domain->qos_work);
+
 	/* To sync current freq with resume freq, check until they become same */
 	mutex_lock(&domain->lock);
 	while (domain->old > freq) {
@@ -651,6 +655,63 @@ static int need_update_freq(struct exynos_cpufreq_domain *domain,
 	return 1;
 }
 
+static void exynos_cpufreq_qos_work(struct kthread_work *work)
+{
+	struct exynos_cpufreq_domain *domain = container_of(work,
+			struct exynos_cpufreq_domain, qos_work);
+	unsigned long flags;
+	unsigned int cur, freq;
+	int qos_min, qos_max;
+	ktime_t req_time;
+	u32 latency;
+
+	/* Requests arriving from now on queue this work again */
+	spin_lock_irqsave(&domain->qos_req_lock, flags);
+	req_time = domain->qos_req_time;
+	domain->qos_req_pending = false;
+	spin_unlock_irqrestore(&domain->qos_req_lock, flags);
+
+	/*
+	 * All merged requests are served by scaling once to the current
+	 * PM QoS aggregate, max class has priority as in apply_pm_qos().
+	 */
+	qos_min = pm_qos_request(domain->pm_qos_min_class);
+	qos_max = pm_qos_request(domain->pm_qos_max_class);
+	if (qos_min >= 0 && qos_max >= 0) {
+		cur = get_freq(domain);
+		freq = max((unsigned int)qos_min, cur);
+		freq = min((unsigned int)qos_max, freq);
+
+		if (freq != cur)
+			update_freq(domain, freq);
+	}
+
+	latency = (u32)ktime_us_delta(ktime_get(), req_time);
+
+	spin_lock_irqsave(&domain->qos_req_lock, flags);
+	domain->qos_work_count++;
+	domain->qos_latency_sum += latency;
+	domain->qos_latency_max = max(domain->qos_latency_max, latency);
+	spin_unlock_irqrestore(&domain->qos_req_lock, flags);
+}
+
+static void queue_qos_request(struct exynos_cpufreq_domain *domain)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&domain->qos_req_lock, flags);
+	domain->qos_req_count++;
+	if (domain->qos_req_pending) {
+		domain->qos_merge_count++;
+	} else {
+		domain->qos_req_pending = true;
+		domain->qos_req_time = ktime_get();
+	}
+	spin_unlock_irqrestore(&domain->qos_req_lock, flags);
+
+	kthread_queue_work(&domain->qos_worker, &domain->qos_work);
+}
+
 static int exynos_cpufreq_pm_qos_callback(struct notifier_block *nb,
 					unsigned long val, void *v)
 {
@@ -677,14 +738,15 @@ static int exynos_cpufreq_pm_qos_callback(struct notifier_block *nb,
 	if (pm_qos_class == domain->pm_qos_max_class)
 		update_qos_capacity(cpumask_first(&domain->cpus), val, policy->cpuinfo.max_freq);
 
+	cpufreq_cpu_put(policy);
+
 	ret = need_update_freq(domain, pm_qos_class, val);
 	if (ret < 0)
 		return NOTIFY_BAD;
 	if (!ret)
 		return NOTIFY_OK;
 
-	if (update_freq(domain, val))
-		return NOTIFY_BAD;
+	queue_qos_request(domain);
 
 	return NOTIFY_OK;
 }
@@ -769,6 +831,7 @@ static int exynos_cpufreq_cpu_down_callback(unsigned int cpu)
 	cpumask_and(&mask, &domain->cpus, cpu_online_mask);
 	if (cpumask_weight(&mask) == 1) {
 		pm_qos_update_request(&domain->max_qos_req, domain->min_freq);
+		kthread_flush_work(&domain->qos_work);
 		disable_domain(domain);
 	}
 
@@ -986,6 +1049,35 @@ static struct kobj_attribute freqvar_idlelatency =
 __ATTR(freqvar_idlelatency, S_IRUGO | S_IWUSR,
 		show_freqvar_idlelatency, store_freqvar_idlelatency);
 
+static ssize_t show_cpufreq_qos_stat(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	struct exynos_cpufreq_domain *domain;
+	ssize_t count = 0;
+	unsigned long flags;
+	u64 avg;
+
+	count += snprintf(buf + count, PAGE_SIZE - count,
+			"domain  requests    merged     works  avg(us)  max(us)\n");
+
+	list_for_each_entry(domain, &domains, list) {
+		spin_lock_irqsave(&domain->qos_req_lock, flags);
+		avg = domain->qos_work_count ?
+			div64_u64(domain->qos_latency_sum, domain->qos_work_count) : 0;
+		count += snprintf(buf + count, PAGE_SIZE - count,
+				"%6u %9llu %9llu %9llu %8llu %8u\n",
+				domain->id, domain->qos_req_count,
+				domain->qos_merge_count, domain->qos_work_count,
+				avg, domain->qos_latency_max);
+		spin_unlock_irqrestore(&domain->qos_req_lock, flags);
+	}
+
+	return count;
+}
+
+static struct kobj_attribute cpufreq_qos_stat =
+__ATTR(cpufreq_qos_stat, S_IRUGO, show_cpufreq_qos_stat, NULL);
+
 
 /*********************************************************************
  *                  INITIALIZE EXYNOS CPUFREQ DRIVER                 *
@@ -1032,6 +1124,9 @@ static __init void init_sysfs(void)
 	if (sysfs_create_file(power_kobj, &freqvar_idlelatency.attr))
 		pr_err("failed to create freqvar_idlelatency node\n");
 
+	if (sysfs_create_file(power_kobj, &cpufreq_qos_stat.attr))
+		pr_err("failed to create cpufreq_qos_stat node\n");
+
 }
 
 static __init int init_table(struct exynos_cpufreq_domain *domain)
@@ -1128,6 +1223,37 @@ static __init void set_boot_qos(struct exynos_cpufreq_domain *domain)
 
 }
 
+static __init int init_qos_worker(struct exynos_cpufreq_domain *domain)
+{
+	struct sched_param param = { .sched_priority = MAX_USER_RT_PRIO / 2 };
+	struct task_struct *thread;
+	int ret;
+
+	spin_lock_init(&domain->qos_req_lock);
+	kthread_init_work(&domain->qos_work, exynos_cpufreq_qos_work);
+	kthread_init_worker(&domain->qos_worker);
+
+	thread = kthread_create(kthread_worker_fn, &domain->qos_worker,
+				"cpufreq_qos:%d", domain->id);
+	if (IS_ERR(thread)) {
+		pr_err("failed to create qos thread of domain%d: %ld\n",
+				domain->id, PTR_ERR(thread));
+		return PTR_ERR(thread);
+	}
+
+	ret = sched_setscheduler_nocheck(thread, SCHED_FIFO, &param);
+	if (ret) {
+		kthread_stop(thread);
+		pr_err("failed to set SCHED_FIFO of domain%d\n", domain->id);
+		return ret;
+	}
+
+	domain->qos_thread = thread;
+	wake_up_process(thread);
+
+	return 0;
+}
+
 static __init int init_pm_qos(struct exynos_cpufreq_domain *domain,
 					struct device_node *dn)
 {
@@ -1494,6 +1620,11 @@ static __init int init_domain(struct exynos_cpufreq_domain *domain,
 
 	domain->old = get_freq(domain);
 
+	/* PM QoS notifier queues requests to this worker */
+	ret = init_qos_worker(domain);
+	if (ret)
+		return ret;
+
 	/* Initialize PM QoS */
 	ret = init_pm_qos(domain, dn);
 	if (ret)
@@ -1551,6 +1682,11 @@ static __init void __free_domain(struct exynos_cpufreq_domain *domain)
 		kfree(dm);
 	}
 
+	if (domain->qos_thread) {
+		kthread_flush_worker(&domain->qos_worker);
+		kthread_stop(domain->qos_thread);
+	}
+
 	kfree(domain->freq_table);
 	kfree(domain);
 }
@@ -9,6 +9,7 @@
  */
 
 #include <linux/pm_qos.h>
+#include <linux/kthread.h>
 #include <soc/samsung/exynos-dm.h>
 #include "exynos-ufc.h"
 
@@ -73,6 +74,24 @@ struct exynos_cpufreq_domain {
 	struct notifier_block		pm_qos_min_notifier;
 	struct notifier_block		pm_qos_max_notifier;
 
+	/*
+	 * PM QoS requests are handed over to an RT kthread. Requests arriving
+	 * while one is pending are merged into it.
+	 */
+	struct kthread_worker		qos_worker;
+	struct kthread_work		qos_work;
+	struct task_struct		*qos_thread;
+	spinlock_t			qos_req_lock;
+	bool				qos_req_pending;
+	ktime_t				qos_req_time;
+
+	/* statistics of PM QoS requests */
+	u64				qos_req_count;
+	u64				qos_merge_count;
+	u64				qos_work_count;
+	u64				qos_latency_sum;	/* usec */
+	u32				qos_latency_max;	/* usec */
+
 	/* for sysfs */
 	int				user_boost;
 	unsigned int			user_default_qos;
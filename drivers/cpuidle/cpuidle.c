@@ -197,14 +197,15 @@ int cpuidle_enter_s2idle(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 }
 #endif /* CONFIG_SUSPEND */
 
+/* filled by the governors for the exynos cpuidle driver */
+DEFINE_PER_CPU(struct cpuidle_info, cpuidle_inf);
+
 /**
  * cpuidle_enter_state - enter the state and update stats
  * @dev: cpuidle device for this cpu
  * @drv: cpuidle driver for this cpu
  * @index: index into the states table in @drv of the state to enter
  */
-DECLARE_PER_CPU(struct cpuidle_info, cpuidle_inf);
-
 int cpuidle_enter_state(struct cpuidle_device *dev, struct cpuidle_driver *drv,
 			int index)
 {
@@ -192,7 +192,7 @@ static inline int performance_multiplier(unsigned long nr_iowaiters, unsigned lo
 }
 
 static DEFINE_PER_CPU(struct menu_device, menu_devices);
-DEFINE_PER_CPU(struct cpuidle_info, cpuidle_inf);
+DECLARE_PER_CPU(struct cpuidle_info, cpuidle_inf);
 
 static void menu_update(struct cpuidle_driver *drv, struct cpuidle_device *dev);
 
@@ -0,0 +1,428 @@
+/*
+ * teo.c - timer events oriented idle governor
+ *
+ * This code is licenced under the GPL version 2 as described
+ * in the COPYING file that acompanies the Linux Kernel.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos.h>
+#include <linux/ktime.h>
+#include <linux/tick.h>
+#include <linux/sched.h>
+#include <linux/cpu.h>
+
+/*
+ * Concepts behind the teo governor
+ *
+ * The menu governor scales the time till the next timer event by a
+ * correction factor, which works well as long as the cpu is woken up by
+ * timers. Wakeups by interrupts of devices and IPIs are not timers and the
+ * cpu ends up in a state that is too deep for them.
+ *
+ * The teo governor takes the time till the next timer event (the sleep
+ * length) as the upper bound of the idle duration and counts, for each
+ * idle state, how often the cpu actually stayed idle long enough for the
+ * state that matched the sleep length (hits) and how often it was woken up
+ * earlier (misses). For an early wakeup, the state that would have matched
+ * the measured idle duration gets an "early hit". If the misses of the
+ * state matching the sleep length outweigh its hits, the state with the
+ * most early hits is used instead.
+ *
+ * In addition, the idle durations of the last INTERVALS non-timer wakeups
+ * are kept. If most of them are shorter than the target residency of the
+ * selected state, the cpu is likely to be woken up early again and the
+ * average of them is used as the expected idle duration.
+ *
+ * The expected end of idle of each cpu is published, so that the platform
+ * code deciding cluster or system power modes can predict the idle
+ * duration of the whole power domain from the same history instead of the
+ * timer events only (see cpuidle_predicted_wakeup()).
+ */
+
+/*
+ * The metrics decay by 1/2^DECAY_SHIFT on every update and a hit or a miss
+ * adds PULSE, so they saturate at PULSE << DECAY_SHIFT.
+ */
+#define PULSE		1024
+#define DECAY_SHIFT	3
+
+/* number of recent non-timer idle durations kept for pattern detection */
+#define INTERVALS	8
+
+/**
+ * struct teo_idle_state - idle state data used by the teo governor
+ * @early_hits: wakeups that matched this state, but were earlier than the
+ *		state matching the sleep length
+ * @hits: wakeups that matched the sleep length and this state
+ * @misses: wakeups that matched the sleep length, but not this state
+ */
+struct teo_idle_state {
+	unsigned int early_hits;
+	unsigned int hits;
+	unsigned int misses;
+};
+
+/**
+ * struct teo_cpu - per-cpu data used by the teo governor
+ * @select_time: time of the last idle state selection
+ * @time_span_us: time between the idle state selection and the wakeup
+ * @sleep_length_us: time till the next timer event at the selection
+ * @predicted_end: expected end of the current idle period
+ * @states: idle state data
+ * @last_state: idle state entered by the cpu
+ * @interval_idx: index of the next slot of @intervals
+ * @intervals: recent idle durations of non-timer wakeups
+ * @tick_wakeup: the cpu was woken up by the tick
+ * @needs_update: the idle state data has to be updated on the next select
+ */
+struct teo_cpu {
+	ktime_t select_time;
+	unsigned int time_span_us;
+	unsigned int sleep_length_us;
+	ktime_t predicted_end;
+	struct teo_idle_state states[CPUIDLE_STATE_MAX];
+	int last_state;
+	int interval_idx;
+	unsigned int intervals[INTERVALS];
+	bool tick_wakeup;
+	bool needs_update;
+};
+
+static DEFINE_PER_CPU(struct teo_cpu, teo_cpus);
+
+/* filled the same way as by the menu governor for the exynos cpuidle driver */
+DECLARE_PER_CPU(struct cpuidle_info, cpuidle_inf);
+
+/**
+ * teo_update - update the idle state data after a wakeup
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ */
+static void teo_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
+{
+	struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, dev->cpu);
+	unsigned int sleep_length_us = cpu_data->sleep_length_us;
+	unsigned int measured_us;
+	bool timer_wakeup;
+	int i, idx_hit = -1, idx_timer = -1;
+
+	/*
+	 * The wakeup is regarded as a timer one if the cpu stayed idle till
+	 * the next timer event, or if it was the tick that was not stopped
+	 * because the sleep length was long enough.
+	 */
+	timer_wakeup = cpu_data->time_span_us >= sleep_length_us ||
+		       (cpu_data->tick_wakeup && sleep_length_us > TICK_USEC);
+
+	if (timer_wakeup) {
+		measured_us = sleep_length_us;
+	} else {
+		unsigned int lat = drv->states[cpu_data->last_state].exit_latency;
+
+		/*
+		 * The exit latency is not worst-case on every wakeup, take a
+		 * half of it as a rough approximation.
+		 */
+		measured_us = cpu_data->time_span_us;
+		if (measured_us >= lat)
+			measured_us -= lat / 2;
+		else
+			measured_us /= 2;
+	}
+
+	/*
+	 * Decay the early hits of all states and find the states matching
+	 * the sleep length and the measured idle duration.
+	 */
+	for (i = 0; i < drv->state_count; i++) {
+		struct teo_idle_state *s = &cpu_data->states[i];
+
+		s->early_hits -= s->early_hits >> DECAY_SHIFT;
+
+		if (drv->states[i].target_residency <= sleep_length_us) {
+			idx_timer = i;
+			if (drv->states[i].target_residency <= measured_us)
+				idx_hit = i;
+		}
+	}
+
+	if (idx_timer >= 0) {
+		struct teo_idle_state *s = &cpu_data->states[idx_timer];
+
+		s->hits -= s->hits >> DECAY_SHIFT;
+		s->misses -= s->misses >> DECAY_SHIFT;
+
+		if (idx_timer > idx_hit) {
+			s->misses += PULSE;
+			if (idx_hit >= 0)
+				cpu_data->states[idx_hit].early_hits += PULSE;
+		} else {
+			s->hits += PULSE;
+		}
+	}
+
+	/* timer wakeups are predictable, keep only the others as a pattern */
+	cpu_data->intervals[cpu_data->interval_idx++] =
+		timer_wakeup ? UINT_MAX : measured_us;
+	if (cpu_data->interval_idx >= INTERVALS)
+		cpu_data->interval_idx = 0;
+}
+
+/**
+ * teo_find_shallower_state - find the deepest state shallower than @idx
+ * that fits in @duration_us
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ * @idx: index of the state to start with
+ * @duration_us: expected idle duration
+ */
+static int teo_find_shallower_state(struct cpuidle_driver *drv,
+				    struct cpuidle_device *dev, int idx,
+				    unsigned int duration_us)
+{
+	int i;
+
+	for (i = idx - 1; i >= 0; i--) {
+		if (drv->states[i].disabled || dev->states_usage[i].disable)
+			continue;
+
+		idx = i;
+		if (drv->states[i].target_residency <= duration_us)
+			break;
+	}
+
+	return idx;
+}
+
+/**
+ * teo_select - selects the next idle state to enter
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ * @stop_tick: indication on whether or not to stop the tick
+ */
+static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
+		      bool *stop_tick)
+{
+	struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, dev->cpu);
+	struct cpuidle_info *idle_info = this_cpu_ptr(&cpuidle_inf);
+	struct device *device = get_cpu_device(dev->cpu);
+	int latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
+	int resume_latency = dev_pm_qos_raw_read_value(device);
+	unsigned int duration_us, hits, misses, early_hits;
+	int max_early_idx, constraint_idx, idx, i;
+	ktime_t delta_tick;
+
+	if (cpu_data->needs_update) {
+		teo_update(drv, dev);
+		cpu_data->needs_update = false;
+	}
+
+	/* resume_latency is 0 means no restriction */
+	if (resume_latency && resume_latency < latency_req)
+		latency_req = resume_latency;
+
+	cpu_data->select_time = ktime_get();
+	cpu_data->sleep_length_us =
+		ktime_to_us(tick_nohz_get_sleep_length(&delta_tick));
+	duration_us = cpu_data->sleep_length_us;
+
+	if (unlikely(latency_req == 0)) {
+		*stop_tick = false;
+		idle_info->bUse_GovDecision = 1;
+		cpu_data->predicted_end = cpu_data->select_time;
+		return 0;
+	}
+
+	hits = 0;
+	misses = 0;
+	early_hits = 0;
+	max_early_idx = -1;
+	constraint_idx = drv->state_count;
+	idx = -1;
+
+	for (i = 0; i < drv->state_count; i++) {
+		struct cpuidle_state *s = &drv->states[i];
+		struct cpuidle_state_usage *su = &dev->states_usage[i];
+
+		if (s->disabled || su->disable)
+			continue;
+
+		if (idx < 0)
+			idx = i; /* first enabled state */
+
+		if (s->target_residency > duration_us)
+			break;
+
+		if (s->exit_latency > latency_req && constraint_idx > i)
+			constraint_idx = i;
+
+		idx = i;
+		hits = cpu_data->states[i].hits;
+		misses = cpu_data->states[i].misses;
+
+		/*
+		 * With the tick already stopped, a state shallower than the
+		 * tick may keep the cpu in it for a long time, don't prefer it.
+		 */
+		if (early_hits < cpu_data->states[i].early_hits &&
+		    !(tick_nohz_tick_stopped() && s->target_residency < TICK_USEC)) {
+			early_hits = cpu_data->states[i].early_hits;
+			max_early_idx = i;
+		}
+	}
+
+	/*
+	 * If the state matching the sleep length missed more often than it
+	 * hit, the cpu is likely to be woken up early and the state that
+	 * matched the early wakeups most often is a better choice.
+	 */
+	if (hits <= misses && max_early_idx >= 0) {
+		idx = max_early_idx;
+		duration_us = drv->states[idx].target_residency;
+	}
+
+	if (constraint_idx < idx)
+		idx = constraint_idx;
+
+	if (idx < 0) {
+		idx = 0; /* No states enabled. Must use 0. */
+	} else if (idx > 0) {
+		unsigned int count = 0, sum = 0;
+
+		/*
+		 * If most of the recent non-timer wakeups came earlier than
+		 * the target residency of the selected state, expect the
+		 * average of them.
+		 */
+		for (i = 0; i < INTERVALS; i++) {
+			unsigned int val = cpu_data->intervals[i];
+
+			if (val >= drv->states[idx].target_residency)
+				continue;
+
+			count++;
+			sum += val;
+		}
+
+		if (count > INTERVALS / 2) {
+			duration_us = sum / count;
+			idx = teo_find_shallower_state(drv, dev, idx, duration_us);
+		}
+	}
+
+	idle_info->predicted_us = duration_us;
+	idle_info->latency_req = latency_req;
+	idle_info->bfirst_idx = 0;
+	idle_info->bUse_GovDecision = 0;
+
+	/*
+	 * Don't stop the tick if the selected state is a polling one or if the
+	 * expected idle duration is shorter than the tick period length.
+	 */
+	if (((drv->states[idx].flags & CPUIDLE_FLAG_POLLING) ||
+	     duration_us < TICK_USEC) && !tick_nohz_tick_stopped()) {
+		unsigned int delta_tick_us = ktime_to_us(delta_tick);
+
+		*stop_tick = false;
+
+		/*
+		 * The tick is not going to be stopped, so the state must fit
+		 * in the time till the tick.
+		 */
+		if (idx > 0 && drv->states[idx].target_residency > delta_tick_us) {
+			idle_info->bUse_GovDecision = 1;
+			idx = teo_find_shallower_state(drv, dev, idx, delta_tick_us);
+		}
+	}
+
+	cpu_data->predicted_end = ktime_add_us(cpu_data->select_time,
+			min(duration_us, cpu_data->sleep_length_us));
+
+	return idx;
+}
+
+/**
+ * teo_reflect - records that data structures need update
+ * @dev: the CPU
+ * @index: the index of actual entered state
+ */
+static void teo_reflect(struct cpuidle_device *dev, int index)
+{
+	struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, dev->cpu);
+
+	cpu_data->last_state = index;
+	cpu_data->needs_update = true;
+	cpu_data->tick_wakeup = tick_nohz_idle_got_tick();
+	cpu_data->time_span_us =
+		ktime_to_us(ktime_sub(ktime_get(), cpu_data->select_time));
+}
+
+/**
+ * cpuidle_predicted_wakeup - expected end of idle of a cpu
+ * @cpu: the CPU
+ *
+ * Returns the time the cpu is expected to be woken up at, taking the recent
+ * non-timer wakeups into account, or KTIME_MAX if the teo governor does not
+ * drive the cpu. The value is only meaningful while the cpu is idle.
+ */
+ktime_t cpuidle_predicted_wakeup(int cpu)
+{
+	return READ_ONCE(per_cpu(teo_cpus, cpu).predicted_end);
+}
+
+/**
+ * teo_enable_device - initialize the governor's data for the CPU
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static int teo_enable_device(struct cpuidle_driver *drv,
+			     struct cpuidle_device *dev)
+{
+	struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, dev->cpu);
+	int i;
+
+	memset(cpu_data, 0, sizeof(*cpu_data));
+	cpu_data->predicted_end = KTIME_MAX;
+
+	for (i = 0; i < INTERVALS; i++)
+		cpu_data->intervals[i] = UINT_MAX;
+
+	return 0;
+}
+
+/**
+ * teo_disable_device - stop publishing predictions for the CPU
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static void teo_disable_device(struct cpuidle_driver *drv,
+			       struct cpuidle_device *dev)
+{
+	WRITE_ONCE(per_cpu(teo_cpus, dev->cpu).predicted_end, KTIME_MAX);
+}
+
+static struct cpuidle_governor teo_governor = {
+	.name =		"teo",
+	.rating =	30,
+	.enable =	teo_enable_device,
+	.disable =	teo_disable_device,
+	.select =	teo_select,
+	.reflect =	teo_reflect,
+};
+
+/**
+ * teo_governor_init - initializes the governor
+ */
+static int __init teo_governor_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		per_cpu(teo_cpus, cpu).predicted_end = KTIME_MAX;
+
+	return cpuidle_register_governor(&teo_governor);
+}
+
+postcore_initcall(teo_governor_init);
@@ -31,6 +31,12 @@ struct cpuidle_stats {
 	/* number of times the entry into idle state is canceled */
 	unsigned int		cancel_count;
 
+	/*
+	 * number of times idle state is exited before its target residency,
+	 * the entry was mispredicted and cost more energy than it saved
+	 */
+	unsigned int		early_count;
+
 	/* time in idle state */
 	unsigned long long	time;
 };
@@ -47,6 +53,9 @@ struct cpu_idle_state {
 	/* description of idle state */
 	char 			desc[DESC_LEN];
 
+	/* minimum residency to break even on entry and exit */
+	unsigned int		target_residency;
+
 	/* idle state statstics for each cpu */
 	struct cpuidle_stats	stats[NR_CPUS];
 };
@@ -66,6 +75,9 @@ struct group_idle_state {
 	/* description of idle state */
 	char 			desc[DESC_LEN];
 
+	/* minimum residency to break even on entry and exit */
+	unsigned int		target_residency;
+
 	/* idle state statstics */
 	struct cpuidle_stats	stats;
 };
@@ -90,7 +102,8 @@ static void idle_enter(struct cpuidle_stats *stats)
 	stats->entry_count++;
 }
 
-static void idle_exit(struct cpuidle_stats *stats, int cancel)
+static void idle_exit(struct cpuidle_stats *stats, int cancel,
+		      unsigned int target_residency)
 {
 	s64 diff;
 
@@ -112,6 +125,9 @@ static void idle_exit(struct cpuidle_stats *stats, int cancel)
 	diff = ktime_to_us(ktime_sub(ktime_get(), stats->idle_entry_time));
 	stats->time += diff;
 
+	if (diff < target_residency)
+		stats->early_count++;
+
 	stats->idle_entry_time = 0;
 }
 
@@ -134,7 +150,8 @@ void cpuidle_profile_cpu_idle_exit(int cpu, int index, int cancel)
 		return;
 
 	exynos_perf_cpu_idle_exit(cpu, index, cancel);
-	idle_exit(&cpu_idle_state[index].stats[cpu], cancel);
+	idle_exit(&cpu_idle_state[index].stats[cpu], cancel,
+		  cpu_idle_state[index].target_residency);
 }
 
 /*
@@ -166,7 +183,36 @@ void cpuidle_profile_group_idle_exit(int id, int cancel)
 		if (group_idle_state[i]->id == id)
 			break;
 
-	idle_exit(&group_idle_state[i]->stats, cancel);
+	idle_exit(&group_idle_state[i]->stats, cancel,
+		  group_idle_state[i]->target_residency);
+}
+
+/*
+ * cpuidle_profile_cpupm_enter
+ * : profile for latency of power mode decision on idle entry
+ */
+struct cpupm_enter_stats {
+	/* number of idle entries */
+	unsigned int		count;
+
+	/* sum and maximum of latency in cycles */
+	unsigned long long	cycles;
+	unsigned long long	max_cycles;
+};
+
+static struct cpupm_enter_stats cpupm_enter_stats[NR_CPUS];
+
+void cpuidle_profile_cpupm_enter(int cpu, u64 cycles)
+{
+	struct cpupm_enter_stats *stats = &cpupm_enter_stats[cpu];
+
+	if (!profile_started)
+		return;
+
+	stats->count++;
+	stats->cycles += cycles;
+	if (stats->max_cycles < cycles)
+		stats->max_cycles = cycles;
 }
 
 /************************************************************************
@@ -191,6 +237,7 @@ static void clear_stats(struct cpuidle_stats *stats)
 
 	stats->entry_count = 0;
 	stats->cancel_count = 0;
+	stats->early_count = 0;
 	stats->time = 0;
 }
 
@@ -208,6 +255,7 @@ static void reset_profile(void)
 		clear_stats(&group_idle_state[i]->stats);
 
 	memset(idle_ip_stats, 0, sizeof(idle_ip_stats));
+	memset(cpupm_enter_stats, 0, sizeof(cpupm_enter_stats));
 }
 
 static void do_nothing(void *unused)
@@ -349,25 +397,26 @@ static ssize_t show_result(struct kobject *kobj,
 	 * rows depends on the number of cpu.
 	 *
 	 * [state : {desc}]
-	 * #cpu   #entry   #cancel      #time    #ratio
-	 * cpu0     985        8      8808916us    87%
-	 * cpu1     340        2      8311318us    82%
-	 * cpu2     270        7      8744801us    87%
-	 * cpu3     330        2      9001329us    89%
+	 * #cpu   #entry   #cancel   #early      #time    #ratio
+	 * cpu0     985        8       31      8808916us    87%
+	 * cpu1     340        2       12      8311318us    82%
+	 * cpu2     270        7       20      8744801us    87%
+	 * cpu3     330        2        9      9001329us    89%
 	 */
 	for (i = 0; i < cpu_idle_state_count; i++) {
 		ret += snprintf(buf + ret, PAGE_SIZE - ret,
 			"[state : %s]\n", cpu_idle_state[i].desc);
 		ret += snprintf(buf + ret, PAGE_SIZE - ret,
-			"#cpu   #entry   #cancel      #time    #ratio\n");
+			"#cpu   #entry   #cancel   #early      #time    #ratio\n");
 		for_each_possible_cpu(cpu) {
 			struct cpuidle_stats *stats = &cpu_idle_state[i].stats[cpu];
 
 			ret += snprintf(buf + ret, PAGE_SIZE - ret,
-				"cpu%d   %5u    %5u   %10lluus   %3u%%\n",
+				"cpu%d   %5u    %5u    %5u   %10lluus   %3u%%\n",
 				cpu,
 				stats->entry_count,
 				stats->cancel_count,
+				stats->early_count,
 				stats->time,
 				calculate_percent(stats->time));
 		}
@@ -381,12 +430,12 @@ static ssize_t show_result(struct kobject *kobj,
 	 * The number of results depends on the number of group idle state.
 	 *
 	 * [state : {desc}]
-	 * #entry   #cancel      #time    #ratio
-	 *   52        1       4296397us    42%
+	 * #entry   #cancel   #early      #time    #ratio
+	 *   52        1        4      4296397us    42%
 	 *
 	 * [state : {desc}]
-	 * #entry   #cancel      #time    #ratio
-	 *    20        0      2230528us    22%
+	 * #entry   #cancel   #early      #time    #ratio
+	 *    20        0        1     2230528us    22%
 	 */
 	for (i = 0; i < group_idle_state_count; i++) {
 		struct cpuidle_stats *stats = &group_idle_state[i]->stats;
@@ -394,11 +443,12 @@ static ssize_t show_result(struct kobject *kobj,
 		ret += snprintf(buf + ret, PAGE_SIZE - ret,
 			"[state : %s]\n", group_idle_state[i]->desc);
 		ret += snprintf(buf + ret, PAGE_SIZE - ret,
-			"#entry   #cancel      #time    #ratio\n");
+			"#entry   #cancel   #early      #time    #ratio\n");
 		ret += snprintf(buf + ret, PAGE_SIZE - ret,
-			"%5u    %5u   %10lluus   %3u%%\n",
+			"%5u    %5u    %5u   %10lluus   %3u%%\n",
 			stats->entry_count,
 			stats->cancel_count,
+			stats->early_count,
 			stats->time,
 			calculate_percent(stats->time));
 
@@ -406,6 +456,32 @@ static ssize_t show_result(struct kobject *kobj,
 				"\n");
 	}
 
+	/*
+	 * Example of power mode decision latency profile result.
+	 *
+	 * [cpupm entry latency]
+	 * #cpu   #entry   #avg(cycles)   #max(cycles)
+	 * cpu0     985          142           2310
+	 */
+	ret += snprintf(buf + ret, PAGE_SIZE - ret,
+		"[cpupm entry latency]\n");
+	ret += snprintf(buf + ret, PAGE_SIZE - ret,
+		"#cpu   #entry   #avg(cycles)   #max(cycles)\n");
+	for_each_possible_cpu(cpu) {
+		struct cpupm_enter_stats *stats = &cpupm_enter_stats[cpu];
+		unsigned long long avg = stats->cycles;
+
+		if (stats->count)
+			do_div(avg, stats->count);
+
+		ret += snprintf(buf + ret, PAGE_SIZE - ret,
+			"cpu%d   %5u    %10llu     %10llu\n",
+			cpu, stats->count, avg, stats->max_cycles);
+	}
+
+	ret += snprintf(buf + ret, PAGE_SIZE - ret,
+			"\n");
+
 	ret += snprintf(buf + ret, PAGE_SIZE - ret, "[IDLE-IP statistics]\n");
 	for (i = 0; i < 4; i++) {
 		for (bit = 0; bit < 32; bit++) {
@@ -488,8 +564,10 @@ cpuidle_profile_cpu_idle_register(struct cpuidle_driver *drv)
 		return;
 	}
 
-	for (i = 0; i < state_count; i++)
+	for (i = 0; i < state_count; i++) {
 		strncpy(state[i].desc, drv->states[i].desc, DESC_LEN - 1);
+		state[i].target_residency = drv->states[i].target_residency;
+	}
 
 	cpu_idle_state = state;
 	cpu_idle_state_count = state_count;
@@ -498,7 +576,8 @@ cpuidle_profile_cpu_idle_register(struct cpuidle_driver *drv)
 }
 
 void __init
-cpuidle_profile_group_idle_register(int id, const char *name)
+cpuidle_profile_group_idle_register(int id, const char *name,
+				    unsigned int target_residency)
 {
 	struct group_idle_state *state;
 
@@ -510,6 +589,7 @@ cpuidle_profile_group_idle_register(int id, const char *name)
 
 	state->id = id;
 	strncpy(state->desc, name, DESC_LEN - 1);
+	state->target_residency = target_residency;
 
 	group_idle_state[group_idle_state_count] = state;
 	group_idle_state_count++;
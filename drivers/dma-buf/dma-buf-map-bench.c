@@ -0,0 +1,302 @@
+/*
+ * Copyright(C) 2026 Samsung Electronics Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the mapping cache of dma-buf attachments.
+ *
+ * A software exporter backs a buffer with pages of the page allocator and
+ * maps it the way simple exporters do: it builds an sg_table of the pages
+ * and maps it with dma_map_sg() for the attached device. Reading
+ * dma_buf/map_bench in debugfs exports such a buffer with and without
+ * &dma_buf_ops.cache_sgt_mapping, maps and unmaps every attachment once per
+ * frame, and reports the average time of a frame for both.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-mapping.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+/* dma_buf_debugfs_dir is defined in dma-buf.c */
+extern struct dentry *dma_buf_debugfs_dir;
+
+/* 8MiB, a 1080p ARGB frame rounded up */
+static unsigned int nr_pages = 2048;
+module_param(nr_pages, uint, 0644);
+MODULE_PARM_DESC(nr_pages, "number of pages of the buffer");
+
+static unsigned int nr_frames = 1000;
+module_param(nr_frames, uint, 0644);
+MODULE_PARM_DESC(nr_frames, "number of frames to map and unmap");
+
+static unsigned int nr_importers = 2;
+module_param(nr_importers, uint, 0644);
+MODULE_PARM_DESC(nr_importers, "number of attachments of the buffer");
+
+#define BENCH_MAX_IMPORTERS	8
+
+struct bench_buffer {
+	unsigned int nr_pages;
+	struct page **pages;
+};
+
+static struct platform_device *bench_pdev;
+static DEFINE_MUTEX(bench_lock);
+
+static struct sg_table *bench_map_dma_buf(struct dma_buf_attachment *attach,
+					  enum dma_data_direction dir)
+{
+	struct bench_buffer *buffer = attach->dmabuf->priv;
+	struct sg_table *sgt;
+	int ret;
+
+	sgt = kmalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	ret = sg_alloc_table_from_pages(sgt, buffer->pages, buffer->nr_pages,
+					0, attach->dmabuf->size, GFP_KERNEL);
+	if (ret)
+		goto err_free;
+
+	if (!dma_map_sg(attach->dev, sgt->sgl, sgt->nents, dir)) {
+		ret = -ENOMEM;
+		goto err_table;
+	}
+
+	return sgt;
+
+err_table:
+	sg_free_table(sgt);
+err_free:
+	kfree(sgt);
+	return ERR_PTR(ret);
+}
+
+static void bench_unmap_dma_buf(struct dma_buf_attachment *attach,
+				struct sg_table *sgt,
+				enum dma_data_direction dir)
+{
+	dma_unmap_sg(attach->dev, sgt->sgl, sgt->nents, dir);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void bench_free_buffer(struct bench_buffer *buffer)
+{
+	unsigned int i;
+
+	for (i = 0; i < buffer->nr_pages; i++)
+		__free_page(buffer->pages[i]);
+	kvfree(buffer->pages);
+	kfree(buffer);
+}
+
+static void bench_release(struct dma_buf *dmabuf)
+{
+	bench_free_buffer(dmabuf->priv);
+}
+
+static void *bench_map(struct dma_buf *dmabuf, unsigned long page_num)
+{
+	return NULL;
+}
+
+static int bench_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
+{
+	return -EINVAL;
+}
+
+static const struct dma_buf_ops bench_ops = {
+	.map_dma_buf = bench_map_dma_buf,
+	.unmap_dma_buf = bench_unmap_dma_buf,
+	.release = bench_release,
+	.map_atomic = bench_map,
+	.map = bench_map,
+	.mmap = bench_mmap,
+};
+
+static const struct dma_buf_ops bench_cached_ops = {
+	.cache_sgt_mapping = true,
+	.map_dma_buf = bench_map_dma_buf,
+	.unmap_dma_buf = bench_unmap_dma_buf,
+	.release = bench_release,
+	.map_atomic = bench_map,
+	.map = bench_map,
+	.mmap = bench_mmap,
+};
+
+static struct dma_buf *bench_export(const struct dma_buf_ops *ops,
+				    unsigned int pages)
+{
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct bench_buffer *buffer;
+	struct dma_buf *dmabuf;
+	unsigned int i;
+
+	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
+	if (!buffer)
+		return ERR_PTR(-ENOMEM);
+
+	buffer->pages = kvmalloc_array(pages, sizeof(*buffer->pages),
+				       GFP_KERNEL);
+	if (!buffer->pages) {
+		kfree(buffer);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	for (i = 0; i < pages; i++) {
+		buffer->pages[i] = alloc_page(GFP_KERNEL);
+		if (!buffer->pages[i])
+			break;
+		buffer->nr_pages++;
+	}
+
+	exp_info.ops = ops;
+	exp_info.size = (size_t)buffer->nr_pages << PAGE_SHIFT;
+	exp_info.flags = O_RDWR;
+	exp_info.priv = buffer;
+
+	if (buffer->nr_pages < pages)
+		dmabuf = ERR_PTR(-ENOMEM);
+	else
+		dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf))
+		bench_free_buffer(buffer);
+
+	return dmabuf;
+}
+
+/* Returns the average time of a frame in ns, or a negative error */
+static s64 bench_run(const struct dma_buf_ops *ops, unsigned int pages,
+		     unsigned int frames, unsigned int importers)
+{
+	struct dma_buf_attachment *attach[BENCH_MAX_IMPORTERS];
+	struct sg_table *sgt;
+	struct dma_buf *dmabuf;
+	unsigned int frame, i, nr_attached = 0;
+	ktime_t start;
+	s64 ret = 0;
+
+	dmabuf = bench_export(ops, pages);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	for (i = 0; i < importers; i++) {
+		attach[i] = dma_buf_attach(dmabuf, &bench_pdev->dev);
+		if (IS_ERR(attach[i])) {
+			ret = PTR_ERR(attach[i]);
+			goto out;
+		}
+		nr_attached++;
+	}
+
+	start = ktime_get();
+	for (frame = 0; frame < frames; frame++) {
+		for (i = 0; i < nr_attached; i++) {
+			sgt = dma_buf_map_attachment(attach[i], DMA_TO_DEVICE);
+			if (IS_ERR(sgt)) {
+				ret = PTR_ERR(sgt);
+				goto out;
+			}
+			dma_buf_unmap_attachment(attach[i], sgt, DMA_TO_DEVICE);
+		}
+	}
+	ret = div_s64(ktime_to_ns(ktime_sub(ktime_get(), start)), frames);
+out:
+	for (i = 0; i < nr_attached; i++)
+		dma_buf_detach(dmabuf, attach[i]);
+	dma_buf_put(dmabuf);
+
+	return ret;
+}
+
+static int bench_show(struct seq_file *s, void *unused)
+{
+	/* the parameters can be changed while the benchmark runs */
+	unsigned int pages = READ_ONCE(nr_pages);
+	unsigned int frames = READ_ONCE(nr_frames);
+	unsigned int importers = READ_ONCE(nr_importers);
+	s64 uncached, cached;
+
+	if (!pages || !frames || !importers ||
+	    importers > BENCH_MAX_IMPORTERS)
+		return -EINVAL;
+
+	mutex_lock(&bench_lock);
+	uncached = bench_run(&bench_ops, pages, frames, importers);
+	cached = bench_run(&bench_cached_ops, pages, frames, importers);
+	mutex_unlock(&bench_lock);
+
+	if (uncached < 0)
+		return uncached;
+	if (cached < 0)
+		return cached;
+
+	seq_printf(s, "%u pages, %u importers, %u frames\n",
+		   pages, importers, frames);
+	seq_printf(s, "map/unmap per frame: %lld ns\n", uncached);
+	seq_printf(s, "cached mapping per frame: %lld ns\n", cached);
+
+	return 0;
+}
+
+static int bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bench_show, NULL);
+}
+
+static const struct file_operations bench_fops = {
+	.open		= bench_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dma_buf_map_bench_init(void)
+{
+	struct dentry *d;
+	struct platform_device_info pdevinfo = {
+		.name = "dma-buf-map-bench",
+		.id = -1,
+		.dma_mask = DMA_BIT_MASK(36),
+	};
+
+	if (!dma_buf_debugfs_dir)
+		return -ENODEV;
+
+	bench_pdev = platform_device_register_full(&pdevinfo);
+	if (IS_ERR(bench_pdev))
+		return PTR_ERR(bench_pdev);
+
+	arch_setup_dma_ops(&bench_pdev->dev, 0, 1ULL << 36, NULL, false);
+
+	d = debugfs_create_file("map_bench", 0400,
+				dma_buf_debugfs_dir, NULL, &bench_fops);
+	if (IS_ERR_OR_NULL(d)) {
+		platform_device_unregister(bench_pdev);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+late_initcall(dma_buf_map_bench_init);
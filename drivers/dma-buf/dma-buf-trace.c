@@ -24,6 +24,8 @@
 #include <linux/debugfs.h>
 #include <linux/dma-buf.h>
 #include <linux/anon_inodes.h>
+#include <linux/hashtable.h>
+#include <linux/rculist.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/mm.h>
 #include <linux/ion_exynos.h>
@@ -31,9 +33,26 @@
 
 #include "dma-buf-trace.h"
 
+/*
+ * The memtrack flags and type of a buffer never change and they have only a
+ * few combinations, called classes here. Every task keeps the sum of the
+ * proportional sizes of its buffers per class so that a memtrack query does
+ * not need to walk the buffers of the task.
+ */
+#define DMABUF_TRACE_CLASS_DEDICATED	BIT(0)
+#define DMABUF_TRACE_CLASS_SECURE	BIT(1)
+#define DMABUF_TRACE_CLASS_GRAPHICS	BIT(2)
+#define DMABUF_TRACE_CLASS_UNKNOWN	BIT(3)	/* no flags from the exporter */
+#define DMABUF_TRACE_NR_CLASS		(DMABUF_TRACE_CLASS_UNKNOWN + 1)
+
+#define DMABUF_TRACE_REF_HASH_BITS	6
+#define DMABUF_TRACE_TASK_HASH_BITS	7
+#define DMABUF_TRACE_BUFFER_HASH_BITS	10
+
 struct dmabuf_trace_ref {
 	struct list_head task_node;
 	struct list_head buffer_node;
+	struct hlist_node hash_node;
 
 	struct dmabuf_trace_task *task;
 	struct dmabuf_trace_buffer *buffer;
@@ -43,21 +62,36 @@ struct dmabuf_trace_ref {
 struct dmabuf_trace_task {
 	struct list_head node;
 	struct list_head ref_list;
+	struct hlist_node hash_node;
+	struct rcu_head rcu;
+
+	DECLARE_HASHTABLE(ref_hash, DMABUF_TRACE_REF_HASH_BITS);
+	unsigned long size[DMABUF_TRACE_NR_CLASS];
 
+	pid_t pid;
 	struct task_struct *task;
 	struct file *file;
 	struct dentry *debug_task;
 };
 
 struct dmabuf_trace_buffer {
-	struct list_head node;
+	struct hlist_node hash_node;
 	struct list_head ref_list;
 
 	struct dma_buf *dmabuf;
 	int shared_count;
+	unsigned int class;
 };
 
-static struct list_head buffer_list = LIST_HEAD_INIT(buffer_list);
+/*
+ * The buffers are hashed by dma_buf and the tasks by the pid of the group
+ * leader. Both are updated under trace_lock. The memtrack query looks up the
+ * task under RCU and reads its per-class sizes without taking trace_lock.
+ */
+static DEFINE_HASHTABLE(buffer_hash, DMABUF_TRACE_BUFFER_HASH_BITS);
+static DEFINE_HASHTABLE(task_hash, DMABUF_TRACE_TASK_HASH_BITS);
+
+static unsigned int dmabuf_trace_get_class(struct dma_buf *dmabuf);
 
 /*
  * head_task.node is the head node of all other dmabuf_trace_task.node.
@@ -162,12 +196,55 @@ static int dmabuf_trace_init_debugfs(void)
 }
 #endif
 
+/*
+ * Adds (or removes if @sign is negative) the share of @buffer to all tasks
+ * referencing it. It is called before and after the shared count changes.
+ */
+static void dmabuf_trace_account(struct dmabuf_trace_buffer *buffer, int sign)
+{
+	struct dmabuf_trace_ref *ref;
+	unsigned long share;
+
+	if (!buffer->shared_count)
+		return;
+
+	share = buffer->dmabuf->size / buffer->shared_count;
+
+	list_for_each_entry(ref, &buffer->ref_list, buffer_node) {
+		unsigned long *size = &ref->task->size[buffer->class];
+
+		WRITE_ONCE(*size, sign > 0 ? *size + share : *size - share);
+	}
+}
+
+static void dmabuf_trace_link_ref(struct dmabuf_trace_ref *ref)
+{
+	struct dmabuf_trace_buffer *buffer = ref->buffer;
+
+	dmabuf_trace_account(buffer, -1);
+
+	list_add_tail(&ref->task_node, &ref->task->ref_list);
+	list_add_tail(&ref->buffer_node, &buffer->ref_list);
+	hash_add(ref->task->ref_hash, &ref->hash_node, (unsigned long)buffer);
+
+	buffer->shared_count++;
+
+	dmabuf_trace_account(buffer, 1);
+}
+
 static void dmabuf_trace_free_ref_force(struct dmabuf_trace_ref *ref)
 {
-	ref->buffer->shared_count--;
+	struct dmabuf_trace_buffer *buffer = ref->buffer;
+
+	dmabuf_trace_account(buffer, -1);
+
+	buffer->shared_count--;
 
 	list_del(&ref->buffer_node);
 	list_del(&ref->task_node);
+	hash_del(&ref->hash_node);
+
+	dmabuf_trace_account(buffer, 1);
 
 	kfree(ref);
 }
@@ -205,12 +282,13 @@ static int dmabuf_trace_task_release(struct inode *inode, struct file *file)
 		dmabuf_trace_free_ref_force(ref);
 
 	list_del(&task->node);
+	hash_del_rcu(&task->hash_node);
 
 	mutex_unlock(&trace_lock);
 
 	dmabuf_trace_remove_debugfs(task);
 
-	kfree(task);
+	kfree_rcu(task, rcu);
 
 	return 0;
 }
@@ -224,7 +302,8 @@ static struct dmabuf_trace_buffer *dmabuf_trace_get_buffer(
 {
 	struct dmabuf_trace_buffer *buffer;
 
-	list_for_each_entry(buffer, &buffer_list, node)
+	hash_for_each_possible(buffer_hash, buffer, hash_node,
+			       (unsigned long)dmabuf)
 		if (buffer->dmabuf == dmabuf)
 			return buffer;
 
@@ -247,7 +326,8 @@ static struct dmabuf_trace_task *dmabuf_trace_get_task_noalloc(void)
 	if (current->group_leader->pid == 1)
 		return &head_task;
 
-	list_for_each_entry(task, &head_task.node, node)
+	hash_for_each_possible(task_hash, task, hash_node,
+			       current->group_leader->pid)
 		if (task->task == current->group_leader)
 			return task;
 
@@ -270,12 +350,14 @@ static struct dmabuf_trace_task *dmabuf_trace_get_task(void)
 
 	INIT_LIST_HEAD(&task->node);
 	INIT_LIST_HEAD(&task->ref_list);
+	hash_init(task->ref_hash);
 
 	scnprintf(name, 10, "%d", current->group_leader->pid);
 
 	get_task_struct(current->group_leader);
 
 	task->task = current->group_leader;
+	task->pid = current->group_leader->pid;
 
 	ret = dmabuf_trace_create_debugfs(task, name);
 	if (ret)
@@ -297,6 +379,7 @@ static struct dmabuf_trace_task *dmabuf_trace_get_task(void)
 	fd_install(fd, task->file);
 
 	list_add_tail(&task->node, &head_task.node);
+	hash_add_rcu(task_hash, &task->hash_node, task->pid);
 
 	return task;
 
@@ -321,7 +404,8 @@ static struct dmabuf_trace_ref *dmabuf_trace_get_ref_noalloc(
 {
 	struct dmabuf_trace_ref *ref;
 
-	list_for_each_entry(ref, &task->ref_list, task_node)
+	hash_for_each_possible(task->ref_hash, ref, hash_node,
+			       (unsigned long)buffer)
 		if (ref->buffer == buffer)
 			return ref;
 
@@ -344,17 +428,11 @@ static struct dmabuf_trace_ref *dmabuf_trace_get_ref(
 	if (!ref)
 		return ERR_PTR(-ENOMEM);
 
-	INIT_LIST_HEAD(&ref->buffer_node);
-	INIT_LIST_HEAD(&ref->task_node);
-
 	ref->task = task;
 	ref->buffer = buffer;
 	ref->refcount = 1;
 
-	list_add_tail(&ref->task_node, &task->ref_list);
-	list_add_tail(&ref->buffer_node, &buffer->ref_list);
-
-	buffer->shared_count++;
+	dmabuf_trace_link_ref(ref);
 
 	return ref;
 }
@@ -379,9 +457,10 @@ int dmabuf_trace_alloc(struct dma_buf *dmabuf)
 
 	INIT_LIST_HEAD(&buffer->ref_list);
 	buffer->dmabuf = dmabuf;
+	buffer->class = dmabuf_trace_get_class(dmabuf);
 
 	mutex_lock(&trace_lock);
-	list_add_tail(&buffer->node, &buffer_list);
+	hash_add(buffer_hash, &buffer->hash_node, (unsigned long)dmabuf);
 	mutex_unlock(&trace_lock);
 
 	ref = kzalloc(sizeof(*ref), GFP_KERNEL);
@@ -412,10 +491,7 @@ int dmabuf_trace_alloc(struct dma_buf *dmabuf)
 	}
 	ref->task = task;
 
-	list_add_tail(&ref->task_node, &task->ref_list);
-	list_add_tail(&ref->buffer_node, &buffer->ref_list);
-
-	buffer->shared_count++;
+	dmabuf_trace_link_ref(ref);
 
 	mutex_unlock(&trace_lock);
 
@@ -441,10 +517,15 @@ void dmabuf_trace_free(struct dma_buf *dmabuf)
 		return;
 	}
 
-	list_for_each_entry_safe(ref, tmp, &buffer->ref_list, buffer_node)
-		dmabuf_trace_free_ref_force(ref);
+	dmabuf_trace_account(buffer, -1);
+
+	list_for_each_entry_safe(ref, tmp, &buffer->ref_list, buffer_node) {
+		list_del(&ref->task_node);
+		hash_del(&ref->hash_node);
+		kfree(ref);
+	}
 
-	list_del(&buffer->node);
+	hash_del(&buffer->hash_node);
 
 	mutex_unlock(&trace_lock);
 
@@ -721,22 +802,42 @@ enum memtrack_type {
 #define MEMTRACK_ION_EXYNOS_FLAG_PROTECTED BIT(4)
 #define MEMTRACK_ION_FLAG_MAY_HWRENDER BIT(6)
 
-static unsigned int dmabuf_trace_get_memtrack_flags(struct dma_buf *dmabuf)
+static unsigned int dmabuf_trace_get_class(struct dma_buf *dmabuf)
 {
-	unsigned long mflags, flags = 0;
-
-	mflags = MEMTRACK_FLAG_SMAPS_UNACCOUNTED | MEMTRACK_FLAG_SHARED_PSS;
+	unsigned long flags = 0;
+	unsigned int class = 0;
 
 	if (dma_buf_get_flags(dmabuf, &flags))
-		return 0;
+		return DMABUF_TRACE_CLASS_UNKNOWN;
 
 	if (ION_HEAP_MASK(flags >> ION_HEAP_SHIFT) ==
 	    MEMTRACK_ION_HEAP_TYPE_CARVEOUT)
+		class |= DMABUF_TRACE_CLASS_DEDICATED;
+
+	if (ION_BUFFER_MASK(flags) & MEMTRACK_ION_EXYNOS_FLAG_PROTECTED)
+		class |= DMABUF_TRACE_CLASS_SECURE;
+
+	if (ION_BUFFER_MASK(flags) & MEMTRACK_ION_FLAG_MAY_HWRENDER)
+		class |= DMABUF_TRACE_CLASS_GRAPHICS;
+
+	return class;
+}
+
+static unsigned int dmabuf_trace_get_memtrack_flags(unsigned int class)
+{
+	unsigned int mflags;
+
+	if (class == DMABUF_TRACE_CLASS_UNKNOWN)
+		return 0;
+
+	mflags = MEMTRACK_FLAG_SMAPS_UNACCOUNTED | MEMTRACK_FLAG_SHARED_PSS;
+
+	if (class & DMABUF_TRACE_CLASS_DEDICATED)
 		mflags |= MEMTRACK_FLAG_DEDICATED;
 	else
 		mflags |= MEMTRACK_FLAG_SYSTEM;
 
-	if (ION_BUFFER_MASK(flags) & MEMTRACK_ION_EXYNOS_FLAG_PROTECTED)
+	if (class & DMABUF_TRACE_CLASS_SECURE)
 		mflags |= MEMTRACK_FLAG_SECURE;
 	else
 		mflags |= MEMTRACK_FLAG_NONSECURE;
@@ -744,14 +845,9 @@ static unsigned int dmabuf_trace_get_memtrack_flags(struct dma_buf *dmabuf)
 	return mflags;
 }
 
-static unsigned int dmabuf_trace_get_memtrack_type(struct dma_buf *dmabuf)
+static unsigned int dmabuf_trace_get_memtrack_type(unsigned int class)
 {
-	unsigned long flags = 0;
-
-	if (dma_buf_get_flags(dmabuf, &flags))
-		return 0;
-
-	if (ION_BUFFER_MASK(flags) & MEMTRACK_ION_FLAG_MAY_HWRENDER)
+	if (class & DMABUF_TRACE_CLASS_GRAPHICS)
 		return MEMTRACK_TYPE_GRAPHICS;
 
 	return MEMTRACK_TYPE_OTHER;
@@ -762,32 +858,32 @@ static void dmabuf_trace_set_sizes(unsigned int pid, unsigned int count,
 				   unsigned int sizes[])
 {
 	struct dmabuf_trace_task *task;
-	struct dmabuf_trace_ref *ref;
+	unsigned int class;
 	int i;
 
-	mutex_lock(&trace_lock);
-	list_for_each_entry(task, &head_task.node, node)
-		if (task->task->pid == pid)
+	rcu_read_lock();
+	hash_for_each_possible_rcu(task_hash, task, hash_node, pid)
+		if (task->pid == pid)
 			break;
 
-	if (&task->node == &head_task.node) {
-		mutex_unlock(&trace_lock);
+	if (!task) {
+		rcu_read_unlock();
 		return;
 	}
 
-	list_for_each_entry(ref, &task->ref_list, task_node) {
-		unsigned int mflags, mtype;
+	for (class = 0; class < DMABUF_TRACE_NR_CLASS; class++) {
+		unsigned int mflags = dmabuf_trace_get_memtrack_flags(class);
+		unsigned long size = READ_ONCE(task->size[class]);
 
-		mflags = dmabuf_trace_get_memtrack_flags(ref->buffer->dmabuf);
-		mtype = dmabuf_trace_get_memtrack_type(ref->buffer->dmabuf);
+		if (dmabuf_trace_get_memtrack_type(class) != type)
+			continue;
 
 		for (i = 0; i < count; i++) {
-			if ((flags[i] == mflags) && (type == mtype))
-				sizes[i] += ref->buffer->dmabuf->size /
-					ref->buffer->shared_count;
+			if (flags[i] == mflags)
+				sizes[i] += size;
 		}
 	}
-	mutex_unlock(&trace_lock);
+	rcu_read_unlock();
 }
 
 static int dmabuf_trace_get_memory(unsigned int cmd, unsigned long arg)
@@ -854,6 +950,7 @@ static int __init dmabuf_trace_create(void)
 
 	INIT_LIST_HEAD(&head_task.node);
 	INIT_LIST_HEAD(&head_task.ref_list);
+	hash_init(head_task.ref_hash);
 
 	pr_info("Initialized dma-buf trace successfully.\n");
 
@@ -4738,6 +4738,7 @@ int kbase_device_debugfs_init(struct kbase_device *kbdev)
 #endif /* !MALI_USE_CSF */
 
 	kbasep_gpu_memory_debugfs_init(kbdev);
+	kbase_mem_pool_warm_debugfs_init(kbdev->mali_debugfs_directory, kbdev);
 	kbase_as_fault_debugfs_init(kbdev);
 #ifdef CONFIG_MALI_PRFCNT_SET_SELECT_VIA_DEBUG_FS
 	kbase_instr_backend_debugfs_init(kbdev);
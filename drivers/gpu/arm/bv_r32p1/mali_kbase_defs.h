@@ -450,6 +450,18 @@ struct kbase_pm_device_data {
  *                operations should be abandoned
  * @dont_reclaim: true if the shrinker is forbidden from reclaiming memory from
  *                this pool, eg during a grow operation
+ * @warm_target:  Number of free pages the background warmer keeps in the pool,
+ *                adapted to the recent rate of allocations from the kernel.
+ *                Only used for the pools of the device.
+ * @last_reclaim: Time in jiffies the shrinker last freed pages from the pool.
+ *                The warmer leaves the pool alone for a period after it.
+ * @nr_missed:    Number of pages allocated from the kernel for this pool, or
+ *                for a context pool spilling to it, since the warmer last ran
+ * @nr_kernel:    Total number of pages allocated from the kernel on the
+ *                allocation paths of this pool and the context pools above it
+ * @nr_warmed:    Total number of pages added to the pool by the warmer
+ * @nr_hits:      Total number of pages context pools took from this pool when
+ *                growing, instead of allocating them from the kernel
  */
 struct kbase_mem_pool {
 	struct kbase_device *kbdev;
@@ -465,6 +477,13 @@ struct kbase_mem_pool {
 
 	bool dying;
 	bool dont_reclaim;
+
+	size_t warm_target;
+	unsigned long last_reclaim;
+	atomic_t nr_missed;
+	atomic_long_t nr_kernel;
+	atomic_long_t nr_warmed;
+	atomic_long_t nr_hits;
 };
 
 /**
@@ -695,6 +714,8 @@ struct kbase_process {
  *                         the device
  * @mem_pools:             Global pools of free physical memory pages which can
  *                         be used by all the contexts.
+ * @mem_pool_warm_work:    Work keeping @mem_pools filled with zeroed pages up to
+ *                         their warm targets, see kbase_mem_pool_warm_init().
  * @memdev:                keeps track of the in use physical pages allocated by
  *                         the Driver.
  * @mmu_mode:              Pointer to the object containing methods for programming
@@ -966,6 +987,7 @@ struct kbase_device {
 	struct kbase_pm_device_data pm;
 
 	struct kbase_mem_pool_group mem_pools;
+	struct delayed_work mem_pool_warm_work;
 	struct kbasep_mem_device memdev;
 	struct kbase_mmu_mode const *mmu_mode;
 
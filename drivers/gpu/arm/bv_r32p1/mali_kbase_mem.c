@@ -1292,6 +1292,8 @@ int kbase_mem_init(struct kbase_device *kbdev)
 		kbase_mem_pool_group_config_set_max_size(&mem_pool_defaults,
 			KBASE_MEM_POOL_MAX_SIZE_KBDEV);
 
+		kbase_mem_pool_warm_init(kbdev);
+
 		err = kbase_mem_pool_group_init(&kbdev->mem_pools, kbdev,
 			&mem_pool_defaults, NULL);
 	}
@@ -1317,6 +1319,7 @@ void kbase_mem_term(struct kbase_device *kbdev)
 	if (pages != 0)
 		dev_warn(kbdev->dev, "%s: %d pages in use!\n", __func__, pages);
 
+	kbase_mem_pool_warm_term(kbdev);
 	kbase_mem_pool_group_term(&kbdev->mem_pools);
 
 	WARN_ON(kbdev->total_gpu_pages);
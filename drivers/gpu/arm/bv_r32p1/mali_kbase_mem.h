@@ -738,6 +738,17 @@ static inline int kbase_reg_prepare_native(struct kbase_va_region *reg,
  */
 #define KBASE_MEM_POOL_MAX_SIZE_KCTX  (SZ_64M >> PAGE_SHIFT)
 
+/*
+ * Period of the background warmer of the kbdev memory pools (in ms)
+ */
+#define KBASE_MEM_POOL_WARM_PERIOD_MS 100
+
+/*
+ * Fraction of the warm target of a kbdev memory pool that is dropped every
+ * period, as a shift
+ */
+#define KBASE_MEM_POOL_WARM_DECAY_SHIFT 2
+
 /*
  * The order required for a 2MB page allocation (2^order * 4KB = 2MB)
  */
@@ -1021,10 +1032,57 @@ void kbase_mem_pool_set_max_size(struct kbase_mem_pool *pool, size_t max_size);
  * Adds @nr_to_grow pages to the pool. Note that this may cause the pool to
  * become larger than the maximum size specified.
  *
+ * Pages are taken from the next pool first, where they are already zeroed
+ * and synced, and only the remainder is allocated from the kernel.
+ *
  * Returns: 0 on success, -ENOMEM if unable to allocate sufficent pages
  */
 int kbase_mem_pool_grow(struct kbase_mem_pool *pool, size_t nr_to_grow);
 
+/**
+ * kbase_mem_pool_warm_target - Adapt the warm target of a kbdev memory pool
+ * @target:   Warm target of the last period
+ * @missed:   Number of pages allocated from the kernel in the last period
+ * @max_size: Maximum number of free pages the pool can hold
+ *
+ * The target covers twice the pages the pool failed to provide in the last
+ * period, and otherwise decays so that pages are not held when the demand
+ * is gone.
+ *
+ * Return: The warm target for the next period
+ */
+static inline size_t kbase_mem_pool_warm_target(size_t target, size_t missed,
+		size_t max_size)
+{
+	target -= DIV_ROUND_UP(target, 1 << KBASE_MEM_POOL_WARM_DECAY_SHIFT);
+	target = max(target, 2 * missed);
+
+	return min(target, max_size);
+}
+
+/**
+ * kbase_mem_pool_warm_init - Initialize the warmer of the kbdev memory pools
+ * @kbdev: Kbase device
+ *
+ * When an allocation from a pool of @kbdev, or a grow of a context pool
+ * spilling to it, has to allocate pages from the kernel, a worker is kicked
+ * that refills the pool with zeroed and synced pages up to its warm target,
+ * so that later page faults find them in the pool. The worker runs every
+ * KBASE_MEM_POOL_WARM_PERIOD_MS while any target is not zero. It only takes
+ * free pages, without direct or kswapd reclaim, does not refill a pool the
+ * shrinker freed pages from in the last period, and never warms a pool with
+ * a maximum size of 0.
+ */
+void kbase_mem_pool_warm_init(struct kbase_device *kbdev);
+
+/**
+ * kbase_mem_pool_warm_term - Stop the warmer of the kbdev memory pools
+ * @kbdev: Kbase device
+ *
+ * Must be called before the pools of @kbdev are terminated.
+ */
+void kbase_mem_pool_warm_term(struct kbase_device *kbdev);
+
 /**
  * kbase_mem_pool_trim - Grow or shrink the pool to a new size
  * @pool:     Memory pool to trim
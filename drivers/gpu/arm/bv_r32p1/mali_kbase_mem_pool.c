@@ -27,6 +27,7 @@
 #include <linux/shrinker.h>
 #include <linux/atomic.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 
 #define pool_dbg(pool, format, ...) \
 	dev_dbg(pool->kbdev->dev, "%s-pool [%zu/%zu]: " format,	\
@@ -150,10 +151,10 @@ static void kbase_mem_pool_spill(struct kbase_mem_pool *next_pool,
 	kbase_mem_pool_add(next_pool, p);
 }
 
-struct page *kbase_mem_alloc_page(struct kbase_mem_pool *pool)
+static struct page *kbase_mem_alloc_page_gfp(struct kbase_mem_pool *pool,
+		gfp_t gfp)
 {
 	struct page *p;
-	gfp_t gfp = GFP_HIGHUSER | __GFP_ZERO;
 	struct kbase_device *const kbdev = pool->kbdev;
 	struct device *const dev = kbdev->dev;
 	dma_addr_t dma_addr;
@@ -184,6 +185,34 @@ struct page *kbase_mem_alloc_page(struct kbase_mem_pool *pool)
 	return p;
 }
 
+struct page *kbase_mem_alloc_page(struct kbase_mem_pool *pool)
+{
+	return kbase_mem_alloc_page_gfp(pool, GFP_HIGHUSER | __GFP_ZERO);
+}
+
+static void kbase_mem_pool_warm_kick(struct kbase_device *kbdev)
+{
+	/* Does nothing if the worker is already scheduled */
+	queue_delayed_work(system_freezable_power_efficient_wq,
+			&kbdev->mem_pool_warm_work, 0);
+}
+
+/* Account pages the pool had to allocate from the kernel to the kbdev pool */
+static void kbase_mem_pool_account_kernel(struct kbase_mem_pool *pool,
+		size_t nr_pages)
+{
+	struct kbase_mem_pool *const dev_pool =
+		pool->next_pool ? pool->next_pool : pool;
+
+	if (!nr_pages)
+		return;
+
+	atomic_long_add(nr_pages, &dev_pool->nr_kernel);
+	atomic_add(nr_pages, &dev_pool->nr_missed);
+
+	kbase_mem_pool_warm_kick(pool->kbdev);
+}
+
 static void kbase_mem_pool_free_page(struct kbase_mem_pool *pool,
 		struct page *p)
 {
@@ -231,20 +260,52 @@ static size_t kbase_mem_pool_shrink(struct kbase_mem_pool *pool,
 	return nr_freed;
 }
 
-int kbase_mem_pool_grow(struct kbase_mem_pool *pool,
+static size_t kbase_mem_pool_grow_from_next(struct kbase_mem_pool *pool,
 		size_t nr_to_grow)
 {
+	struct kbase_mem_pool *const next_pool = pool->next_pool;
+	LIST_HEAD(page_list);
 	struct page *p;
 	size_t i;
 
+	if (!next_pool)
+		return 0;
+
+	/* Pages of the next pool are zeroed and synced already */
+	kbase_mem_pool_lock(next_pool);
+	for (i = 0; i < nr_to_grow; i++) {
+		p = kbase_mem_pool_remove_locked(next_pool);
+		if (!p)
+			break;
+		list_add(&p->lru, &page_list);
+	}
+	kbase_mem_pool_unlock(next_pool);
+
+	if (i) {
+		kbase_mem_pool_add_list(pool, &page_list, i);
+		atomic_long_add(i, &next_pool->nr_hits);
+	}
+
+	return i;
+}
+
+int kbase_mem_pool_grow(struct kbase_mem_pool *pool,
+		size_t nr_to_grow)
+{
+	struct page *p;
+	size_t i, nr_from_next;
+
+	nr_from_next = kbase_mem_pool_grow_from_next(pool, nr_to_grow);
+
 	kbase_mem_pool_lock(pool);
 
 	pool->dont_reclaim = true;
-	for (i = 0; i < nr_to_grow; i++) {
+	for (i = nr_from_next; i < nr_to_grow; i++) {
 		if (pool->dying) {
 			pool->dont_reclaim = false;
 			kbase_mem_pool_shrink_locked(pool, nr_to_grow);
 			kbase_mem_pool_unlock(pool);
+			kbase_mem_pool_account_kernel(pool, i - nr_from_next);
 
 			return -ENOMEM;
 		}
@@ -255,6 +316,7 @@ int kbase_mem_pool_grow(struct kbase_mem_pool *pool,
 			kbase_mem_pool_lock(pool);
 			pool->dont_reclaim = false;
 			kbase_mem_pool_unlock(pool);
+			kbase_mem_pool_account_kernel(pool, i - nr_from_next);
 
 			return -ENOMEM;
 		}
@@ -265,6 +327,8 @@ int kbase_mem_pool_grow(struct kbase_mem_pool *pool,
 	pool->dont_reclaim = false;
 	kbase_mem_pool_unlock(pool);
 
+	kbase_mem_pool_account_kernel(pool, nr_to_grow - nr_from_next);
+
 	return 0;
 }
 
@@ -347,6 +411,8 @@ static unsigned long kbase_mem_pool_reclaim_scan_objects(struct shrinker *s,
 	pool_dbg(pool, "reclaim scan %ld:\n", sc->nr_to_scan);
 
 	freed = kbase_mem_pool_shrink_locked(pool, sc->nr_to_scan);
+	if (freed)
+		WRITE_ONCE(pool->last_reclaim, jiffies);
 
 	kbase_mem_pool_unlock(pool);
 
@@ -374,6 +440,13 @@ int kbase_mem_pool_init(struct kbase_mem_pool *pool,
 	pool->kbdev = kbdev;
 	pool->next_pool = next_pool;
 	pool->dying = false;
+	pool->warm_target = 0;
+	pool->last_reclaim = jiffies -
+		msecs_to_jiffies(KBASE_MEM_POOL_WARM_PERIOD_MS);
+	atomic_set(&pool->nr_missed, 0);
+	atomic_long_set(&pool->nr_kernel, 0);
+	atomic_long_set(&pool->nr_warmed, 0);
+	atomic_long_set(&pool->nr_hits, 0);
 
 	spin_lock_init(&pool->pool_lock);
 	INIT_LIST_HEAD(&pool->page_list);
@@ -532,6 +605,7 @@ int kbase_mem_pool_alloc_pages(struct kbase_mem_pool *pool, size_t nr_4k_pages,
 	struct page *p;
 	size_t nr_from_pool;
 	size_t i = 0;
+	size_t nr_from_kernel = 0;
 	int err = -ENOMEM;
 	size_t nr_pages_internal;
 
@@ -581,6 +655,7 @@ int kbase_mem_pool_alloc_pages(struct kbase_mem_pool *pool, size_t nr_4k_pages,
 				else
 					goto err_rollback;
 			}
+			nr_from_kernel++;
 
 			if (pool->order) {
 				int j;
@@ -602,10 +677,12 @@ int kbase_mem_pool_alloc_pages(struct kbase_mem_pool *pool, size_t nr_4k_pages,
 	}
 
 done:
+	kbase_mem_pool_account_kernel(pool, nr_from_kernel);
 	pool_dbg(pool, "alloc_pages(%zu) done\n", i);
 	return i;
 
 err_rollback:
+	kbase_mem_pool_account_kernel(pool, nr_from_kernel);
 	kbase_mem_pool_free_pages(pool, i, pages, NOT_DIRTY, NOT_RECLAIMED);
 	return err;
 }
@@ -828,3 +905,71 @@ void kbase_mem_pool_free_pages_locked(struct kbase_mem_pool *pool,
 
 	pool_dbg(pool, "free_pages_locked(%zu) done\n", nr_pages);
 }
+
+/* Fill @pool up to its warm target, return whether it still has a target */
+static bool kbase_mem_pool_warm(struct kbase_mem_pool *pool)
+{
+	/* Only take free memory, the pool is not worth any reclaim */
+	const gfp_t gfp = (GFP_HIGHUSER | __GFP_ZERO | __GFP_NOWARN) &
+		~__GFP_RECLAIM;
+	size_t missed = atomic_xchg(&pool->nr_missed, 0);
+	size_t target;
+	struct page *p;
+
+	target = kbase_mem_pool_warm_target(READ_ONCE(pool->warm_target),
+			missed, kbase_mem_pool_max_size(pool));
+	WRITE_ONCE(pool->warm_target, target);
+
+	/* Do not refill what the shrinker has just given back */
+	if (time_before(jiffies, READ_ONCE(pool->last_reclaim) +
+			msecs_to_jiffies(KBASE_MEM_POOL_WARM_PERIOD_MS))) {
+		pool_dbg(pool, "not warmed, reclaimed in this period\n");
+		return target != 0;
+	}
+
+	while (kbase_mem_pool_size(pool) < target) {
+		if (READ_ONCE(pool->dying))
+			break;
+
+		p = kbase_mem_alloc_page_gfp(pool, gfp);
+		if (!p)
+			break;
+
+		kbase_mem_pool_add(pool, p);
+		atomic_long_inc(&pool->nr_warmed);
+	}
+
+	pool_dbg(pool, "warmed to target %zu, missed %zu\n", target, missed);
+
+	return target != 0;
+}
+
+static void kbase_mem_pool_warm_worker(struct work_struct *data)
+{
+	struct kbase_device *kbdev = container_of(data, struct kbase_device,
+			mem_pool_warm_work.work);
+	bool active = false;
+	int gid;
+
+	for (gid = 0; gid < MEMORY_GROUP_MANAGER_NR_GROUPS; ++gid) {
+		active |= kbase_mem_pool_warm(&kbdev->mem_pools.small[gid]);
+		active |= kbase_mem_pool_warm(&kbdev->mem_pools.large[gid]);
+	}
+
+	/* Keep decaying the targets, a miss kicks an idle worker again */
+	if (active)
+		queue_delayed_work(system_freezable_power_efficient_wq,
+				&kbdev->mem_pool_warm_work,
+				msecs_to_jiffies(KBASE_MEM_POOL_WARM_PERIOD_MS));
+}
+
+void kbase_mem_pool_warm_init(struct kbase_device *kbdev)
+{
+	INIT_DELAYED_WORK(&kbdev->mem_pool_warm_work,
+			kbase_mem_pool_warm_worker);
+}
+
+void kbase_mem_pool_warm_term(struct kbase_device *kbdev)
+{
+	cancel_delayed_work_sync(&kbdev->mem_pool_warm_work);
+}
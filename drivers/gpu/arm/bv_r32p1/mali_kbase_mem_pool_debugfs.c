@@ -188,3 +188,88 @@ void kbase_mem_pool_debugfs_init(struct dentry *parent,
 	debugfs_create_file("lp_mem_pool_max_size", mode, parent,
 		&kctx->mem_pools.large, &kbase_mem_pool_debugfs_max_size_fops);
 }
+
+static void kbase_mem_pool_warm_debugfs_show_pools(struct seq_file *sfile,
+	const char *name, struct kbase_mem_pool *const mem_pools)
+{
+	int gid;
+
+	for (gid = 0; gid < MEMORY_GROUP_MANAGER_NR_GROUPS; ++gid) {
+		struct kbase_mem_pool *const pool = &mem_pools[gid];
+
+		seq_printf(sfile, "%-5s %3d %8zu %8zu %10ld %10ld %10ld\n",
+			name, gid, kbase_mem_pool_size(pool),
+			READ_ONCE(pool->warm_target),
+			atomic_long_read(&pool->nr_hits),
+			atomic_long_read(&pool->nr_warmed),
+			atomic_long_read(&pool->nr_kernel));
+	}
+}
+
+static int kbase_mem_pool_warm_debugfs_show(struct seq_file *sfile,
+	void *data)
+{
+	struct kbase_device *const kbdev = sfile->private;
+
+	CSTD_UNUSED(data);
+
+	seq_printf(sfile, "%-5s %3s %8s %8s %10s %10s %10s\n", "pool", "gid",
+		"size", "target", "hits", "warmed", "kernel");
+	kbase_mem_pool_warm_debugfs_show_pools(sfile, "small",
+		kbdev->mem_pools.small);
+	kbase_mem_pool_warm_debugfs_show_pools(sfile, "large",
+		kbdev->mem_pools.large);
+
+	return 0;
+}
+
+static int kbase_mem_pool_warm_debugfs_open(struct inode *in,
+	struct file *file)
+{
+	return single_open(file, kbase_mem_pool_warm_debugfs_show,
+		in->i_private);
+}
+
+/* Any write resets the counters */
+static ssize_t kbase_mem_pool_warm_debugfs_write(struct file *file,
+		const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct seq_file *const sfile = file->private_data;
+	struct kbase_device *const kbdev = sfile->private;
+	int gid;
+
+	CSTD_UNUSED(ubuf);
+	CSTD_UNUSED(ppos);
+
+	for (gid = 0; gid < MEMORY_GROUP_MANAGER_NR_GROUPS; ++gid) {
+		struct kbase_mem_pool *const pools[] = {
+			&kbdev->mem_pools.small[gid],
+			&kbdev->mem_pools.large[gid],
+		};
+		int i;
+
+		for (i = 0; i < ARRAY_SIZE(pools); i++) {
+			atomic_long_set(&pools[i]->nr_hits, 0);
+			atomic_long_set(&pools[i]->nr_warmed, 0);
+			atomic_long_set(&pools[i]->nr_kernel, 0);
+		}
+	}
+
+	return count;
+}
+
+static const struct file_operations kbase_mem_pool_warm_debugfs_fops = {
+	.owner = THIS_MODULE,
+	.open = kbase_mem_pool_warm_debugfs_open,
+	.read = seq_read,
+	.write = kbase_mem_pool_warm_debugfs_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+void kbase_mem_pool_warm_debugfs_init(struct dentry *parent,
+		struct kbase_device *kbdev)
+{
+	debugfs_create_file("mem_pool_warm", 0600, parent, kbdev,
+		&kbase_mem_pool_warm_debugfs_fops);
+}
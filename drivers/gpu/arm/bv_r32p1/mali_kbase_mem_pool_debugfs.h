@@ -38,6 +38,19 @@
 void kbase_mem_pool_debugfs_init(struct dentry *parent,
 		struct kbase_context *kctx);
 
+/**
+ * kbase_mem_pool_warm_debugfs_init - add debugfs file for the pool warmer
+ * @parent:  Parent debugfs dentry
+ * @kbdev:   The kbase device
+ *
+ * Adds the file mem_pool_warm under @parent, listing for each pool of @kbdev
+ * its size, its warm target, the pages context pools took from it when
+ * growing, the pages added by the warmer and the pages that still had to be
+ * allocated from the kernel. Writing to the file resets the counters.
+ */
+void kbase_mem_pool_warm_debugfs_init(struct dentry *parent,
+		struct kbase_device *kbdev);
+
 /**
  * kbase_mem_pool_debugfs_trim - Grow or shrink a memory pool to a new size
  *
@@ -14,6 +14,8 @@
 #include <linux/kernel.h>
 #include <linux/spinlock.h>
 #include <linux/list.h>
+#include <linux/rbtree.h>
+#include <linux/workqueue.h>
 #include <linux/device.h>
 #include <linux/platform_device.h>
 #include <linux/genalloc.h>
@@ -28,10 +30,6 @@
 typedef u32 sysmmu_iova_t;
 typedef u32 sysmmu_pte_t;
 
-#define IOVM_NUM_PAGES(vmsize) (vmsize / PAGE_SIZE)
-#define IOVM_BITMAP_SIZE(vmsize) \
-		((IOVM_NUM_PAGES(vmsize) + BITS_PER_BYTE) / BITS_PER_BYTE)
-
 #define SECT_ORDER 20
 #define LPAGE_ORDER 16
 #define SPAGE_ORDER 12
@@ -363,26 +361,38 @@ struct sysmmu_drvdata {
 };
 
 struct exynos_vm_region {
-	struct list_head node;
+	struct rb_node rb;
 	u32 start;
 	u32 size;
 	u32 section_off;
 	u32 dummy_size;
+	u32 gap;		/* free space between the previous region and this */
+	u32 subtree_max_gap;	/* largest gap in the subtree rooted here */
+	bool in_use;		/* false while kept in a magazine for reuse */
 };
 
+struct iovm_magazine;
+
+#define IOVM_FLUSH_BATCH	32
+
 struct exynos_iovmm {
 	struct iommu_domain *domain;	/* iommu domain for this iovmm */
-	size_t iovm_size;		/* iovm bitmap size per plane */
+	size_t iovm_size;		/* iovm size per plane */
 	u32 iova_start;			/* iovm start address per plane */
-	unsigned long *vm_map;		/* iovm biatmap per plane */
-	struct list_head regions_list;	/* list of exynos_vm_region */
-	spinlock_t vmlist_lock;		/* lock for updating regions_list */
-	spinlock_t bitmap_lock;		/* lock for manipulating bitmaps */
+	struct rb_root regions;		/* exynos_vm_region sorted by address */
+	spinlock_t vmlist_lock;		/* lock for updating regions */
+	struct iovm_magazine __percpu *magazines; /* recently freed regions */
+	spinlock_t flush_lock;		/* lock for the deferred flush queue */
+	unsigned int nr_pending;
+	struct exynos_vm_region *pending[IOVM_FLUSH_BATCH]; /* TLB not flushed */
+	struct delayed_work flush_work;
 	struct device *dev;	/* peripheral device that has this iovmm */
 	size_t allocated_size;
 	int num_areas;
 	unsigned int num_map;
 	unsigned int num_unmap;
+	unsigned int num_reuse;
+	unsigned int num_flush;
 	const char *domain_name;
 	struct iommu_group *group;
 	struct exynos_iommu_event_log log;
@@ -19,6 +19,11 @@
 #include <linux/err.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/rbtree_augmented.h>
+#include <linux/percpu.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
+#include <linux/bitmap.h>
 
 #include <linux/exynos_iovmm.h>
 
@@ -26,6 +31,310 @@
 
 #define sg_physically_continuous(sg) (sg_next(sg) == NULL)
 
+/*
+ * IOVM regions are kept in an rbtree sorted by address. Each region records
+ * the free gap between the previous region and itself, and the largest gap
+ * in its subtree, so that the first-fit search below only descends into
+ * subtrees that are able to hold the request.
+ *
+ * Unmapped regions are not released immediately but kept reserved in a small
+ * per-cpu magazine. The next allocation of the same size on that cpu takes
+ * the region back without searching the tree. Magazines are flushed to the
+ * tree when the IOVM space runs out.
+ */
+#define IOVM_MAG_SIZE	8
+
+struct iovm_magazine {
+	spinlock_t lock;
+	unsigned int next;
+	struct exynos_vm_region *regions[IOVM_MAG_SIZE];
+};
+
+static inline u32 iovm_region_base(struct exynos_vm_region *region)
+{
+	return region->start & PAGE_MASK;
+}
+
+static inline u32 iovm_region_end(struct exynos_vm_region *region)
+{
+	return iovm_region_base(region) + region->size;
+}
+
+static inline struct exynos_vm_region *rb_to_region(struct rb_node *node)
+{
+	return rb_entry(node, struct exynos_vm_region, rb);
+}
+
+static u32 iovm_compute_max_gap(struct exynos_vm_region *region)
+{
+	u32 max_gap = region->gap;
+
+	if (region->rb.rb_left)
+		max_gap = max(max_gap,
+			      rb_to_region(region->rb.rb_left)->subtree_max_gap);
+	if (region->rb.rb_right)
+		max_gap = max(max_gap,
+			      rb_to_region(region->rb.rb_right)->subtree_max_gap);
+
+	return max_gap;
+}
+
+RB_DECLARE_CALLBACKS(static, iovm_gap_callbacks, struct exynos_vm_region, rb,
+		     u32, subtree_max_gap, iovm_compute_max_gap)
+
+/* Must be called with vmlist_lock held */
+static int iovm_insert_region(struct exynos_iovmm *vmm,
+			      struct exynos_vm_region *region)
+{
+	struct rb_node **link = &vmm->regions.rb_node, *parent = NULL;
+	struct exynos_vm_region *prev = NULL, *next = NULL, *pos;
+	u32 base = iovm_region_base(region);
+	u32 end = base + region->size;
+
+	while (*link) {
+		parent = *link;
+		pos = rb_to_region(parent);
+		if (base < iovm_region_base(pos)) {
+			next = pos;
+			link = &parent->rb_left;
+		} else {
+			prev = pos;
+			link = &parent->rb_right;
+		}
+	}
+
+	if ((prev && iovm_region_end(prev) > base) ||
+			(next && iovm_region_base(next) < end))
+		return -EBUSY;
+
+	region->gap = base - (prev ? iovm_region_end(prev) : vmm->iova_start);
+
+	/*
+	 * The gaps of the ancestors were not updated on the way down. Link
+	 * the region with an empty subtree gap and propagate it upwards
+	 * before rebalancing.
+	 */
+	rb_link_node(&region->rb, parent, link);
+	region->subtree_max_gap = 0;
+	iovm_gap_callbacks_propagate(&region->rb, NULL);
+	rb_insert_augmented(&region->rb, &vmm->regions, &iovm_gap_callbacks);
+
+	if (next) {
+		next->gap = iovm_region_base(next) - end;
+		iovm_gap_callbacks_propagate(&next->rb, NULL);
+	}
+
+	return 0;
+}
+
+/* Must be called with vmlist_lock held */
+static void iovm_erase_region(struct exynos_iovmm *vmm,
+			      struct exynos_vm_region *region)
+{
+	struct rb_node *next = rb_next(&region->rb);
+
+	rb_erase_augmented(&region->rb, &vmm->regions, &iovm_gap_callbacks);
+
+	if (next) {
+		rb_to_region(next)->gap += region->gap + region->size;
+		iovm_gap_callbacks_propagate(next, NULL);
+	}
+}
+
+/* Must be called with vmlist_lock held */
+static struct exynos_vm_region *iovm_lookup_region(struct exynos_iovmm *vmm,
+						   dma_addr_t iova)
+{
+	struct rb_node *node = vmm->regions.rb_node;
+	struct exynos_vm_region *region;
+
+	while (node) {
+		region = rb_to_region(node);
+		if (iova < iovm_region_base(region))
+			node = node->rb_left;
+		else if (iova >= iovm_region_end(region))
+			node = node->rb_right;
+		else
+			return region;
+	}
+
+	return NULL;
+}
+
+static inline bool iovm_gap_fits(struct exynos_iovmm *vmm, u32 gap_start,
+				 u64 gap_end, u32 size, u32 align, u32 *addr)
+{
+	u32 start = vmm->iova_start + ALIGN(gap_start - vmm->iova_start, align);
+
+	if (start < gap_start || (u64)start + size > gap_end)
+		return false;
+
+	*addr = start;
+	return true;
+}
+
+/*
+ * Finds the lowest free range of @size bytes aligned to @align from
+ * iova_start. Must be called with vmlist_lock held.
+ */
+static int iovm_find_free(struct exynos_iovmm *vmm, u32 size, u32 align,
+			  u32 *addr)
+{
+	struct exynos_vm_region *region, *child;
+	struct rb_node *prev;
+	u32 gap_start, gap_end;
+	u64 iova_end = (u64)vmm->iova_start + vmm->iovm_size;
+
+	if (RB_EMPTY_ROOT(&vmm->regions))
+		goto check_tail;
+
+	region = rb_to_region(vmm->regions.rb_node);
+	if (region->subtree_max_gap < size)
+		goto check_tail;
+
+	while (true) {
+		/* Visit the left subtree first if it looks promising */
+		if (region->rb.rb_left) {
+			child = rb_to_region(region->rb.rb_left);
+			if (child->subtree_max_gap >= size) {
+				region = child;
+				continue;
+			}
+		}
+check_current:
+		gap_end = iovm_region_base(region);
+		gap_start = gap_end - region->gap;
+		if (region->gap >= size &&
+		    iovm_gap_fits(vmm, gap_start, gap_end, size, align, addr))
+			return 0;
+
+		if (region->rb.rb_right) {
+			child = rb_to_region(region->rb.rb_right);
+			if (child->subtree_max_gap >= size) {
+				region = child;
+				continue;
+			}
+		}
+
+		/* Go back up to the next region in address order */
+		while (true) {
+			prev = &region->rb;
+			if (!rb_parent(prev))
+				goto check_tail;
+			region = rb_to_region(rb_parent(prev));
+			if (prev == region->rb.rb_left)
+				goto check_current;
+		}
+	}
+
+check_tail:
+	prev = rb_last(&vmm->regions);
+	gap_start = prev ? iovm_region_end(rb_to_region(prev)) :
+			   vmm->iova_start;
+	/* the last page of the IOVM space is never allocated */
+	if (iovm_gap_fits(vmm, gap_start, iova_end - PAGE_SIZE,
+			  size, align, addr))
+		return 0;
+
+	return -ENOSPC;
+}
+
+static struct exynos_vm_region *iovm_magazine_get(struct exynos_iovmm *vmm,
+						  u32 size)
+{
+	struct iovm_magazine *mag = raw_cpu_ptr(vmm->magazines);
+	struct exynos_vm_region *region = NULL;
+	int i;
+
+	spin_lock(&mag->lock);
+	for (i = 0; i < IOVM_MAG_SIZE; i++) {
+		if (mag->regions[i] && mag->regions[i]->size == size) {
+			region = mag->regions[i];
+			mag->regions[i] = NULL;
+			break;
+		}
+	}
+	spin_unlock(&mag->lock);
+
+	return region;
+}
+
+/* Returns the oldest region if the magazine had to make room for @region */
+static struct exynos_vm_region *iovm_magazine_put(struct exynos_iovmm *vmm,
+					struct exynos_vm_region *region)
+{
+	struct iovm_magazine *mag = raw_cpu_ptr(vmm->magazines);
+	struct exynos_vm_region *evicted;
+	int i;
+
+	spin_lock(&mag->lock);
+	for (i = 0; i < IOVM_MAG_SIZE; i++) {
+		if (!mag->regions[i]) {
+			mag->regions[i] = region;
+			spin_unlock(&mag->lock);
+			return NULL;
+		}
+	}
+	evicted = mag->regions[mag->next];
+	mag->regions[mag->next] = region;
+	mag->next = (mag->next + 1) % IOVM_MAG_SIZE;
+	spin_unlock(&mag->lock);
+
+	return evicted;
+}
+
+static void iovm_magazine_flush(struct exynos_iovmm *vmm)
+{
+	struct exynos_vm_region *region;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		struct iovm_magazine *mag = per_cpu_ptr(vmm->magazines, cpu);
+
+		spin_lock(&mag->lock);
+		for (i = 0; i < IOVM_MAG_SIZE; i++) {
+			region = mag->regions[i];
+			if (!region)
+				continue;
+			mag->regions[i] = NULL;
+
+			spin_lock(&vmm->vmlist_lock);
+			iovm_erase_region(vmm, region);
+			spin_unlock(&vmm->vmlist_lock);
+			kfree(region);
+		}
+		spin_unlock(&mag->lock);
+	}
+}
+
+static void iovm_flush_pending(struct exynos_iovmm *vmm);
+
+/*
+ * A region waiting for its TLB invalidation must not be handed out again
+ * before its batch is flushed. Walks the whole batch, so it is only checked
+ * with CONFIG_EXYNOS_IOMMU_DEBUG.
+ */
+static void iovm_check_pending(struct exynos_iovmm *vmm,
+			       struct exynos_vm_region *region)
+{
+	u32 base = iovm_region_base(region), end = iovm_region_end(region);
+	struct exynos_vm_region *pos;
+	unsigned int i;
+
+	if (!IS_ENABLED(CONFIG_EXYNOS_IOMMU_DEBUG) ||
+	    !IS_ENABLED(CONFIG_EXYNOS_IOVMM_DEFERRED_FLUSH))
+		return;
+
+	spin_lock(&vmm->flush_lock);
+	for (i = 0; i < vmm->nr_pending; i++) {
+		pos = vmm->pending[i];
+		WARN(iovm_region_base(pos) < end && base < iovm_region_end(pos),
+		     "IOVMM: %#x(+%#x) reused before %#x(+%#x) is flushed\n",
+		     base, region->size, iovm_region_base(pos), pos->size);
+	}
+	spin_unlock(&vmm->flush_lock);
+}
+
 /* alloc_iovm_region - Allocate IO virtual memory region
  * vmm: virtual memory allocator
  * size: total size to allocate vm region from @vmm.
@@ -49,76 +358,62 @@ static dma_addr_t alloc_iovm_region(struct exynos_iovmm *vmm, size_t size,
 			size_t section_offset,
 			off_t page_offset)
 {
-	u32 index = 0;
-	u32 vstart;
-	u32 vsize;
-	unsigned long end, i;
 	struct exynos_vm_region *region;
-	size_t align = SZ_1M;
+	bool flushed = false;
+	u32 vsize, vstart;
+	int ret;
 
 	BUG_ON(page_offset >= PAGE_SIZE);
 
 	/* To avoid allocating prefetched iovm region */
-	vsize = (ALIGN(size + SZ_128K, SZ_128K) + section_offset) >> PAGE_SHIFT;
-	align >>= PAGE_SHIFT;
-	section_offset >>= PAGE_SHIFT;
-
-	spin_lock(&vmm->bitmap_lock);
-again:
-	index = find_next_zero_bit(vmm->vm_map,
-			IOVM_NUM_PAGES(vmm->iovm_size), index);
-
-	if (align) {
-		index = ALIGN(index, align);
-		if (index >= IOVM_NUM_PAGES(vmm->iovm_size)) {
-			spin_unlock(&vmm->bitmap_lock);
-			return 0;
-		}
+	vsize = ALIGN(size + SZ_128K, SZ_128K) + section_offset;
 
-		if (test_bit(index, vmm->vm_map))
-			goto again;
+	region = iovm_magazine_get(vmm, vsize);
+	if (region) {
+		spin_lock(&vmm->vmlist_lock);
+		vmm->num_reuse++;
+		goto found;
 	}
 
-	end = index + vsize;
-
-	if (end >= IOVM_NUM_PAGES(vmm->iovm_size)) {
-		spin_unlock(&vmm->bitmap_lock);
+	region = kmalloc(sizeof(*region), GFP_KERNEL);
+	if (unlikely(!region))
 		return 0;
-	}
-
-	i = find_next_bit(vmm->vm_map, end, index);
-	if (i < end) {
-		index = i + 1;
-		goto again;
-	}
-
-	bitmap_set(vmm->vm_map, index, vsize);
 
-	spin_unlock(&vmm->bitmap_lock);
+	region->size = vsize;
 
-	vstart = (index << PAGE_SHIFT) + vmm->iova_start + page_offset;
-
-	region = kmalloc(sizeof(*region), GFP_KERNEL);
-	if (unlikely(!region)) {
-		spin_lock(&vmm->bitmap_lock);
-		bitmap_clear(vmm->vm_map, index, vsize);
-		spin_unlock(&vmm->bitmap_lock);
-		return 0;
+	spin_lock(&vmm->vmlist_lock);
+	while (iovm_find_free(vmm, vsize, SZ_1M, &vstart)) {
+		spin_unlock(&vmm->vmlist_lock);
+		if (flushed) {
+			kfree(region);
+			return 0;
+		}
+		iovm_flush_pending(vmm);
+		iovm_magazine_flush(vmm);
+		flushed = true;
+		spin_lock(&vmm->vmlist_lock);
 	}
 
-	INIT_LIST_HEAD(&region->node);
 	region->start = vstart;
-	region->size = vsize << PAGE_SHIFT;
+	ret = iovm_insert_region(vmm, region);
+	if (WARN_ON(ret)) {
+		/* iovm_find_free() returned a range that is not free */
+		spin_unlock(&vmm->vmlist_lock);
+		kfree(region);
+		return 0;
+	}
+found:
+	region->start = iovm_region_base(region) + page_offset;
 	region->dummy_size = region->size - size;
-	region->section_off = (unsigned int)(section_offset << PAGE_SHIFT);
-
-	spin_lock(&vmm->vmlist_lock);
-	list_add_tail(&region->node, &vmm->regions_list);
+	region->section_off = (u32)section_offset;
+	region->in_use = true;
 	vmm->allocated_size += region->size;
 	vmm->num_areas++;
 	vmm->num_map++;
 	spin_unlock(&vmm->vmlist_lock);
 
+	iovm_check_pending(vmm, region);
+
 	return region->start + region->section_off;
 }
 
@@ -128,18 +423,12 @@ struct exynos_vm_region *find_iovm_region(struct exynos_iovmm *vmm,
 	struct exynos_vm_region *region;
 
 	spin_lock(&vmm->vmlist_lock);
-
-	list_for_each_entry(region, &vmm->regions_list, node) {
-		if (region->start <= iova &&
-			(region->start + region->size) > iova) {
-			spin_unlock(&vmm->vmlist_lock);
-			return region;
-		}
-	}
-
+	region = iovm_lookup_region(vmm, iova);
+	if (region && !region->in_use)
+		region = NULL;
 	spin_unlock(&vmm->vmlist_lock);
 
-	return NULL;
+	return region;
 }
 
 static struct exynos_vm_region *remove_iovm_region(struct exynos_iovmm *vmm,
@@ -149,20 +438,42 @@ static struct exynos_vm_region *remove_iovm_region(struct exynos_iovmm *vmm,
 
 	spin_lock(&vmm->vmlist_lock);
 
-	list_for_each_entry(region, &vmm->regions_list, node) {
-		if (region->start + region->section_off == iova) {
-			list_del(&region->node);
-			vmm->allocated_size -= region->size;
-			vmm->num_areas--;
-			vmm->num_unmap++;
-			spin_unlock(&vmm->vmlist_lock);
-			return region;
-		}
+	region = iovm_lookup_region(vmm, iova);
+	if (region && region->in_use &&
+			region->start + region->section_off == iova) {
+		region->in_use = false;
+		vmm->allocated_size -= region->size;
+		vmm->num_areas--;
+		vmm->num_unmap++;
+	} else {
+		region = NULL;
 	}
 
 	spin_unlock(&vmm->vmlist_lock);
 
-	return NULL;
+	return region;
+}
+
+/* Puts back a region taken by remove_iovm_region() */
+static void restore_iovm_region(struct exynos_iovmm *vmm,
+				struct exynos_vm_region *region)
+{
+	spin_lock(&vmm->vmlist_lock);
+	region->in_use = true;
+	vmm->allocated_size += region->size;
+	vmm->num_areas++;
+	vmm->num_unmap--;
+	spin_unlock(&vmm->vmlist_lock);
+}
+
+static void __free_iovm_region(struct exynos_iovmm *vmm,
+				struct exynos_vm_region *region)
+{
+	spin_lock(&vmm->vmlist_lock);
+	iovm_erase_region(vmm, region);
+	spin_unlock(&vmm->vmlist_lock);
+
+	kfree(region);
 }
 
 static void free_iovm_region(struct exynos_iovmm *vmm,
@@ -171,59 +482,155 @@ static void free_iovm_region(struct exynos_iovmm *vmm,
 	if (!region)
 		return;
 
-	spin_lock(&vmm->bitmap_lock);
-	bitmap_clear(vmm->vm_map,
-		(region->start - vmm->iova_start) >> PAGE_SHIFT,
-			region->size >> PAGE_SHIFT);
-	spin_unlock(&vmm->bitmap_lock);
+	SYSMMU_EVENT_LOG_IOVMM_UNMAP(IOVMM_TO_LOG(vmm),
+			region->start, region->start + region->size);
+
+	__free_iovm_region(vmm, region);
+}
+
+/*
+ * Releases a region allocated by alloc_iovm_region() after it is unmapped.
+ * The region stays reserved in the magazine of this cpu for the next
+ * allocation of the same size.
+ */
+static void release_iovm_region(struct exynos_iovmm *vmm,
+				struct exynos_vm_region *region)
+{
+	struct exynos_vm_region *evicted;
 
 	SYSMMU_EVENT_LOG_IOVMM_UNMAP(IOVMM_TO_LOG(vmm),
 			region->start, region->start + region->size);
 
-	kfree(region);
+	evicted = iovm_magazine_put(vmm, region);
+	if (evicted)
+		__free_iovm_region(vmm, evicted);
+}
+
+/*
+ * With CONFIG_EXYNOS_IOVMM_DEFERRED_FLUSH, iovmm_unmap() queues the unmapped
+ * region here instead of invalidating the TLB right away. A batch is flushed
+ * with a single range invalidation covering all of its regions and a single
+ * wait for the page table walk, when it is full, IOVM_FLUSH_DELAY after the
+ * first queued unmap, or when the IOVM space runs out. Queued regions stay
+ * reserved until their batch is flushed.
+ */
+#define IOVM_FLUSH_DELAY	msecs_to_jiffies(10)
+
+static void iovm_flush_pending(struct exynos_iovmm *vmm)
+{
+	struct exynos_vm_region *batch[IOVM_FLUSH_BATCH];
+	u32 start = U32_MAX, end = 0;
+	unsigned int nr, i;
+
+	spin_lock(&vmm->flush_lock);
+	nr = vmm->nr_pending;
+	memcpy(batch, vmm->pending, nr * sizeof(batch[0]));
+	vmm->nr_pending = 0;
+	spin_unlock(&vmm->flush_lock);
+
+	if (!nr)
+		return;
+
+	for (i = 0; i < nr; i++) {
+		start = min(start, iovm_region_base(batch[i]));
+		end = max(end, iovm_region_end(batch[i]));
+	}
+
+	exynos_sysmmu_tlb_invalidate(vmm->domain, start, end - start);
+
+	/* TODO: for sysmmu v6, remove it later */
+	/* 60us is required to guarantee that PTW ends itself */
+	udelay(60);
+
+	for (i = 0; i < nr; i++)
+		release_iovm_region(vmm, batch[i]);
+
+	spin_lock(&vmm->vmlist_lock);
+	vmm->num_flush++;
+	spin_unlock(&vmm->vmlist_lock);
+}
+
+static void iovm_flush_work(struct work_struct *work)
+{
+	struct exynos_iovmm *vmm = container_of(to_delayed_work(work),
+					struct exynos_iovmm, flush_work);
+
+	iovm_flush_pending(vmm);
+}
+
+static void iovm_defer_release(struct exynos_iovmm *vmm,
+			       struct exynos_vm_region *region)
+{
+	bool full;
+
+	spin_lock(&vmm->flush_lock);
+	while (vmm->nr_pending == IOVM_FLUSH_BATCH) {
+		spin_unlock(&vmm->flush_lock);
+		iovm_flush_pending(vmm);
+		spin_lock(&vmm->flush_lock);
+	}
+	vmm->pending[vmm->nr_pending++] = region;
+	full = vmm->nr_pending == IOVM_FLUSH_BATCH;
+	spin_unlock(&vmm->flush_lock);
+
+	if (full)
+		iovm_flush_pending(vmm);
+	else
+		queue_delayed_work(system_power_efficient_wq,
+				   &vmm->flush_work, IOVM_FLUSH_DELAY);
 }
 
 static dma_addr_t add_iovm_region(struct exynos_iovmm *vmm,
 					dma_addr_t start, size_t size)
 {
-	struct exynos_vm_region *region, *pos;
+	struct exynos_vm_region *region;
+	int ret;
 
 	region = kzalloc(sizeof(*region), GFP_KERNEL);
 	if (!region)
 		return 0;
 
-	INIT_LIST_HEAD(&region->node);
 	region->start = start;
 	region->size = (u32)size;
 
 	spin_lock(&vmm->vmlist_lock);
-
-	list_for_each_entry(pos, &vmm->regions_list, node) {
-		if ((start < (pos->start + pos->size)) &&
-					((start + size) > pos->start)) {
-			spin_unlock(&vmm->vmlist_lock);
-			kfree(region);
-			return 0;
-		}
+	ret = iovm_insert_region(vmm, region);
+	if (ret) {
+		/* the range may be held by a cached or unflushed region */
+		spin_unlock(&vmm->vmlist_lock);
+		iovm_flush_pending(vmm);
+		iovm_magazine_flush(vmm);
+		spin_lock(&vmm->vmlist_lock);
+		ret = iovm_insert_region(vmm, region);
+	}
+	if (!ret) {
+		region->in_use = true;
+		vmm->allocated_size += region->size;
+		vmm->num_areas++;
 	}
-
-	list_add(&region->node, &vmm->regions_list);
-
 	spin_unlock(&vmm->vmlist_lock);
 
+	if (ret) {
+		kfree(region);
+		return 0;
+	}
+
 	return start;
 }
 
 static void show_iovm_regions(struct exynos_iovmm *vmm)
 {
 	struct exynos_vm_region *pos;
+	struct rb_node *node;
 
 	pr_err("LISTING IOVMM REGIONS...\n");
 	spin_lock(&vmm->vmlist_lock);
-	list_for_each_entry(pos, &vmm->regions_list, node) {
-		pr_err("REGION: %#x (SIZE: %#x, +[%#x, %#x])\n",
+	for (node = rb_first(&vmm->regions); node; node = rb_next(node)) {
+		pos = rb_to_region(node);
+		pr_err("REGION: %#x (SIZE: %#x, +[%#x, %#x])%s\n",
 				pos->start, pos->size,
-				pos->section_off, pos->dummy_size);
+				pos->section_off, pos->dummy_size,
+				pos->in_use ? "" : " cached");
 	}
 	spin_unlock(&vmm->vmlist_lock);
 	pr_err("END OF LISTING IOVMM REGIONS...\n");
@@ -472,8 +879,7 @@ void iovmm_unmap(struct device *dev, dma_addr_t iova)
 				region->start, region->section_off);
 			show_iovm_regions(vmm);
 			/* reinsert iovm region */
-			add_iovm_region(vmm, region->start, region->size);
-			kfree(region);
+			restore_iovm_region(vmm, region);
 			return;
 		}
 		unmap_size = iommu_unmap(vmm->domain, start & SPAGE_MASK, size);
@@ -483,18 +889,22 @@ void iovmm_unmap(struct device *dev, dma_addr_t iova)
 			dev_err(dev, "(SIZE: %#x, iova: %pa, unmapped: %#zx)\n",
 					 size, &iova, unmap_size);
 			show_iovm_regions(vmm);
-			kfree(region);
 			BUG();
 			return;
 		}
 
-		exynos_sysmmu_tlb_invalidate(vmm->domain, region->start, region->size);
+		if (IS_ENABLED(CONFIG_EXYNOS_IOVMM_DEFERRED_FLUSH)) {
+			iovm_defer_release(vmm, region);
+		} else {
+			exynos_sysmmu_tlb_invalidate(vmm->domain,
+					region->start, region->size);
 
-		/* TODO: for sysmmu v6, remove it later */
-		/* 60us is required to guarantee that PTW ends itself */
-		udelay(60);
+			/* TODO: for sysmmu v6, remove it later */
+			/* 60us is required to guarantee that PTW ends itself */
+			udelay(60);
 
-		free_iovm_region(vmm, region);
+			release_iovm_region(vmm, region);
+		}
 
 		dev_dbg(dev, "IOVMM: Unmapped %#x bytes from %#x.\n",
 				(unsigned int)unmap_size, (unsigned int)iova);
@@ -599,15 +1009,14 @@ void exynos_iovmm_unmap_userptr(struct device *dev, dma_addr_t iova)
 				region->start, region->section_off);
 			show_iovm_regions(vmm);
 			/* reinsert iovm region */
-			add_iovm_region(vmm, region->start, region->size);
-			kfree(region);
+			restore_iovm_region(vmm, region);
 			return;
 		}
 
 		exynos_iommu_unmap_userptr(vmm->domain,
 					   start & SPAGE_MASK, size);
 
-		free_iovm_region(vmm, region);
+		release_iovm_region(vmm, region);
 	} else {
 		dev_err(dev, "IOVMM: No IOVM region %pa to free.\n", &iova);
 	}
@@ -713,6 +1122,8 @@ static int iovmm_debug_show(struct seq_file *s, void *unused)
 	seq_puts(s, "---------------------------------------------\n");
 	seq_printf(s, "Total number of mappings  : %d\n", vmm->num_map);
 	seq_printf(s, "Total number of unmappings: %d\n", vmm->num_unmap);
+	seq_printf(s, "Total number of reused    : %d\n", vmm->num_reuse);
+	seq_printf(s, "Total number of TLB batch : %d\n", vmm->num_flush);
 	spin_unlock(&vmm->vmlist_lock);
 
 	return 0;
@@ -732,6 +1143,8 @@ static ssize_t iovmm_debug_write(struct file *filp, const char __user *p,
 	spin_lock(&vmm->vmlist_lock);
 	vmm->num_map = 0;
 	vmm->num_unmap = 0;
+	vmm->num_reuse = 0;
+	vmm->num_flush = 0;
 	spin_unlock(&vmm->vmlist_lock);
 	return len;
 }
@@ -758,6 +1171,7 @@ struct exynos_iovmm *exynos_create_single_iovmm(const char *name,
 {
 	struct exynos_iovmm *vmm;
 	int ret = 0;
+	int cpu;
 
 	vmm = kzalloc(sizeof(*vmm), GFP_KERNEL);
 	if (!vmm) {
@@ -767,11 +1181,14 @@ struct exynos_iovmm *exynos_create_single_iovmm(const char *name,
 
 	vmm->iovm_size = (size_t)(end - start);
 	vmm->iova_start = start;
-	vmm->vm_map = kzalloc(IOVM_BITMAP_SIZE(vmm->iovm_size), GFP_KERNEL);
-	if (!vmm->vm_map) {
+	vmm->regions = RB_ROOT;
+	vmm->magazines = alloc_percpu(struct iovm_magazine);
+	if (!vmm->magazines) {
 		ret = -ENOMEM;
 		goto err_setup_domain;
 	}
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(vmm->magazines, cpu)->lock);
 
 	vmm->domain = iommu_domain_alloc(&platform_bus_type);
 	if (!vmm->domain) {
@@ -790,9 +1207,8 @@ struct exynos_iovmm *exynos_create_single_iovmm(const char *name,
 	}
 
 	spin_lock_init(&vmm->vmlist_lock);
-	spin_lock_init(&vmm->bitmap_lock);
-
-	INIT_LIST_HEAD(&vmm->regions_list);
+	spin_lock_init(&vmm->flush_lock);
+	INIT_DELAYED_WORK(&vmm->flush_work, iovm_flush_work);
 
 	vmm->domain_name = name;
 
@@ -805,6 +1221,7 @@ struct exynos_iovmm *exynos_create_single_iovmm(const char *name,
 err_init_event_log:
 	iommu_domain_free(vmm->domain);
 err_setup_domain:
+	free_percpu(vmm->magazines);
 	kfree(vmm);
 err_alloc_vmm:
 	pr_err("%s IOVMM: Failed to create IOVMM (%d)\n", name, ret);
@@ -821,3 +1238,327 @@ void iovmm_set_fault_handler(struct device *dev,
 	if (ret)
 		dev_err(dev, "Failed to add fault handler\n");
 }
+
+#ifdef CONFIG_EXYNOS_IOVMM_SELFTEST
+
+/*
+ * Boot time test of the IOVM allocator on an iovmm that is not attached to
+ * any System MMU. Random allocations and releases are checked against the
+ * rbtree after every step: regions must be aligned, inside the IOVM space,
+ * must not overlap and the gaps must match the free space between them.
+ * The average cost of the allocations and releases is reported as well.
+ *
+ * With CONFIG_EXYNOS_IOVMM_DEFERRED_FLUSH, releases go through the deferred
+ * flush queue like iovmm_unmap() and the test keeps a software model of the
+ * TLB: the pages of a queued region are stale until the region leaves the
+ * queue, and no allocation may return a range with a stale page.
+ */
+#define IOVM_TEST_START		SZ_256M
+#define IOVM_TEST_SIZE		SZ_256M
+#define IOVM_TEST_LIVE		32
+#define IOVM_TEST_ROUNDS	20000
+
+static dma_addr_t iovm_test_iova[IOVM_TEST_SIZE / SZ_1M] __initdata;
+static struct exynos_iommu_domain iovm_test_domain __initdata;
+
+static DECLARE_BITMAP(iovm_test_stale, IOVM_TEST_SIZE / PAGE_SIZE) __initdata;
+static struct {
+	u32 base;
+	u32 size;
+} iovm_test_queued[IOVM_FLUSH_BATCH + 1] __initdata;
+static unsigned int iovm_test_nr_queued __initdata;
+
+static struct exynos_iovmm * __init iovm_test_create(void)
+{
+	struct exynos_iovmm *vmm;
+	int cpu;
+
+	vmm = kzalloc(sizeof(*vmm), GFP_KERNEL);
+	if (!vmm)
+		return NULL;
+
+	vmm->magazines = alloc_percpu(struct iovm_magazine);
+	if (!vmm->magazines)
+		goto err_magazines;
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(vmm->magazines, cpu)->lock);
+
+	if (exynos_iommu_init_event_log(IOVMM_TO_LOG(vmm), IOVMM_LOG_LEN))
+		goto err_log;
+
+	/* TLB invalidations find no client to invalidate */
+	spin_lock_init(&iovm_test_domain.lock);
+	INIT_LIST_HEAD(&iovm_test_domain.clients_list);
+	vmm->domain = &iovm_test_domain.domain;
+
+	vmm->iova_start = IOVM_TEST_START;
+	vmm->iovm_size = IOVM_TEST_SIZE;
+	vmm->regions = RB_ROOT;
+	spin_lock_init(&vmm->vmlist_lock);
+	spin_lock_init(&vmm->flush_lock);
+	INIT_DELAYED_WORK(&vmm->flush_work, iovm_flush_work);
+	vmm->domain_name = "selftest";
+
+	return vmm;
+
+err_log:
+	free_percpu(vmm->magazines);
+err_magazines:
+	kfree(vmm);
+	return NULL;
+}
+
+static void __init iovm_test_destroy(struct exynos_iovmm *vmm)
+{
+	free_pages_exact(vmm->log.log,
+			 PAGE_ALIGN(sizeof(*vmm->log.log) * vmm->log.log_len));
+	free_percpu(vmm->magazines);
+	kfree(vmm);
+}
+
+static int __init iovm_test_check_tree(struct exynos_iovmm *vmm)
+{
+	struct exynos_vm_region *region;
+	struct rb_node *node;
+	u32 prev_end = vmm->iova_start;
+	int ret = 0;
+
+	spin_lock(&vmm->vmlist_lock);
+	for (node = rb_first(&vmm->regions); node; node = rb_next(node)) {
+		region = rb_to_region(node);
+		if (iovm_region_base(region) < prev_end ||
+		    (u64)iovm_region_end(region) >
+				(u64)vmm->iova_start + vmm->iovm_size ||
+		    region->gap != iovm_region_base(region) - prev_end ||
+		    region->subtree_max_gap != iovm_compute_max_gap(region)) {
+			pr_err("IOVMM selftest: bad region %#x (SIZE: %#x, gap %#x/%#x) after %#x\n",
+			       region->start, region->size, region->gap,
+			       region->subtree_max_gap, prev_end);
+			ret = -EINVAL;
+			break;
+		}
+		prev_end = iovm_region_end(region);
+	}
+	spin_unlock(&vmm->vmlist_lock);
+
+	return ret;
+}
+
+static inline unsigned int __init iovm_test_page(u32 iova)
+{
+	return (iova - IOVM_TEST_START) >> PAGE_SHIFT;
+}
+
+/* Drops the stale TLB entries of the regions flushed since the last call */
+static void __init iovm_test_sync_tlb(struct exynos_iovmm *vmm)
+{
+	unsigned int i = 0, j;
+
+	spin_lock(&vmm->flush_lock);
+	while (i < iovm_test_nr_queued) {
+		for (j = 0; j < vmm->nr_pending; j++)
+			if (iovm_region_base(vmm->pending[j]) ==
+						iovm_test_queued[i].base)
+				break;
+		if (j < vmm->nr_pending) {
+			i++;
+			continue;
+		}
+
+		bitmap_clear(iovm_test_stale,
+			     iovm_test_page(iovm_test_queued[i].base),
+			     iovm_test_queued[i].size >> PAGE_SHIFT);
+		iovm_test_queued[i] = iovm_test_queued[--iovm_test_nr_queued];
+	}
+	spin_unlock(&vmm->flush_lock);
+}
+
+static dma_addr_t __init iovm_test_alloc(struct exynos_iovmm *vmm, size_t size,
+				size_t section_offset, off_t page_offset,
+				u64 *ns)
+{
+	struct exynos_vm_region *region;
+	ktime_t start = ktime_get();
+	dma_addr_t iova;
+
+	iova = alloc_iovm_region(vmm, size, section_offset, page_offset);
+	*ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (!iova)
+		return 0;
+
+	region = find_iovm_region(vmm, iova);
+	if (!region || region->start + region->section_off != iova ||
+	    (iovm_region_base(region) - vmm->iova_start) & (SZ_1M - 1) ||
+	    region->size < size + section_offset ||
+	    iovm_region_end(region) >
+			vmm->iova_start + vmm->iovm_size - PAGE_SIZE) {
+		pr_err("IOVMM selftest: bad allocation %pad for %#zx(+%#zx+%#lx)\n",
+		       &iova, size, section_offset, (unsigned long)page_offset);
+		return 0;
+	}
+
+	iovm_test_sync_tlb(vmm);
+	if (find_next_bit(iovm_test_stale,
+			  iovm_test_page(iovm_region_end(region)),
+			  iovm_test_page(iovm_region_base(region))) <
+				iovm_test_page(iovm_region_end(region))) {
+		pr_err("IOVMM selftest: %pad allocated before its TLB flush\n",
+		       &iova);
+		return 0;
+	}
+
+	return iova;
+}
+
+static int __init iovm_test_free(struct exynos_iovmm *vmm, dma_addr_t iova,
+				 u64 *ns)
+{
+	struct exynos_vm_region *region;
+	ktime_t start = ktime_get();
+
+	region = remove_iovm_region(vmm, iova);
+	if (!region) {
+		pr_err("IOVMM selftest: %pad is not allocated\n", &iova);
+		return -ENOENT;
+	}
+	if (IS_ENABLED(CONFIG_EXYNOS_IOVMM_DEFERRED_FLUSH)) {
+		iovm_test_queued[iovm_test_nr_queued].base =
+					iovm_region_base(region);
+		iovm_test_queued[iovm_test_nr_queued++].size = region->size;
+		bitmap_set(iovm_test_stale,
+			   iovm_test_page(iovm_region_base(region)),
+			   region->size >> PAGE_SHIFT);
+		iovm_defer_release(vmm, region);
+	} else {
+		release_iovm_region(vmm, region);
+	}
+	*ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	iovm_test_sync_tlb(vmm);
+
+	return 0;
+}
+
+static int __init iovm_test_random(struct exynos_iovmm *vmm)
+{
+	unsigned int i, slot, nr_alloc = 0, nr_free = 0;
+	u64 alloc_ns = 0, free_ns = 0;
+	size_t size, section_offset;
+
+	for (i = 0; i < IOVM_TEST_ROUNDS; i++) {
+		slot = prandom_u32() % IOVM_TEST_LIVE;
+
+		if (iovm_test_iova[slot]) {
+			if (iovm_test_free(vmm, iovm_test_iova[slot], &free_ns))
+				return -EINVAL;
+			iovm_test_iova[slot] = 0;
+			nr_free++;
+		} else {
+			/* a few sizes only, for the magazines to be hit */
+			size = (1 << (prandom_u32() % 9)) * PAGE_SIZE;
+			section_offset = (prandom_u32() % 4) ?
+				0 : (prandom_u32() % (SZ_1M / PAGE_SIZE)) * PAGE_SIZE;
+			iovm_test_iova[slot] = iovm_test_alloc(vmm, size,
+					section_offset,
+					prandom_u32() % PAGE_SIZE, &alloc_ns);
+			if (!iovm_test_iova[slot])
+				return -ENOSPC;
+			nr_alloc++;
+		}
+
+		if (iovm_test_check_tree(vmm))
+			return -EINVAL;
+	}
+
+	for (slot = 0; slot < IOVM_TEST_LIVE; slot++) {
+		if (!iovm_test_iova[slot])
+			continue;
+		if (iovm_test_free(vmm, iovm_test_iova[slot], &free_ns))
+			return -EINVAL;
+		iovm_test_iova[slot] = 0;
+		nr_free++;
+	}
+
+	pr_info("IOVMM selftest: %u allocs %llu ns/op, %u frees %llu ns/op, %u reused, %u flushes\n",
+		nr_alloc, div_u64(alloc_ns, max(nr_alloc, 1U)),
+		nr_free, div_u64(free_ns, max(nr_free, 1U)), vmm->num_reuse,
+		vmm->num_flush);
+
+	return 0;
+}
+
+/* Fills the whole IOVM space and releases it again */
+static int __init iovm_test_fill(struct exynos_iovmm *vmm)
+{
+	unsigned int i, nr = 0;
+	u64 ns = 0;
+	int ret = 0;
+
+	while (nr < ARRAY_SIZE(iovm_test_iova)) {
+		/* takes exactly 1MB with the prefetch guard */
+		iovm_test_iova[nr] = iovm_test_alloc(vmm, SZ_1M - SZ_128K,
+						     0, 0, &ns);
+		if (!iovm_test_iova[nr])
+			break;
+		nr++;
+	}
+
+	/* every 1MB but the one holding the last page of the space */
+	if (nr != IOVM_TEST_SIZE / SZ_1M - 1 || iovm_test_check_tree(vmm)) {
+		pr_err("IOVMM selftest: %u regions allocated from %#x bytes\n",
+		       nr, IOVM_TEST_SIZE);
+		ret = -ENOSPC;
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (iovm_test_free(vmm, iovm_test_iova[i], &ns))
+			ret = -EINVAL;
+		iovm_test_iova[i] = 0;
+	}
+
+	return ret;
+}
+
+static int __init exynos_iovmm_selftest(void)
+{
+	struct exynos_iovmm *vmm;
+	int ret;
+
+	vmm = iovm_test_create();
+	if (!vmm)
+		return -ENOMEM;
+
+	ret = iovm_test_random(vmm);
+	/* the second round has to flush the releases queued by the first */
+	if (!ret)
+		ret = iovm_test_fill(vmm);
+	if (!ret)
+		ret = iovm_test_fill(vmm);
+
+	cancel_delayed_work_sync(&vmm->flush_work);
+	iovm_flush_pending(vmm);
+	iovm_test_sync_tlb(vmm);
+	if (!ret && !bitmap_empty(iovm_test_stale, IOVM_TEST_SIZE / PAGE_SIZE)) {
+		pr_err("IOVMM selftest: stale TLB entries left after the flush\n");
+		ret = -EINVAL;
+	}
+	iovm_magazine_flush(vmm);
+	if (!ret && !RB_EMPTY_ROOT(&vmm->regions)) {
+		pr_err("IOVMM selftest: regions left after releasing all\n");
+		show_iovm_regions(vmm);
+		ret = -EINVAL;
+	}
+
+	if (ret) {
+		pr_err("IOVMM selftest: FAIL (%d)\n", ret);
+		/* the regions left are leaked together with the iovmm */
+		return ret;
+	}
+
+	iovm_test_destroy(vmm);
+	pr_info("IOVMM selftest: PASS\n");
+
+	return 0;
+}
+late_initcall(exynos_iovmm_selftest);
+#endif /* CONFIG_EXYNOS_IOVMM_SELFTEST */
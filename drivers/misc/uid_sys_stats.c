@@ -27,7 +27,9 @@
 #include <linux/sched/cputime.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/uaccess.h>
+#include <linux/uid_sys_stats.h>
 
 
 #define UID_HASH_BITS	10
@@ -66,10 +68,6 @@ struct task_entry {
 
 struct uid_entry {
 	uid_t uid;
-	u64 utime;
-	u64 stime;
-	u64 active_utime;
-	u64 active_stime;
 	int state;
 	struct io_stats io[UID_STATE_SIZE];
 	struct hlist_node hash;
@@ -78,6 +76,85 @@ struct uid_entry {
 #endif
 };
 
+/*
+ * Running cputime totals per uid. They are updated from the cputime
+ * accounting path, so they are kept apart from hash_table whose rt_mutex
+ * can sleep.
+ *
+ * The totals are the sums of the tick based utime and stime accounted to
+ * the tasks of the uid, without the scaling to sum_exec_runtime that
+ * task_cputime_adjusted() applies. Interrupt time accounted to the idle
+ * task is not charged to any uid.
+ */
+struct uid_cputime {
+	uid_t uid;
+	u64 utime;
+	u64 stime;
+	struct hlist_node hash;
+	struct rcu_head rcu;
+};
+
+static DEFINE_HASHTABLE(cputime_table, UID_HASH_BITS);
+static DEFINE_SPINLOCK(cputime_lock); /* cputime_table */
+
+#define CPUTIME_DELTA_NR	16
+
+struct cputime_delta {
+	uid_t uid;
+	u64 utime;
+	u64 stime;
+};
+
+/*
+ * Per-cpu buffer of cputime not yet folded into cputime_table. The lock
+ * is only contended when a reader folds the buffers.
+ */
+struct cputime_delta_buf {
+	spinlock_t lock;
+	unsigned int nr;
+	struct cputime_delta deltas[CPUTIME_DELTA_NR];
+};
+
+static DEFINE_PER_CPU(struct cputime_delta_buf, cputime_deltas) = {
+	.lock = __SPIN_LOCK_UNLOCKED(cputime_deltas.lock),
+};
+
+/*
+ * Running io totals per uid, kept the same way as the cputime ones and
+ * updated from the task io accounting helpers. The write bytes have the
+ * cancelled writes already subtracted, so they can go back for a uid that
+ * truncates pages dirtied by another one; compute_io_bucket_stats() only
+ * adds positive deltas to the buckets.
+ */
+struct uid_io {
+	uid_t uid;
+	struct io_stats total;
+	struct hlist_node hash;
+	struct rcu_head rcu;
+};
+
+static DEFINE_HASHTABLE(io_table, UID_HASH_BITS);
+static DEFINE_SPINLOCK(io_lock); /* io_table */
+
+#define IO_DELTA_NR	16
+
+struct io_delta {
+	uid_t uid;
+	struct io_stats io;
+};
+
+/* Per-cpu buffer of io not yet folded into io_table */
+struct io_delta_buf {
+	spinlock_t lock;
+	unsigned int nr;
+	struct io_delta deltas[IO_DELTA_NR];
+};
+
+static DEFINE_PER_CPU(struct io_delta_buf, io_deltas) = {
+	.lock = __SPIN_LOCK_UNLOCKED(io_deltas.lock),
+};
+
+#ifdef CONFIG_UID_SYS_STATS_DEBUG
 static u64 compute_write_bytes(struct task_struct *task)
 {
 	if (task->ioac.write_bytes <= task->ioac.cancelled_write_bytes)
@@ -85,6 +162,16 @@ static u64 compute_write_bytes(struct task_struct *task)
 
 	return task->ioac.write_bytes - task->ioac.cancelled_write_bytes;
 }
+#endif
+
+static void add_io_stats(struct io_stats *dst, struct io_stats *src)
+{
+	dst->read_bytes += src->read_bytes;
+	dst->write_bytes += src->write_bytes;
+	dst->rchar += src->rchar;
+	dst->wchar += src->wchar;
+	dst->fsync += src->fsync;
+}
 
 static void compute_io_bucket_stats(struct io_stats *io_bucket,
 					struct io_stats *io_curr,
@@ -266,6 +353,52 @@ static void compute_io_uid_tasks(struct uid_entry *uid_entry)
 	}
 }
 
+static struct uid_entry *find_or_register_uid(uid_t uid);
+
+/*
+ * The per-uid totals are event driven, only the per-task breakdown still
+ * needs a walk of the threads, of those of @only if it is given.
+ */
+static void update_io_tasks_locked(struct uid_entry *only)
+{
+	struct uid_entry *uid_entry = NULL;
+	struct task_struct *task, *temp;
+	struct user_namespace *user_ns = current_user_ns();
+	unsigned long bkt;
+	uid_t uid;
+
+	if (only) {
+		set_io_uid_tasks_zero(only);
+	} else {
+		hash_for_each(hash_table, bkt, uid_entry, hash)
+			set_io_uid_tasks_zero(uid_entry);
+		uid_entry = NULL;
+	}
+
+	rcu_read_lock();
+	do_each_thread(temp, task) {
+		/* avoid double accounting of dying threads */
+		if (task->flags & PF_EXITING)
+			continue;
+		uid = from_kuid_munged(user_ns, task_uid(task));
+		if (only && only->uid != uid)
+			continue;
+		if (!uid_entry || uid_entry->uid != uid)
+			uid_entry = find_or_register_uid(uid);
+		if (!uid_entry)
+			continue;
+		add_uid_tasks_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
+	} while_each_thread(temp, task);
+	rcu_read_unlock();
+
+	if (only) {
+		compute_io_uid_tasks(only);
+	} else {
+		hash_for_each(hash_table, bkt, uid_entry, hash)
+			compute_io_uid_tasks(uid_entry);
+	}
+}
+
 static void show_io_uid_tasks(struct seq_file *m, struct uid_entry *uid_entry)
 {
 	struct task_entry *task_entry;
@@ -290,10 +423,7 @@ static void show_io_uid_tasks(struct seq_file *m, struct uid_entry *uid_entry)
 }
 #else
 static void remove_uid_tasks(struct uid_entry *uid_entry) {};
-static void set_io_uid_tasks_zero(struct uid_entry *uid_entry) {};
-static void add_uid_tasks_io_stats(struct uid_entry *uid_entry,
-		struct task_struct *task, int slot) {};
-static void compute_io_uid_tasks(struct uid_entry *uid_entry) {};
+static void update_io_tasks_locked(struct uid_entry *only) {};
 static void show_io_uid_tasks(struct seq_file *m,
 		struct uid_entry *uid_entry) {}
 #endif
@@ -329,55 +459,224 @@ static struct uid_entry *find_or_register_uid(uid_t uid)
 	return uid_entry;
 }
 
-static int uid_cputime_show(struct seq_file *m, void *v)
+/* Caller must hold cputime_lock */
+static struct uid_cputime *find_or_register_cputime_locked(uid_t uid)
 {
-	struct uid_entry *uid_entry = NULL;
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
-	u64 utime;
-	u64 stime;
-	unsigned long bkt;
-	uid_t uid;
+	struct uid_cputime *uid_cputime;
 
-	rt_mutex_lock(&uid_lock);
+	hash_for_each_possible(cputime_table, uid_cputime, hash, uid) {
+		if (uid_cputime->uid == uid)
+			return uid_cputime;
+	}
 
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		uid_entry->active_stime = 0;
-		uid_entry->active_utime = 0;
+	uid_cputime = kzalloc(sizeof(struct uid_cputime), GFP_ATOMIC);
+	if (!uid_cputime)
+		return NULL;
+
+	uid_cputime->uid = uid;
+	hash_add_rcu(cputime_table, &uid_cputime->hash, uid);
+
+	return uid_cputime;
+}
+
+/* Caller must hold buf->lock */
+static void cputime_fold_locked(struct cputime_delta_buf *buf)
+{
+	struct uid_cputime *uid_cputime;
+	struct cputime_delta *delta;
+	unsigned int i;
+
+	if (!buf->nr)
+		return;
+
+	spin_lock(&cputime_lock);
+	for (i = 0; i < buf->nr; i++) {
+		delta = &buf->deltas[i];
+
+		uid_cputime = find_or_register_cputime_locked(delta->uid);
+		if (!uid_cputime)
+			continue;
+
+		uid_cputime->utime += delta->utime;
+		uid_cputime->stime += delta->stime;
 	}
+	spin_unlock(&cputime_lock);
 
-	rcu_read_lock();
-	do_each_thread(temp, task) {
-		uid = from_kuid_munged(user_ns, task_uid(task));
-		if (!uid_entry || uid_entry->uid != uid)
-			uid_entry = find_or_register_uid(uid);
-		if (!uid_entry) {
-			rcu_read_unlock();
-			rt_mutex_unlock(&uid_lock);
-			pr_err("%s: failed to find the uid_entry for uid %d\n",
-				__func__, uid);
-			return -ENOMEM;
-		}
-		/* avoid double accounting of dying threads */
-		if (!(task->flags & PF_EXITING)) {
-			task_cputime_adjusted(task, &utime, &stime);
-			uid_entry->active_utime += utime;
-			uid_entry->active_stime += stime;
+	buf->nr = 0;
+}
+
+static void cputime_fold_all(void)
+{
+	struct cputime_delta_buf *buf;
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		buf = &per_cpu(cputime_deltas, cpu);
+
+		spin_lock_irqsave(&buf->lock, flags);
+		cputime_fold_locked(buf);
+		spin_unlock_irqrestore(&buf->lock, flags);
+	}
+}
+
+void uid_sys_stats_account_cputime(struct task_struct *p, u64 utime,
+				   u64 stime)
+{
+	struct cputime_delta_buf *buf;
+	struct cputime_delta *delta;
+	uid_t uid = from_kuid_munged(current_user_ns(), task_uid(p));
+	unsigned long flags;
+	unsigned int i;
+
+	/* Interrupts taken while idle do not belong to uid 0 */
+	if (is_idle_task(p))
+		return;
+
+	local_irq_save(flags);
+	buf = this_cpu_ptr(&cputime_deltas);
+	spin_lock(&buf->lock);
+
+	for (i = 0; i < buf->nr; i++) {
+		delta = &buf->deltas[i];
+		if (delta->uid == uid) {
+			delta->utime += utime;
+			delta->stime += stime;
+			goto out;
 		}
-	} while_each_thread(temp, task);
-	rcu_read_unlock();
+	}
 
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		u64 total_utime = uid_entry->utime +
-							uid_entry->active_utime;
-		u64 total_stime = uid_entry->stime +
-							uid_entry->active_stime;
-		seq_printf(m, "%d: %llu %llu\n", uid_entry->uid,
-			ktime_to_ms(total_utime) * USEC_PER_MSEC,
-			ktime_to_ms(total_stime) * USEC_PER_MSEC);
+	if (buf->nr == CPUTIME_DELTA_NR)
+		cputime_fold_locked(buf);
+
+	delta = &buf->deltas[buf->nr++];
+	delta->uid = uid;
+	delta->utime = utime;
+	delta->stime = stime;
+out:
+	spin_unlock(&buf->lock);
+	local_irq_restore(flags);
+}
+
+/* Caller must hold io_lock */
+static struct uid_io *find_or_register_io_locked(uid_t uid)
+{
+	struct uid_io *uid_io;
+
+	hash_for_each_possible(io_table, uid_io, hash, uid) {
+		if (uid_io->uid == uid)
+			return uid_io;
 	}
 
-	rt_mutex_unlock(&uid_lock);
+	uid_io = kzalloc(sizeof(struct uid_io), GFP_ATOMIC);
+	if (!uid_io)
+		return NULL;
+
+	uid_io->uid = uid;
+	hash_add_rcu(io_table, &uid_io->hash, uid);
+
+	return uid_io;
+}
+
+/* Caller must hold buf->lock */
+static void io_fold_locked(struct io_delta_buf *buf)
+{
+	struct uid_io *uid_io;
+	unsigned int i;
+
+	if (!buf->nr)
+		return;
+
+	spin_lock(&io_lock);
+	for (i = 0; i < buf->nr; i++) {
+		uid_io = find_or_register_io_locked(buf->deltas[i].uid);
+		if (uid_io)
+			add_io_stats(&uid_io->total, &buf->deltas[i].io);
+	}
+	spin_unlock(&io_lock);
+
+	buf->nr = 0;
+}
+
+static void io_fold_all(void)
+{
+	struct io_delta_buf *buf;
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		buf = &per_cpu(io_deltas, cpu);
+
+		spin_lock_irqsave(&buf->lock, flags);
+		io_fold_locked(buf);
+		spin_unlock_irqrestore(&buf->lock, flags);
+	}
+}
+
+void uid_sys_stats_account_io(struct task_struct *p, enum uid_io_stat stat,
+			      s64 amount)
+{
+	struct io_delta_buf *buf;
+	struct io_delta *delta;
+	uid_t uid = from_kuid_munged(current_user_ns(), task_uid(p));
+	unsigned long flags;
+	unsigned int i;
+
+	local_irq_save(flags);
+	buf = this_cpu_ptr(&io_deltas);
+	spin_lock(&buf->lock);
+
+	for (i = 0; i < buf->nr; i++) {
+		if (buf->deltas[i].uid == uid)
+			goto found;
+	}
+
+	if (buf->nr == IO_DELTA_NR)
+		io_fold_locked(buf);
+
+	i = buf->nr++;
+	buf->deltas[i].uid = uid;
+	memset(&buf->deltas[i].io, 0, sizeof(struct io_stats));
+found:
+	delta = &buf->deltas[i];
+
+	switch (stat) {
+	case UID_IO_RCHAR:
+		delta->io.rchar += amount;
+		break;
+	case UID_IO_WCHAR:
+		delta->io.wchar += amount;
+		break;
+	case UID_IO_READ_BYTES:
+		delta->io.read_bytes += amount;
+		break;
+	case UID_IO_WRITE_BYTES:
+		delta->io.write_bytes += amount;
+		break;
+	case UID_IO_FSYNC:
+		delta->io.fsync += amount;
+		break;
+	}
+
+	spin_unlock(&buf->lock);
+	local_irq_restore(flags);
+}
+
+static int uid_cputime_show(struct seq_file *m, void *v)
+{
+	struct uid_cputime *uid_cputime;
+	unsigned long bkt;
+
+	cputime_fold_all();
+
+	rcu_read_lock();
+	hash_for_each_rcu(cputime_table, bkt, uid_cputime, hash) {
+		seq_printf(m, "%d: %llu %llu\n", uid_cputime->uid,
+			ktime_to_ms(uid_cputime->utime) * USEC_PER_MSEC,
+			ktime_to_ms(uid_cputime->stime) * USEC_PER_MSEC);
+	}
+	rcu_read_unlock();
+
 	return 0;
 }
 
@@ -402,10 +701,14 @@ static ssize_t uid_remove_write(struct file *file,
 			const char __user *buffer, size_t count, loff_t *ppos)
 {
 	struct uid_entry *uid_entry;
+	struct uid_cputime *uid_cputime;
+	struct uid_io *uid_io;
 	struct hlist_node *tmp;
 	char uids[128];
 	char *start_uid, *end_uid = NULL;
 	long int uid_start = 0, uid_end = 0;
+	long int uid;
+	unsigned long flags;
 
 	if (count >= sizeof(uids))
 		count = sizeof(uids) - 1;
@@ -428,6 +731,34 @@ static ssize_t uid_remove_write(struct file *file,
 	/* Also remove uids from /proc/uid_time_in_state */
 	cpufreq_task_times_remove_uids(uid_start, uid_end);
 
+	/* Otherwise pending deltas would register the removed uids again */
+	cputime_fold_all();
+	io_fold_all();
+
+	spin_lock_irqsave(&cputime_lock, flags);
+	for (uid = uid_start; uid <= uid_end; uid++) {
+		hash_for_each_possible_safe(cputime_table, uid_cputime, tmp,
+							hash, (uid_t)uid) {
+			if (uid == uid_cputime->uid) {
+				hash_del_rcu(&uid_cputime->hash);
+				kfree_rcu(uid_cputime, rcu);
+			}
+		}
+	}
+	spin_unlock_irqrestore(&cputime_lock, flags);
+
+	spin_lock_irqsave(&io_lock, flags);
+	for (uid = uid_start; uid <= uid_end; uid++) {
+		hash_for_each_possible_safe(io_table, uid_io, tmp,
+							hash, (uid_t)uid) {
+			if (uid == uid_io->uid) {
+				hash_del_rcu(&uid_io->hash);
+				kfree_rcu(uid_io, rcu);
+			}
+		}
+	}
+	spin_unlock_irqrestore(&io_lock, flags);
+
 	rt_mutex_lock(&uid_lock);
 
 	for (; uid_start <= uid_end; uid_start++) {
@@ -452,80 +783,54 @@ static const struct file_operations uid_remove_fops = {
 };
 
 
-static void add_uid_io_stats(struct uid_entry *uid_entry,
-			struct task_struct *task, int slot)
+/* Caller must hold uid_lock, @total is the running total of the uid */
+static void update_io_stats_uid_locked(struct uid_entry *uid_entry,
+				       struct io_stats *total)
 {
-	struct io_stats *io_slot = &uid_entry->io[slot];
-
-	/* avoid double accounting of dying threads */
-	if (slot != UID_STATE_DEAD_TASKS && (task->flags & PF_EXITING))
-		return;
-
-	io_slot->read_bytes += task->ioac.read_bytes;
-	io_slot->write_bytes += compute_write_bytes(task);
-	io_slot->rchar += task->ioac.rchar;
-	io_slot->wchar += task->ioac.wchar;
-	io_slot->fsync += task->ioac.syscfs;
+	uid_entry->io[UID_STATE_TOTAL_CURR] = *total;
 
-	add_uid_tasks_io_stats(uid_entry, task, slot);
+	compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
+				&uid_entry->io[UID_STATE_TOTAL_CURR],
+				&uid_entry->io[UID_STATE_TOTAL_LAST],
+				&uid_entry->io[UID_STATE_DEAD_TASKS]);
 }
 
 static void update_io_stats_all_locked(void)
 {
-	struct uid_entry *uid_entry = NULL;
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
+	struct uid_entry *uid_entry;
+	struct uid_io *uid_io;
 	unsigned long bkt;
-	uid_t uid;
 
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
-			sizeof(struct io_stats));
-		set_io_uid_tasks_zero(uid_entry);
-	}
+	io_fold_all();
 
 	rcu_read_lock();
-	do_each_thread(temp, task) {
-		uid = from_kuid_munged(user_ns, task_uid(task));
-		if (!uid_entry || uid_entry->uid != uid)
-			uid_entry = find_or_register_uid(uid);
+	hash_for_each_rcu(io_table, bkt, uid_io, hash) {
+		uid_entry = find_or_register_uid(uid_io->uid);
 		if (!uid_entry)
 			continue;
-		add_uid_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
-	} while_each_thread(temp, task);
+		update_io_stats_uid_locked(uid_entry, &uid_io->total);
+	}
 	rcu_read_unlock();
 
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
-					&uid_entry->io[UID_STATE_TOTAL_CURR],
-					&uid_entry->io[UID_STATE_TOTAL_LAST],
-					&uid_entry->io[UID_STATE_DEAD_TASKS]);
-		compute_io_uid_tasks(uid_entry);
-	}
+	update_io_tasks_locked(NULL);
 }
 
-static void update_io_stats_uid_locked(struct uid_entry *uid_entry)
+static void update_io_stats_one_locked(struct uid_entry *uid_entry)
 {
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
+	struct uid_io *uid_io;
 
-	memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
-		sizeof(struct io_stats));
-	set_io_uid_tasks_zero(uid_entry);
+	io_fold_all();
 
 	rcu_read_lock();
-	do_each_thread(temp, task) {
-		if (from_kuid_munged(user_ns, task_uid(task)) != uid_entry->uid)
-			continue;
-		add_uid_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
-	} while_each_thread(temp, task);
+	hash_for_each_possible_rcu(io_table, uid_io, hash, uid_entry->uid) {
+		if (uid_io->uid == uid_entry->uid) {
+			update_io_stats_uid_locked(uid_entry, &uid_io->total);
+			break;
+		}
+	}
 	rcu_read_unlock();
 
-	compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
-				&uid_entry->io[UID_STATE_TOTAL_CURR],
-				&uid_entry->io[UID_STATE_TOTAL_LAST],
-				&uid_entry->io[UID_STATE_DEAD_TASKS]);
-	compute_io_uid_tasks(uid_entry);
+	update_io_tasks_locked(uid_entry);
 }
 
 
@@ -612,7 +917,7 @@ static ssize_t uid_procstat_write(struct file *file,
 		return count;
 	}
 
-	update_io_stats_uid_locked(uid_entry);
+	update_io_stats_one_locked(uid_entry);
 
 	uid_entry->state = state;
 
@@ -627,12 +932,16 @@ static const struct file_operations uid_procstat_fops = {
 	.write		= uid_procstat_write,
 };
 
+#ifdef CONFIG_UID_SYS_STATS_DEBUG
+/*
+ * The per-uid io of a task has already been accounted while it ran, only
+ * the per-task breakdown keeps what the dead tasks did.
+ */
 static int process_notifier(struct notifier_block *self,
 			unsigned long cmd, void *v)
 {
 	struct task_struct *task = v;
 	struct uid_entry *uid_entry;
-	u64 utime, stime;
 	uid_t uid;
 
 	if (!task)
@@ -646,11 +955,7 @@ static int process_notifier(struct notifier_block *self,
 		goto exit;
 	}
 
-	task_cputime_adjusted(task, &utime, &stime);
-	uid_entry->utime += utime;
-	uid_entry->stime += stime;
-
-	add_uid_io_stats(uid_entry, task, UID_STATE_DEAD_TASKS);
+	add_uid_tasks_io_stats(uid_entry, task, UID_STATE_DEAD_TASKS);
 
 exit:
 	rt_mutex_unlock(&uid_lock);
@@ -660,6 +965,7 @@ exit:
 static struct notifier_block process_notifier_block = {
 	.notifier_call	= process_notifier,
 };
+#endif
 
 static int __init proc_uid_sys_stats_init(void)
 {
@@ -697,7 +1003,9 @@ static int __init proc_uid_sys_stats_init(void)
 	proc_create_data("set", 0222, proc_parent,
 		&uid_procstat_fops, NULL);
 
+#ifdef CONFIG_UID_SYS_STATS_DEBUG
 	profile_event_register(PROFILE_TASK_EXIT, &process_notifier_block);
+#endif
 
 	return 0;
 
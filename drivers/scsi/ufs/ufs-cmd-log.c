@@ -0,0 +1,376 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Binary UFS command log and latency histograms
+ *
+ * A command is recorded in a slot of its tag on submission and dispatch, and
+ * copied to the ring of the completing cpu on completion. The completion path
+ * runs with interrupts disabled, so a ring and a histogram of a cpu are only
+ * written by that cpu and need no lock. Readers in debugfs take a snapshot
+ * without stopping the writers, so an entry written during the read may be
+ * torn.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <scsi/scsi_proto.h>
+
+#include "ufs-cmd-log.h"
+
+struct ufs_cmd_log_cpu {
+	unsigned int head;
+	struct ufs_cmd_log_entry ring[UFS_CMD_LOG_RING_SIZE];
+	u32 hist[UFS_CMD_LOG_NR_OPS][UFS_CMD_LOG_QD_BUCKETS]
+		[UFS_CMD_LOG_LAT_BUCKETS];
+};
+
+struct ufs_cmd_log {
+	bool enabled;
+	unsigned int nr_tags;
+	struct ufs_cmd_log_cpu __percpu *cpu;
+	struct dentry *debugfs;
+	struct ufs_cmd_log_entry inflight[];
+};
+
+static const char * const ufs_cmd_log_op_name[UFS_CMD_LOG_NR_OPS] = {
+	[UFS_CMD_LOG_READ]	= "read",
+	[UFS_CMD_LOG_WRITE]	= "write",
+	[UFS_CMD_LOG_FLUSH]	= "flush",
+	[UFS_CMD_LOG_UNMAP]	= "unmap",
+	[UFS_CMD_LOG_OTHER]	= "other",
+};
+
+static enum ufs_cmd_log_op ufs_cmd_log_op(u8 opcode)
+{
+	switch (opcode) {
+	case READ_6:
+	case READ_10:
+	case READ_16:
+		return UFS_CMD_LOG_READ;
+	case WRITE_6:
+	case WRITE_10:
+	case WRITE_16:
+		return UFS_CMD_LOG_WRITE;
+	case SYNCHRONIZE_CACHE:
+		return UFS_CMD_LOG_FLUSH;
+	case UNMAP:
+		return UFS_CMD_LOG_UNMAP;
+	default:
+		return UFS_CMD_LOG_OTHER;
+	}
+}
+
+static unsigned int ufs_cmd_log_qd_bucket(unsigned int qdepth)
+{
+	if (!qdepth)
+		return 0;
+
+	return min_t(unsigned int, fls(qdepth - 1), UFS_CMD_LOG_QD_BUCKETS - 1);
+}
+
+static unsigned int ufs_cmd_log_lat_bucket(u32 ns)
+{
+	return min_t(unsigned int, fls((ns / NSEC_PER_USEC) >> 4),
+		     UFS_CMD_LOG_LAT_BUCKETS - 1);
+}
+
+static u32 ufs_cmd_log_delta(u64 now, u64 then)
+{
+	return (u32)min_t(u64, now - then, U32_MAX);
+}
+
+void ufs_cmd_log_submit(struct ufs_cmd_log *log, unsigned int tag,
+			u8 opcode, u64 lba, u32 len)
+{
+	struct ufs_cmd_log_entry *ent;
+
+	if (!log || !READ_ONCE(log->enabled) || tag >= log->nr_tags)
+		return;
+
+	ent = &log->inflight[tag];
+	ent->submit = local_clock();
+	ent->lba = lba;
+	ent->dispatch = 0;
+	ent->complete = 0;
+	ent->len = len;
+	ent->opcode = opcode;
+	ent->tag = tag;
+	ent->qdepth = 0;
+}
+
+void ufs_cmd_log_dispatch(struct ufs_cmd_log *log, unsigned int tag,
+			  unsigned int qdepth)
+{
+	struct ufs_cmd_log_entry *ent;
+
+	if (!log || tag >= log->nr_tags)
+		return;
+
+	ent = &log->inflight[tag];
+	if (!ent->submit)
+		return;
+
+	ent->dispatch = ufs_cmd_log_delta(local_clock(), ent->submit);
+	ent->qdepth = min_t(unsigned int, qdepth, U8_MAX);
+}
+
+/* should be called with interrupts disabled */
+void ufs_cmd_log_complete(struct ufs_cmd_log *log, unsigned int tag)
+{
+	struct ufs_cmd_log_entry *ent;
+	struct ufs_cmd_log_cpu *lc;
+
+	if (!log || tag >= log->nr_tags)
+		return;
+
+	ent = &log->inflight[tag];
+	if (!ent->submit)
+		return;
+
+	ent->complete = ufs_cmd_log_delta(local_clock(), ent->submit);
+	ent->cpu = smp_processor_id();
+
+	lc = this_cpu_ptr(log->cpu);
+	lc->ring[lc->head & (UFS_CMD_LOG_RING_SIZE - 1)] = *ent;
+	lc->head++;
+
+	lc->hist[ufs_cmd_log_op(ent->opcode)]
+		[ufs_cmd_log_qd_bucket(ent->qdepth)]
+		[ufs_cmd_log_lat_bucket(ent->complete)]++;
+
+	/* the tag is recorded again on the next submission */
+	ent->submit = 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+struct ufs_cmd_log_snapshot {
+	size_t size;
+	struct ufs_cmd_log_entry ent[];
+};
+
+static int ufs_cmd_log_ring_open(struct inode *inode, struct file *file)
+{
+	struct ufs_cmd_log *log = inode->i_private;
+	struct ufs_cmd_log_snapshot *snap;
+	size_t nr = 0;
+	int cpu;
+
+	snap = vmalloc(sizeof(*snap) + sizeof(snap->ent[0]) *
+		       UFS_CMD_LOG_RING_SIZE * num_possible_cpus());
+	if (!snap)
+		return -ENOMEM;
+
+	/* oldest first on each cpu */
+	for_each_possible_cpu(cpu) {
+		struct ufs_cmd_log_cpu *lc = per_cpu_ptr(log->cpu, cpu);
+		unsigned int head = READ_ONCE(lc->head);
+		unsigned int i = head > UFS_CMD_LOG_RING_SIZE ?
+				 head - UFS_CMD_LOG_RING_SIZE : 0;
+
+		for (; i != head; i++)
+			snap->ent[nr++] =
+				lc->ring[i & (UFS_CMD_LOG_RING_SIZE - 1)];
+	}
+	snap->size = nr * sizeof(snap->ent[0]);
+
+	file->private_data = snap;
+
+	return 0;
+}
+
+static ssize_t ufs_cmd_log_ring_read(struct file *file, char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	struct ufs_cmd_log_snapshot *snap = file->private_data;
+
+	return simple_read_from_buffer(buf, count, ppos, snap->ent, snap->size);
+}
+
+static int ufs_cmd_log_ring_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+
+	return 0;
+}
+
+static const struct file_operations ufs_cmd_log_ring_fops = {
+	.open = ufs_cmd_log_ring_open,
+	.read = ufs_cmd_log_ring_read,
+	.llseek = default_llseek,
+	.release = ufs_cmd_log_ring_release,
+};
+
+static int ufs_cmd_log_hist_show(struct seq_file *s, void *unused)
+{
+	struct ufs_cmd_log *log = s->private;
+	u32 hist[UFS_CMD_LOG_LAT_BUCKETS];
+	int op, qd, lat, cpu;
+
+	seq_printf(s, "%-6s %-5s", "op", "qd");
+	for (lat = 0; lat < UFS_CMD_LOG_LAT_BUCKETS - 1; lat++)
+		seq_printf(s, " %7uus", 16U << lat);
+	seq_printf(s, " %7s\n", "over");
+
+	for (op = 0; op < UFS_CMD_LOG_NR_OPS; op++) {
+		for (qd = 0; qd < UFS_CMD_LOG_QD_BUCKETS; qd++) {
+			bool empty = true;
+
+			memset(hist, 0, sizeof(hist));
+			for_each_possible_cpu(cpu) {
+				struct ufs_cmd_log_cpu *lc =
+					per_cpu_ptr(log->cpu, cpu);
+
+				for (lat = 0; lat < UFS_CMD_LOG_LAT_BUCKETS;
+				     lat++)
+					hist[lat] += READ_ONCE(lc->hist[op][qd][lat]);
+			}
+
+			for (lat = 0; lat < UFS_CMD_LOG_LAT_BUCKETS; lat++)
+				if (hist[lat])
+					empty = false;
+			if (empty)
+				continue;
+
+			seq_printf(s, "%-6s %5u", ufs_cmd_log_op_name[op],
+				   qd ? 1U << qd : 1U);
+			for (lat = 0; lat < UFS_CMD_LOG_LAT_BUCKETS; lat++)
+				seq_printf(s, " %9u", hist[lat]);
+			seq_putc(s, '\n');
+		}
+	}
+
+	return 0;
+}
+
+static int ufs_cmd_log_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufs_cmd_log_hist_show, inode->i_private);
+}
+
+/* any write resets the histograms */
+static ssize_t ufs_cmd_log_hist_write(struct file *file,
+				      const char __user *buf,
+				      size_t count, loff_t *ppos)
+{
+	struct ufs_cmd_log *log = file_inode(file)->i_private;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ufs_cmd_log_cpu *lc = per_cpu_ptr(log->cpu, cpu);
+
+		memset(lc->hist, 0, sizeof(lc->hist));
+	}
+
+	return count;
+}
+
+static const struct file_operations ufs_cmd_log_hist_fops = {
+	.open = ufs_cmd_log_hist_open,
+	.read = seq_read,
+	.write = ufs_cmd_log_hist_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* debugfs/ufs_cmd_log/ holds a directory for each host */
+static struct dentry *ufs_cmd_log_root;
+static unsigned int ufs_cmd_log_nr_hosts;
+static DEFINE_MUTEX(ufs_cmd_log_root_lock);
+
+static void ufs_cmd_log_init_debugfs(struct ufs_cmd_log *log,
+				     const char *name)
+{
+	struct dentry *root;
+
+	mutex_lock(&ufs_cmd_log_root_lock);
+	if (!ufs_cmd_log_root) {
+		root = debugfs_create_dir("ufs_cmd_log", NULL);
+		if (!IS_ERR_OR_NULL(root))
+			ufs_cmd_log_root = root;
+	}
+	if (ufs_cmd_log_root) {
+		log->debugfs = debugfs_create_dir(name, ufs_cmd_log_root);
+		if (IS_ERR_OR_NULL(log->debugfs))
+			log->debugfs = NULL;
+		else
+			ufs_cmd_log_nr_hosts++;
+	}
+	mutex_unlock(&ufs_cmd_log_root_lock);
+
+	if (!log->debugfs)
+		return;
+
+	debugfs_create_bool("enable", 0644, log->debugfs, &log->enabled);
+	debugfs_create_file("ring", 0400, log->debugfs, log,
+			    &ufs_cmd_log_ring_fops);
+	debugfs_create_file("latency", 0600, log->debugfs, log,
+			    &ufs_cmd_log_hist_fops);
+}
+
+static void ufs_cmd_log_remove_debugfs(struct ufs_cmd_log *log)
+{
+	if (!log->debugfs)
+		return;
+
+	debugfs_remove_recursive(log->debugfs);
+
+	mutex_lock(&ufs_cmd_log_root_lock);
+	if (--ufs_cmd_log_nr_hosts == 0) {
+		debugfs_remove(ufs_cmd_log_root);
+		ufs_cmd_log_root = NULL;
+	}
+	mutex_unlock(&ufs_cmd_log_root_lock);
+}
+#else
+static void ufs_cmd_log_init_debugfs(struct ufs_cmd_log *log,
+				     const char *name)
+{
+}
+
+static void ufs_cmd_log_remove_debugfs(struct ufs_cmd_log *log)
+{
+}
+#endif
+
+struct ufs_cmd_log *ufs_cmd_log_create(const char *name,
+				       unsigned int nr_tags)
+{
+	struct ufs_cmd_log *log;
+
+	if (WARN_ON(nr_tags > U8_MAX + 1))
+		return NULL;
+
+	log = kzalloc(sizeof(*log) + sizeof(log->inflight[0]) * nr_tags,
+		      GFP_KERNEL);
+	if (!log)
+		return NULL;
+
+	log->cpu = alloc_percpu(struct ufs_cmd_log_cpu);
+	if (!log->cpu) {
+		kfree(log);
+		return NULL;
+	}
+
+	log->nr_tags = nr_tags;
+	log->enabled = true;
+
+	ufs_cmd_log_init_debugfs(log, name);
+
+	return log;
+}
+
+void ufs_cmd_log_destroy(struct ufs_cmd_log *log)
+{
+	if (!log)
+		return;
+
+	ufs_cmd_log_remove_debugfs(log);
+	free_percpu(log->cpu);
+	kfree(log);
+}
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Binary UFS command log and latency histograms
+ *
+ * The log knows nothing about the host controller. The driver reports the
+ * submission, the doorbell and the completion of a tag, and the log keeps the
+ * last commands completed on each cpu and a latency histogram per opcode
+ * class and queue depth.
+ */
+
+#ifndef _UFS_CMD_LOG_H
+#define _UFS_CMD_LOG_H
+
+#include <linux/types.h>
+
+/* commands kept per cpu, must be a power of 2 */
+#define UFS_CMD_LOG_RING_SIZE		256
+
+/* queue depth: 1, 2, 3-4, 5-8, 9-16, 17- */
+#define UFS_CMD_LOG_QD_BUCKETS		6
+/* latency: -16us, -32us, -64us, ... , -256ms, 256ms- */
+#define UFS_CMD_LOG_LAT_BUCKETS		16
+
+enum ufs_cmd_log_op {
+	UFS_CMD_LOG_READ,
+	UFS_CMD_LOG_WRITE,
+	UFS_CMD_LOG_FLUSH,
+	UFS_CMD_LOG_UNMAP,
+	UFS_CMD_LOG_OTHER,
+	UFS_CMD_LOG_NR_OPS,
+};
+
+/*
+ * An entry of the binary log read from debugfs. Times are in ns and the
+ * dispatch and complete times are relative to the submission.
+ */
+struct ufs_cmd_log_entry {
+	u64	submit;
+	u64	lba;		/* in 512 byte sectors */
+	u32	dispatch;
+	u32	complete;
+	u32	len;		/* in bytes */
+	u8	opcode;
+	u8	tag;
+	u8	qdepth;		/* outstanding commands at dispatch */
+	u8	cpu;		/* cpu that completed the command */
+};
+
+struct ufs_cmd_log;
+
+#ifdef CONFIG_SCSI_UFS_CMD_LOG
+struct ufs_cmd_log *ufs_cmd_log_create(const char *name,
+				       unsigned int nr_tags);
+void ufs_cmd_log_destroy(struct ufs_cmd_log *log);
+void ufs_cmd_log_submit(struct ufs_cmd_log *log, unsigned int tag,
+			u8 opcode, u64 lba, u32 len);
+void ufs_cmd_log_dispatch(struct ufs_cmd_log *log, unsigned int tag,
+			  unsigned int qdepth);
+void ufs_cmd_log_complete(struct ufs_cmd_log *log, unsigned int tag);
+#else
+static inline struct ufs_cmd_log *ufs_cmd_log_create(const char *name,
+						     unsigned int nr_tags)
+{
+	return NULL;
+}
+static inline void ufs_cmd_log_destroy(struct ufs_cmd_log *log) {}
+static inline void ufs_cmd_log_submit(struct ufs_cmd_log *log,
+				      unsigned int tag, u8 opcode,
+				      u64 lba, u32 len) {}
+static inline void ufs_cmd_log_dispatch(struct ufs_cmd_log *log,
+					unsigned int tag,
+					unsigned int qdepth) {}
+static inline void ufs_cmd_log_complete(struct ufs_cmd_log *log,
+					unsigned int tag) {}
+#endif
+
+#endif /* _UFS_CMD_LOG_H */
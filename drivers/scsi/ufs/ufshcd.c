@@ -2937,6 +2937,9 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 		goto out;
 	}
 
+	ufs_cmd_log_submit(hba->cmd_log, tag, cmd->cmnd[0],
+			   blk_rq_pos(cmd->request), blk_rq_bytes(cmd->request));
+
 	err = ufshcd_hold(hba, true);
 	if (err) {
 		err = SCSI_MLQUEUE_HOST_BUSY;
@@ -2985,6 +2988,8 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 #ifdef CONFIG_SCSI_UFS_CMD_LOGGING
 	exynos_ufs_cmd_log_start(hba, cmd);
 #endif
+	ufs_cmd_log_dispatch(hba->cmd_log, tag,
+			     hweight_long(hba->outstanding_reqs) + 1);
 	ufshcd_send_command(hba, tag);
 
 	if (hba->monitor.flag & UFSHCD_MONITOR_LEVEL1)
@@ -5667,6 +5672,7 @@ static void __ufshcd_transfer_req_compl(struct ufs_hba *hba, int reason,
 			cmd->result = result;
 			if (reason)
 				set_host_byte(cmd, reason);
+			ufs_cmd_log_complete(hba->cmd_log, index);
 			ufshcd_complete_lrbp_crypto(hba, cmd, lrbp);
 			/* Mark completed command as NULL in LRB */
 			lrbp->cmd = NULL;
@@ -9730,6 +9736,8 @@ void ufshcd_remove(struct ufs_hba *hba)
 	if (ufshcd_is_clkscaling_supported(hba))
 		device_remove_file(hba->dev, &hba->clk_scaling.enable_attr);
 #endif
+	ufs_cmd_log_destroy(hba->cmd_log);
+	hba->cmd_log = NULL;
 	ufshcd_hba_exit(hba);
 }
 EXPORT_SYMBOL_GPL(ufshcd_remove);
@@ -10034,6 +10042,8 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 	 */
 	ufshcd_set_ufs_dev_poweroff(hba);
 
+	hba->cmd_log = ufs_cmd_log_create(dev_name(hba->dev), hba->nutrs);
+
 	async_schedule(ufshcd_async_scan, hba);
 	ufshcd_add_sysfs_nodes(hba);
 
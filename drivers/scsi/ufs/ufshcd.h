@@ -71,6 +71,7 @@
 #include "ufs.h"
 #include "ufshci.h"
 #include "ufs_quirks.h"
+#include "ufs-cmd-log.h"
 
 #define UFSHCD "ufshcd"
 #define UFSHCD_DRIVER_VERSION "0.2"
@@ -917,6 +918,7 @@ struct ufs_hba {
 	struct SEC_UFS_TW_info SEC_tw_info_old;
 
 	struct ufs_monitor monitor;
+	struct ufs_cmd_log *cmd_log;
 
 	enum bkops_status urgent_bkops_lvl;
 	bool is_urgent_bkops_lvl_checked;
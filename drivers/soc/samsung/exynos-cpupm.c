@@ -11,6 +11,7 @@
 #include <linux/cpumask.h>
 #include <linux/slab.h>
 #include <linux/tick.h>
+#include <linux/timex.h>
 #include <linux/psci.h>
 #include <linux/cpuhotplug.h>
 #include <linux/cpuidle_profiler.h>
@@ -429,6 +430,15 @@ struct power_mode {
 	/* cpus belonging to the power domain */
 	struct cpumask	siblings;
 
+	/*
+	 * Among siblings, the cpus in POWERDOWN state and the earliest time
+	 * one of them is expected to wake up. They are updated by each cpu
+	 * entering and exiting idle, so the entry decision does not have to
+	 * visit the siblings.
+	 */
+	struct cpumask	idle_cpus;
+	ktime_t		next_wakeup;
+
 	/*
 	 * Among siblings, the cpus that can enter the power mode.
 	 * Due to H/W constraint, only certain cpus need to enter power mode.
@@ -466,6 +476,12 @@ struct exynos_cpupm {
 	/* cpu state, RUN or POWERDOWN */
 	int			state;
 
+	/* expected wakeup time of the cpu, valid in POWERDOWN state */
+	ktime_t			next_wakeup;
+
+	/* wakeup time of the next timer event, valid in POWERDOWN state */
+	ktime_t			next_event;
+
 	/* array to manage the power mode that contains the cpu */
 	struct power_mode *	modes[MAX_MODE];
 };
@@ -552,43 +568,121 @@ void enable_power_mode(int cpu, int type)
 	spin_unlock(&cpupm_lock);
 }
 
-/* get sleep length of given cpu from tickless framework */
-static s64 get_sleep_length(int cpu)
+/*
+ * set wakeup time of given cpu from tickless framework. If the idle
+ * governor expects the cpu to be woken up by a non-timer event earlier,
+ * the expected wakeup time is used instead. The prediction is only a hint,
+ * one that is already due is ignored. It is called by the cpu itself
+ * entering idle.
+ */
+static void set_next_wakeup(int cpu, struct exynos_cpupm *pm)
+{
+	ktime_t predicted = cpuidle_predicted_wakeup(cpu);
+
+	pm->next_event = *(get_next_event_cpu(cpu));
+	pm->next_wakeup = pm->next_event;
+
+	if (ktime_before(predicted, pm->next_event) &&
+			ktime_after(predicted, ktime_get()))
+		pm->next_wakeup = predicted;
+}
+
+/*
+ * update_idle_cpus/clear_idle_cpus
+ * Maintain the idle cpus and the earliest wakeup of the power mode. The
+ * earliest wakeup only has to be recalculated when the cpu that provided
+ * it wakes up, which is not on the idle entry path.
+ */
+static void update_idle_cpus(int cpu, struct power_mode *mode)
+{
+	struct exynos_cpupm *pm = &per_cpu(cpupm, cpu);
+
+	cpumask_set_cpu(cpu, &mode->idle_cpus);
+
+	if (ktime_before(pm->next_wakeup, mode->next_wakeup))
+		mode->next_wakeup = pm->next_wakeup;
+}
+
+static void clear_idle_cpus(int cpu, struct power_mode *mode)
+{
+	struct exynos_cpupm *pm = &per_cpu(cpupm, cpu);
+	ktime_t next_wakeup = KTIME_MAX;
+	int i;
+
+	cpumask_clear_cpu(cpu, &mode->idle_cpus);
+
+	if (mode->next_wakeup != pm->next_wakeup)
+		return;
+
+	for_each_cpu(i, &mode->idle_cpus) {
+		ktime_t t = per_cpu(cpupm, i).next_wakeup;
+
+		if (ktime_before(t, next_wakeup))
+			next_wakeup = t;
+	}
+
+	mode->next_wakeup = next_wakeup;
+}
+
+/*
+ * A cpu that is still idle after its predicted wakeup was mispredicted, it
+ * is expected to wake up for its next timer event instead. Replace the
+ * expired predictions of the idle cpus and recalculate the earliest wakeup,
+ * otherwise it would veto the power mode until that cpu wakes up.
+ */
+static ktime_t expire_predictions(struct power_mode *mode, ktime_t now)
 {
-	return ktime_to_us(ktime_sub(*(get_next_event_cpu(cpu)), ktime_get()));
+	ktime_t next_wakeup = KTIME_MAX;
+	int i;
+
+	for_each_cpu_and(i, &mode->idle_cpus, cpu_online_mask) {
+		struct exynos_cpupm *pm = &per_cpu(cpupm, i);
+
+		if (!ktime_after(pm->next_wakeup, now))
+			pm->next_wakeup = pm->next_event;
+
+		if (ktime_before(pm->next_wakeup, next_wakeup))
+			next_wakeup = pm->next_wakeup;
+	}
+
+	mode->next_wakeup = next_wakeup;
+
+	return next_wakeup;
 }
 
-static int cpus_busy(int target_residency, const struct cpumask *cpus)
+static int cpus_busy(int target_residency, struct power_mode *mode)
 {
-	unsigned int cpu;
-	int leader_cpu = per_cpu(clhead_cpu, cpumask_any(cpus));
+	int leader_cpu = per_cpu(clhead_cpu, cpumask_any(&mode->siblings));
 	struct freqvariant_idlefactor *pfv_factor = &per_cpu(fv_ifactor, leader_cpu);
-	unsigned int tmp_cur_freqvar_if;
-	unsigned long flags;
+	struct cpumask running;
+	ktime_t now, next_wakeup;
 
 	/* target residency for system-wide c-state (CPD/SICD) is
-	 * re-evaluated in accordance with the current frequency variant idle factor (cur_freqvar_if)
+	 * re-evaluated in accordance with the current frequency variant idle factor (cur_freqvar_if).
+	 * cur_freqvar_if is a single word updated under freqvar_if_lock, so
+	 * it is read without taking the lock on the idle entry path.
 	 */
-	spin_lock_irqsave(&pfv_factor->freqvar_if_lock, flags);
-	tmp_cur_freqvar_if = pfv_factor->cur_freqvar_if;
-	spin_unlock_irqrestore(&pfv_factor->freqvar_if_lock, flags);
-
-	target_residency = (target_residency * tmp_cur_freqvar_if) / 100;
+	target_residency = (target_residency * READ_ONCE(pfv_factor->cur_freqvar_if)) / 100;
 
 	/*
-	 * If there is even one cpu which is not in POWERDOWN state or has
-	 * the smaller sleep length than target_residency, CPUPM regards
-	 * it as BUSY.
+	 * If there is even one cpu which is not in POWERDOWN state,
+	 * CPUPM regards it as BUSY.
 	 */
-	for_each_cpu_and(cpu, cpu_online_mask, cpus) {
-		struct exynos_cpupm *pm = &per_cpu(cpupm, cpu);
+	cpumask_andnot(&running, &mode->siblings, &mode->idle_cpus);
+	if (cpumask_intersects(&running, cpu_online_mask))
+		return -EBUSY;
 
-		if (check_state_run(pm))
-			return -EBUSY;
+	/*
+	 * The power domain stays idle till the earliest wakeup of the
+	 * cpus, if it is sooner than target_residency, regards it as BUSY.
+	 */
+	now = ktime_get();
+	next_wakeup = mode->next_wakeup;
+	if (!ktime_after(next_wakeup, now))
+		next_wakeup = expire_predictions(mode, now);
 
-		if (get_sleep_length(cpu) < target_residency)
-			return -EBUSY;
-	}
+	if (ktime_to_us(ktime_sub(next_wakeup, now)) < target_residency)
+		return -EBUSY;
 
 	return 0;
 }
@@ -620,7 +714,7 @@ static int can_enter_power_mode(int cpu, struct power_mode *mode)
 	if (!cpumask_test_cpu(cpu, &mode->entry_allowed))
 		return 0;
 
-	if (cpus_busy(mode->target_residency, &mode->siblings))
+	if (cpus_busy(mode->target_residency, mode))
 		return 0;
 
 	if (is_IPI_pending(&mode->siblings))
@@ -705,6 +799,7 @@ int exynos_cpu_pm_enter(int cpu, int index)
 {
 	struct exynos_cpupm *pm;
 	struct power_mode *mode;
+	cycles_t start = get_cycles();
 	int i;
 
 	spin_lock(&cpupm_lock);
@@ -715,6 +810,7 @@ int exynos_cpu_pm_enter(int cpu, int index)
 
 	/* Set cpu state to POWERDOWN */
 	set_state_powerdown(pm);
+	set_next_wakeup(cpu, pm);
 
 	/* Try to enter power mode */
 	for (i = 0; i < MAX_MODE; i++) {
@@ -722,12 +818,16 @@ int exynos_cpu_pm_enter(int cpu, int index)
 		if (IS_NULL(mode))
 			break;
 
+		update_idle_cpus(cpu, mode);
+
 		if (try_to_enter_power_mode(cpu, mode))
 			index |= mode->psci_index;
 	}
 
 	spin_unlock(&cpupm_lock);
 
+	cpuidle_profile_cpupm_enter(cpu, get_cycles() - start);
+
 	return index;
 }
 
@@ -748,6 +848,8 @@ void exynos_cpu_pm_exit(int cpu, int cancel)
 
 		if (check_state_powerdown(mode))
 			exit_mode(cpu, mode, cancel);
+
+		clear_idle_cpus(cpu, mode);
 	}
 
 	/* Set cpu state to RUN */
@@ -902,6 +1004,8 @@ static int __init cpu_power_mode_init(void)
 
 		atomic_set(&mode->disable, 0);
 
+		mode->next_wakeup = KTIME_MAX;
+
 		/*
 		 * The users' request is set to enable since initialization state of
 		 * power mode is enabled.
@@ -922,7 +1026,8 @@ static int __init cpu_power_mode_init(void)
 		for_each_cpu(cpu, &mode->siblings)
 			add_mode(per_cpu(cpupm, cpu).modes, mode);
 
-		cpuidle_profile_group_idle_register(mode->id, mode->name);
+		cpuidle_profile_group_idle_register(mode->id, mode->name,
+						    mode->target_residency);
 	}
 
 	if (attr_count)
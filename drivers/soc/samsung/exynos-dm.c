@@ -16,6 +16,10 @@
 #include <linux/errno.h>
 #include <linux/of.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/debug-snapshot.h>
 #include "acpm/acpm.h"
 #include "acpm/acpm_ipc.h"
@@ -36,6 +40,8 @@ static void get_target_freq(struct exynos_dm_data *dm_data, u32 *target_freq);
 static struct exynos_dm_device *exynos_dm;
 static int *min_order;
 static int *max_order;
+/* domains whose constraint_checked was set by the current DM_CALL */
+static unsigned long *checked_domains;
 
 /*
  * SYSFS for Debugging
@@ -273,6 +279,68 @@ static struct attribute_group exynos_dm_attr_group = {
  * SYSFS for Debugging end
  */
 
+#ifdef CONFIG_DEBUG_FS
+static int exynos_dm_stats_show(struct seq_file *m, void *unused)
+{
+	struct exynos_dm_device *dm = m->private;
+	struct exynos_dm_stats *stats;
+	int i, j;
+
+	seq_printf(m, "%-16s %10s %10s %12s %8s", "dm_type", "calls",
+			"skipped", "transitions", "max(us)");
+	for (j = 0; j < EXYNOS_DM_LAT_BUCKETS - 1; j++)
+		seq_printf(m, " %9s%u", "<", 1 << j);
+	seq_printf(m, " %9s%u\n", ">=", 1 << (EXYNOS_DM_LAT_BUCKETS - 2));
+
+	mutex_lock(&dm->lock);
+	for (i = 0; i < dm->domain_count; i++) {
+		if (!dm->dm_data[i].available)
+			continue;
+
+		stats = &dm->dm_data[i].stats;
+		seq_printf(m, "%-16s %10llu %10llu %12llu %8u",
+				dm->dm_data[i].dm_type_name, stats->call_count,
+				stats->skip_count, stats->transition_count,
+				stats->max_latency);
+		for (j = 0; j < EXYNOS_DM_LAT_BUCKETS; j++)
+			seq_printf(m, " %10llu", stats->latency_hist[j]);
+		seq_putc(m, '\n');
+	}
+	mutex_unlock(&dm->lock);
+
+	return 0;
+}
+
+static int exynos_dm_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, exynos_dm_stats_show, inode->i_private);
+}
+
+static const struct file_operations exynos_dm_stats_fops = {
+	.open		= exynos_dm_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void exynos_dm_debugfs_init(struct exynos_dm_device *dm)
+{
+	struct dentry *root, *d;
+
+	root = debugfs_create_dir("exynos-dm", NULL);
+	if (!root) {
+		dev_err(dm->dev, "couldn't create debugfs dir\n");
+		return;
+	}
+
+	d = debugfs_create_file("stats", 0400, root, dm, &exynos_dm_stats_fops);
+	if (!d)
+		dev_err(dm->dev, "couldn't create debugfs stats\n");
+}
+#else
+static inline void exynos_dm_debugfs_init(struct exynos_dm_device *dm) { }
+#endif
+
 static void print_available_dm_data(struct exynos_dm_device *dm)
 {
 	int i;
@@ -334,6 +402,13 @@ static int exynos_dm_parse_dt(struct device_node *np, struct exynos_dm_device *d
 		return -ENOMEM;
 	}
 
+	checked_domains = kcalloc(BITS_TO_LONGS(dm->domain_count),
+				sizeof(unsigned long), GFP_KERNEL);
+	if (!checked_domains) {
+		dev_err(dm->dev, "failed to allocate checked_domains\n");
+		return -ENOMEM;
+	}
+
 	/* min/max order clear */
 	for (i = 0; i <= dm->domain_count; i++) {
 		min_order[i] = DM_EMPTY;
@@ -356,6 +431,9 @@ static int exynos_dm_parse_dt(struct device_node *np, struct exynos_dm_device *d
 		if (of_property_read_string(child_np, "available", &available))
 			return -ENODEV;
 
+		INIT_LIST_HEAD(&dm->dm_data[index].min_slist);
+		INIT_LIST_HEAD(&dm->dm_data[index].max_slist);
+
 		if (!strcmp(available, "true")) {
 			dm->dm_data[index].dm_type = index;
 			dm->dm_data[index].available = true;
@@ -400,6 +478,15 @@ static struct list_head *get_max_constraint_list(struct exynos_dm_data *dm_data)
 	return &dm_data->max_clist;
 }
 
+/* Constraint tables changed, next DM_CALL of every domain must propagate */
+static void mark_constraint_dirty(void)
+{
+	int i;
+
+	for (i = 0; i < exynos_dm->domain_count; i++)
+		exynos_dm->dm_data[i].constraint_dirty = true;
+}
+
 /*
  * This function should be called from each DVFS drivers
  * before DVFS driver registration to DVFS framework.
@@ -484,10 +571,15 @@ int register_exynos_dm_constraint_table(int dm_type,
 	constraint->min_freq = 0;
 	constraint->max_freq = UINT_MAX;
 
-	if (constraint->constraint_type == CONSTRAINT_MIN)
+	if (constraint->constraint_type == CONSTRAINT_MIN) {
 		list_add(&constraint->node, &exynos_dm->dm_data[dm_type].min_clist);
-	else if (constraint->constraint_type == CONSTRAINT_MAX)
+		list_add(&constraint->slave_node,
+			&exynos_dm->dm_data[constraint->constraint_dm_type].min_slist);
+	} else if (constraint->constraint_type == CONSTRAINT_MAX) {
 		list_add(&constraint->node, &exynos_dm->dm_data[dm_type].max_clist);
+		list_add(&constraint->slave_node,
+			&exynos_dm->dm_data[constraint->constraint_dm_type].max_slist);
+	}
 
 	/* check guidance and sub constraint table generations */
 	if (constraint->guidance && (constraint->constraint_type == CONSTRAINT_MIN)) {
@@ -526,11 +618,15 @@ int register_exynos_dm_constraint_table(int dm_type,
 
 		list_add(&sub_constraint->node,
 			&exynos_dm->dm_data[constraint->constraint_dm_type].max_clist);
+		list_add(&sub_constraint->slave_node,
+			&exynos_dm->dm_data[dm_type].max_slist);
 
 		/* linked sub constraint */
 		constraint->sub_constraint = sub_constraint;
 	}
 
+	mark_constraint_dirty();
+
 	mutex_unlock(&exynos_dm->lock);
 
 	return 0;
@@ -539,6 +635,7 @@ err_freq_table:
 	kfree(sub_constraint);
 err_sub_const:
 	list_del(&constraint->node);
+	list_del(&constraint->slave_node);
 
 	mutex_unlock(&exynos_dm->lock);
 
@@ -565,11 +662,15 @@ int unregister_exynos_dm_constraint_table(int dm_type,
 	if (constraint->sub_constraint) {
 		sub_constraint = constraint->sub_constraint;
 		list_del(&sub_constraint->node);
+		list_del(&sub_constraint->slave_node);
 		kfree(sub_constraint->freq_table);
 		kfree(sub_constraint);
 	}
 
 	list_del(&constraint->node);
+	list_del(&constraint->slave_node);
+
+	mark_constraint_dirty();
 
 	mutex_unlock(&exynos_dm->lock);
 
@@ -664,7 +765,7 @@ static bool max_flag = false;
 static int __policy_update_call_to_DM(int dm_type, u32 min_freq, u32 max_freq)
 {
 	struct exynos_dm_data *dm;
-	struct timeval pre, before, after;
+	ktime_t before;
 #ifdef CONFIG_EXYNOS_ACPM
 	struct ipc_config config;
 	unsigned int cmd[4];
@@ -674,8 +775,7 @@ static int __policy_update_call_to_DM(int dm_type, u32 min_freq, u32 max_freq)
 
 	dbg_snapshot_dm((int)dm_type, min_freq, max_freq, pre_time, time);
 
-	do_gettimeofday(&pre);
-	do_gettimeofday(&before);
+	before = ktime_get();
 
 	min_freq = min(min_freq, max_freq);
 
@@ -712,12 +812,7 @@ static int __policy_update_call_to_DM(int dm_type, u32 min_freq, u32 max_freq)
 #endif
 
 out:
-	do_gettimeofday(&after);
-
-	pre_time = (before.tv_sec - pre.tv_sec) * USEC_PER_SEC +
-		(before.tv_usec - pre.tv_usec);
-	time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-		(after.tv_usec - before.tv_usec);
+	time = (s32)ktime_us_delta(ktime_get(), before);
 
 	dbg_snapshot_dm((int)dm_type, min_freq, max_freq, pre_time, time);
 
@@ -771,6 +866,23 @@ static int constraint_checker_max(struct list_head *head, u32 freq)
 	return 0;
 }
 
+static void update_dm_stats(struct exynos_dm_data *dm, s64 time, bool skip)
+{
+	struct exynos_dm_stats *stats = &dm->stats;
+	int bucket = 0;
+
+	stats->call_count++;
+	if (skip)
+		stats->skip_count++;
+
+	if (time > 0)
+		bucket = min_t(int, ilog2(time) + 1, EXYNOS_DM_LAT_BUCKETS - 1);
+	stats->latency_hist[bucket]++;
+
+	if (time > stats->max_latency)
+		stats->max_latency = (u32)time;
+}
+
 /*
  * DM CALL
  */
@@ -780,25 +892,24 @@ static int __DM_CALL(int dm_type, unsigned long *target_freq)
 	int i;
 	int ret;
 	unsigned int relation = EXYNOS_DM_RELATION_L;
-	u32 old_min_freq;
-	struct timeval pre, before, after;
+	u32 old_min_freq, old_max_freq, old_target_freq;
+	ktime_t before;
 	s32 time = 0, pre_time = 0;
+	bool skip = false;
 
 	dbg_snapshot_dm((int)dm_type, *target_freq, 1, pre_time, time);
 
-	do_gettimeofday(&pre);
-	do_gettimeofday(&before);
+	before = ktime_get();
 
 	dm = &exynos_dm->dm_data[dm_type];
 	old_min_freq = dm->min_freq;
+	old_max_freq = dm->max_freq;
+	old_target_freq = dm->target_freq;
 	dm->gov_min_freq = (u32)(*target_freq);
 
 	if (dm->gov_min_freq > dm->policy_max_freq)
 		dm->gov_min_freq = dm->policy_max_freq;
 
-	for (i = 0; i < exynos_dm->domain_count; i++)
-		(&exynos_dm->dm_data[i])->constraint_checked = 0;
-
 	if (dm->policy_max_freq < dm->cur_freq)
 		max_flag = true;
 	else
@@ -821,6 +932,22 @@ static int __DM_CALL(int dm_type, unsigned long *target_freq)
 
 	*target_freq = dm->target_freq;
 
+	/*
+	 * Dependent domains were already resolved against these min/max
+	 * frequencies, so nothing has to be propagated or scaled if the
+	 * resolved target is not changed either.
+	 */
+	if (!dm->constraint_dirty && !max_flag &&
+			dm->min_freq == old_min_freq &&
+			dm->max_freq == old_max_freq &&
+			dm->target_freq == old_target_freq &&
+			dm->target_freq == dm->cur_freq) {
+		skip = true;
+		goto out;
+	}
+
+	dm->constraint_dirty = false;
+
 	/* Constratin checker should be called to decide target frequency */
 	constraint_data_updater(dm_type, 1);
 	max_constraint_data_updater(dm_type, 1);
@@ -834,18 +961,20 @@ static int __DM_CALL(int dm_type, unsigned long *target_freq)
 	else if (dm->min_freq < old_min_freq)
 		scaling_callback(DOWN, relation);
 
+	/* Clear only the domains checked by this call */
+	for_each_set_bit(i, checked_domains, exynos_dm->domain_count)
+		exynos_dm->dm_data[i].constraint_checked = 0;
+	bitmap_zero(checked_domains, exynos_dm->domain_count);
+
 	/* min/max order clear */
 	for (i = 0; i <= exynos_dm->domain_count; i++) {
 		min_order[i] = DM_EMPTY;
 		max_order[i] = DM_EMPTY;
 	}
 
-	do_gettimeofday(&after);
-
-	pre_time = (before.tv_sec - pre.tv_sec) * USEC_PER_SEC +
-		(before.tv_usec - pre.tv_usec);
-	time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-		(after.tv_usec - before.tv_usec);
+out:
+	time = (s32)ktime_us_delta(ktime_get(), before);
+	update_dm_stats(dm, time, skip);
 
 	dbg_snapshot_dm((int)dm_type, *target_freq, 3, pre_time, time);
 
@@ -856,8 +985,6 @@ static int dm_data_updater(int dm_type)
 {
 	struct exynos_dm_data *dm;
 	struct exynos_dm_constraint *constraint;
-	struct list_head *constraint_list;
-	int i;
 	/* Initial min/max frequency is set to policy min/max frequency */
 	u32 min_freq;
 	u32 max_freq;
@@ -867,30 +994,11 @@ static int dm_data_updater(int dm_type)
 	max_freq = dm->policy_max_freq;
 
 	/* Check min/max constraint conditions */
-	for (i = 0; i < exynos_dm->domain_count; i++) {
-		if (!exynos_dm->dm_data[i].available)
-			continue;
-
-		constraint_list = get_min_constraint_list(&exynos_dm->dm_data[i]);
-		if (list_empty(constraint_list))
-			continue;
-		list_for_each_entry(constraint, constraint_list, node) {
-			if (constraint->constraint_dm_type == dm_type)
-				min_freq = max(min_freq, constraint->min_freq);
-		}
-	}
-	for (i = 0; i < exynos_dm->domain_count; i++) {
-		if (!exynos_dm->dm_data[i].available)
-			continue;
+	list_for_each_entry(constraint, &dm->min_slist, slave_node)
+		min_freq = max(min_freq, constraint->min_freq);
 
-		constraint_list = get_max_constraint_list(&exynos_dm->dm_data[i]);
-		if (list_empty(constraint_list))
-			continue;
-		list_for_each_entry(constraint, constraint_list, node) {
-			if (constraint->constraint_dm_type == dm_type)
-				max_freq = min(max_freq, constraint->max_freq);
-		}
-	}
+	list_for_each_entry(constraint, &dm->max_slist, slave_node)
+		max_freq = min(max_freq, constraint->max_freq);
 
 	min_freq = max(min_freq, dm->gov_min_freq); //MIN freq should be checked with gov_min_freq
 	update_min_max_freq(dm, min_freq, max_freq);
@@ -944,8 +1052,10 @@ static int constraint_data_updater(int dm_type, int cnt)
 	/* Check dependent domains */
 	constraint_checker_min(get_min_constraint_list(dm), dm->min_freq);
 
-	if (!dm->constraint_checked)
+	if (!dm->constraint_checked) {
 		dm->constraint_checked += cnt;
+		set_bit(dm_type, checked_domains);
+	}
 
 	min_order[dm->constraint_checked] = dm_type;
 
@@ -980,8 +1090,10 @@ static int max_constraint_data_updater(int dm_type, int cnt)
 	/* Check dependent domains */
 	constraint_checker_max(get_max_constraint_list(dm), dm->max_freq);
 
-	if (!dm->constraint_checked)
+	if (!dm->constraint_checked) {
 		dm->constraint_checked += cnt;
+		set_bit(dm_type, checked_domains);
+	}
 
 	max_order[dm->constraint_checked] = dm_type;
 
@@ -1005,6 +1117,19 @@ static int max_constraint_data_updater(int dm_type, int cnt)
 	return 0;
 }
 
+static void dm_scale(struct exynos_dm_data *dm, unsigned int relation)
+{
+	if (!dm->constraint_checked)
+		return;
+
+	if (dm->freq_scaler) {
+		dm->freq_scaler(dm->dm_type, dm->devdata, dm->target_freq, relation);
+		dm->cur_freq = dm->target_freq;
+		dm->stats.transition_count++;
+	}
+	dm->constraint_checked = 0;
+}
+
 /*
  * Scaling Callback
  * Call callback function in each DVFS drivers to scaling frequency
@@ -1022,13 +1147,7 @@ static int scaling_callback(enum dvfs_direction dir, unsigned int relation)
 					continue;
 
 				dm = &exynos_dm->dm_data[min_order[i]];
-				if (dm->constraint_checked) {
-					if (dm->freq_scaler) {
-						dm->freq_scaler(dm->dm_type, dm->devdata, dm->target_freq, relation);
-						dm->cur_freq = dm->target_freq;
-					}
-					dm->constraint_checked = 0;
-				}
+				dm_scale(dm, relation);
 			}
 		} else if (max_order[0] == 0 && max_flag == true) {
 			for (i = exynos_dm->domain_count; i > 0; i--) {
@@ -1036,13 +1155,7 @@ static int scaling_callback(enum dvfs_direction dir, unsigned int relation)
 					continue;
 
 				dm = &exynos_dm->dm_data[max_order[i]];
-				if (dm->constraint_checked) {
-					if (dm->freq_scaler) {
-						dm->freq_scaler(dm->dm_type, dm->devdata, dm->target_freq, relation);
-						dm->cur_freq = dm->target_freq;
-					}
-					dm->constraint_checked = 0;
-				}
+				dm_scale(dm, relation);
 			}
 		}
 		break;
@@ -1053,13 +1166,7 @@ static int scaling_callback(enum dvfs_direction dir, unsigned int relation)
 					continue;
 
 				dm = &exynos_dm->dm_data[min_order[i]];
-				if (dm->constraint_checked) {
-					if (dm->freq_scaler) {
-						dm->freq_scaler(dm->dm_type, dm->devdata, dm->target_freq, relation);
-						dm->cur_freq = dm->target_freq;
-					}
-					dm->constraint_checked = 0;
-				}
+				dm_scale(dm, relation);
 			}
 		} else if (max_order[0] == 0) {
 			for (i = 1; i <= exynos_dm->domain_count; i++) {
@@ -1067,13 +1174,7 @@ static int scaling_callback(enum dvfs_direction dir, unsigned int relation)
 					continue;
 
 				dm = &exynos_dm->dm_data[max_order[i]];
-				if (dm->constraint_checked) {
-					if (dm->freq_scaler) {
-						dm->freq_scaler(dm->dm_type, dm->devdata, dm->target_freq, relation);
-						dm->cur_freq = dm->target_freq;
-					}
-					dm->constraint_checked = 0;
-				}
+				dm_scale(dm, relation);
 			}
 		}
 		break;
@@ -1086,13 +1187,7 @@ static int scaling_callback(enum dvfs_direction dir, unsigned int relation)
 			continue;
 
 		dm = &exynos_dm->dm_data[min_order[i]];
-		if (dm->constraint_checked) {
-			if (dm->freq_scaler) {
-				dm->freq_scaler(dm->dm_type, dm->devdata, dm->target_freq, relation);
-				dm->cur_freq = dm->target_freq;
-			}
-			dm->constraint_checked = 0;
-		}
+		dm_scale(dm, relation);
 	}
 
 	max_flag = false;
@@ -1216,6 +1311,8 @@ static int exynos_dm_probe(struct platform_device *pdev)
 	exynos_dm = dm;
 	platform_set_drvdata(pdev, dm);
 
+	exynos_dm_debugfs_init(dm);
+
 	return 0;
 
 err_parse_dt:
@@ -454,6 +454,11 @@ static int ion_dma_buf_get_flags(struct dma_buf *dmabuf, unsigned long *flags)
 	return 0;
 }
 
+/*
+ * Only the generic ops let the dma-buf core cache the mapping. The Exynos
+ * map_dma_buf and unmap_dma_buf do nothing but the cache maintenance of the
+ * transfer on the shared buffer->sg_table, which must not be skipped.
+ */
 const struct dma_buf_ops ion_dma_buf_ops = {
 #ifdef CONFIG_ION_EXYNOS
 	.map_dma_buf = ion_exynos_map_dma_buf,
@@ -463,6 +468,7 @@ const struct dma_buf_ops ion_dma_buf_ops = {
 	.begin_cpu_access = ion_exynos_dma_buf_begin_cpu_access,
 	.end_cpu_access = ion_exynos_dma_buf_end_cpu_access,
 #else
+	.cache_sgt_mapping = true,
 	.attach = ion_dma_buf_attach,
 	.detach = ion_dma_buf_detatch,
 	.map_dma_buf = ion_map_dma_buf,
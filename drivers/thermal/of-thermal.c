@@ -1001,6 +1001,9 @@ int __init of_parse_thermal_zones(void)
 		if (!of_property_read_u32(child, "integral_cutoff", &prop))
 			tzp->integral_cutoff = prop;
 
+		if (!of_property_read_u32(child, "mpc-horizon-ms", &prop))
+			tzp->mpc_horizon = prop;
+
 		for (i = 0; i < tz->ntrips; i++)
 			mask |= 1 << i;
 
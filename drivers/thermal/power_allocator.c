@@ -23,6 +23,7 @@
 #include <trace/events/thermal_power_allocator.h>
 
 #include "thermal_core.h"
+#include "power_allocator_mpc.h"
 
 #define INVALID_TRIP -1
 
@@ -70,6 +71,10 @@ static inline s64 div_frac(s64 x, s64 y)
  * @trip_max_desired_temperature:	last passive trip point of the thermal
  *					zone.  The temperature we are
  *					controlling for.
+ * @model:	thermal model of the zone fitted for the model predictive
+ *		mode
+ * @prev_temp:	temperature at the previous allocation, INT_MIN if the
+ *		governor was switched off since then
  */
 struct power_allocator_params {
 	bool allocated_tzp;
@@ -77,6 +82,10 @@ struct power_allocator_params {
 	s32 prev_err;
 	int trip_switch_on;
 	int trip_max_desired_temperature;
+#ifdef CONFIG_THERMAL_GOV_POWER_ALLOCATOR_MPC
+	struct pa_mpc_model model;
+	int prev_temp;
+#endif
 };
 
 /**
@@ -272,6 +281,63 @@ static u32 pid_controller(struct thermal_zone_device *tz,
 	return power_range;
 }
 
+#ifdef CONFIG_THERMAL_GOV_POWER_ALLOCATOR_MPC
+/**
+ * mpc_controller() - model predictive controller
+ * @tz:	thermal zone we are operating in
+ * @control_temp:	the target temperature in millicelsius
+ * @total_req_power:	power the actors drew during the last period
+ * @max_allocatable_power:	maximum allocatable power for this thermal zone
+ *
+ * Fit the thermal model of the zone with the temperature change over the
+ * last period and the power drawn during it, and allocate the power that
+ * is predicted to bring the zone to @control_temp after tzp->mpc_horizon
+ * ms.  Looking ahead avoids the overshoot of a controller that only reacts
+ * to the current error, and holding the predicted temperature avoids
+ * throttling harder than needed when the zone is already cooling.
+ *
+ * Return: The power budget for the next period, or a negative value if
+ * the model predictive mode is off or the model cannot be trusted yet, in
+ * which case the PID controller has to be used.
+ */
+static s64 mpc_controller(struct thermal_zone_device *tz, int control_temp,
+			  u32 total_req_power, u32 max_allocatable_power)
+{
+	struct power_allocator_params *params = tz->governor_data;
+	s32 err = tz->temperature - control_temp;
+	unsigned int steps;
+	s64 power;
+
+	if (params->prev_temp != INT_MIN)
+		pa_mpc_update(&params->model, total_req_power,
+			      params->prev_temp - control_temp, err);
+	params->prev_temp = tz->temperature;
+
+	if (tz->tzp->mpc_horizon <= 0 || !tz->passive_delay)
+		return -1;
+
+	steps = DIV_ROUND_UP(tz->tzp->mpc_horizon, tz->passive_delay);
+	power = pa_mpc_power(&params->model, err, steps);
+	if (power < 0)
+		return power;
+
+	power = clamp(power, (s64)0, (s64)max_allocatable_power);
+
+	trace_thermal_power_allocator_mpc(tz, params->model.a,
+					  params->model.b, params->model.c,
+					  steps, power);
+
+	return power;
+}
+#else
+static inline s64 mpc_controller(struct thermal_zone_device *tz,
+				 int control_temp, u32 total_req_power,
+				 u32 max_allocatable_power)
+{
+	return -1;
+}
+#endif
+
 /**
  * divvy_up_power() - divvy the allocated power between the actors
  * @req_power:	each actor's requested power
@@ -352,6 +418,7 @@ static int allocate_power(struct thermal_zone_device *tz,
 	u32 *weighted_req_power;
 	u32 total_req_power, max_allocatable_power, total_weighted_req_power;
 	u32 total_granted_power, power_range;
+	s64 mpc_power;
 	int i, num_actors, total_weight, ret = 0;
 	int trip_max_desired_temperature = params->trip_max_desired_temperature;
 
@@ -432,7 +499,13 @@ static int allocate_power(struct thermal_zone_device *tz,
 		i++;
 	}
 
-	power_range = pid_controller(tz, control_temp, max_allocatable_power);
+	mpc_power = mpc_controller(tz, control_temp, total_req_power,
+				   max_allocatable_power);
+	if (mpc_power >= 0)
+		power_range = mpc_power;
+	else
+		power_range = pid_controller(tz, control_temp,
+					     max_allocatable_power);
 
 	divvy_up_power(weighted_req_power, max_power, num_actors,
 		       total_weighted_req_power, power_range, granted_power,
@@ -537,6 +610,10 @@ static void reset_pid_controller(struct power_allocator_params *params, struct t
 	params->err_integral = div_frac(i, tz->tzp->k_i);
 	params->prev_err = 0;
 
+#ifdef CONFIG_THERMAL_GOV_POWER_ALLOCATOR_MPC
+	/* the model is kept, but there is no sample across the gap */
+	params->prev_temp = INT_MIN;
+#endif
 }
 
 static void allow_maximum_power(struct thermal_zone_device *tz)
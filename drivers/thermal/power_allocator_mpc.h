@@ -0,0 +1,234 @@
+/*
+ * Thermal model for the model predictive mode of the power allocator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The thermal zone is modelled as a first order RC circuit sampled every
+ * polling period:
+ *
+ *	e[k+1] - e[k] = a * u[k] - b * e[k] + c
+ *
+ * where e is the temperature relative to the control temperature in C,
+ * u is the power drawn by the actors in W, a is the period over the heat
+ * capacity, b is the period over the RC time constant and c absorbs the
+ * ambient temperature. a, b and c are fitted online by exponentially
+ * weighted least squares, and the power is chosen so that the predicted
+ * temperature reaches the control temperature after the horizon.
+ *
+ * The model only uses integer arithmetic and no kernel interfaces other
+ * than div64_s64(), so that tools/thermal/pa_sim can replay traces through
+ * the same code on the host.
+ */
+
+#ifndef __POWER_ALLOCATOR_MPC_H__
+#define __POWER_ALLOCATOR_MPC_H__
+
+#ifdef __KERNEL__
+#include <linux/math64.h>
+#include <linux/types.h>
+#endif
+
+/* temperatures and powers: C and W in 10 fractional bits */
+#define PA_MPC_IN_BITS		10
+/* model parameters have to resolve time constants of minutes */
+#define PA_MPC_PARAM_BITS	20
+#define PA_MPC_ONE		(1LL << PA_MPC_PARAM_BITS)
+
+/*
+ * weight of a new sample in the least squares fit is 1/2^DECAY_SHIFT, the
+ * window has to be long compared with the time constant of the zone for
+ * the cooling to be told apart from the heating
+ */
+#define PA_MPC_DECAY_SHIFT	8
+/* samples needed before the model is trusted */
+#define PA_MPC_MIN_SAMPLES	(1 << PA_MPC_DECAY_SHIFT)
+/*
+ * minimum determinant of the weighted sums, the power and the temperature
+ * must have varied enough for the fit, by about 1/4 W and 1/4 C
+ */
+#define PA_MPC_MIN_DET		(1LL << (2 * (PA_MPC_IN_BITS + \
+					      PA_MPC_DECAY_SHIFT) - 4))
+/* largest numerator that can be scaled to PA_MPC_PARAM_BITS */
+#define PA_MPC_MAX_NUM		(1LL << (62 - PA_MPC_PARAM_BITS))
+/* upper bound of the horizon in periods */
+#define PA_MPC_MAX_STEPS	1024
+
+/**
+ * struct pa_mpc_model - online fitted thermal model of a zone
+ *
+ * The weighted sums are 2^PA_MPC_DECAY_SHIFT times the weighted means, so
+ * that small temperature changes are not lost to rounding.
+ *
+ * @sum_u:	weighted sum of the power
+ * @sum_e:	weighted sum of the temperature
+ * @sum_y:	weighted sum of the temperature change
+ * @s_uu:	weighted sum of squares of the power
+ * @s_ue:	weighted sum of products of the power and the temperature
+ * @s_ee:	weighted sum of squares of the temperature
+ * @s_uy:	weighted sum of products of the power and the temperature
+ *		change
+ * @s_ey:	weighted sum of products of the temperature and its change
+ * @a:		heating by power, in PA_MPC_PARAM_BITS
+ * @b:		cooling towards ambient, in PA_MPC_PARAM_BITS
+ * @c:		offset, in PA_MPC_IN_BITS
+ * @nr_samples:	number of samples fitted, saturated at PA_MPC_MIN_SAMPLES
+ * @valid:	whether @a, @b and @c describe a physical zone
+ */
+struct pa_mpc_model {
+	s64 sum_u, sum_e, sum_y;
+	s64 s_uu, s_ue, s_ee, s_uy, s_ey;
+	s64 a, b, c;
+	u32 nr_samples;
+	bool valid;
+};
+
+static inline s64 pa_mpc_from_milli(s64 mc)
+{
+	return div64_s64(mc * (1 << PA_MPC_IN_BITS), 1000);
+}
+
+static inline s64 pa_mpc_to_milli(s64 in)
+{
+	return div64_s64(in * 1000, 1 << PA_MPC_IN_BITS);
+}
+
+static inline void pa_mpc_reset(struct pa_mpc_model *m)
+{
+	*m = (struct pa_mpc_model){ 0 };
+}
+
+static inline void pa_mpc_decay(s64 *sum, s64 sample)
+{
+	*sum += sample - (*sum >> PA_MPC_DECAY_SHIFT);
+}
+
+static inline s64 pa_mpc_mean(s64 sum)
+{
+	return sum >> PA_MPC_DECAY_SHIFT;
+}
+
+/* num / den in PA_MPC_PARAM_BITS, both scaled down as needed to fit */
+static inline s64 pa_mpc_div(s64 num, s64 den)
+{
+	while (num >= PA_MPC_MAX_NUM || num <= -PA_MPC_MAX_NUM) {
+		num >>= 1;
+		den >>= 1;
+	}
+
+	if (!den)
+		return 0;
+
+	return div64_s64(num * PA_MPC_ONE, den);
+}
+
+/**
+ * pa_mpc_update() - fit the model with a new sample
+ * @m:		the model
+ * @power:	power drawn during the last period in mW
+ * @prev_err:	temperature above the control temperature at the start of
+ *		the last period in millicelsius
+ * @err:	temperature above the control temperature now in millicelsius
+ */
+static inline void pa_mpc_update(struct pa_mpc_model *m, u32 power,
+				 s32 prev_err, s32 err)
+{
+	s64 u = pa_mpc_from_milli(power);
+	s64 e = pa_mpc_from_milli(prev_err);
+	s64 y = pa_mpc_from_milli(err) - e;
+	s64 du, de, dy, det, a, beta;
+
+	if (!m->nr_samples) {
+		m->sum_u = u << PA_MPC_DECAY_SHIFT;
+		m->sum_e = e << PA_MPC_DECAY_SHIFT;
+		m->sum_y = y << PA_MPC_DECAY_SHIFT;
+	}
+
+	du = u - pa_mpc_mean(m->sum_u);
+	de = e - pa_mpc_mean(m->sum_e);
+	dy = y - pa_mpc_mean(m->sum_y);
+
+	pa_mpc_decay(&m->sum_u, u);
+	pa_mpc_decay(&m->sum_e, e);
+	pa_mpc_decay(&m->sum_y, y);
+
+	pa_mpc_decay(&m->s_uu, (du * du) >> PA_MPC_IN_BITS);
+	pa_mpc_decay(&m->s_ue, (du * de) >> PA_MPC_IN_BITS);
+	pa_mpc_decay(&m->s_ee, (de * de) >> PA_MPC_IN_BITS);
+	pa_mpc_decay(&m->s_uy, (du * dy) >> PA_MPC_IN_BITS);
+	pa_mpc_decay(&m->s_ey, (de * dy) >> PA_MPC_IN_BITS);
+
+	if (m->nr_samples < PA_MPC_MIN_SAMPLES)
+		m->nr_samples++;
+
+	m->valid = false;
+	if (m->nr_samples < PA_MPC_MIN_SAMPLES)
+		return;
+
+	/* solve the normal equations of y = a * u + beta * e */
+	det = m->s_uu * m->s_ee - m->s_ue * m->s_ue;
+	if (det < PA_MPC_MIN_DET)
+		return;
+
+	a = pa_mpc_div(m->s_uy * m->s_ee - m->s_ue * m->s_ey, det);
+	beta = pa_mpc_div(m->s_uu * m->s_ey - m->s_ue * m->s_uy, det);
+
+	/* heating by power and cooling towards ambient are both positive */
+	if (a <= 0 || beta >= 0 || -beta >= PA_MPC_ONE)
+		return;
+
+	m->a = a;
+	m->b = -beta;
+	m->c = pa_mpc_mean(m->sum_y) -
+	       ((a * pa_mpc_mean(m->sum_u) - m->b * pa_mpc_mean(m->sum_e)) >>
+		PA_MPC_PARAM_BITS);
+	m->valid = true;
+}
+
+/**
+ * pa_mpc_power() - power that brings the zone to the control temperature
+ * @m:		the model
+ * @err:	temperature above the control temperature now in millicelsius
+ * @steps:	horizon in polling periods
+ *
+ * Return: the power in mW to be drawn constantly for @steps periods so that
+ * the zone is predicted to be at the control temperature at the end of
+ * them, or a negative value if the model is not valid. The power may be
+ * larger than the actors can draw and is left to the caller to clamp.
+ */
+static inline s64 pa_mpc_power(struct pa_mpc_model *m, s32 err,
+			       unsigned int steps)
+{
+	s64 e = pa_mpc_from_milli(err);
+	s64 q = PA_MPC_ONE, base = PA_MPC_ONE - m->b;
+	s64 e_ss, u;
+
+	if (!m->valid || !steps)
+		return -1;
+
+	if (steps > PA_MPC_MAX_STEPS)
+		steps = PA_MPC_MAX_STEPS;
+
+	/* q = (1 - b)^steps, the part of the error left after the horizon */
+	for (; steps; steps >>= 1) {
+		if (steps & 1)
+			q = (q * base) >> PA_MPC_PARAM_BITS;
+		base = (base * base) >> PA_MPC_PARAM_BITS;
+	}
+
+	if (q >= PA_MPC_ONE)
+		return -1;
+
+	/*
+	 * e[steps] = e_ss + (e - e_ss) * q = 0 gives the steady state error
+	 * to aim for, and a * u - b * e_ss + c = 0 the power for it.
+	 */
+	e_ss = div64_s64(-e * q, PA_MPC_ONE - q);
+	u = ((m->b * e_ss) >> PA_MPC_PARAM_BITS) - m->c;
+	u = div64_s64(u * PA_MPC_ONE, m->a);
+
+	return u > 0 ? pa_mpc_to_milli(u) : 0;
+}
+
+#endif /* __POWER_ALLOCATOR_MPC_H__ */
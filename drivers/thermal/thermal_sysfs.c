@@ -390,6 +390,7 @@ create_s32_tzp_attr(integral_cutoff);
 create_s32_tzp_attr(slope);
 create_s32_tzp_attr(offset);
 create_s32_tzp_attr(integral_max);
+create_s32_tzp_attr(mpc_horizon);
 #undef create_s32_tzp_attr
 
 /*
@@ -426,6 +427,7 @@ static struct attribute *thermal_zone_dev_attrs[] = {
 	&dev_attr_slope.attr,
 	&dev_attr_offset.attr,
 	&dev_attr_integral_max.attr,
+	&dev_attr_mpc_horizon.attr,
 	NULL,
 };
 
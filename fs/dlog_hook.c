@@ -24,6 +24,12 @@
 #include <linux/ctype.h>
 #include <linux/module.h>
 #include <linux/magic.h>
+#include <linux/llist.h>
+#include <linux/workqueue.h>
+#include <linux/dcache.h>
+#include <linux/cred.h>
+#include <linux/hash.h>
+#include <linux/kref.h>
 #include "mount.h"
 
 #define DEFINE_DLOG(_name) extern int fslog_##_name(const char *fmt, ...)
@@ -35,6 +41,54 @@ DEFINE_DLOG(dlog_rmdir);
 #define EXT_SHIFT		7
 #define MAX_EXT			(1 << 7)
 #define MAX_DEPTH		2
+/* longer than any keyword, anything this long can not match */
+#define MAX_EXT_LEN		16
+
+/*
+ * The unlink path takes a snapshot of the name and a few attributes of the
+ * victim, and a reference to the path of its parent directory. That path is
+ * built once and shared by all deletes in the directory, see dlog_get_dir().
+ * No reference to a dentry or a mount is held, so a pending batch can not
+ * make an umount fail. dlog_work writes the log in batches and coalesces
+ * long runs of deletes in one directory.
+ */
+#define DLOG_BATCH_DELAY	msecs_to_jiffies(20)
+#define DLOG_MAX_PENDING	4096
+#define DLOG_COALESCE_MAX	32
+#define DLOG_DIR_CACHE_BITS	3
+
+/* path of a parent directory, relative to the root of its filesystem */
+struct dlog_dir {
+	struct kref kref;
+	/* only compared, never dereferenced */
+	const struct dentry *dentry;
+	const struct super_block *sb;
+	unsigned long ino;
+	/* rename_lock sequence the path was built under */
+	unsigned int seq;
+	char path[];
+};
+
+struct dlog_event {
+	struct llist_node node;
+	struct dlog_dir *dir;
+	kuid_t euid;
+	unsigned long parent_ino;
+	unsigned long ino;
+	loff_t isize;
+	int type;
+	int part_id;
+	struct name_snapshot name;
+};
+
+static struct dlog_dir *dlog_dir_cache[1 << DLOG_DIR_CACHE_BITS];
+static DEFINE_SPINLOCK(dlog_dir_lock);
+static LLIST_HEAD(dlog_pending);
+static atomic_t dlog_nr_pending = ATOMIC_INIT(0);
+static atomic_long_t dlog_dropped = ATOMIC_LONG_INIT(0);
+static void dlog_work_fn(struct work_struct *work);
+static void dlog_drop_dir_cache(void);
+static DECLARE_DELAYED_WORK(dlog_work, dlog_work_fn);
 
 struct dlog_keyword {
 	struct hlist_node hlist;
@@ -127,31 +181,28 @@ static inline unsigned int dlog_full_name_hash(const char *name, unsigned int le
 bool is_ext(const char *name, const char token, struct dlog_keyword_hash_tbl *hash_tbl)
 {
 	char *ext = strrchr(name, token);
+	char buf[MAX_EXT_LEN];
 	struct dlog_keyword *hash_cur;
 	unsigned hash;
 	int i;
-	bool ret = false;
 
 	if (!ext || !ext[1])
 		return false;
 
-	ext = kstrdup(&ext[1], GFP_KERNEL);
-	if (!ext)
-		return false;
-
-	for (i = 0; ext[i]; i++)
-		ext[i] = tolower(ext[i]);
-	hash = dlog_full_name_hash(ext, strlen(ext));
+	for (i = 0, ext++; ext[i]; i++) {
+		if (i == MAX_EXT_LEN - 1)
+			return false;
+		buf[i] = tolower(ext[i]);
+	}
+	buf[i] = '\0';
+	hash = dlog_full_name_hash(buf, i);
 
 	hash_for_each_possible(hash_tbl->table, hash_cur, hlist, hash) {
-		if (!strcmp(ext, hash_cur->keyword)) {
-			ret = true;
-			break;
-		}
+		if (!strcmp(buf, hash_cur->keyword))
+			return true;
 	}
-	kfree(ext);
 
-	return ret;
+	return false;
 }
 
 int __init dlog_keyword_hash_init(void)
@@ -191,6 +242,8 @@ void __exit dlog_keyword_hash_exit(void)
 			kfree(hash_cur);
 	} while(++num_ht < DLOG_HT_MAX);
 
+	flush_delayed_work(&dlog_work);
+	dlog_drop_dir_cache();
 }
 module_exit(dlog_keyword_hash_exit);
 
@@ -233,55 +286,283 @@ static void make_prefix(int part_id, char *prefix)
 		*prefix = 's';
 }
 
-static void store_log(struct dentry *dentry, struct inode *inode,
-		struct path *path, int type, int part_id)
+static const char *dlog_dir_path(struct dlog_event *ev)
+{
+	return ev->dir ? ev->dir->path : "?";
+}
+
+static void store_log(struct dlog_event *ev)
 {
-	kuid_t euid = current->cred->euid;
-	unsigned long ino = inode ? inode->i_ino : 0;
-	loff_t isize = inode ? inode->i_size : 0;
+	const char *dir = dlog_dir_path(ev);
+	loff_t isize = ev->isize;
 	char prefix = 0;
-	char *buf, *full_path;
+	const char *name = ev->name.name;
 	char unit = 'B';
 
-	buf = kzalloc(PATH_MAX, GFP_KERNEL);
-	if (!buf) {
-		printk(KERN_ERR "%s memory alloc failed : ENOMEM\n", __func__);
+	make_prefix(ev->part_id, &prefix);
+	if (isize >> 10) {
+		isize >>= 10;
+		unit = 'K';
+	}
+
+	if (ev->type == DLOG_MM) {
+		fslog_dlog_mm("[%c]\"%s/%s\" (%u, %lu, %lu, %lld%c)\n", prefix,
+				dir, name, ev->euid, ev->parent_ino, ev->ino, isize, unit);
 		return;
 	}
 
-	full_path = dentry_path_raw(dentry, buf, PATH_MAX);
-	if (IS_ERR(full_path))
-		goto out;
+	if (ev->type == DLOG_ETC) {
+		fslog_dlog_etc("[%c]\"%s/%s\" (%u, %lu, %lu, %lld%c)\n", prefix,
+				dir, name, ev->euid, ev->parent_ino, ev->ino, isize, unit);
+		return;
+	}
 
-	make_prefix(part_id, &prefix);
-	if (isize >> 10) {
-		isize >>= 10;
-		unit = 'K';
+	if (ev->type == DLOG_EFS) {
+		fslog_dlog_efs("\"%s/%s\" (%lu, %lu, %lld%c)\n", dir, name,
+				ev->parent_ino, ev->ino, isize, unit);
+		return;
 	}
 
-	if (type == DLOG_MM) {
-		fslog_dlog_mm("[%c]\"%s\" (%u, %lu, %lu, %lld%c)\n", prefix, full_path,
-				euid, path->dentry->d_inode->i_ino, ino, isize, unit);
-		goto out;
+	if (ev->type == DLOG_RMDIR)
+		fslog_dlog_rmdir("[%c]\"%s/%s\" (%u, %lu)\n", prefix, dir,
+				name, ev->euid, ev->parent_ino);
+}
+
+static void dlog_free_dir(struct kref *kref)
+{
+	kfree(container_of(kref, struct dlog_dir, kref));
+}
+
+static void dlog_put_dir(struct dlog_dir *dir)
+{
+	if (dir)
+		kref_put(&dir->kref, dlog_free_dir);
+}
+
+static bool dlog_dir_match(struct dlog_dir *dir, struct dentry *dentry,
+		unsigned int seq)
+{
+	return dir && dir->dentry == dentry && dir->sb == dentry->d_sb &&
+		dir->ino == d_inode(dentry)->i_ino && dir->seq == seq;
+}
+
+/*
+ * Path of the directory @dentry, taken from the cache if it was built for
+ * the same dentry and no rename happened since, or built and cached now.
+ * The cache is keyed by the dentry pointer and only holds references to the
+ * paths, the inode number and the rename_lock sequence guard against a
+ * reused dentry or a moved directory. Returns NULL if the path can not be
+ * built, the caller owns a reference otherwise.
+ */
+static struct dlog_dir *dlog_get_dir(struct dentry *dentry)
+{
+	struct dlog_dir **slot =
+		&dlog_dir_cache[hash_ptr(dentry, DLOG_DIR_CACHE_BITS)];
+	struct dlog_dir *dir, *old;
+	unsigned int seq = read_seqbegin(&rename_lock);
+	char *buf, *path;
+	size_t len;
+
+	spin_lock(&dlog_dir_lock);
+	dir = *slot;
+	if (dlog_dir_match(dir, dentry, seq)) {
+		kref_get(&dir->kref);
+		spin_unlock(&dlog_dir_lock);
+		return dir;
 	}
+	spin_unlock(&dlog_dir_lock);
+
+	buf = __getname();
+	if (!buf)
+		return NULL;
 
-	if (type == DLOG_ETC) {
-		fslog_dlog_etc("[%c]\"%s\" (%u, %lu, %lu, %lld%c)\n", prefix, full_path,
-				euid, path->dentry->d_inode->i_ino, ino, isize, unit);
+	dir = NULL;
+	path = dentry_path_raw(dentry, buf, PATH_MAX);
+	if (IS_ERR(path))
 		goto out;
-	}
 
-	if (type == DLOG_EFS) {
-		fslog_dlog_efs("\"%s\" (%lu, %lu, %lld%c)\n", full_path,
-				path->dentry->d_inode->i_ino, ino, isize, unit);
+	/* the root is kept empty, the name is always appended after a '/' */
+	if (!path[1])
+		path++;
+	len = strlen(path);
+
+	dir = kmalloc(sizeof(*dir) + len + 1, GFP_KERNEL);
+	if (!dir)
 		goto out;
+
+	kref_init(&dir->kref);
+	dir->dentry = dentry;
+	dir->sb = dentry->d_sb;
+	dir->ino = d_inode(dentry)->i_ino;
+	dir->seq = seq;
+	memcpy(dir->path, path, len + 1);
+
+	/* one reference for the caller, one for the cache */
+	kref_get(&dir->kref);
+	spin_lock(&dlog_dir_lock);
+	old = *slot;
+	*slot = dir;
+	spin_unlock(&dlog_dir_lock);
+	dlog_put_dir(old);
+out:
+	__putname(buf);
+	return dir;
+}
+
+/* Forget the path of a removed directory, its dentry may be reused */
+static void dlog_forget_dir(struct dentry *dentry)
+{
+	struct dlog_dir **slot =
+		&dlog_dir_cache[hash_ptr(dentry, DLOG_DIR_CACHE_BITS)];
+	struct dlog_dir *dir = NULL;
+
+	spin_lock(&dlog_dir_lock);
+	if (*slot && (*slot)->dentry == dentry) {
+		dir = *slot;
+		*slot = NULL;
+	}
+	spin_unlock(&dlog_dir_lock);
+
+	dlog_put_dir(dir);
+}
+
+static void dlog_drop_dir_cache(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(dlog_dir_cache); i++) {
+		dlog_put_dir(dlog_dir_cache[i]);
+		dlog_dir_cache[i] = NULL;
 	}
+}
+
+static void dlog_free_event(struct dlog_event *ev)
+{
+	dlog_put_dir(ev->dir);
+	release_dentry_name_snapshot(&ev->name);
+	kfree(ev);
+	atomic_dec(&dlog_nr_pending);
+}
+
+/* a run of consecutive deletes of one type in one directory */
+struct dlog_run {
+	/* first event of the run, freed when the run ends */
+	struct dlog_event *ev;
+	unsigned long count;
+};
+
+static bool dlog_same_run(struct dlog_run *run, struct dlog_event *ev)
+{
+	/* a rename elsewhere rebuilds the path, compare it by value then */
+	return run->ev && run->ev->parent_ino == ev->parent_ino &&
+		run->ev->type == ev->type &&
+		(run->ev->dir == ev->dir ||
+		 !strcmp(dlog_dir_path(run->ev), dlog_dir_path(ev)));
+}
+
+static void dlog_end_run(struct dlog_run *run)
+{
+	struct dlog_event *ev = run->ev;
+	const char *dir;
+	unsigned long skipped;
+	char prefix = 0;
 
-	if (type == DLOG_RMDIR)
-		fslog_dlog_rmdir("[%c]\"%s\" (%u, %lu)\n", prefix, full_path,
-				euid, path->dentry->d_inode->i_ino);
+	if (!ev)
+		return;
+
+	skipped = run->count > DLOG_COALESCE_MAX ?
+			run->count - DLOG_COALESCE_MAX : 0;
+	if (!skipped)
+		goto out;
+
+	dir = dlog_dir_path(ev);
+	make_prefix(ev->part_id, &prefix);
+	switch (ev->type) {
+	case DLOG_MM:
+		fslog_dlog_mm("[%c]\"%s/\" (%u, %lu, +%lu files)\n", prefix,
+				dir, ev->euid, ev->parent_ino, skipped);
+		break;
+	case DLOG_ETC:
+		fslog_dlog_etc("[%c]\"%s/\" (%u, %lu, +%lu files)\n", prefix,
+				dir, ev->euid, ev->parent_ino, skipped);
+		break;
+	case DLOG_EFS:
+		fslog_dlog_efs("\"%s/\" (%lu, +%lu files)\n",
+				dir, ev->parent_ino, skipped);
+		break;
+	}
 out:
-	kfree(buf);
+	dlog_free_event(ev);
+	run->ev = NULL;
+	run->count = 0;
+}
+
+static void dlog_work_fn(struct work_struct *work)
+{
+	struct llist_node *list;
+	struct dlog_event *ev, *next;
+	struct dlog_run run = { };
+	unsigned long dropped;
+
+	list = llist_reverse_order(llist_del_all(&dlog_pending));
+
+	llist_for_each_entry_safe(ev, next, list, node) {
+		/* directories are rare, always log them on their own */
+		if (ev->type == DLOG_RMDIR) {
+			store_log(ev);
+			dlog_free_event(ev);
+			continue;
+		}
+
+		if (!dlog_same_run(&run, ev)) {
+			dlog_end_run(&run);
+			run.ev = ev;
+		}
+
+		if (++run.count <= DLOG_COALESCE_MAX)
+			store_log(ev);
+
+		if (ev != run.ev)
+			dlog_free_event(ev);
+	}
+
+	dlog_end_run(&run);
+
+	dropped = atomic_long_xchg(&dlog_dropped, 0);
+	if (dropped)
+		fslog_dlog_etc("[dlog] %lu deletes not logged\n", dropped);
+}
+
+static void queue_log(struct dentry *dentry, struct inode *inode,
+		struct path *path, int type, int part_id)
+{
+	struct dlog_event *ev;
+
+	if (atomic_inc_return(&dlog_nr_pending) > DLOG_MAX_PENDING)
+		goto drop;
+
+	ev = kmalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		goto drop;
+
+	/* the parent is still locked by the caller, its path is stable */
+	ev->dir = dlog_get_dir(path->dentry);
+	take_dentry_name_snapshot(&ev->name, dentry);
+	ev->euid = current_euid();
+	ev->parent_ino = path->dentry->d_inode->i_ino;
+	ev->ino = inode ? inode->i_ino : 0;
+	ev->isize = inode ? i_size_read(inode) : 0;
+	ev->type = type;
+	ev->part_id = part_id;
+
+	llist_add(&ev->node, &dlog_pending);
+	queue_delayed_work(system_unbound_wq, &dlog_work, DLOG_BATCH_DELAY);
+	return;
+
+drop:
+	atomic_dec(&dlog_nr_pending);
+	atomic_long_inc(&dlog_dropped);
+	queue_delayed_work(system_unbound_wq, &dlog_work, DLOG_BATCH_DELAY);
 }
 
 void dlog_hook(struct dentry *dentry, struct inode *inode, struct path *path)
@@ -293,20 +574,20 @@ void dlog_hook(struct dentry *dentry, struct inode *inode, struct path *path)
 
 	/* for efs partition */
 	if (part_id == DLOG_SUPP_PART_EFS) {
-		store_log(dentry, inode, path, DLOG_EFS, part_id);
+		queue_log(dentry, inode, path, DLOG_EFS, part_id);
 		goto out;
 	}
 
 	/* for data partition`s only multimedia file */
 	if (is_ext(dentry->d_name.name, '.', &ht[DLOG_HT_EXTENSION])) {
-		store_log(dentry, inode, path, DLOG_MM, part_id);
+		queue_log(dentry, inode, path, DLOG_MM, part_id);
 		goto out;
 	}
 
 	/* for data partition except multimedia file */
 	if (!is_ext(dentry->d_name.name, '.', &ht[DLOG_HT_EXCEPTION])
 		&& !is_ext(dentry->d_name.name, '-', &ht[DLOG_HT_EXCEPTION]))
-		store_log(dentry, inode, path, DLOG_ETC, part_id);
+		queue_log(dentry, inode, path, DLOG_ETC, part_id);
 
 out:
 	return;
@@ -334,6 +615,8 @@ void dlog_hook_rmdir(struct dentry *dentry, struct path *path)
 	int depth = 0;
 	int part_id = get_support_part_id(path->mnt);
 
+	dlog_forget_dir(dentry);
+
 	if (part_id != DLOG_SUPP_PART_DATA)
 		return;
 
@@ -341,7 +624,7 @@ void dlog_hook_rmdir(struct dentry *dentry, struct path *path)
 	if (depth < 0)
 		return;
 
-	store_log(dentry, NULL, path, DLOG_RMDIR, part_id);
+	queue_log(dentry, NULL, path, DLOG_RMDIR, part_id);
 
 	return;
 }
@@ -304,6 +304,97 @@ static unsigned int count_bits(const unsigned long *addr,
 	return sum;
 }
 
+static bool skip_victim(struct f2fs_sb_info *sbi, unsigned int segno,
+			int gc_type, struct victim_sel_policy *p)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int secno = GET_SEC_FROM_SEG(sbi, segno);
+
+#ifdef CONFIG_F2FS_CHECK_FS
+	/*
+	 * skip selecting the invalid segno (that is failed due to block
+	 * validity check failure during GC) to avoid endless GC loop in
+	 * such cases.
+	 */
+	if (test_bit(segno, SIT_I(sbi)->invalid_segmap))
+		return true;
+#endif
+
+	if (sec_usage_check(sbi, secno))
+		return true;
+	/* Don't touch checkpointed data */
+	if (unlikely(is_sbi_flag_set(sbi, SBI_CP_DISABLED) &&
+				get_ckpt_valid_blocks(sbi, segno) &&
+				p->alloc_mode != SSR))
+		return true;
+	if (gc_type == BG_GC && test_bit(secno, dirty_i->victim_secmap))
+		return true;
+	/* W/A for FG_GC failure due to Atomic Write File and Pinned File */
+	if (test_bit(secno, dirty_i->blacklist_victim_secmap))
+		return true;
+	return false;
+}
+
+/* lowest cost a section in the bucket of the victim index can have */
+static unsigned int get_bucket_min_cost(struct f2fs_sb_info *sbi,
+			unsigned int bucket, struct victim_sel_policy *p)
+{
+	unsigned char u;
+
+	if (p->gc_mode == GC_GREEDY)
+		return bucket << sbi->log_segs_per_sec;
+
+	/* the utilization is the same in a bucket, the oldest age is 100 */
+	u = (bucket * 100) >> sbi->log_blocks_per_seg;
+	return UINT_MAX - ((100 * (100 - u) * 100) / (100 + u));
+}
+
+/*
+ * Instead of scanning the dirty segmap, walk the sections from the fewest
+ * valid blocks up, and stop as soon as no section in the remaining buckets
+ * can cost less than the best one found. The victim is the same one a full
+ * scan would find, but usually only the first buckets are looked at.
+ * The index is protected by sit_i->sentry_lock held for write.
+ */
+static void get_victim_from_index(struct f2fs_sb_info *sbi, int gc_type,
+			struct victim_sel_policy *p)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int nsearched = 0;
+	unsigned int bucket;
+
+	lockdep_assert_held(&SIT_I(sbi)->sentry_lock);
+
+	for (bucket = 0; bucket < dirty_i->nr_victim_buckets; bucket++) {
+		struct list_head *node;
+
+		if (get_bucket_min_cost(sbi, bucket, p) >= p->min_cost)
+			break;
+
+		list_for_each(node, &dirty_i->victim_bucket[bucket]) {
+			unsigned int secno = node - dirty_i->victim_sec;
+			unsigned int start = GET_SEG_FROM_SEC(sbi, secno);
+			unsigned int segno, cost;
+
+			segno = find_next_bit(p->dirty_segmap,
+					start + p->ofs_unit, start);
+			if (segno >= start + p->ofs_unit)
+				continue;
+
+			if (!skip_victim(sbi, segno, gc_type, p)) {
+				cost = get_gc_cost(sbi, segno, p);
+				if (p->min_cost > cost) {
+					p->min_segno = segno;
+					p->min_cost = cost;
+				}
+			}
+
+			if (++nsearched >= p->max_search)
+				return;
+		}
+	}
+}
+
 /*
  * This function is called from two paths.
  * One is garbage collection and the other is SSR segment selection.
@@ -364,6 +455,11 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			goto got_it;
 	}
 
+	if (p.alloc_mode == LFS && sbi->gc_victim_index) {
+		get_victim_from_index(sbi, gc_type, &p);
+		goto searched;
+	}
+
 	while (1) {
 		unsigned long cost;
 		unsigned int segno;
@@ -390,29 +486,7 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			nsearched++;
 		}
 
-#ifdef CONFIG_F2FS_CHECK_FS
-		/*
-		 * skip selecting the invalid segno (that is failed due to block
-		 * validity check failure during GC) to avoid endless GC loop in
-		 * such cases.
-		 */
-		if (test_bit(segno, sm->invalid_segmap))
-			goto next;
-#endif
-
-		secno = GET_SEC_FROM_SEG(sbi, segno);
-
-		if (sec_usage_check(sbi, secno))
-			goto next;
-		/* Don't touch checkpointed data */
-		if (unlikely(is_sbi_flag_set(sbi, SBI_CP_DISABLED) &&
-					get_ckpt_valid_blocks(sbi, segno) &&
-					p.alloc_mode != SSR))
-			goto next;
-		if (gc_type == BG_GC && test_bit(secno, dirty_i->victim_secmap))
-			goto next;
-		/* W/A for FG_GC failure due to Atomic Write File and Pinned File */
-		if (test_bit(secno, dirty_i->blacklist_victim_secmap))
+		if (skip_victim(sbi, segno, gc_type, &p))
 			goto next;
 		cost = get_gc_cost(sbi, segno, &p);
 
@@ -431,6 +505,7 @@ next:
 			break;
 		}
 	}
+searched:
 	if (p.min_segno != NULL_SEGNO) {
 got_it:
 		*result = (p.min_segno / p.ofs_unit) * p.ofs_unit;
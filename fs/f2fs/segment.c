@@ -2152,6 +2152,57 @@ static void __set_sit_entry_type(struct f2fs_sb_info *sbi, int type,
 		__mark_sit_entry_dirty(sbi, segno);
 }
 
+/*
+ * get_cb_cost() widens the min/max mtime range with each section it costs,
+ * but selection from the victim index costs only a few of them. So widen
+ * it with every section the index sees instead.
+ */
+static void update_victim_mtime(struct f2fs_sb_info *sbi, unsigned int secno)
+{
+	struct sit_info *sit_i = SIT_I(sbi);
+	unsigned int start = GET_SEG_FROM_SEC(sbi, secno);
+	unsigned long long mtime = 0;
+	unsigned int i;
+
+	for (i = 0; i < sbi->segs_per_sec; i++)
+		mtime += get_seg_entry(sbi, start + i)->mtime;
+
+	mtime = div_u64(mtime, sbi->segs_per_sec);
+
+	if (mtime < sit_i->min_mtime)
+		sit_i->min_mtime = mtime;
+	if (mtime > sit_i->max_mtime)
+		sit_i->max_mtime = mtime;
+}
+
+/*
+ * Move the section of segno to the bucket of its valid blocks, so that the
+ * victim selection of LFS GC finds the emptiest sections first.
+ * This should be covered by &sit_i->sentry_lock held for write.
+ */
+static void update_victim_index(struct f2fs_sb_info *sbi, unsigned int segno)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int secno = GET_SEC_FROM_SEG(sbi, segno);
+	unsigned int vblocks = get_valid_blocks(sbi, segno, true);
+	struct list_head *node;
+
+	lockdep_assert_held(&SIT_I(sbi)->sentry_lock);
+
+	/* only kept while gc_victim_index is set */
+	if (!dirty_i->victim_bucket)
+		return;
+
+	update_victim_mtime(sbi, secno);
+
+	node = &dirty_i->victim_sec[secno];
+	if (!vblocks)
+		list_del_init(node);
+	else
+		list_move_tail(node, &dirty_i->victim_bucket[vblocks >>
+					sbi->log_segs_per_sec]);
+}
+
 static void update_sit_entry(struct f2fs_sb_info *sbi, block_t blkaddr, int del)
 {
 	struct seg_entry *se;
@@ -2251,6 +2302,9 @@ static void update_sit_entry(struct f2fs_sb_info *sbi, block_t blkaddr, int del)
 
 	if (__is_large_section(sbi))
 		get_sec_entry(sbi, segno)->valid_blocks += del;
+
+	if (del)
+		update_victim_index(sbi, segno);
 }
 
 void f2fs_invalidate_blocks(struct f2fs_sb_info *sbi, block_t addr)
@@ -4379,6 +4433,86 @@ static int init_victim_secmap(struct f2fs_sb_info *sbi)
 	return 0;
 }
 
+/*
+ * Build the index of sections by valid blocks from the SIT and select LFS
+ * GC victims from it. The index is neither allocated nor maintained while
+ * gc_victim_index is off.
+ */
+int f2fs_build_victim_index(struct f2fs_sb_info *sbi)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	struct sit_info *sit_i = SIT_I(sbi);
+	/* a full section goes to the last bucket */
+	unsigned int nr_buckets = sbi->blocks_per_seg + 1;
+	struct list_head *bucket, *sec;
+	unsigned int secno, i;
+
+	/* buckets are indexed by shifting the valid blocks of a section */
+	if (!is_power_of_2(sbi->segs_per_sec))
+		return -EINVAL;
+
+	bucket = f2fs_kvmalloc(sbi, array_size(sizeof(struct list_head),
+					nr_buckets), GFP_KERNEL);
+	sec = f2fs_kvmalloc(sbi, array_size(sizeof(struct list_head),
+					MAIN_SECS(sbi)), GFP_KERNEL);
+	if (!bucket || !sec) {
+		kvfree(sec);
+		kvfree(bucket);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < nr_buckets; i++)
+		INIT_LIST_HEAD(&bucket[i]);
+
+	down_write(&sit_i->sentry_lock);
+
+	if (dirty_i->victim_bucket) {
+		up_write(&sit_i->sentry_lock);
+		kvfree(sec);
+		kvfree(bucket);
+		return 0;
+	}
+
+	for (secno = 0; secno < MAIN_SECS(sbi); secno++) {
+		unsigned int segno = GET_SEG_FROM_SEC(sbi, secno);
+		unsigned int vblocks = get_valid_blocks(sbi, segno, true);
+
+		INIT_LIST_HEAD(&sec[secno]);
+		if (vblocks)
+			list_add_tail(&sec[secno],
+				&bucket[vblocks >> sbi->log_segs_per_sec]);
+		update_victim_mtime(sbi, secno);
+	}
+
+	dirty_i->victim_bucket = bucket;
+	dirty_i->victim_sec = sec;
+	dirty_i->nr_victim_buckets = nr_buckets;
+	sbi->gc_victim_index = 1;
+
+	up_write(&sit_i->sentry_lock);
+
+	return 0;
+}
+
+void f2fs_destroy_victim_index(struct f2fs_sb_info *sbi)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	struct sit_info *sit_i = SIT_I(sbi);
+	struct list_head *bucket, *sec;
+
+	down_write(&sit_i->sentry_lock);
+	sbi->gc_victim_index = 0;
+	bucket = dirty_i->victim_bucket;
+	sec = dirty_i->victim_sec;
+	dirty_i->victim_bucket = NULL;
+	dirty_i->victim_sec = NULL;
+	dirty_i->nr_victim_buckets = 0;
+	up_write(&sit_i->sentry_lock);
+
+	kvfree(sec);
+	kvfree(bucket);
+}
+
 static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 {
 	struct dirty_seglist_info *dirty_i;
@@ -4575,6 +4709,8 @@ static void destroy_dirty_segmap(struct f2fs_sb_info *sbi)
 		discard_dirty_segmap(sbi, i);
 
 	destroy_victim_secmap(sbi);
+	kvfree(dirty_i->victim_sec);
+	kvfree(dirty_i->victim_bucket);
 	SM_I(sbi)->dirty_info = NULL;
 	kvfree(dirty_i);
 }
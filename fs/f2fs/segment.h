@@ -272,6 +272,15 @@ struct dirty_seglist_info {
 
 	/* W/A for FG_GC failure due to Atomic Write File and Pinned File */
 	unsigned long *blacklist_victim_secmap; /* GC Failed Bitmap */
+
+	/*
+	 * sections in use, bucketed by valid blocks for LFS victim selection,
+	 * only built while gc_victim_index is set, protected by
+	 * sit_i->sentry_lock
+	 */
+	struct list_head *victim_bucket;	/* sections by valid blocks */
+	struct list_head *victim_sec;		/* list node of each section */
+	unsigned int nr_victim_buckets;		/* # of buckets */
 };
 
 /* victim selection function for cleaning and SSR */
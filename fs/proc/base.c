@@ -3206,6 +3206,7 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("mountstats", S_IRUSR, proc_mountstats_operations),
 #ifdef CONFIG_PROCESS_RECLAIM
 	REG("reclaim", S_IWUSR|S_IWOTH, proc_reclaim_operations),
+	ONE("reclaim_stat", S_IRUGO, proc_pid_reclaim_stat),
 #endif
 #ifdef CONFIG_PROC_PAGE_MONITOR
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
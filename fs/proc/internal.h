@@ -200,6 +200,8 @@ extern const struct inode_operations proc_link_inode_operations;
 
 extern const struct inode_operations proc_pid_link_inode_operations;
 extern const struct file_operations proc_reclaim_operations;
+extern int proc_pid_reclaim_stat(struct seq_file *, struct pid_namespace *,
+				 struct pid *, struct task_struct *);
 
 extern void proc_init_inodecache(void);
 void set_proc_pid_nlink(void);
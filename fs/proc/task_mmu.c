@@ -21,6 +21,10 @@
 #include <linux/mm_inline.h>
 #include <linux/ctype.h>
 #include <linux/freezer.h>
+#include <linux/workqueue.h>
+#include <linux/delay.h>
+#include <linux/sizes.h>
+#include <linux/blkdev.h>
 
 #include <asm/elf.h>
 #include <asm/tlb.h>
@@ -28,7 +32,6 @@
 #include "internal.h"
 
 #ifdef CONFIG_ZRAM_LRU_WRITEBACK
-#include <linux/delay.h>
 #include "../../drivers/block/zram/zram_drv.h"
 #endif
 
@@ -1691,15 +1694,97 @@ const struct file_operations proc_pagemap_operations = {
 #endif /* CONFIG_PROC_PAGE_MONITOR */
 
 #ifdef CONFIG_PROCESS_RECLAIM
+struct reclaim_job;
+
+struct reclaim_param {
+	struct vm_area_struct *vma;
+	/* async pass the walk belongs to, NULL for a synchronous write */
+	struct reclaim_job *job;
+	/* address the walk reached when it bailed out */
+	unsigned long resume_addr;
+	/* only reclaim pages idle for at least min_age scans, 0 for all */
+	unsigned int min_age;
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+	unsigned long age_hist[RECLAIM_AGE_BUCKETS];
+#endif
+};
+
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+static inline bool page_idle_aged(struct page *page, pte_t ptent,
+				unsigned int min_age)
+{
+	/* referenced since the last scan, it is part of the working set */
+	if (pte_young(ptent) || !page_is_idle(page))
+		return false;
+
+	return page_age(page) >= min_age;
+}
+
+static int age_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_param *rp = walk->private;
+	struct vm_area_struct *vma = rp->vma;
+	pte_t *pte;
+	spinlock_t *ptl;
+	struct page *page;
+	unsigned int age;
+	bool referenced;
+
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		if (!pte_present(*pte))
+			continue;
+
+		page = vm_normal_page(vma, addr, *pte);
+		if (!page || !PageLRU(page) || PageUnevictable(page))
+			continue;
+
+		/*
+		 * Like page_idle, hand a cleared young bit over to the page so
+		 * that vmscan still sees the reference.
+		 */
+		referenced = !page_is_idle(page);
+		if (ptep_test_and_clear_young(vma, addr, pte)) {
+			set_page_young(page);
+			referenced = true;
+		}
+
+		age = referenced ? 0 : min_t(unsigned int, page_age(page) + 1,
+							PAGE_AGE_MAX);
+		set_page_age(page, age);
+		set_page_idle(page);
+
+		rp->age_hist[min(fls(age), RECLAIM_AGE_BUCKETS - 1)]++;
+	}
+	pte_unmap_unlock(pte - 1, ptl);
+
+	cond_resched();
+	return 0;
+}
+#else
+static inline bool page_idle_aged(struct page *page, pte_t ptent,
+				unsigned int min_age)
+{
+	return true;
+}
+#endif
+
 static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 				unsigned long end, struct mm_walk *walk)
 {
-	struct vm_area_struct *vma = walk->private;
+	struct reclaim_param *rp = walk->private;
+	struct vm_area_struct *vma = rp->vma;
+	struct mm_reclaim_stat *stat = &walk->mm->reclaim_stat;
 	pte_t *pte, ptent;
 	spinlock_t *ptl;
 	struct page *page;
 	LIST_HEAD(page_list);
-	int isolated;
+	unsigned long reclaimed;
+	int isolated, scanned;
 
 #ifdef CONFIG_ZRAM_LRU_WRITEBACK
 	bool is_lru_wb = false;
@@ -1712,18 +1797,24 @@ static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 	if (pmd_trans_unstable(pmd))
 		return 0;
 cont:
+	rp->resume_addr = addr;
 	if (rwsem_is_contended(&walk->mm->mmap_sem))
 		return -1;
 	if (pm_freezing)
 		return -1;
-	
+	if (rp->job && atomic_long_read(&stat->budget) <= 0)
+		return -1;
+
 	isolated = 0;
+	scanned = 0;
 	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
 	for (; addr != end; pte++, addr += PAGE_SIZE) {
 		ptent = *pte;
 		if (!pte_present(ptent))
 			continue;
 
+		scanned++;
+
 		page = vm_normal_page(vma, addr, ptent);
 		if (!page)
 			continue;
@@ -1731,6 +1822,9 @@ cont:
 		if (PageUnevictable(page))
 			continue;
 
+		if (rp->min_age && !page_idle_aged(page, ptent, rp->min_age))
+			continue;
+
 #ifdef CONFIG_ZRAM_LRU_WRITEBACK
 		if (is_lru_wb && ptep_test_and_clear_young(vma, addr, pte))
 			continue;
@@ -1762,7 +1856,82 @@ cont:
 			break;
 	}
 	pte_unmap_unlock(pte - 1, ptl);
-	reclaim_pages_from_list(&page_list, vma);
+	reclaimed = reclaim_pages_from_list(&page_list, vma);
+	atomic_long_add(scanned, &stat->nr_scanned);
+	atomic_long_add(reclaimed, &stat->nr_reclaimed);
+	if (rp->job)
+		atomic_long_sub(reclaimed, &stat->budget);
+	if (addr != end)
+		goto cont;
+
+	cond_resched();
+	return 0;
+}
+
+/*
+ * Bring the swapped out pages of a process back before it touches them, so
+ * that a resumed app does not refault its working set one page at a time.
+ * The swap ptes left behind by reclaim are the record of what to read back.
+ * Entries are collected a batch at a time under the pte lock and read with
+ * the block layer plugged, so the swap device sees large batches.
+ */
+static int prefetch_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_param *rp = walk->private;
+	struct vm_area_struct *vma = rp->vma;
+	struct mm_reclaim_stat *stat = &walk->mm->reclaim_stat;
+	swp_entry_t entries[SWAP_CLUSTER_MAX];
+	unsigned long addrs[SWAP_CLUSTER_MAX];
+	pte_t *orig_pte, *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	struct blk_plug plug;
+	swp_entry_t entry;
+	int nr, i;
+
+	if (pmd_none_or_trans_huge_or_clear_bad(pmd))
+		return 0;
+cont:
+	rp->resume_addr = addr;
+	if (rwsem_is_contended(&walk->mm->mmap_sem))
+		return -1;
+	if (pm_freezing)
+		return -1;
+	if (rp->job && atomic_long_read(&stat->budget) <= 0)
+		return -1;
+
+	nr = 0;
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		if (nr == SWAP_CLUSTER_MAX)
+			break;
+
+		ptent = *pte;
+		if (!is_swap_pte(ptent))
+			continue;
+
+		entry = pte_to_swp_entry(ptent);
+		if (unlikely(non_swap_entry(entry)))
+			continue;
+
+		entries[nr] = entry;
+		addrs[nr++] = addr;
+	}
+	pte_unmap_unlock(orig_pte, ptl);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr; i++) {
+		page = read_swap_cache_async(entries[i], GFP_HIGHUSER_MOVABLE,
+						vma, addrs[i], false);
+		if (page)
+			put_page(page);
+	}
+	blk_finish_plug(&plug);
+
+	atomic_long_add(nr, &stat->nr_prefetched);
+	if (rp->job)
+		atomic_long_sub(nr, &stat->budget);
 	if (addr != end)
 		goto cont;
 
@@ -1817,8 +1986,259 @@ enum reclaim_type {
 #ifdef CONFIG_ZRAM_LRU_WRITEBACK
 	RECLAIM_WRITEBACK,
 #endif
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+	RECLAIM_AGE_SCAN,
+#endif
+	RECLAIM_PREFETCH,
 };
 
+/*
+ * Asynchronous process reclaim
+ *
+ * "<type> async [budget]" hands the walk over to a pool of unbound workers
+ * so the writer returns immediately. The workers claim chunks of at most
+ * RECLAIM_CHUNK_SIZE within a vma from a shared cursor and walk them in
+ * parallel under mmap_sem for read. When a walk backs off because mmap_sem
+ * is contended, the worker drops the lock and resumes the same chunk from
+ * the address it reached instead of giving up on the whole pass. The pass
+ * ends when every vma was walked or when budget pages have been reclaimed.
+ */
+#define RECLAIM_MAX_WORKERS	4
+#define RECLAIM_CHUNK_SIZE	SZ_16M
+
+struct reclaim_worker {
+	struct work_struct work;
+	struct reclaim_job *job;
+};
+
+struct reclaim_job {
+	struct mm_struct *mm;
+	enum reclaim_type type;
+	unsigned int min_age;
+	spinlock_t lock;
+	/* start of the next unclaimed chunk */
+	unsigned long cursor;
+	atomic_t nr_workers;
+	struct reclaim_worker workers[RECLAIM_MAX_WORKERS];
+};
+
+static struct workqueue_struct *reclaim_wq;
+
+static bool reclaim_skip_vma(struct vm_area_struct *vma, enum reclaim_type type)
+{
+	if (is_vm_hugetlb_page(vma))
+		return true;
+
+	if ((type == RECLAIM_ANON || type == RECLAIM_PREFETCH) && vma->vm_file)
+		return true;
+
+	if (type == RECLAIM_FILE && !vma->vm_file)
+		return true;
+
+	return false;
+}
+
+/* Called with mmap_sem held, a chunk never crosses a vma boundary */
+static bool reclaim_claim_chunk(struct reclaim_job *job,
+			unsigned long *start, unsigned long *end)
+{
+	struct vm_area_struct *vma;
+	bool claimed = false;
+
+	spin_lock(&job->lock);
+	for (vma = find_vma(job->mm, job->cursor); vma; vma = vma->vm_next) {
+		if (reclaim_skip_vma(vma, job->type))
+			continue;
+
+		*start = max(vma->vm_start, job->cursor);
+		*end = min(vma->vm_end, *start + RECLAIM_CHUNK_SIZE);
+		job->cursor = *end;
+		claimed = true;
+		break;
+	}
+	spin_unlock(&job->lock);
+
+	return claimed;
+}
+
+/* Called with mmap_sem held, returns the address the walk reached */
+static unsigned long reclaim_walk_chunk(struct reclaim_job *job,
+			unsigned long start, unsigned long end)
+{
+	struct reclaim_param rp = {
+		.job = job,
+		.min_age = job->min_age,
+	};
+	struct mm_walk reclaim_walk = {
+		.pmd_entry = reclaim_pte_range,
+		.mm = job->mm,
+		.private = &rp,
+	};
+	struct vm_area_struct *vma;
+
+	if (job->type == RECLAIM_PREFETCH)
+		reclaim_walk.pmd_entry = prefetch_pte_range;
+
+	/* the vma may have changed while mmap_sem was dropped */
+	vma = find_vma(job->mm, start);
+	if (!vma || vma->vm_start >= end || reclaim_skip_vma(vma, job->type))
+		return end;
+
+	rp.vma = vma;
+	if (walk_page_range(max(vma->vm_start, start),
+				min(vma->vm_end, end), &reclaim_walk))
+		return rp.resume_addr;
+
+	return end;
+}
+
+static void reclaim_async_work(struct work_struct *work)
+{
+	struct reclaim_worker *worker = container_of(work,
+					struct reclaim_worker, work);
+	struct reclaim_job *job = worker->job;
+	struct mm_struct *mm = job->mm;
+	struct mm_reclaim_stat *stat = &mm->reclaim_stat;
+	unsigned long start = 0, end = 0;
+	bool claimed = false;
+
+	while (atomic_long_read(&stat->budget) > 0 && !pm_freezing) {
+		if (!mmget_not_zero(mm))
+			break;
+
+		down_read(&mm->mmap_sem);
+		if (!claimed)
+			claimed = reclaim_claim_chunk(job, &start, &end);
+		if (claimed) {
+			start = reclaim_walk_chunk(job, start, end);
+			flush_tlb_mm(mm);
+		}
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+
+		if (!claimed)
+			break;
+
+		if (start >= end) {
+			claimed = false;
+			continue;
+		}
+
+		if (atomic_long_read(&stat->budget) <= 0 || pm_freezing)
+			break;
+
+		/* let the mmap_sem writer in, then resume where we stopped */
+		atomic_long_inc(&stat->nr_contended);
+		usleep_range(1000, 2000);
+	}
+
+	if (job->type == RECLAIM_PREFETCH)
+		lru_add_drain();
+
+	if (atomic_dec_and_test(&job->nr_workers)) {
+		stat->end_time = ktime_get_ns();
+		atomic_set(&stat->running, 0);
+		mmdrop(mm);
+		kfree(job);
+	}
+}
+
+static int reclaim_start_async(struct mm_struct *mm, enum reclaim_type type,
+				unsigned int min_age, long budget)
+{
+	struct mm_reclaim_stat *stat = &mm->reclaim_stat;
+	struct reclaim_job *job;
+	int i, nr_workers;
+
+	if (!reclaim_wq)
+		return -ENODEV;
+
+	if (atomic_cmpxchg(&stat->running, 0, 1))
+		return -EBUSY;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job) {
+		atomic_set(&stat->running, 0);
+		return -ENOMEM;
+	}
+
+	nr_workers = clamp_t(int, num_online_cpus() / 2, 1, RECLAIM_MAX_WORKERS);
+
+	mmgrab(mm);
+	job->mm = mm;
+	job->type = type;
+	job->min_age = min_age;
+	spin_lock_init(&job->lock);
+	atomic_set(&job->nr_workers, nr_workers);
+
+	atomic_long_set(&stat->budget, budget);
+	stat->start_time = ktime_get_ns();
+	stat->end_time = 0;
+
+	for (i = 0; i < nr_workers; i++) {
+		job->workers[i].job = job;
+		INIT_WORK(&job->workers[i].work, reclaim_async_work);
+		queue_work(reclaim_wq, &job->workers[i].work);
+	}
+
+	return 0;
+}
+
+int proc_pid_reclaim_stat(struct seq_file *m, struct pid_namespace *ns,
+			struct pid *pid, struct task_struct *task)
+{
+	struct mm_struct *mm = get_task_mm(task);
+	struct mm_reclaim_stat *stat;
+	bool running;
+	u64 elapsed = 0;
+
+	if (!mm)
+		return 0;
+
+	stat = &mm->reclaim_stat;
+	running = atomic_read(&stat->running);
+	if (stat->start_time)
+		elapsed = (running ? ktime_get_ns() : stat->end_time) -
+							stat->start_time;
+
+	seq_printf(m, "state: %s\n", running ? "running" : "idle");
+	seq_printf(m, "budget_left: %ld\n",
+			max(atomic_long_read(&stat->budget), 0L));
+	seq_printf(m, "scanned: %ld\n", atomic_long_read(&stat->nr_scanned));
+	seq_printf(m, "reclaimed: %ld\n", atomic_long_read(&stat->nr_reclaimed));
+	seq_printf(m, "contended: %ld\n", atomic_long_read(&stat->nr_contended));
+	seq_printf(m, "prefetched: %ld\n", atomic_long_read(&stat->nr_prefetched));
+	seq_printf(m, "swapin_faults: %ld\n",
+			atomic_long_read(&stat->nr_swapin_faults));
+	seq_printf(m, "elapsed_ms: %llu\n", div_u64(elapsed, NSEC_PER_MSEC));
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+	{
+		int i;
+
+		seq_printf(m, "age_scans: %lu\n", stat->nr_age_scans);
+		seq_puts(m, "age_hist:");
+		for (i = 0; i < RECLAIM_AGE_BUCKETS; i++)
+			seq_printf(m, " %lu", stat->age_hist[i]);
+		seq_putc(m, '\n');
+	}
+#endif
+
+	mmput(mm);
+
+	return 0;
+}
+
+static int __init proc_reclaim_init(void)
+{
+	reclaim_wq = alloc_workqueue("proc_reclaim",
+			WQ_UNBOUND | WQ_FREEZABLE, RECLAIM_MAX_WORKERS);
+	if (!reclaim_wq)
+		pr_err("%s: failed to create workqueue\n", __func__);
+
+	return 0;
+}
+late_initcall(proc_reclaim_init);
+
 static ssize_t reclaim_write(struct file *file, const char __user *buf,
 				size_t count, loff_t *ppos)
 {
@@ -1827,7 +2247,11 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	struct mm_struct *mm;
 	struct vm_area_struct *vma;
 	enum reclaim_type type;
-	char *type_buf;
+	char *type_buf, *async_buf, *idle_buf;
+	bool async = false;
+	long budget = LONG_MAX;
+	unsigned int min_age = 0;
+	struct reclaim_param rp = { };
 	struct mm_walk reclaim_walk = {
 		.pmd_entry = reclaim_pte_range,
 	};
@@ -1847,6 +2271,34 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 		return -EFAULT;
 
 	type_buf = strstrip(buffer);
+	async_buf = strstr(type_buf, " async");
+	if (async_buf) {
+		*async_buf = '\0';
+		async_buf = skip_spaces(async_buf + strlen(" async"));
+		async = true;
+
+		if (*async_buf) {
+			char *token;
+
+			budget = memparse(async_buf, &token) >> PAGE_SHIFT;
+			if (*token || budget <= 0)
+				goto out_err;
+		}
+	}
+
+	idle_buf = strstr(type_buf, " idle ");
+	if (idle_buf) {
+		if (!IS_ENABLED(CONFIG_PROCESS_RECLAIM_AGE))
+			goto out_err;
+
+		*idle_buf = '\0';
+		if (kstrtouint(skip_spaces(idle_buf + strlen(" idle ")), 10,
+								&min_age))
+			goto out_err;
+		if (!min_age || min_age > PAGE_AGE_MAX)
+			goto out_err;
+	}
+
 	if (!strcmp(type_buf, "file"))
 		type = RECLAIM_FILE;
 	else if (!strcmp(type_buf, "anon"))
@@ -1859,9 +2311,25 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	else if (!strcmp(type_buf, "writeback"))
 		type = RECLAIM_WRITEBACK;
 #endif
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+	else if (!strcmp(type_buf, "scan"))
+		type = RECLAIM_AGE_SCAN;
+#endif
+	else if (!strcmp(type_buf, "prefetch"))
+		type = RECLAIM_PREFETCH;
 	else
 		goto out_err;
 
+	/* only the page selecting types take an idle age */
+	if (min_age && type != RECLAIM_FILE && type != RECLAIM_ANON &&
+	    type != RECLAIM_ALL)
+		goto out_err;
+
+	/* async mode walks whole vmas of a type */
+	if (async && type != RECLAIM_FILE && type != RECLAIM_ANON &&
+	    type != RECLAIM_ALL && type != RECLAIM_PREFETCH)
+		goto out_err;
+
 	if (type == RECLAIM_RANGE) {
 		char *token;
 		unsigned long long len, len_in, tmp;
@@ -1911,7 +2379,23 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	if (!mm)
 		goto out;
 
+	if (async) {
+		err = reclaim_start_async(mm, type, min_age, budget);
+		if (err)
+			count = err;
+		mmput(mm);
+		goto out;
+	}
+
 	reclaim_walk.mm = mm;
+	reclaim_walk.private = &rp;
+	rp.min_age = min_age;
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+	if (type == RECLAIM_AGE_SCAN)
+		reclaim_walk.pmd_entry = age_pte_range;
+#endif
+	if (type == RECLAIM_PREFETCH)
+		reclaim_walk.pmd_entry = prefetch_pte_range;
 
 	down_read(&mm->mmap_sem);
 	if (type == RECLAIM_RANGE) {
@@ -1922,7 +2406,7 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 			if (is_vm_hugetlb_page(vma))
 				continue;
 
-			reclaim_walk.private = vma;
+			rp.vma = vma;
 			if (walk_page_range(max(vma->vm_start, start),
 					min(vma->vm_end, end),
 					&reclaim_walk))
@@ -1931,7 +2415,7 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 		}
 	} else {
 		for (vma = mm->mmap; vma; vma = vma->vm_next) {
-			reclaim_walk.private = vma;
+			rp.vma = vma;
 #ifdef CONFIG_ZRAM_LRU_WRITEBACK
 			if (type == RECLAIM_WRITEBACK)
 				reclaim_walk.private = (void *) zwbs;
@@ -1939,7 +2423,8 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 			if (is_vm_hugetlb_page(vma))
 				continue;
 
-			if (type == RECLAIM_ANON && vma->vm_file)
+			if ((type == RECLAIM_ANON || type == RECLAIM_PREFETCH) &&
+			    vma->vm_file)
 				continue;
 
 			if (type == RECLAIM_FILE && !vma->vm_file)
@@ -1960,6 +2445,15 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	}
 
 	flush_tlb_mm(mm);
+	if (type == RECLAIM_PREFETCH)
+		lru_add_drain();
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+	if (type == RECLAIM_AGE_SCAN) {
+		memcpy(mm->reclaim_stat.age_hist, rp.age_hist,
+					sizeof(rp.age_hist));
+		mm->reclaim_stat.nr_age_scans++;
+	}
+#endif
 	up_read(&mm->mmap_sem);
 	mmput(mm);
 out:
@@ -126,6 +126,8 @@ typedef __u32 __bitwise req_flags_t;
 /* Look at ->special_vec for the actual data payload instead of the
    bio chain. */
 #define RQF_SPECIAL_PAYLOAD	((__force req_flags_t)(1 << 18))
+/* counted in the I/O volume of blk-mq queue */
+#define RQF_IO_VOL		((__force req_flags_t)(1 << 19))
 
 /* flags that prevent us from merging requests: */
 #define RQF_NOMERGE_FLAGS \
@@ -423,6 +425,18 @@ struct block_io_volume {
 
 // WRITE : 1, READ : 0
 #define BLK_MAX_IO_VOLS	2
+
+/*
+ * blk-mq queues count the I/O volume per cpu without queue_lock.
+ * The counters are folded into blk_io_vol[] by io_vol_work.
+ */
+struct block_io_volume_pcpu {
+	int			queuing_rqs[BLK_MAX_IO_VOLS];
+	long long		queuing_bytes[BLK_MAX_IO_VOLS];
+	/* write amount issued to the device */
+	long long		issued_bytes;
+};
+
 #define blk_io_vol_rqs(q, op)		((q)->blk_io_vol[(op)&1].queuing_rqs)
 #define blk_io_vol_bytes(q, op)		((q)->blk_io_vol[(op)&1].queuing_bytes)
 #else
@@ -469,6 +483,8 @@ struct blk_turbo_write {
 	int			curr_issued_kb;
 	/* accumulated write amount in TW sessions */
 	unsigned int		total_issued_mb;
+	/* issued write amount of blk-mq queue at the last fold */
+	long long		mq_issued_bytes;
 	/* volume count of write amount per TW session */
 	unsigned int		issued_size_cnt[4];
 };
@@ -721,6 +737,8 @@ struct request_queue {
 
 #ifdef CONFIG_BLK_IO_VOLUME
 	struct block_io_volume	blk_io_vol[BLK_MAX_IO_VOLS];
+	struct block_io_volume_pcpu __percpu *blk_io_vol_pcpu;
+	struct delayed_work	io_vol_work;
 #endif
 
 #ifdef CONFIG_BLK_TURBO_WRITE
@@ -270,6 +270,13 @@ static inline int cpuidle_register_governor(struct cpuidle_governor *gov)
 {return 0;}
 #endif
 
+#if defined(CONFIG_CPU_IDLE) && defined(CONFIG_CPU_IDLE_GOV_TEO)
+extern ktime_t cpuidle_predicted_wakeup(int cpu);
+#else
+static inline ktime_t cpuidle_predicted_wakeup(int cpu)
+{return KTIME_MAX;}
+#endif
+
 #define CPU_PM_CPU_IDLE_ENTER(low_level_idle_enter, idx)	\
 ({								\
 	int __ret;						\
@@ -19,7 +19,9 @@ extern void cpuidle_profile_cpu_idle_exit(int cpu, int index, int cancel);
 extern void cpuidle_profile_cpu_idle_register(struct cpuidle_driver *drv);
 extern void cpuidle_profile_group_idle_enter(int id);
 extern void cpuidle_profile_group_idle_exit(int id, int cancel);
-extern void cpuidle_profile_group_idle_register(int id, const char *name);
+extern void cpuidle_profile_group_idle_register(int id, const char *name,
+						unsigned int target_residency);
 extern void cpuidle_profile_idle_ip(int index, unsigned int idle_ip);
+extern void cpuidle_profile_cpupm_enter(int cpu, u64 cycles);
 
 #endif /* CPUIDLE_PROFILE_H */
@@ -51,6 +51,18 @@ struct dma_buf_attachment;
  * @vunmap: [optional] unmaps a vmap from the buffer
  */
 struct dma_buf_ops {
+	/**
+	 * @cache_sgt_mapping:
+	 *
+	 * If true the framework will cache the first mapping made for each
+	 * attachment. The cached &sg_table is returned again by
+	 * dma_buf_map_attachment() without calling @map_dma_buf, and it is
+	 * only unmapped on dma_buf_detach(). The exporter must then keep the
+	 * mapping coherent with @begin_cpu_access and @end_cpu_access since
+	 * @unmap_dma_buf is no longer called after each DMA transfer.
+	 */
+	bool cache_sgt_mapping;
+
 	/**
 	 * @attach:
 	 *
@@ -344,6 +356,8 @@ struct dma_buf {
  * @dev: device attached to the buffer.
  * @node: list of dma_buf_attachment.
  * @priv: exporter specific attachment data.
+ * @sgt: cached mapping, only used with &dma_buf_ops.cache_sgt_mapping.
+ * @dir: direction of the cached mapping.
  *
  * This structure holds the attachment information between the dma_buf buffer
  * and its user device(s). The list contains one attachment struct per device
@@ -359,6 +373,8 @@ struct dma_buf_attachment {
 	struct device *dev;
 	struct list_head node;
 	void *priv;
+	struct sg_table *sgt;
+	enum dma_data_direction dir;
 };
 
 /**
@@ -35,6 +35,23 @@ struct task_band {
 
 	unsigned long util;
 	unsigned long last_update_time;
+
+	/*
+	 * Placement feedback. Counters are bumped from the wakeup path without
+	 * band->lock, so they are approximate; they are only consumed as rates.
+	 */
+	unsigned long wakeups;
+	unsigned long cross_cpu_wakeups;
+	unsigned long migrations;
+	unsigned long colocated_wakeups;
+
+	/* counter snapshot at the start of the current feedback window */
+	unsigned long window_start;
+	unsigned long window_wakeups;
+	unsigned long window_cross_cpu;
+
+	/* number of cpus in the band's coregroup the band may play on */
+	int play_span;
 };
 
 struct rq;
@@ -850,6 +850,11 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+
+	pgoff_t mmap_start;		/* where the last mmap read-around started */
+	unsigned int mmap_window;	/* adaptive mmap read-around window */
+	unsigned int mmap_hit;		/* faults in the last read-around */
+	unsigned int mmap_span;		/* pages mapped per fault-around */
 };
 
 /*
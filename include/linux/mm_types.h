@@ -362,6 +362,31 @@ struct core_state {
 	struct completion startup;
 };
 
+#ifdef CONFIG_PROCESS_RECLAIM
+#define RECLAIM_AGE_BUCKETS	8
+
+/* Progress of /proc/<pid>/reclaim, reported by /proc/<pid>/reclaim_stat */
+struct mm_reclaim_stat {
+	atomic_t running;		/* an async pass is in flight */
+	atomic_long_t budget;		/* pages left for the async pass */
+	atomic_long_t nr_scanned;
+	atomic_long_t nr_reclaimed;
+	atomic_long_t nr_contended;	/* backoffs on mmap_sem contention */
+	atomic_long_t nr_prefetched;	/* swap entries read back by prefetch */
+	atomic_long_t nr_swapin_faults;	/* faults that had to read from swap */
+	u64 start_time;
+	u64 end_time;
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+	/*
+	 * Idle age histogram of the last scan. Bucket 0 counts pages of age 0,
+	 * bucket n ages [2^(n-1), 2^n) and the last bucket everything older.
+	 */
+	unsigned long nr_age_scans;
+	unsigned long age_hist[RECLAIM_AGE_BUCKETS];
+#endif
+};
+#endif
+
 struct kioctx_table;
 struct mm_struct {
 	struct vm_area_struct *mmap;		/* list of VMAs */
@@ -517,6 +542,9 @@ struct mm_struct {
 	/* HMM needs to track a few things per mm */
 	struct hmm *hmm;
 #endif
+#ifdef CONFIG_PROCESS_RECLAIM
+	struct mm_reclaim_stat reclaim_stat;
+#endif
 } __randomize_layout;
 
 extern struct mm_struct init_mm;
@@ -137,4 +137,22 @@ static inline void clear_page_idle(struct page *page)
 
 #endif /* CONFIG_IDLE_PAGE_TRACKING */
 
+#define PAGE_AGE_MAX	255
+
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+extern struct page_ext_operations page_age_ops;
+
+extern unsigned int page_age(struct page *page);
+extern void set_page_age(struct page *page, unsigned int age);
+#else
+static inline unsigned int page_age(struct page *page)
+{
+	return 0;
+}
+
+static inline void set_page_age(struct page *page, unsigned int age)
+{
+}
+#endif /* CONFIG_PROCESS_RECLAIM_AGE */
+
 #endif /* _LINUX_MM_PAGE_IDLE_H */
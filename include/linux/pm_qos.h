@@ -151,6 +151,7 @@ enum pm_qos_type {
  * types linux supports for 32 bit quantites
  */
 struct pm_qos_constraints {
+	spinlock_t lock;	/* protects list and target_value */
 	struct plist_head list;
 	s32 target_value;	/* Do not change to 64 bit */
 	s32 default_value;
@@ -198,6 +199,8 @@ void pm_qos_update_request(struct pm_qos_request *req,
 void pm_qos_update_request_timeout(struct pm_qos_request *req,
 				   s32 new_value, unsigned long timeout_us);
 void pm_qos_remove_request(struct pm_qos_request *req);
+void pm_qos_update_request_batch(struct pm_qos_request **reqs,
+				 const s32 *values, int nr);
 
 int pm_qos_read_req_value(int pm_qos_class, struct pm_qos_request *req);
 int pm_qos_request(int pm_qos_class);
@@ -7,16 +7,19 @@
  */
 
 #include <linux/sched.h>
+#include <linux/uid_sys_stats.h>
 
 #ifdef CONFIG_TASK_XACCT
 static inline void add_rchar(struct task_struct *tsk, ssize_t amt)
 {
 	tsk->ioac.rchar += amt;
+	uid_sys_stats_account_io(tsk, UID_IO_RCHAR, amt);
 }
 
 static inline void add_wchar(struct task_struct *tsk, ssize_t amt)
 {
 	tsk->ioac.wchar += amt;
+	uid_sys_stats_account_io(tsk, UID_IO_WCHAR, amt);
 }
 
 static inline void inc_syscr(struct task_struct *tsk)
@@ -32,6 +35,7 @@ static inline void inc_syscw(struct task_struct *tsk)
 static inline void inc_syscfs(struct task_struct *tsk)
 {
 	tsk->ioac.syscfs++;
+	uid_sys_stats_account_io(tsk, UID_IO_FSYNC, 1);
 }
 #else
 static inline void add_rchar(struct task_struct *tsk, ssize_t amt)
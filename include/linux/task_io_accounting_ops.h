@@ -6,11 +6,13 @@
 #define __TASK_IO_ACCOUNTING_OPS_INCLUDED
 
 #include <linux/sched.h>
+#include <linux/uid_sys_stats.h>
 
 #ifdef CONFIG_TASK_IO_ACCOUNTING
 static inline void task_io_account_read(size_t bytes)
 {
 	current->ioac.read_bytes += bytes;
+	uid_sys_stats_account_io(current, UID_IO_READ_BYTES, bytes);
 }
 
 /*
@@ -25,6 +27,7 @@ static inline unsigned long task_io_get_inblock(const struct task_struct *p)
 static inline void task_io_account_write(size_t bytes)
 {
 	current->ioac.write_bytes += bytes;
+	uid_sys_stats_account_io(current, UID_IO_WRITE_BYTES, bytes);
 }
 
 /*
@@ -39,6 +42,7 @@ static inline unsigned long task_io_get_oublock(const struct task_struct *p)
 static inline void task_io_account_cancelled_write(size_t bytes)
 {
 	current->ioac.cancelled_write_bytes += bytes;
+	uid_sys_stats_account_io(current, UID_IO_WRITE_BYTES, -(s64)bytes);
 }
 
 static inline void task_io_accounting_init(struct task_io_accounting *ioac)
@@ -341,6 +341,13 @@ struct thermal_zone_params {
 
 	s32 integral_max;
 
+	/*
+	 * @mpc_horizon:	time in ms the power allocator predicts the
+	 *			temperature ahead in its model predictive
+	 *			mode, 0 to use the PID controller only
+	 */
+	s32 mpc_horizon;
+
 	/*
 	 * @slope:	slope of a linear temperature adjustment curve.
 	 * 		Used by thermal zone drivers.
@@ -0,0 +1,39 @@
+/* include/linux/uid_sys_stats.h
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _LINUX_UID_SYS_STATS_H
+#define _LINUX_UID_SYS_STATS_H
+
+#include <linux/sched.h>
+
+enum uid_io_stat {
+	UID_IO_RCHAR,
+	UID_IO_WCHAR,
+	UID_IO_READ_BYTES,
+	UID_IO_WRITE_BYTES,
+	UID_IO_FSYNC,
+};
+
+#ifdef CONFIG_UID_SYS_STATS
+void uid_sys_stats_account_cputime(struct task_struct *p, u64 utime,
+				   u64 stime);
+void uid_sys_stats_account_io(struct task_struct *p, enum uid_io_stat stat,
+			      s64 amount);
+#else
+static inline void uid_sys_stats_account_cputime(struct task_struct *p,
+						 u64 utime, u64 stime) {}
+static inline void uid_sys_stats_account_io(struct task_struct *p,
+					    enum uid_io_stat stat,
+					    s64 amount) {}
+#endif /* CONFIG_UID_SYS_STATS */
+#endif /* _LINUX_UID_SYS_STATS_H */
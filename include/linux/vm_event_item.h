@@ -110,6 +110,10 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		SWAP_RA,
 		SWAP_RA_HIT,
 #endif
+		MMAP_RA,
+		MMAP_RA_HIT,
+		MMAP_RA_GROW,
+		MMAP_RA_SHRINK,
 #ifdef CONFIG_ZRAM_LRU_WRITEBACK
 		SQZR_OBJCNT,
 		SQZR_COUNT,
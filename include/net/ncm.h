@@ -40,6 +40,8 @@
 #include <linux/inet.h>
 #include <linux/sched.h>
 #include <linux/string.h>
+#include <linux/refcount.h>
+#include <linux/rcupdate.h>
 #include <net/netfilter/nf_conntrack.h>
 
 #define isIpv4AddressEqualsNull(srcaddr, dstaddr) ((((strcmp(srcaddr, "0.0.0.0")) || (strcmp(dstaddr, "0.0.0.0"))) == 0) ? 1 : 0)
@@ -131,6 +133,40 @@ struct knox_user_socket_metadata {
 	int   flow_type;
 };
 
+/** Struct holding the attribution of the process which created a socket;
+ *  It is built once per process, shared by all its sockets through sk->knox_attr and reference-counted;
+ */
+struct knox_proc_attr {
+/* One reference per socket plus one while the attribution is cached */
+	refcount_t ref;
+	struct rcu_head rcu;
+/* The key of the cache entry: tgid, start time and command of the process and the time it was built */
+	pid_t   tgid;
+	__u64   start_time;
+	char    comm[TASK_COMM_LEN];
+	unsigned long stamp;
+/* The parent user id and process id under which the socket was created */
+	uid_t   knox_puid;
+	pid_t   knox_ppid;
+/* The name of the process which created the socket */
+	char process_name[PROCESS_NAME_LEN_NAP];
+/* The name of the parent process which created the socket */
+	char parent_process_name[PROCESS_NAME_LEN_NAP];
+};
+
+/* Returns true if neither address of the tuple is set */
+static inline bool knox_ipv4_tuple_is_null(const struct nf_conntrack_tuple *tuple)
+{
+	return !tuple->src.u3.ip && !tuple->dst.u3.ip;
+}
+
+static inline bool knox_ipv6_tuple_is_null(const struct nf_conntrack_tuple *tuple)
+{
+	const __u32 *src = tuple->src.u3.all, *dst = tuple->dst.u3.all;
+
+	return !(src[0] | src[1] | src[2] | src[3] | dst[0] | dst[1] | dst[2] | dst[3]);
+}
+
 /* The list of function which is being referenced */
 extern unsigned int check_ncm_flag(void);
 extern void knox_collect_conntrack_data(struct nf_conn *ct, int startStop, int where);
@@ -138,6 +174,15 @@ extern bool kfifo_status(void);
 extern void insert_data_kfifo_kthread(struct knox_socket_metadata* knox_socket_metadata);
 extern unsigned int check_intermediate_flag(void);
 extern unsigned int get_intermediate_timeout(void);
+extern struct knox_proc_attr *knox_get_proc_attr(gfp_t gfp);
+extern void knox_put_proc_attr(struct knox_proc_attr *attr);
+extern void knox_attach_flow_attr(struct nf_conn *ct, struct sock *sk, struct sk_buff *skb);
+
+static inline void knox_hold_proc_attr(struct knox_proc_attr *attr)
+{
+	if (attr)
+		refcount_inc(&attr->ref);
+}
 
 /* Debug */
 #define NCM_DEBUG        1
@@ -156,6 +201,7 @@ extern unsigned int get_intermediate_timeout(void);
 #define NCM_ACTIVATED_ALL        _IO(__NCMIOC, 16)
 #define NCM_GETVERSION           _IO(__NCMIOC, 32)
 #define NCM_MATCH_VERSION        _IO(__NCMIOC, 64)
+#define NCM_GETDROPPED           _IO(__NCMIOC, 128)
 
 #endif
 
@@ -75,6 +75,7 @@
 // SEC_PRODUCT_FEATURE_KNOX_SUPPORT_NPA {
 #define NAP_PROCESS_NAME_LEN	128
 #define NAP_DOMAIN_NAME_LEN	255
+struct knox_proc_attr;
 // SEC_PRODUCT_FEATURE_KNOX_SUPPORT_NPA }
 
 /*
@@ -481,10 +482,7 @@ struct sock {
 	pid_t			knox_pid;
 	uid_t			knox_dns_uid;
 	char 			domain_name[NAP_DOMAIN_NAME_LEN];
-	char			process_name[NAP_PROCESS_NAME_LEN];
-	uid_t			knox_puid;
-	pid_t			knox_ppid;
-	char			parent_process_name[NAP_PROCESS_NAME_LEN];
+	struct knox_proc_attr	*knox_attr;
 	pid_t			knox_dns_pid;
 	char 			dns_process_name[NAP_PROCESS_NAME_LEN];
 	// SEC_PRODUCT_FEATURE_KNOX_SUPPORT_NPA }
@@ -68,6 +68,20 @@ struct exynos_dm_freq {
 	u32				constraint_freq;
 };
 
+/*
+ * DM_CALL latency histogram. Bucket n counts calls shorter than 2^n usec,
+ * the last bucket counts the rest.
+ */
+#define EXYNOS_DM_LAT_BUCKETS		8
+
+struct exynos_dm_stats {
+	u64				call_count;
+	u64				skip_count;		/* early exit, target unchanged */
+	u64				transition_count;	/* freq_scaler calls */
+	u64				latency_hist[EXYNOS_DM_LAT_BUCKETS];
+	u32				max_latency;		/* usec */
+};
+
 struct exynos_dm_attrs {
 	struct device_attribute attr;
 	char name[EXYNOS_DM_ATTR_NAME_LEN];
@@ -75,6 +89,8 @@ struct exynos_dm_attrs {
 
 struct exynos_dm_constraint {
 	struct list_head		node;
+	/* node in min/max_slist of the constrained domain */
+	struct list_head		slave_node;
 
 	bool				guidance;		/* check constraint table by hw guide */
 	u32				table_length;
@@ -112,7 +128,12 @@ struct exynos_dm_data {
 
 	struct list_head		min_clist;
 	struct list_head		max_clist;
+	/* constraints of other domains applied to this domain */
+	struct list_head		min_slist;
+	struct list_head		max_slist;
 	u32				constraint_checked;
+	/* constraint tables changed since last full DM_CALL */
+	bool				constraint_dirty;
 #ifdef CONFIG_EXYNOS_ACPM
 	u32				cal_id;
 #endif
@@ -121,6 +142,8 @@ struct exynos_dm_data {
 
 	struct exynos_dm_attrs		dm_policy_attr;
 	struct exynos_dm_attrs		constraint_table_attr;
+
+	struct exynos_dm_stats		stats;
 };
 
 struct exynos_dm_device {
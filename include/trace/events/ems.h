@@ -222,9 +222,9 @@ TRACE_EVENT(ems_select_idle_cpu,
 TRACE_EVENT(ems_ontime_migration,
 
 	TP_PROTO(struct task_struct *p, unsigned long load,
-		int src_cpu, int dst_cpu, int boost_migration),
+		int src_cpu, int dst_cpu, int boost_migration, u64 delay),
 
-	TP_ARGS(p, load, src_cpu, dst_cpu, boost_migration),
+	TP_ARGS(p, load, src_cpu, dst_cpu, boost_migration, delay),
 
 	TP_STRUCT__entry(
 		__array(	char,		comm,	TASK_COMM_LEN	)
@@ -234,6 +234,7 @@ TRACE_EVENT(ems_ontime_migration,
 		__field(	int,		src_cpu			)
 		__field(	int,		dst_cpu			)
 		__field(	int,		bm			)
+		__field(	u64,		delay			)
 	),
 
 	TP_fast_assign(
@@ -244,11 +245,12 @@ TRACE_EVENT(ems_ontime_migration,
 		__entry->src_cpu	= src_cpu;
 		__entry->dst_cpu	= dst_cpu;
 		__entry->bm		= boost_migration;
+		__entry->delay		= delay;
 	),
 
-	TP_printk("comm=%s pid=%d sse=%d ontime_load_avg=%lu src_cpu=%d dst_cpu=%d boost_migration=%d",
+	TP_printk("comm=%s pid=%d sse=%d ontime_load_avg=%lu src_cpu=%d dst_cpu=%d boost_migration=%d delay=%llu",
 		__entry->comm, __entry->pid, __entry->sse, __entry->load,
-		__entry->src_cpu, __entry->dst_cpu, __entry->bm)
+		__entry->src_cpu, __entry->dst_cpu, __entry->bm, __entry->delay)
 );
 
 TRACE_EVENT(ems_ontime_check_migrate,
@@ -336,7 +338,7 @@ TRACE_EVENT(ems_lbt_overutilized,
 
 TRACE_EVENT(ems_update_band,
 
-	TP_PROTO(int band_id, unsigned long band_util, int member_count, unsigned int playable_cpus),
+	TP_PROTO(int band_id, unsigned long band_util, int member_count, unsigned long playable_cpus),
 
 	TP_ARGS(band_id, band_util, member_count, playable_cpus),
 
@@ -344,7 +346,7 @@ TRACE_EVENT(ems_update_band,
 		__field( int,		band_id			)
 		__field( unsigned long,	band_util		)
 		__field( int,		member_count		)
-		__field( unsigned int,	playable_cpus		)
+		__field( unsigned long,	playable_cpus		)
 	),
 
 	TP_fast_assign(
@@ -354,7 +356,7 @@ TRACE_EVENT(ems_update_band,
 		__entry->playable_cpus		= playable_cpus;
 	),
 
-	TP_printk("band_id=%d band_util=%ld member_count=%d playable_cpus=%#x",
+	TP_printk("band_id=%d band_util=%ld member_count=%d playable_cpus=%#lx",
 			__entry->band_id, __entry->band_util, __entry->member_count,
 			__entry->playable_cpus)
 );
@@ -110,6 +110,42 @@ TRACE_EVENT(file_check_and_advance_wb_err,
 			MINOR(__entry->s_dev), __entry->i_ino, __entry->old,
 			__entry->new)
 );
+
+TRACE_EVENT(mm_filemap_mmap_readaround,
+		TP_PROTO(struct file *file, pgoff_t index,
+			unsigned int prev_window, unsigned int hit,
+			unsigned int window),
+
+		TP_ARGS(file, index, prev_window, hit, window),
+
+		TP_STRUCT__entry(
+			__field(unsigned long, i_ino)
+			__field(dev_t, s_dev)
+			__field(unsigned long, index)
+			__field(unsigned int, prev_window)
+			__field(unsigned int, hit)
+			__field(unsigned int, window)
+		),
+
+		TP_fast_assign(
+			__entry->i_ino = file->f_mapping->host->i_ino;
+			if (file->f_mapping->host->i_sb)
+				__entry->s_dev =
+					file->f_mapping->host->i_sb->s_dev;
+			else
+				__entry->s_dev =
+					file->f_mapping->host->i_rdev;
+			__entry->index = index;
+			__entry->prev_window = prev_window;
+			__entry->hit = hit;
+			__entry->window = window;
+		),
+
+		TP_printk("dev=%d:%d ino=0x%lx ofs=%lu prev_window=%u hit=%u window=%u",
+			MAJOR(__entry->s_dev), MINOR(__entry->s_dev),
+			__entry->i_ino, __entry->index << PAGE_SHIFT,
+			__entry->prev_window, __entry->hit, __entry->window)
+);
 #endif /* _TRACE_FILEMAP_H */
 
 /* This part must be outside protection */
@@ -82,6 +82,32 @@ TRACE_EVENT(thermal_power_allocator_pid,
 		  __entry->tz_id, __entry->err, __entry->err_integral,
 		  __entry->p, __entry->i, __entry->d, __entry->output)
 );
+
+TRACE_EVENT(thermal_power_allocator_mpc,
+	TP_PROTO(struct thermal_zone_device *tz, s64 a, s64 b, s64 c,
+		 unsigned int steps, s32 output),
+	TP_ARGS(tz, a, b, c, steps, output),
+	TP_STRUCT__entry(
+		__field(int,          tz_id )
+		__field(s64,          a     )
+		__field(s64,          b     )
+		__field(s64,          c     )
+		__field(unsigned int, steps )
+		__field(s32,          output)
+	),
+	TP_fast_assign(
+		__entry->tz_id = tz->id;
+		__entry->a = a;
+		__entry->b = b;
+		__entry->c = c;
+		__entry->steps = steps;
+		__entry->output = output;
+	),
+
+	TP_printk("thermal_zone_id=%d a=%lld b=%lld c=%lld steps=%u output=%d",
+		  __entry->tz_id, __entry->a, __entry->b, __entry->c,
+		  __entry->steps, __entry->output)
+);
 #endif /* _TRACE_THERMAL_POWER_ALLOCATOR_H */
 
 /* This part must be outside protection */
@@ -49,14 +49,34 @@
 #include <trace/events/power.h>
 
 /*
- * locking rule: all changes to constraints or notifiers lists
- * or pm_qos_object list and pm_qos_objects need to happen with pm_qos_lock
- * held, taken with _irqsave.  One lock to rule them all
+ * locking rule: all changes to a constraints list and its target value need
+ * to happen with the lock of those constraints held, taken with _irqsave, so
+ * that updates of different classes do not serialize on each other.
+ * pm_qos_lock only protects the pm_qos_flags sets.
  */
+struct pm_qos_stat {
+	unsigned long updates;		/* constraint list updates */
+	unsigned long notifies;		/* notifier chain runs */
+	unsigned long coalesced;	/* updates folded into a pending notify */
+	u64 notify_ns;			/* total time spent in the chain */
+	u64 max_notify_ns;
+};
+
 struct pm_qos_object {
 	struct pm_qos_constraints *constraints;
 	struct miscdevice pm_qos_power_miscdev;
 	char *name;
+	int pm_qos_class;
+
+	/*
+	 * In coalescing mode the notifiers run from notify_work and only see
+	 * the aggregate value at that time, however many updates came before.
+	 */
+	bool coalesce;
+	s32 notified_value;
+	struct work_struct notify_work;
+
+	struct pm_qos_stat stat;	/* protected by constraints->lock */
 };
 
 static DEFINE_SPINLOCK(pm_qos_lock);
@@ -65,6 +85,7 @@ static struct pm_qos_object null_pm_qos;
 
 static BLOCKING_NOTIFIER_HEAD(cpu_dma_lat_notifier);
 static struct pm_qos_constraints cpu_dma_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cpu_dma_constraints.lock),
 	.list = PLIST_HEAD_INIT(cpu_dma_constraints.list),
 	.target_value = PM_QOS_CPU_DMA_LAT_DEFAULT_VALUE,
 	.default_value = PM_QOS_CPU_DMA_LAT_DEFAULT_VALUE,
@@ -79,6 +100,7 @@ static struct pm_qos_object cpu_dma_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(network_lat_notifier);
 static struct pm_qos_constraints network_lat_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(network_lat_constraints.lock),
 	.list = PLIST_HEAD_INIT(network_lat_constraints.list),
 	.target_value = PM_QOS_NETWORK_LAT_DEFAULT_VALUE,
 	.default_value = PM_QOS_NETWORK_LAT_DEFAULT_VALUE,
@@ -93,6 +115,7 @@ static struct pm_qos_object network_lat_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(device_throughput_notifier);
 static struct pm_qos_constraints device_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(device_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(device_tput_constraints.list),
 	.target_value = PM_QOS_DEVICE_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_DEVICE_THROUGHPUT_DEFAULT_VALUE,
@@ -106,6 +129,7 @@ static struct pm_qos_object device_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(device_throughput_max_notifier);
 static struct pm_qos_constraints device_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(device_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(device_tput_max_constraints.list),
 	.target_value = PM_QOS_DEVICE_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_DEVICE_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -119,6 +143,7 @@ static struct pm_qos_object device_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(intcam_throughput_notifier);
 static struct pm_qos_constraints intcam_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(intcam_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(intcam_tput_constraints.list),
 	.target_value = PM_QOS_INTCAM_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_INTCAM_THROUGHPUT_DEFAULT_VALUE,
@@ -132,6 +157,7 @@ static struct pm_qos_object intcam_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(intcam_throughput_max_notifier);
 static struct pm_qos_constraints intcam_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(intcam_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(intcam_tput_max_constraints.list),
 	.target_value = PM_QOS_INTCAM_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_INTCAM_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -145,6 +171,7 @@ static struct pm_qos_object intcam_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(bus_throughput_notifier);
 static struct pm_qos_constraints bus_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(bus_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(bus_tput_constraints.list),
 	.target_value = PM_QOS_BUS_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_BUS_THROUGHPUT_DEFAULT_VALUE,
@@ -158,6 +185,7 @@ static struct pm_qos_object bus_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(bus_throughput_max_notifier);
 static struct pm_qos_constraints bus_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(bus_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(bus_tput_max_constraints.list),
 	.target_value = PM_QOS_BUS_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_BUS_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -171,6 +199,7 @@ static struct pm_qos_object bus_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(network_throughput_notifier);
 static struct pm_qos_constraints network_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(network_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(network_tput_constraints.list),
 	.target_value = PM_QOS_NETWORK_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_NETWORK_THROUGHPUT_DEFAULT_VALUE,
@@ -186,6 +215,7 @@ static struct pm_qos_object network_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(memory_bandwidth_notifier);
 static struct pm_qos_constraints memory_bw_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(memory_bw_constraints.lock),
 	.list = PLIST_HEAD_INIT(memory_bw_constraints.list),
 	.target_value = PM_QOS_MEMORY_BANDWIDTH_DEFAULT_VALUE,
 	.default_value = PM_QOS_MEMORY_BANDWIDTH_DEFAULT_VALUE,
@@ -200,6 +230,7 @@ static struct pm_qos_object memory_bandwidth_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cluster2_freq_min_notifier);
 static struct pm_qos_constraints cluster2_freq_min_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cluster2_freq_min_constraints.lock),
 	.list = PLIST_HEAD_INIT(cluster2_freq_min_constraints.list),
 	.target_value = PM_QOS_CLUSTER2_FREQ_MIN_DEFAULT_VALUE,
 	.default_value = PM_QOS_CLUSTER2_FREQ_MIN_DEFAULT_VALUE,
@@ -213,6 +244,7 @@ static struct pm_qos_object cluster2_freq_min_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cluster2_freq_max_notifier);
 static struct pm_qos_constraints cluster2_freq_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cluster2_freq_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(cluster2_freq_max_constraints.list),
 	.target_value = PM_QOS_CLUSTER2_FREQ_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_CLUSTER2_FREQ_MAX_DEFAULT_VALUE,
@@ -226,6 +258,7 @@ static struct pm_qos_object cluster2_freq_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cluster1_freq_min_notifier);
 static struct pm_qos_constraints cluster1_freq_min_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cluster1_freq_min_constraints.lock),
 	.list = PLIST_HEAD_INIT(cluster1_freq_min_constraints.list),
 	.target_value = PM_QOS_CLUSTER1_FREQ_MIN_DEFAULT_VALUE,
 	.default_value = PM_QOS_CLUSTER1_FREQ_MIN_DEFAULT_VALUE,
@@ -239,6 +272,7 @@ static struct pm_qos_object cluster1_freq_min_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cluster1_freq_max_notifier);
 static struct pm_qos_constraints cluster1_freq_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cluster1_freq_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(cluster1_freq_max_constraints.list),
 	.target_value = PM_QOS_CLUSTER1_FREQ_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_CLUSTER1_FREQ_MAX_DEFAULT_VALUE,
@@ -252,6 +286,7 @@ static struct pm_qos_object cluster1_freq_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cluster0_freq_min_notifier);
 static struct pm_qos_constraints cluster0_freq_min_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cluster0_freq_min_constraints.lock),
 	.list = PLIST_HEAD_INIT(cluster0_freq_min_constraints.list),
 	.target_value = PM_QOS_CLUSTER0_FREQ_MIN_DEFAULT_VALUE,
 	.default_value = PM_QOS_CLUSTER0_FREQ_MIN_DEFAULT_VALUE,
@@ -265,6 +300,7 @@ static struct pm_qos_object cluster0_freq_min_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cluster0_freq_max_notifier);
 static struct pm_qos_constraints cluster0_freq_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cluster0_freq_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(cluster0_freq_max_constraints.list),
 	.target_value = PM_QOS_CLUSTER0_FREQ_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_CLUSTER0_FREQ_MAX_DEFAULT_VALUE,
@@ -278,6 +314,7 @@ static struct pm_qos_object cluster0_freq_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cpu_online_min_notifier);
 static struct pm_qos_constraints cpu_online_min_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cpu_online_min_constraints.lock),
 	.list = PLIST_HEAD_INIT(cpu_online_min_constraints.list),
 	.target_value = PM_QOS_CPU_ONLINE_MIN_DEFAULT_VALUE,
 	.default_value = PM_QOS_CPU_ONLINE_MIN_DEFAULT_VALUE,
@@ -291,6 +328,7 @@ static struct pm_qos_object cpu_online_min_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cpu_online_max_notifier);
 static struct pm_qos_constraints cpu_online_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cpu_online_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(cpu_online_max_constraints.list),
 	.target_value = PM_QOS_CPU_ONLINE_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_CPU_ONLINE_MAX_DEFAULT_VALUE,
@@ -304,6 +342,7 @@ static struct pm_qos_object cpu_online_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(display_throughput_notifier);
 static struct pm_qos_constraints display_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(display_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(display_tput_constraints.list),
 	.target_value = PM_QOS_DISPLAY_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_DISPLAY_THROUGHPUT_DEFAULT_VALUE,
@@ -317,6 +356,7 @@ static struct pm_qos_object display_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(display_throughput_max_notifier);
 static struct pm_qos_constraints display_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(display_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(display_tput_max_constraints.list),
 	.target_value = PM_QOS_DISPLAY_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_DISPLAY_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -330,6 +370,7 @@ static struct pm_qos_object display_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cam_throughput_notifier);
 static struct pm_qos_constraints cam_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cam_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(cam_tput_constraints.list),
 	.target_value = PM_QOS_CAM_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_CAM_THROUGHPUT_DEFAULT_VALUE,
@@ -343,6 +384,7 @@ static struct pm_qos_object cam_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(aud_throughput_notifier);
 static struct pm_qos_constraints aud_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(aud_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(aud_tput_constraints.list),
 	.target_value = PM_QOS_AUD_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_AUD_THROUGHPUT_DEFAULT_VALUE,
@@ -356,6 +398,7 @@ static struct pm_qos_object aud_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(iva_throughput_notifier);
 static struct pm_qos_constraints iva_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(iva_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(iva_tput_constraints.list),
 	.target_value = PM_QOS_IVA_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_IVA_THROUGHPUT_DEFAULT_VALUE,
@@ -369,6 +412,7 @@ static struct pm_qos_object iva_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(score_throughput_notifier);
 static struct pm_qos_constraints score_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(score_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(score_tput_constraints.list),
 	.target_value = PM_QOS_SCORE_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_SCORE_THROUGHPUT_DEFAULT_VALUE,
@@ -382,6 +426,7 @@ static struct pm_qos_object score_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(fsys0_throughput_notifier);
 static struct pm_qos_constraints fsys0_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(fsys0_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(fsys0_tput_constraints.list),
 	.target_value = PM_QOS_FSYS0_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_FSYS0_THROUGHPUT_DEFAULT_VALUE,
@@ -395,6 +440,7 @@ static struct pm_qos_object fsys0_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(cam_throughput_max_notifier);
 static struct pm_qos_constraints cam_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(cam_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(cam_tput_max_constraints.list),
 	.target_value = PM_QOS_CAM_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_CAM_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -408,6 +454,7 @@ static struct pm_qos_object cam_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(aud_throughput_max_notifier);
 static struct pm_qos_constraints aud_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(aud_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(aud_tput_max_constraints.list),
 	.target_value = PM_QOS_AUD_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_AUD_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -421,6 +468,7 @@ static struct pm_qos_object aud_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(iva_throughput_max_notifier);
 static struct pm_qos_constraints iva_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(iva_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(iva_tput_max_constraints.list),
 	.target_value = PM_QOS_IVA_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_IVA_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -434,6 +482,7 @@ static struct pm_qos_object iva_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(score_throughput_max_notifier);
 static struct pm_qos_constraints score_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(score_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(score_tput_max_constraints.list),
 	.target_value = PM_QOS_SCORE_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_SCORE_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -447,6 +496,7 @@ static struct pm_qos_object score_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(fsys0_throughput_max_notifier);
 static struct pm_qos_constraints fsys0_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(fsys0_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(fsys0_tput_max_constraints.list),
 	.target_value = PM_QOS_FSYS0_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_FSYS0_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -460,6 +510,7 @@ static struct pm_qos_object fsys0_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(mfc_throughput_notifier);
 static struct pm_qos_constraints mfc_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(mfc_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(mfc_tput_constraints.list),
 	.target_value = PM_QOS_MFC_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_MFC_THROUGHPUT_DEFAULT_VALUE,
@@ -473,6 +524,7 @@ static struct pm_qos_object mfc_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(npu_throughput_notifier);
 static struct pm_qos_constraints npu_tput_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(npu_tput_constraints.lock),
 	.list = PLIST_HEAD_INIT(npu_tput_constraints.list),
 	.target_value = PM_QOS_NPU_THROUGHPUT_DEFAULT_VALUE,
 	.default_value = PM_QOS_NPU_THROUGHPUT_DEFAULT_VALUE,
@@ -486,6 +538,7 @@ static struct pm_qos_object npu_throughput_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(mfc_throughput_max_notifier);
 static struct pm_qos_constraints mfc_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(mfc_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(mfc_tput_max_constraints.list),
 	.target_value = PM_QOS_MFC_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_MFC_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -499,6 +552,7 @@ static struct pm_qos_object mfc_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(npu_throughput_max_notifier);
 static struct pm_qos_constraints npu_tput_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(npu_tput_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(npu_tput_max_constraints.list),
 	.target_value = PM_QOS_NPU_THROUGHPUT_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_NPU_THROUGHPUT_MAX_DEFAULT_VALUE,
@@ -512,6 +566,7 @@ static struct pm_qos_object npu_throughput_max_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(gpu_freq_min_notifier);
 static struct pm_qos_constraints gpu_freq_min_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(gpu_freq_min_constraints.lock),
 	.list = PLIST_HEAD_INIT(gpu_freq_min_constraints.list),
 	.target_value = PM_QOS_GPU_FREQ_MIN_DEFAULT_VALUE,
 	.default_value = PM_QOS_GPU_FREQ_MIN_DEFAULT_VALUE,
@@ -525,6 +580,7 @@ static struct pm_qos_object gpu_freq_min_pm_qos = {
 
 static BLOCKING_NOTIFIER_HEAD(gpu_freq_max_notifier);
 static struct pm_qos_constraints gpu_freq_max_constraints = {
+	.lock = __SPIN_LOCK_UNLOCKED(gpu_freq_max_constraints.lock),
 	.list = PLIST_HEAD_INIT(gpu_freq_max_constraints.list),
 	.target_value = PM_QOS_GPU_FREQ_MAX_DEFAULT_VALUE,
 	.default_value = PM_QOS_GPU_FREQ_MAX_DEFAULT_VALUE,
@@ -654,7 +710,7 @@ static int pm_qos_dbg_show_requests(struct seq_file *s, void *unused)
 	}
 
 	/* Lock to ensure we have a snapshot */
-	spin_lock_irqsave(&pm_qos_lock, flags);
+	spin_lock_irqsave(&c->lock, flags);
 	if (plist_head_empty(&c->list)) {
 		seq_puts(s, "Empty!\n");
 		goto out;
@@ -692,7 +748,7 @@ static int pm_qos_dbg_show_requests(struct seq_file *s, void *unused)
 		   type, pm_qos_get_value(c), active_reqs, tot_reqs);
 
 out:
-	spin_unlock_irqrestore(&pm_qos_lock, flags);
+	spin_unlock_irqrestore(&c->lock, flags);
 	return 0;
 }
 
@@ -709,26 +765,20 @@ static const struct file_operations pm_qos_debug_fops = {
 	.release        = single_release,
 };
 
-/**
- * pm_qos_update_target - manages the constraints list and calls the notifiers
- *  if needed
- * @c: constraints data struct
- * @node: request to add to the list, to update or to remove
- * @action: action to take on the constraints list
- * @value: value of the request to add or update
- *
- * This function returns 1 if the aggregated constraint value has changed, 0
- *  otherwise.
+/*
+ * Apply @action to the constraints list and refresh the aggregate value.
+ * Returns the new aggregate, the previous one is stored in @prev_value.
  */
-int pm_qos_update_target(struct pm_qos_constraints *c, struct plist_node *node,
-			 enum pm_qos_req_action action, int value)
+static int pm_qos_apply_request(struct pm_qos_constraints *c,
+				struct plist_node *node,
+				enum pm_qos_req_action action, int value,
+				int *prev_value, struct pm_qos_object *qos)
 {
 	unsigned long flags;
-	int prev_value, curr_value, new_value;
-	int ret;
+	int curr_value, new_value;
 
-	spin_lock_irqsave(&pm_qos_lock, flags);
-	prev_value = pm_qos_get_value(c);
+	spin_lock_irqsave(&c->lock, flags);
+	*prev_value = pm_qos_get_value(c);
 	if (value == PM_QOS_DEFAULT_VALUE)
 		new_value = c->default_value;
 	else
@@ -757,9 +807,35 @@ int pm_qos_update_target(struct pm_qos_constraints *c, struct plist_node *node,
 	curr_value = pm_qos_get_value(c);
 	pm_qos_set_value(c, curr_value);
 
-	spin_unlock_irqrestore(&pm_qos_lock, flags);
+	if (qos)
+		qos->stat.updates++;
+
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	trace_pm_qos_update_target(action, *prev_value, curr_value);
+
+	return curr_value;
+}
+
+/**
+ * pm_qos_update_target - manages the constraints list and calls the notifiers
+ *  if needed
+ * @c: constraints data struct
+ * @node: request to add to the list, to update or to remove
+ * @action: action to take on the constraints list
+ * @value: value of the request to add or update
+ *
+ * This function returns 1 if the aggregated constraint value has changed, 0
+ *  otherwise.
+ */
+int pm_qos_update_target(struct pm_qos_constraints *c, struct plist_node *node,
+			 enum pm_qos_req_action action, int value)
+{
+	int prev_value, curr_value;
+	int ret;
 
-	trace_pm_qos_update_target(action, prev_value, curr_value);
+	curr_value = pm_qos_apply_request(c, node, action, value,
+						&prev_value, NULL);
 
 	if (c->type == PM_QOS_FORCE_MAX) {
 		blocking_notifier_call_chain(c->notifiers,
@@ -782,6 +858,78 @@ int pm_qos_update_target(struct pm_qos_constraints *c, struct plist_node *node,
 	return ret;
 }
 
+static void pm_qos_call_notifiers(struct pm_qos_object *qos, s32 value,
+				  void *data)
+{
+	struct pm_qos_constraints *c = qos->constraints;
+	unsigned long flags;
+	u64 start, delta;
+
+	start = ktime_get_ns();
+	blocking_notifier_call_chain(c->notifiers, (unsigned long)value,
+				     c->type == PM_QOS_FORCE_MAX ? NULL : data);
+	delta = ktime_get_ns() - start;
+
+	spin_lock_irqsave(&c->lock, flags);
+	qos->notified_value = value;
+	qos->stat.notifies++;
+	qos->stat.notify_ns += delta;
+	if (delta > qos->stat.max_notify_ns)
+		qos->stat.max_notify_ns = delta;
+	spin_unlock_irqrestore(&c->lock, flags);
+}
+
+static void pm_qos_notify_work_fn(struct work_struct *work)
+{
+	struct pm_qos_object *qos = container_of(work, struct pm_qos_object,
+						 notify_work);
+	struct pm_qos_constraints *c = qos->constraints;
+	s32 value = pm_qos_read_value(c);
+
+	if (c->type == PM_QOS_FORCE_MAX || value != qos->notified_value)
+		pm_qos_call_notifiers(qos, value, &qos->pm_qos_class);
+}
+
+static void pm_qos_notify_class(struct pm_qos_object *qos, s32 value,
+				void *data)
+{
+	struct pm_qos_constraints *c = qos->constraints;
+	unsigned long flags;
+
+	if (!c->notifiers)
+		return;
+
+	if (!READ_ONCE(qos->coalesce)) {
+		pm_qos_call_notifiers(qos, value, data);
+		return;
+	}
+
+	if (!queue_work(system_highpri_wq, &qos->notify_work)) {
+		spin_lock_irqsave(&c->lock, flags);
+		qos->stat.coalesced++;
+		spin_unlock_irqrestore(&c->lock, flags);
+	}
+}
+
+/* pm_qos_update_target() for the requests of a pm_qos_array class */
+static int pm_qos_update_class(struct pm_qos_request *req,
+			       enum pm_qos_req_action action, int value)
+{
+	struct pm_qos_object *qos = pm_qos_array[req->pm_qos_class];
+	struct pm_qos_constraints *c = qos->constraints;
+	int prev_value, curr_value;
+
+	curr_value = pm_qos_apply_request(c, &req->node, action, value,
+						&prev_value, qos);
+
+	if (c->type != PM_QOS_FORCE_MAX && prev_value == curr_value)
+		return 0;
+
+	pm_qos_notify_class(qos, curr_value, &req->pm_qos_class);
+
+	return 1;
+}
+
 /**
  * pm_qos_flags_remove_req - Remove device PM QoS flags request.
  * @pqf: Device PM QoS flags set to remove the request from.
@@ -855,19 +1003,20 @@ bool pm_qos_update_flags(struct pm_qos_flags *pqf,
  */
 int pm_qos_read_req_value(int pm_qos_class, struct pm_qos_request *req)
 {
+	struct pm_qos_constraints *c = pm_qos_array[pm_qos_class]->constraints;
 	struct plist_node *p;
 	unsigned long flags;
 
-	spin_lock_irqsave(&pm_qos_lock, flags);
+	spin_lock_irqsave(&c->lock, flags);
 
-	plist_for_each(p, &pm_qos_array[pm_qos_class]->constraints->list) {
+	plist_for_each(p, &c->list) {
 		if (req == container_of(p, struct pm_qos_request, node)) {
-			spin_unlock_irqrestore(&pm_qos_lock, flags);
+			spin_unlock_irqrestore(&c->lock, flags);
 			return p->prio;
 		}
 	}
 
-	spin_unlock_irqrestore(&pm_qos_lock, flags);
+	spin_unlock_irqrestore(&c->lock, flags);
 
 	return -ENODATA;
 }
@@ -897,9 +1046,7 @@ static void __pm_qos_update_request(struct pm_qos_request *req,
 	trace_pm_qos_update_request(req->pm_qos_class, new_value);
 
 	if (new_value != req->node.prio)
-		pm_qos_update_target(
-			pm_qos_array[req->pm_qos_class]->constraints,
-			&req->node, PM_QOS_UPDATE_REQ, new_value);
+		pm_qos_update_class(req, PM_QOS_UPDATE_REQ, new_value);
 }
 
 /**
@@ -946,8 +1093,7 @@ void pm_qos_add_request_trace(char *func, unsigned int line,
 	req->line = line;
 	INIT_DELAYED_WORK(&req->work, pm_qos_work_fn);
 	trace_pm_qos_add_request(pm_qos_class, value);
-	pm_qos_update_target(pm_qos_array[pm_qos_class]->constraints,
-			     &req->node, PM_QOS_ADD_REQ, value);
+	pm_qos_update_class(req, PM_QOS_ADD_REQ, value);
 }
 EXPORT_SYMBOL_GPL(pm_qos_add_request_trace);
 
@@ -1002,9 +1148,7 @@ void pm_qos_update_request_timeout(struct pm_qos_request *req, s32 new_value,
 	trace_pm_qos_update_request_timeout(req->pm_qos_class,
 					    new_value, timeout_us);
 	if (new_value != req->node.prio)
-		pm_qos_update_target(
-			pm_qos_array[req->pm_qos_class]->constraints,
-			&req->node, PM_QOS_UPDATE_REQ, new_value);
+		pm_qos_update_class(req, PM_QOS_UPDATE_REQ, new_value);
 
 	schedule_delayed_work(&req->work, usecs_to_jiffies(timeout_us));
 }
@@ -1032,13 +1176,70 @@ void pm_qos_remove_request(struct pm_qos_request *req)
 		cancel_delayed_work_sync(&req->work);
 
 	trace_pm_qos_remove_request(req->pm_qos_class, PM_QOS_DEFAULT_VALUE);
-	pm_qos_update_target(pm_qos_array[req->pm_qos_class]->constraints,
-			     &req->node, PM_QOS_REMOVE_REQ,
-			     PM_QOS_DEFAULT_VALUE);
+	pm_qos_update_class(req, PM_QOS_REMOVE_REQ, PM_QOS_DEFAULT_VALUE);
 	memset(req, 0, sizeof(*req));
 }
 EXPORT_SYMBOL_GPL(pm_qos_remove_request);
 
+/**
+ * pm_qos_update_request_batch - modifies several qos requests at once
+ * @reqs: handles of the requests to update
+ * @values: new value of each request
+ * @nr: number of requests
+ *
+ * All constraint lists are updated first. Then the notifiers of each class
+ * whose aggregate value changed run once with the final value, rather than
+ * once per request. Requests may belong to any mix of classes.
+ */
+void pm_qos_update_request_batch(struct pm_qos_request **reqs,
+				 const s32 *values, int nr)
+{
+	DECLARE_BITMAP(touched, PM_QOS_NUM_CLASSES);
+	s32 prev_values[PM_QOS_NUM_CLASSES];
+	int i, class, prev_value;
+
+	bitmap_zero(touched, PM_QOS_NUM_CLASSES);
+
+	for (i = 0; i < nr; i++) {
+		struct pm_qos_request *req = reqs[i];
+
+		if (!req)
+			continue;
+
+		if (!pm_qos_request_active(req)) {
+			WARN(1, KERN_ERR "pm_qos_update_request_batch() called for unknown object\n");
+			continue;
+		}
+
+		if (delayed_work_pending(&req->work))
+			cancel_delayed_work_sync(&req->work);
+
+		trace_pm_qos_update_request(req->pm_qos_class, values[i]);
+		if (values[i] == req->node.prio)
+			continue;
+
+		class = req->pm_qos_class;
+		pm_qos_apply_request(pm_qos_array[class]->constraints,
+				     &req->node, PM_QOS_UPDATE_REQ, values[i],
+				     &prev_value, pm_qos_array[class]);
+		if (!test_and_set_bit(class, touched))
+			prev_values[class] = prev_value;
+	}
+
+	for_each_set_bit(class, touched, PM_QOS_NUM_CLASSES) {
+		struct pm_qos_object *qos = pm_qos_array[class];
+		struct pm_qos_constraints *c = qos->constraints;
+		s32 curr_value = pm_qos_read_value(c);
+
+		if (c->type != PM_QOS_FORCE_MAX &&
+		    curr_value == prev_values[class])
+			continue;
+
+		pm_qos_notify_class(qos, curr_value, &qos->pm_qos_class);
+	}
+}
+EXPORT_SYMBOL_GPL(pm_qos_update_request_batch);
+
 /**
  * pm_qos_add_notifier - sets notification entry for changes to target value
  * @pm_qos_class: identifies which qos target changes should be notified.
@@ -1143,15 +1344,17 @@ static ssize_t pm_qos_power_read(struct file *filp, char __user *buf,
 	s32 value;
 	unsigned long flags;
 	struct pm_qos_request *req = filp->private_data;
+	struct pm_qos_constraints *c;
 
 	if (!req)
 		return -EINVAL;
 	if (!pm_qos_request_active(req))
 		return -EINVAL;
 
-	spin_lock_irqsave(&pm_qos_lock, flags);
-	value = pm_qos_get_value(pm_qos_array[req->pm_qos_class]->constraints);
-	spin_unlock_irqrestore(&pm_qos_lock, flags);
+	c = pm_qos_array[req->pm_qos_class]->constraints;
+	spin_lock_irqsave(&c->lock, flags);
+	value = pm_qos_get_value(c);
+	spin_unlock_irqrestore(&c->lock, flags);
 
 	return simple_read_from_buffer(buf, count, f_pos, &value, sizeof(s32));
 }
@@ -1179,11 +1382,53 @@ static ssize_t pm_qos_power_write(struct file *filp, const char __user *buf,
 	return count;
 }
 
+static int pm_qos_dbg_show_stats(struct seq_file *s, void *unused)
+{
+	struct pm_qos_object *qos;
+	struct pm_qos_stat stat;
+	unsigned long flags;
+	int i;
+
+	seq_printf(s, "%-24s %10s %10s %10s %10s %10s %8s\n", "class",
+		   "updates", "notifies", "coalesced", "avg_us", "max_us",
+		   "coalesce");
+
+	for (i = PM_QOS_CPU_DMA_LATENCY; i < PM_QOS_NUM_CLASSES; i++) {
+		qos = pm_qos_array[i];
+
+		spin_lock_irqsave(&qos->constraints->lock, flags);
+		stat = qos->stat;
+		spin_unlock_irqrestore(&qos->constraints->lock, flags);
+
+		seq_printf(s, "%-24s %10lu %10lu %10lu %10llu %10llu %8d\n",
+			   qos->name, stat.updates, stat.notifies,
+			   stat.coalesced,
+			   stat.notifies ? div64_u64(stat.notify_ns,
+				stat.notifies * NSEC_PER_USEC) : 0,
+			   div64_u64(stat.max_notify_ns, NSEC_PER_USEC),
+			   READ_ONCE(qos->coalesce));
+	}
+
+	return 0;
+}
+
+static int pm_qos_dbg_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pm_qos_dbg_show_stats, inode->i_private);
+}
+
+static const struct file_operations pm_qos_debug_stats_fops = {
+	.open           = pm_qos_dbg_stats_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static int __init pm_qos_power_init(void)
 {
 	int ret = 0;
 	int i;
-	struct dentry *d;
+	struct dentry *d, *coalesce_d = NULL;
 
 	BUILD_BUG_ON(ARRAY_SIZE(pm_qos_array) != PM_QOS_NUM_CLASSES);
 
@@ -1191,7 +1436,24 @@ static int __init pm_qos_power_init(void)
 	if (IS_ERR_OR_NULL(d))
 		d = NULL;
 
+	if (d) {
+		(void)debugfs_create_file("stats", S_IRUGO, d, NULL,
+					  &pm_qos_debug_stats_fops);
+		coalesce_d = debugfs_create_dir("coalesce", d);
+		if (IS_ERR_OR_NULL(coalesce_d))
+			coalesce_d = NULL;
+	}
+
 	for (i = PM_QOS_CPU_DMA_LATENCY; i < PM_QOS_NUM_CLASSES; i++) {
+		struct pm_qos_object *qos = pm_qos_array[i];
+
+		qos->pm_qos_class = i;
+		qos->notified_value = pm_qos_read_value(qos->constraints);
+		INIT_WORK(&qos->notify_work, pm_qos_notify_work_fn);
+		if (coalesce_d)
+			debugfs_create_bool(qos->name, S_IRUGO | S_IWUSR,
+					    coalesce_d, &qos->coalesce);
+
 		ret = register_pm_qos_misc(pm_qos_array[i], d);
 		if (ret < 0) {
 			printk(KERN_ERR "pm_qos_param: %s setup failed\n",
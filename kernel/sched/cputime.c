@@ -6,6 +6,7 @@
 #include <linux/context_tracking.h>
 #include <linux/sched/cputime.h>
 #include <linux/cpufreq_times.h>
+#include <linux/uid_sys_stats.h>
 #include "sched.h"
 #include "walt.h"
 
@@ -151,6 +152,9 @@ void account_user_time(struct task_struct *p, u64 cputime)
 
 	/* Account power usage for user time */
 	cpufreq_acct_update_power(p, cputime);
+
+	/* Account user time to the uid */
+	uid_sys_stats_account_cputime(p, cputime, 0);
 }
 
 /*
@@ -175,6 +179,9 @@ void account_guest_time(struct task_struct *p, u64 cputime)
 		cpustat[CPUTIME_USER] += cputime;
 		cpustat[CPUTIME_GUEST] += cputime;
 	}
+
+	/* Account guest time to the uid */
+	uid_sys_stats_account_cputime(p, cputime, 0);
 }
 
 /*
@@ -198,6 +205,9 @@ void account_system_index_time(struct task_struct *p,
 
 	/* Account power usage for system time */
 	cpufreq_acct_update_power(p, cputime);
+
+	/* Account system time to the uid */
+	uid_sys_stats_account_cputime(p, 0, cputime);
 }
 
 /*
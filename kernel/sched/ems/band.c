@@ -8,6 +8,7 @@
 #include <linux/spinlock.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/kobject.h>
 #include <linux/ems.h>
 #include <linux/sched/signal.h>
 #include <trace/events/ems.h>
@@ -52,12 +53,127 @@ int band_play_cpu(struct task_struct *p)
 	return min_cpu;
 }
 
-static void pick_playable_cpus(struct task_band *band)
+void band_account_wakeup(struct task_struct *p, int prev_cpu, int target_cpu)
 {
+	struct task_band *band;
+
+	if (!cpu_selected(target_cpu))
+		return;
+
+	band = lookup_band(p);
+	if (!band)
+		return;
+
+	band->wakeups++;
+
+	/* woken on another cpu, private cache is cold */
+	if (target_cpu != prev_cpu)
+		band->cross_cpu_wakeups++;
+
+	/* woken on another coregroup, shared cache is cold as well */
+	if (!cpumask_test_cpu(target_cpu, cpu_coregroup_mask(prev_cpu)))
+		band->migrations++;
+
+	/* woken next to the waker, e.g. consumer next to its producer */
+	if (cpumask_test_cpu(target_cpu, cpu_coregroup_mask(smp_processor_id())))
+		band->colocated_wakeups++;
+}
+
+static void reset_band_stats(struct task_band *band)
+{
+	band->wakeups = 0;
+	band->cross_cpu_wakeups = 0;
+	band->migrations = 0;
+	band->colocated_wakeups = 0;
+	band->window_start = 0;
+	band->window_wakeups = 0;
+	band->window_cross_cpu = 0;
+	band->play_span = 0;
+}
+
+/*
+ * The band starts playing on the whole coregroup. At the end of every feedback
+ * window, the span grows by one cpu if the band utilization no longer fits in
+ * the capacity of the span, and shrinks by one cpu if the band still fits in
+ * a smaller span while most of its wakeups move members across cpus. Packing
+ * the members tighter in that case keeps the data they share cache-hot.
+ */
+static unsigned long band_window = 100000000;	/* 100ms */
+static unsigned int band_min_wakeups = 16;
+static unsigned int band_widen_ratio = 80;	/* % of span capacity */
+static unsigned int band_shrink_ratio = 60;	/* % of shrunk span capacity */
+static unsigned int band_cross_ratio = 50;	/* % of cross-cpu wakeups */
+
+static unsigned long span_capacity(struct cpumask *mask, int span, int sse)
+{
+	unsigned long capacity = 0;
+	int cpu;
+
+	for_each_cpu(cpu, mask) {
+		if (span-- <= 0)
+			break;
+		capacity += capacity_orig_of_sse(cpu, sse);
+	}
+
+	return capacity;
+}
+
+static void adapt_play_span(struct task_band *band, struct cpumask *mask,
+						unsigned long now)
+{
+	int nr_cpus = cpumask_weight(mask);
+	unsigned long wakeups, cross;
+
+	if (band->play_span <= 0 || band->play_span > nr_cpus)
+		band->play_span = nr_cpus;
+
+	if (now - band->window_start < band_window)
+		return;
+
+	wakeups = band->wakeups - band->window_wakeups;
+	cross = band->cross_cpu_wakeups - band->window_cross_cpu;
+
+	band->window_start = now;
+	band->window_wakeups = band->wakeups;
+	band->window_cross_cpu = band->cross_cpu_wakeups;
+
+	if (band->util * 100 >
+	    span_capacity(mask, band->play_span, band->sse) * band_widen_ratio) {
+		if (band->play_span < nr_cpus)
+			band->play_span++;
+		return;
+	}
+
+	if (band->play_span <= 1 || wakeups < band_min_wakeups)
+		return;
+
+	if (cross * 100 >= wakeups * band_cross_ratio &&
+	    band->util * 100 <
+	    span_capacity(mask, band->play_span - 1, band->sse) * band_shrink_ratio)
+		band->play_span--;
+}
+
+static void pick_playable_cpus(struct task_band *band, unsigned long now)
+{
+	struct cpumask mask, playable;
+	int cpu, span;
+
 	if (!band->sse)
 		return;
 
-	cpumask_and(&band->playable_cpus, cpu_online_mask, cpu_coregroup_mask(4));
+	cpumask_and(&mask, cpu_online_mask, cpu_coregroup_mask(4));
+	adapt_play_span(band, &mask, now);
+
+	cpumask_clear(&playable);
+	span = band->play_span;
+	for_each_cpu(cpu, &mask) {
+		if (span-- <= 0)
+			break;
+		cpumask_set_cpu(cpu, &playable);
+	}
+
+	/* band_play_cpu() reads playable_cpus without band->lock */
+	cpumask_copy(&band->playable_cpus, &playable);
 }
 
 static unsigned long out_of_time = 100000000;	/* 100ms */
@@ -77,11 +193,11 @@ static void __update_band(struct task_band *band, unsigned long now)
 	band->util = util_sum;
 	band->last_update_time = now;
 
-	pick_playable_cpus(band);
+	pick_playable_cpus(band, now);
 
 	task = list_first_entry(&band->members, struct task_struct, band_members);
 	trace_ems_update_band(band->id, band->util, band->member_count,
-		*(unsigned int *)cpumask_bits(&band->playable_cpus));
+		cpumask_bits(&band->playable_cpus)[0]);
 }
 
 static int update_interval = 20000000;	/* 20ms */
@@ -154,6 +270,7 @@ static void join_band(struct task_struct *p)
 	if (!band_playing(band)) {
 		band->tgid = p->tgid;
 		band->sse = p->sse;
+		reset_band_stats(band);
 	}
 	list_add(&p->band_members, &band->members);
 	rcu_assign_pointer(p->band, band);
@@ -250,6 +367,7 @@ int alloc_bands(void)
 		INIT_LIST_HEAD(&band->members);
 		band->member_count = 0;
 		cpumask_clear(&band->playable_cpus);
+		reset_band_stats(band);
 
 		bands[pos] = band;
 	}
@@ -264,3 +382,50 @@ fail:
 
 	return ret;
 }
+
+static ssize_t show_band_stat(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	struct task_band *band;
+	char playable[16];
+	int pos, ret = 0;
+
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret,
+		"id  tgid  sse members util playable wakeups cross_cpu migrations colocated\n");
+
+	read_lock(&band_rwlock);
+	for (pos = 0; pos < MAX_NUM_BAND_ID; pos++) {
+		band = bands[pos];
+		if (!band || !band_playing(band))
+			continue;
+
+		raw_spin_lock_irq(&band->lock);
+		scnprintf(playable, sizeof(playable), "%*pbl",
+			cpumask_pr_args(&band->playable_cpus));
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret,
+			"%-3d %-5d %-3d %-7d %-4lu %-8s %-7lu %-9lu %-10lu %lu\n",
+			band->id, band->tgid, band->sse, band->member_count,
+			band->util, playable,
+			band->wakeups, band->cross_cpu_wakeups,
+			band->migrations, band->colocated_wakeups);
+		raw_spin_unlock_irq(&band->lock);
+	}
+	read_unlock(&band_rwlock);
+
+	return ret;
+}
+
+static struct kobj_attribute band_stat_attr =
+__ATTR(band_stat, 0444, show_band_stat, NULL);
+
+static int __init init_band_sysfs(void)
+{
+	int ret;
+
+	ret = sysfs_create_file(ems_kobj, &band_stat_attr.attr);
+	if (ret)
+		pr_err("%s: failed to create sysfs file\n", __func__);
+
+	return 0;
+}
+late_initcall(init_band_sysfs);
@@ -233,6 +233,7 @@ int exynos_wakeup_balance(struct task_struct *p, int prev_cpu, int sd_flag, int
 		strcpy(state, "proper cpu");
 
 out:
+	band_account_wakeup(p, prev_cpu, target_cpu);
 	trace_ems_wakeup_balance(p, target_cpu, state);
 	return target_cpu;
 }
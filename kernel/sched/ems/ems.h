@@ -28,6 +28,7 @@ extern int select_best_cpu(struct task_struct *p, int prev_cpu, int sd_flag, int
 extern unsigned int calculate_energy(struct task_struct *p, int target_cpu);
 extern int alloc_bands(void);
 extern int band_play_cpu(struct task_struct *p);
+extern void band_account_wakeup(struct task_struct *p, int prev_cpu, int target_cpu);
 
 extern int need_ontime_migration_trigger(int cpu, struct task_struct *p);
 
@@ -44,6 +44,9 @@ struct ontime_cond {
 	int			coregroup;
 	struct cpumask		cpus;
 
+	/* Serializes ontime migration of this coregroup */
+	spinlock_t		om_lock;
+
 	struct list_head	list;
 
 	/* kobject for sysfs group */
@@ -59,6 +62,8 @@ struct ontime_env {
 	int			src_cpu;
 	struct task_struct	*target_task;
 	int			boost_migration;
+	/* Time when the heavy task was picked */
+	u64			start_time;
 };
 DEFINE_PER_CPU(struct ontime_env, ontime_env);
 
@@ -416,7 +421,8 @@ static int ontime_migration_cpu_stop(void *data)
 	double_lock_balance(src_rq, dst_rq);
 	if (move_specific_task(p, env)) {
 		trace_ems_ontime_migration(p, ml_task_runnable(p),
-				src_cpu, dst_cpu, boost_migration);
+				src_cpu, dst_cpu, boost_migration,
+				sched_clock() - env->start_time);
 	}
 	double_unlock_balance(src_rq, dst_rq);
 
@@ -444,113 +450,136 @@ int need_ontime_migration_trigger(int cpu, struct task_struct *p)
 }
 
 DEFINE_PER_CPU(struct cpu_stop_work, ontime_migration_work);
-static DEFINE_SPINLOCK(om_lock);
 
-void ontime_migration(void)
+/*
+ * Pick heavy task on the given cpu and reserve its destination. Return true
+ * if cpu stopper has to be kicked to migrate the task.
+ */
+static bool ontime_prepare_migration(int cpu)
 {
-	int cpu;
+	unsigned long flags;
+	struct rq *rq = cpu_rq(cpu);
+	struct sched_entity *se;
+	struct task_struct *p;
+	struct ontime_env *env = &per_cpu(ontime_env, cpu);
+	struct cpumask fit_cpus;
+	int boost_migration = 0;
+	int dst_cpu;
+	bool queued = false;
 
-	if (!spin_trylock(&om_lock))
-		return;
+	raw_spin_lock_irqsave(&rq->lock, flags);
 
-	for_each_cpu(cpu, cpu_active_mask) {
-		unsigned long flags;
-		struct rq *rq = cpu_rq(cpu);
-		struct sched_entity *se;
-		struct task_struct *p;
-		struct ontime_env *env = &per_cpu(ontime_env, cpu);
-		struct cpumask fit_cpus;
-		int boost_migration = 0;
-		int dst_cpu;
+	/*
+	 * Ontime migration is not performed when active balance
+	 * is in progress.
+	 */
+	if (rq->active_balance)
+		goto out_unlock;
 
-		raw_spin_lock_irqsave(&rq->lock, flags);
+	/*
+	 * No need to migration if source cpu does not have cfs
+	 * tasks.
+	 */
+	if (!rq->cfs.curr)
+		goto out_unlock;
 
-		/*
-		 * Ontime migration is not performed when active balance
-		 * is in progress.
-		 */
-		if (rq->active_balance) {
-			raw_spin_unlock_irqrestore(&rq->lock, flags);
-			continue;
-		}
+	/* Find task entity if entity is cfs_rq. */
+	se = rq->cfs.curr;
+	if (entity_is_cfs_rq(se)) {
+		struct cfs_rq *cfs_rq = se->my_q;
 
-		/*
-		 * No need to migration if source cpu does not have cfs
-		 * tasks.
-		 */
-		if (!rq->cfs.curr) {
-			raw_spin_unlock_irqrestore(&rq->lock, flags);
-			continue;
+		while (cfs_rq) {
+			se = cfs_rq->curr;
+			cfs_rq = se->my_q;
 		}
+	}
 
-		/* Find task entity if entity is cfs_rq. */
-		se = rq->cfs.curr;
-		if (entity_is_cfs_rq(se)) {
-			struct cfs_rq *cfs_rq = se->my_q;
+	/*
+	 * Pick task to be migrated. Return NULL if there is no
+	 * heavy task in rq.
+	 */
+	p = ontime_pick_heavy_task(se, &boost_migration);
+	if (!p)
+		goto out_unlock;
 
-			while (cfs_rq) {
-				se = cfs_rq->curr;
-				cfs_rq = se->my_q;
-			}
-		}
+	/* If fit_cpus is not searched, don't need to select dst_cpu */
+	if (ontime_select_fit_cpus(p, &fit_cpus))
+		goto out_unlock;
 
-		/*
-		 * Pick task to be migrated. Return NULL if there is no
-		 * heavy task in rq.
-		 */
-		p = ontime_pick_heavy_task(se, &boost_migration);
-		if (!p) {
-			raw_spin_unlock_irqrestore(&rq->lock, flags);
-			continue;
-		}
+	/*
+	 * If fit_cpus is smaller than current coregroup,
+	 * don't need to ontime migration.
+	 */
+	if (!is_faster_than(cpu, cpumask_first(&fit_cpus), p->sse))
+		goto out_unlock;
 
-		/* If fit_cpus is not searched, don't need to select dst_cpu */
-		if (ontime_select_fit_cpus(p, &fit_cpus)) {
-			raw_spin_unlock_irqrestore(&rq->lock, flags);
-			continue;
-		}
+	/*
+	 * Select cpu to migrate the task to. Return negative number
+	 * if there is no idle cpu in sg.
+	 */
+	dst_cpu = ontime_select_target_cpu(p, &fit_cpus);
+	if (!cpu_selected(dst_cpu))
+		goto out_unlock;
 
-		/*
-		 * If fit_cpus is smaller than current coregroup,
-		 * don't need to ontime migration.
-		 */
-		if (!is_faster_than(cpu, cpumask_first(&fit_cpus), p->sse)) {
-			raw_spin_unlock_irqrestore(&rq->lock, flags);
-			continue;
-		}
+	/*
+	 * Coregroups are swept concurrently, so several sources can select
+	 * the same destination. Only the first one may use it.
+	 */
+	if (cmpxchg(&cpu_rq(dst_cpu)->ontime_migrating, false, true))
+		goto out_unlock;
 
-		/*
-		 * Select cpu to migrate the task to. Return negative number
-		 * if there is no idle cpu in sg.
-		 */
-		dst_cpu = ontime_select_target_cpu(p, &fit_cpus);
-		if (!cpu_selected(dst_cpu)) {
-			raw_spin_unlock_irqrestore(&rq->lock, flags);
-			continue;
-		}
+	ontime_of(p)->migrating = 1;
+	get_task_struct(p);
 
-		ontime_of(p)->migrating = 1;
-		get_task_struct(p);
+	/* Set environment data */
+	env->dst_cpu = dst_cpu;
+	env->src_rq = rq;
+	env->target_task = p;
+	env->boost_migration = boost_migration;
+	env->start_time = sched_clock();
 
-		/* Set environment data */
-		env->dst_cpu = dst_cpu;
-		env->src_rq = rq;
-		env->target_task = p;
-		env->boost_migration = boost_migration;
+	/* Prevent active balance to use stopper for migration */
+	rq->active_balance = 1;
 
-		/* Prevent active balance to use stopper for migration */
-		rq->active_balance = 1;
+	queued = true;
 
-		cpu_rq(dst_cpu)->ontime_migrating = 1;
+out_unlock:
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
 
-		raw_spin_unlock_irqrestore(&rq->lock, flags);
+	return queued;
+}
 
-		/* Migrate task through stopper */
-		stop_one_cpu_nowait(cpu, ontime_migration_cpu_stop, env,
-				&per_cpu(ontime_migration_work, cpu));
+void ontime_migration(void)
+{
+	struct ontime_cond *cond;
+	struct cpumask stop_cpus;
+	int cpu;
+
+	/*
+	 * Each coregroup is in charge of the heavy tasks on its own cpus, so
+	 * the sweep is serialized only against the other cpus of the same
+	 * coregroup.
+	 */
+	cond = get_current_cond(smp_processor_id());
+	if (!cond)
+		return;
+
+	if (!spin_trylock(&cond->om_lock))
+		return;
+
+	cpumask_clear(&stop_cpus);
+	for_each_cpu_and(cpu, &cond->cpus, cpu_active_mask) {
+		if (ontime_prepare_migration(cpu))
+			cpumask_set_cpu(cpu, &stop_cpus);
 	}
 
-	spin_unlock(&om_lock);
+	spin_unlock(&cond->om_lock);
+
+	/* Migrate tasks through stoppers as a batch */
+	for_each_cpu(cpu, &stop_cpus)
+		stop_one_cpu_nowait(cpu, ontime_migration_cpu_stop,
+				&per_cpu(ontime_env, cpu),
+				&per_cpu(ontime_migration_work, cpu));
 }
 
 int ontime_task_wakeup(struct task_struct *p, int sync)
@@ -862,6 +891,7 @@ static int __init init_ontime(void)
 		cond = kzalloc(sizeof(struct ontime_cond), GFP_KERNEL);
 
 		cpumask_copy(&cond->cpus, cpu_coregroup_mask(cpu));
+		spin_lock_init(&cond->om_lock);
 
 		parse_ontime(dn, cond, cnt++);
 
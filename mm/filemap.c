@@ -2411,6 +2411,58 @@ int mmap_readaround_limit = (VM_MAX_READAHEAD / 4); 		/* page */
 int mmap_readaround_limit = CONFIG_MMAP_READAROUND_LIMIT;	/* page */
 #endif
 
+/*
+ * The mmap read-around window adapts per file. Faults on pages of the last
+ * read-around count as hits; the neighbours mapped by fault-around do not,
+ * since they may never be touched. One fault maps mmap_span pages, so a
+ * window that is used fully takes window / mmap_span faults. When the next
+ * read-around is issued, the window doubles if at least half of those
+ * faults happened and halves if less than an eighth of them did.
+ * mmap_readaround_limit is the initial window and ra_pages the ceiling.
+ */
+#define MMAP_RA_MIN_PAGES	4
+
+static inline void mmap_readaround_hit(struct file_ra_state *ra, pgoff_t index)
+{
+	if (index < ra->mmap_start || index >= ra->mmap_start + ra->mmap_window)
+		return;
+
+	if (ra->mmap_hit < ra->mmap_window) {
+		ra->mmap_hit++;
+		count_vm_event(MMAP_RA_HIT);
+	}
+}
+
+static unsigned int mmap_readaround_window(struct file *file,
+				struct file_ra_state *ra, pgoff_t offset)
+{
+	unsigned int prev = ra->mmap_window;
+	unsigned int window = prev;
+	unsigned int faults = DIV_ROUND_UP(prev, max(ra->mmap_span, 1U));
+
+	if (!prev) {
+		window = min_t(unsigned int, ra->ra_pages, mmap_readaround_limit);
+	} else if (ra->mmap_hit * 2 >= faults) {
+		window = min(prev * 2, ra->ra_pages);
+		if (window > prev)
+			count_vm_event(MMAP_RA_GROW);
+	} else if (ra->mmap_hit * 8 < faults) {
+		window = min_t(unsigned int, ra->ra_pages,
+				max_t(unsigned int, prev / 2, MMAP_RA_MIN_PAGES));
+		if (window < prev)
+			count_vm_event(MMAP_RA_SHRINK);
+	}
+
+	trace_mm_filemap_mmap_readaround(file, offset, prev, ra->mmap_hit,
+								window);
+
+	ra->mmap_window = window;
+	ra->mmap_hit = 0;
+	count_vm_events(MMAP_RA, window);
+
+	return window;
+}
+
 #ifdef CONFIG_TRACING
 static void filemap_tracing_mark_begin(struct file *file,
 		pgoff_t offset, unsigned int size, bool sync)
@@ -2489,8 +2541,9 @@ static struct file *do_sync_mmap_readahead(struct vm_fault *vmf)
 	 * mmap read-around
 	 */
 	fpin = maybe_unlock_mmap_for_io(vmf, fpin);
-	ra_pages = min_t(unsigned int, ra->ra_pages, mmap_readaround_limit);
+	ra_pages = mmap_readaround_window(file, ra, offset);
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
+	ra->mmap_start = ra->start;
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
 	filemap_tracing_mark_begin(file, offset, ra_pages, 1);
@@ -2518,6 +2571,7 @@ static struct file *do_async_mmap_readahead(struct vm_fault *vmf,
 		return fpin;
 	if (ra->mmap_miss > 0)
 		ra->mmap_miss--;
+	mmap_readaround_hit(ra, offset);
 	if (PageReadahead(page)) {
 		fpin = maybe_unlock_mmap_for_io(vmf, fpin);
 		filemap_tracing_mark_begin(file, offset, ra->ra_pages, 0);
@@ -2690,6 +2744,8 @@ void filemap_map_pages(struct vm_fault *vmf,
 	unsigned long max_idx;
 	struct page *head, *page;
 
+	file->f_ra.mmap_span = end_pgoff - start_pgoff + 1;
+
 	rcu_read_lock();
 	radix_tree_for_each_slot(slot, &mapping->page_tree, &iter,
 			start_pgoff) {
@@ -2739,6 +2795,9 @@ repeat:
 
 		if (file->f_ra.mmap_miss > 0)
 			file->f_ra.mmap_miss--;
+		/* only the faulting page, not its neighbours */
+		if (iter.index == vmf->pgoff)
+			mmap_readaround_hit(&file->f_ra, iter.index);
 
 		vmf->address += (iter.index - last_pgoff) << PAGE_SHIFT;
 		if (vmf->pte)
@@ -2947,6 +2947,9 @@ int do_swap_page(struct vm_fault *vmf)
 
 		/* Had to read the page from swap area: Major fault */
 		ret = VM_FAULT_MAJOR;
+#ifdef CONFIG_PROCESS_RECLAIM
+		atomic_long_inc(&vma->vm_mm->reclaim_stat.nr_swapin_faults);
+#endif
 		count_vm_event(PGMAJFAULT);
 		count_memcg_event_mm(vma->vm_mm, PGMAJFAULT);
 	} else if (PageHWPoison(page)) {
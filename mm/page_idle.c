@@ -224,6 +224,47 @@ struct page_ext_operations page_idle_ops = {
 };
 #endif
 
+#ifdef CONFIG_PROCESS_RECLAIM_AGE
+/*
+ * Number of consecutive process reclaim aging passes that found the page
+ * idle. The slot is a full word so that page_ext entries stay aligned for
+ * the bitops done on page_ext->flags.
+ */
+static bool need_page_age(void)
+{
+	return true;
+}
+struct page_ext_operations page_age_ops = {
+	.size = sizeof(unsigned long),
+	.need = need_page_age,
+};
+
+static inline unsigned long *get_page_age(struct page_ext *page_ext)
+{
+	return (void *)page_ext + page_age_ops.offset;
+}
+
+unsigned int page_age(struct page *page)
+{
+	struct page_ext *page_ext = lookup_page_ext(page);
+
+	if (unlikely(!page_ext))
+		return 0;
+
+	return READ_ONCE(*get_page_age(page_ext));
+}
+
+void set_page_age(struct page *page, unsigned int age)
+{
+	struct page_ext *page_ext = lookup_page_ext(page);
+
+	if (unlikely(!page_ext))
+		return;
+
+	WRITE_ONCE(*get_page_age(page_ext), min_t(unsigned int, age, PAGE_AGE_MAX));
+}
+#endif
+
 static int __init page_idle_init(void)
 {
 	int err;
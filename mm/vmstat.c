@@ -1220,6 +1220,10 @@ const char * const vmstat_text[] = {
 	"swap_ra",
 	"swap_ra_hit",
 #endif
+	"mmap_ra",
+	"mmap_ra_hit",
+	"mmap_ra_grow",
+	"mmap_ra_shrink",
 #ifdef CONFIG_ZRAM_LRU_WRITEBACK
 	"sqzr_objcnt",
 	"sqzr_count",
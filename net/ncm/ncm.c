@@ -35,7 +35,6 @@
 #include <linux/workqueue.h>
 #include <linux/sched.h>
 #include <linux/mutex.h>
-#include <linux/kfifo.h>
 #include <linux/kthread.h>
 #include <linux/interrupt.h>
 #include <linux/poll.h>
@@ -49,6 +48,11 @@
 #include <linux/in6.h>
 #include <linux/net.h>
 #include <linux/inet.h>
+#include <linux/percpu.h>
+#include <linux/vmalloc.h>
+#include <linux/hash.h>
+#include <linux/mm.h>
+#include <linux/cred.h>
 
 #include <net/sock.h>
 #include <net/ncm.h>
@@ -60,10 +64,10 @@
 #define SUCCESS 0
 
 #define FAILURE 1
-/* fifo size in elements (bytes) */
-#define FIFO_SIZE   1024
+/* records per cpu ring, must be a power of 2 */
+#define NCM_RING_SIZE   128
 #define WAIT_TIMEOUT  10000 /*milliseconds */
-/* Lock to maintain orderly insertion of elements into kfifo */
+/* Serializes readers of the per-cpu rings */
 static DEFINE_MUTEX(ncm_lock);
 
 static unsigned int ncm_activated_flag = 1;
@@ -86,9 +90,7 @@ static struct nf_hook_ops nfho_ipv4_li_conntrack;
 
 static struct nf_hook_ops nfho_ipv6_li_conntrack;
 
-static struct workqueue_struct *eWq; // default = 0
-
-wait_queue_head_t ncm_wq;
+DECLARE_WAIT_QUEUE_HEAD(ncm_wq);
 
 static atomic_t isNCMEnabled = ATOMIC_INIT(0);
 
@@ -98,7 +100,28 @@ static unsigned int intermediate_flow_timeout; // default = 0
 
 extern struct knox_socket_metadata knox_socket_metadata;
 
-DECLARE_KFIFO(knox_sock_info, struct knox_socket_metadata, FIFO_SIZE);
+/** Flow records are written straight into a preallocated ring of the cpu which sees the event;
+ *  The local cpu is the only producer (with irqs disabled) and ncm_read, under ncm_lock, the only consumer;
+ *  A record is dropped and counted when the ring of its cpu is full;
+ */
+struct ncm_ring {
+	struct knox_user_socket_metadata *slots;
+	unsigned int head;
+	unsigned int tail;
+	unsigned long dropped;
+};
+
+static DEFINE_PER_CPU(struct ncm_ring, ncm_rings);
+
+/* The cpu whose ring is read first by the next ncm_read, so that no ring is starved */
+static int ncm_next_cpu;
+
+/** Direct mapped cache of process attributions indexed by tgid;
+ *  An entry is reused while the process, its command and start time match and it is younger than KNOX_ATTR_TTL;
+ */
+#define KNOX_ATTR_CACHE_BITS  8
+#define KNOX_ATTR_TTL  (10 * HZ)
+static struct knox_proc_attr __rcu *knox_attr_cache[1 << KNOX_ATTR_CACHE_BITS];
 
 /* The function is used to check if ncm feature has been enabled or not; The default value is disabled */
 unsigned int check_ncm_flag(void) {
@@ -112,80 +135,198 @@ unsigned int check_intermediate_flag(void) {
 }
 EXPORT_SYMBOL(check_intermediate_flag);
 
-/** The funcation is used to chedk if the kfifo is active or not;
- *  If the kfifo is active, then the socket metadata would be inserted into the queue which will be read by the user-space;
- *  By default the kfifo is inactive;
+/** The function is used to check if the flow record rings are allocated or not;
+ *  Once allocated the rings are kept for the next activation and only drained on deactivation;
  */
 bool kfifo_status(void) {
-	bool isKfifoActive = false;
-	if (kfifo_initialized(&knox_sock_info)) {
-		NCM_LOGD("The fifo queue for ncm was already intialized \n");
-		isKfifoActive = true;
-	} else {
-		NCM_LOGE("The fifo queue for ncm is not intialized \n");
-		isKfifoActive = false;
-	}
-	return isKfifoActive;
+	return per_cpu(ncm_rings, 0).slots != NULL;
 }
 EXPORT_SYMBOL(kfifo_status);
 
-/** The function is used to insert the socket meta-data into the fifo queue; insertion of data will happen in a seperate kernel thread;
- *  The meta data information will be collected from the context of the process which originates it;
- *  If the kfifo is full, then the kfifo is freed before inserting new meta-data;
- */
-void insert_data_kfifo(struct work_struct *pwork) {
-	struct knox_socket_metadata *knox_socket_metadata;
-
-	knox_socket_metadata = container_of(pwork, struct knox_socket_metadata, work_kfifo);
-	if (IS_ERR(knox_socket_metadata)) {
-		NCM_LOGE("inserting data into the kfifo failed due to unknown error \n");
-		goto err;
-	}
+/* The function reserves the next free slot of the local ring; must be called with irqs disabled */
+static struct knox_user_socket_metadata *ncm_ring_reserve(struct ncm_ring *ring) {
+	unsigned int head = ring->head;
 
-	if (mutex_lock_interruptible(&ncm_lock)) {
-		NCM_LOGE("inserting data into the kfifo failed due to an interuppt \n");
-		goto err;
+	if (!ring->slots)
+		return NULL;
+	if (head - smp_load_acquire(&ring->tail) >= NCM_RING_SIZE) {
+		ring->dropped++;
+		return NULL;
 	}
+	return &ring->slots[head & (NCM_RING_SIZE - 1)];
+}
 
-	if (kfifo_initialized(&knox_sock_info)) {
-		if (kfifo_is_full(&knox_sock_info)) {
-			NCM_LOGD("The kfifo is full and need to free it \n");
-			kfree(knox_socket_metadata);
-		} else {
-			kfifo_in(&knox_sock_info, knox_socket_metadata, 1);
-			kfree(knox_socket_metadata);
-		}
-	} else {
-		kfree(knox_socket_metadata);
-	}
-	mutex_unlock(&ncm_lock);
-	return;
+/* The function publishes the slot returned by ncm_ring_reserve to the reader */
+static void ncm_ring_commit(struct ncm_ring *ring) {
+	smp_store_release(&ring->head, ring->head + 1);
+}
 
-	err:
-	if (knox_socket_metadata != NULL)
-		kfree(knox_socket_metadata);
-	return;
+static void ncm_wake_reader(void) {
+	if (wq_has_sleeper(&ncm_wq))
+		wake_up_interruptible(&ncm_wq);
 }
 
-/** The function is used to insert the socket meta-data into the kfifo in a seperate kernel thread;
- *  The kernel threads which handles the responsibility of inserting the meta-data into the kfifo is manintained by the workqueue function;
+/** The function is used to insert already collected socket meta-data into the ring of the local cpu;
+ *  The meta-data is freed by this function;
  */
 void insert_data_kfifo_kthread(struct knox_socket_metadata* knox_socket_metadata) {
-	if (knox_socket_metadata != NULL)
-	{
-		INIT_WORK(&(knox_socket_metadata->work_kfifo), insert_data_kfifo);
-		if (!eWq) {
-			NCM_LOGD("ewq ncmworkqueue not initialized. Data not collected\r\n");
-			kfree(knox_socket_metadata);
-		}
-		if (eWq) {
-			queue_work(eWq, &(knox_socket_metadata->work_kfifo));
-		}
+	struct knox_user_socket_metadata *slot;
+	unsigned long flags;
+
+	if (knox_socket_metadata == NULL)
+		return;
+
+	local_irq_save(flags);
+	slot = ncm_ring_reserve(this_cpu_ptr(&ncm_rings));
+	if (slot) {
+		slot->srcport = knox_socket_metadata->srcport;
+		slot->dstport = knox_socket_metadata->dstport;
+		slot->trans_proto = knox_socket_metadata->trans_proto;
+		slot->knox_sent = knox_socket_metadata->knox_sent;
+		slot->knox_recv = knox_socket_metadata->knox_recv;
+		slot->knox_uid = knox_socket_metadata->knox_uid;
+		slot->knox_pid = knox_socket_metadata->knox_pid;
+		slot->knox_puid = knox_socket_metadata->knox_puid;
+		slot->open_time = knox_socket_metadata->open_time;
+		slot->close_time = knox_socket_metadata->close_time;
+		slot->knox_uid_dns = knox_socket_metadata->knox_uid_dns;
+		slot->knox_ppid = knox_socket_metadata->knox_ppid;
+		slot->flow_type = knox_socket_metadata->flow_type;
+		memcpy(slot->srcaddr, knox_socket_metadata->srcaddr, sizeof(slot->srcaddr));
+		memcpy(slot->dstaddr, knox_socket_metadata->dstaddr, sizeof(slot->dstaddr));
+		memcpy(slot->process_name, knox_socket_metadata->process_name, sizeof(slot->process_name));
+		memcpy(slot->parent_process_name, knox_socket_metadata->parent_process_name, sizeof(slot->parent_process_name));
+		memcpy(slot->domain_name, knox_socket_metadata->domain_name, sizeof(slot->domain_name));
+		memcpy(slot->interface_name, knox_socket_metadata->interface_name, sizeof(slot->interface_name));
+		ncm_ring_commit(this_cpu_ptr(&ncm_rings));
 	}
+	local_irq_restore(flags);
+
+	kfree(knox_socket_metadata);
+	if (slot)
+		ncm_wake_reader();
 }
 EXPORT_SYMBOL(insert_data_kfifo_kthread);
 
 
+/* The function drops a reference of a process attribution; the last one frees it after a grace period */
+void knox_put_proc_attr(struct knox_proc_attr *attr) {
+	if (attr && refcount_dec_and_test(&attr->ref))
+		kfree_rcu(attr, rcu);
+}
+EXPORT_SYMBOL(knox_put_proc_attr);
+
+static bool knox_proc_attr_match(struct knox_proc_attr *attr, struct task_struct *leader) {
+	return attr->tgid == leader->tgid && attr->start_time == leader->start_time &&
+		time_before(jiffies, attr->stamp + KNOX_ATTR_TTL) &&
+		!strncmp(attr->comm, leader->comm, TASK_COMM_LEN);
+}
+
+/* The function builds the attribution of a process; get_cmdline may sleep */
+static struct knox_proc_attr *knox_alloc_proc_attr(struct task_struct *leader, gfp_t gfp) {
+	struct knox_proc_attr *attr;
+	struct task_struct *parent;
+
+	attr = kzalloc(sizeof(*attr), gfp);
+	if (attr == NULL)
+		return NULL;
+
+	refcount_set(&attr->ref, 1);
+	attr->tgid = leader->tgid;
+	attr->start_time = leader->start_time;
+	attr->stamp = jiffies;
+	get_task_comm(attr->comm, leader);
+	if (get_cmdline(leader, attr->process_name, sizeof(attr->process_name)-1) <= 0)
+		memcpy(attr->process_name, attr->comm, sizeof(attr->comm)-1);
+
+	rcu_read_lock();
+	parent = rcu_dereference(leader->parent);
+	if (parent) {
+		parent = parent->group_leader;
+		get_task_struct(parent);
+	}
+	rcu_read_unlock();
+	if (parent) {
+		if (get_cmdline(parent, attr->parent_process_name, sizeof(attr->parent_process_name)-1) <= 0)
+			__get_task_comm(attr->parent_process_name, TASK_COMM_LEN, parent);
+		attr->knox_puid = task_uid(parent).val;
+		attr->knox_ppid = parent->tgid;
+		put_task_struct(parent);
+	}
+	return attr;
+}
+
+/** The function returns a referenced attribution of the current process;
+ *  It is looked up in the cache first, and only built and cached when missing or stale;
+ */
+struct knox_proc_attr *knox_get_proc_attr(gfp_t gfp) {
+	struct task_struct *leader = current->group_leader;
+	struct knox_proc_attr __rcu **slot;
+	struct knox_proc_attr *attr, *old;
+
+	slot = &knox_attr_cache[hash_32(leader->tgid, KNOX_ATTR_CACHE_BITS)];
+	rcu_read_lock();
+	attr = rcu_dereference(*slot);
+	if (attr && knox_proc_attr_match(attr, leader) && refcount_inc_not_zero(&attr->ref)) {
+		rcu_read_unlock();
+		return attr;
+	}
+	rcu_read_unlock();
+
+	if (!gfpflags_allow_blocking(gfp))
+		return NULL;
+
+	attr = knox_alloc_proc_attr(leader, gfp);
+	if (attr == NULL)
+		return NULL;
+
+	/* one reference for the caller and one for the cache */
+	refcount_inc(&attr->ref);
+	old = (struct knox_proc_attr __force *)xchg(slot, RCU_INITIALIZER(attr));
+	knox_put_proc_attr(old);
+	return attr;
+}
+EXPORT_SYMBOL(knox_get_proc_attr);
+
+/* The function drops all cached attributions; sockets keep their own references */
+static void knox_flush_attr_cache(void) {
+	struct knox_proc_attr *old;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(knox_attr_cache); i++) {
+		old = (struct knox_proc_attr __force *)xchg(&knox_attr_cache[i], NULL);
+		knox_put_proc_attr(old);
+	}
+}
+
+/** The function copies the attribution of the socket into the conntrack entry;
+ *  It is called once per flow, from the first packet which is seen for it;
+ */
+void knox_attach_flow_attr(struct nf_conn *ct, struct sock *sk, struct sk_buff *skb) {
+	struct knox_proc_attr *attr = sk->knox_attr;
+
+	ct->knox_uid = sk->knox_uid;
+	ct->knox_pid = sk->knox_pid;
+	if (attr) {
+		ct->knox_puid = attr->knox_puid;
+		ct->knox_ppid = attr->knox_ppid;
+		memcpy(ct->process_name, attr->process_name, sizeof(ct->process_name)-1);
+		memcpy(ct->parent_process_name, attr->parent_process_name, sizeof(ct->parent_process_name)-1);
+	} else {
+		ct->knox_puid = 0;
+		ct->knox_ppid = 0;
+		ct->process_name[0] = '\0';
+		ct->parent_process_name[0] = '\0';
+	}
+	memcpy(ct->domain_name, sk->domain_name, sizeof(ct->domain_name)-1);
+	if ( (skb->dev) ) {
+		memcpy(ct->interface_name, skb->dev->name, sizeof(ct->interface_name)-1);
+	} else {
+		sprintf(ct->interface_name, "%s", "null");
+	}
+}
+EXPORT_SYMBOL(knox_attach_flow_attr);
+
 /* The function is used to check if the caller is system server or not; */
 static int is_system_server(void) {
 	uid_t uid = current_uid().val;
@@ -200,29 +341,56 @@ static int is_system_server(void) {
 	return 0;
 }
 
-/* The function is used to intialize the kfifo */
-static void initialize_kfifo(void) {
-	INIT_KFIFO(knox_sock_info);
-	if (kfifo_initialized(&knox_sock_info)) {
-		NCM_LOGD("The kfifo for knox ncm has been initialized \n");
-		init_waitqueue_head(&ncm_wq);
+/* The function is used to allocate the per-cpu rings on first activation */
+static int ncm_alloc_rings(void) {
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ncm_ring *ring = per_cpu_ptr(&ncm_rings, cpu);
+
+		if (ring->slots)
+			continue;
+		ring->slots = vzalloc_node(NCM_RING_SIZE * sizeof(*ring->slots), cpu_to_node(cpu));
+		if (!ring->slots) {
+			NCM_LOGE("failed to allocate the ring of cpu %d \n", cpu);
+			return -ENOMEM;
+		}
 	}
+	return SUCCESS;
 }
 
-/* The function is used to create work queue */
-static void initialize_ncmworkqueue(void) {
-	if (!eWq) {
-		NCM_LOGD("ewq..Single Thread created\r\n");
-		eWq = create_workqueue("ncmworkqueue");
+/* The function is used to discard the records which were not read before deactivation */
+static void ncm_drain_rings(void) {
+	int cpu;
+
+	mutex_lock(&ncm_lock);
+	for_each_possible_cpu(cpu) {
+		struct ncm_ring *ring = per_cpu_ptr(&ncm_rings, cpu);
+
+		smp_store_release(&ring->tail, READ_ONCE(ring->head));
 	}
+	mutex_unlock(&ncm_lock);
 }
 
-/* The function is ued to free the kfifo */
-static void free_kfifo(void) {
-	if (kfifo_status()) {
-		NCM_LOGD("The kfifo for knox ncm which was intialized is freed \n");
-		kfifo_free(&knox_sock_info);
+static bool ncm_rings_empty(void) {
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ncm_ring *ring = per_cpu_ptr(&ncm_rings, cpu);
+
+		if (READ_ONCE(ring->head) != READ_ONCE(ring->tail))
+			return false;
 	}
+	return true;
+}
+
+static unsigned long ncm_dropped(void) {
+	unsigned long dropped = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		dropped += READ_ONCE(per_cpu_ptr(&ncm_rings, cpu)->dropped);
+	return dropped;
 }
 
 /* The function is used to update the flag indicating whether the feature has been enabled or not */
@@ -266,8 +434,6 @@ static unsigned int hook_func_ipv4_out_conntrack(void *priv, struct sk_buff *skb
 	struct nf_conn *ct = NULL;
 	enum ip_conntrack_info ctinfo;
 	struct nf_conntrack_tuple *tuple = NULL;
-	char srcaddr[INET6_ADDRSTRLEN_NAP];
-	char dstaddr[INET6_ADDRSTRLEN_NAP];
 
 	if ( (skb) && (skb->sk) ) {
 		if ( (skb->sk->knox_pid == INIT_PID_NAP) && (skb->sk->knox_uid == INIT_UID_NAP) && (skb->sk->sk_protocol == IPPROTO_TCP) ) {
@@ -278,9 +444,7 @@ static unsigned int hook_func_ipv4_out_conntrack(void *priv, struct sk_buff *skb
 			if ( (ct) && (!atomic_read(&ct->startFlow)) && (!nf_ct_is_dying(ct)) ) {
 				tuple = &ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple;
 				if (tuple) {
-					sprintf(srcaddr,"%pI4",(void *)&tuple->src.u3.ip);
-					sprintf(dstaddr,"%pI4",(void *)&tuple->dst.u3.ip);
-					if ( isIpv4AddressEqualsNull(srcaddr, dstaddr) ) {
+					if ( knox_ipv4_tuple_is_null(tuple) ) {
 						return NF_ACCEPT;
 					}
 				} else {
@@ -299,18 +463,7 @@ static unsigned int hook_func_ipv4_out_conntrack(void *priv, struct sk_buff *skb
 							}'
 					if struct nf_conn->timeout is of type struct timer_list; */
 				}
-				ct->knox_uid = skb->sk->knox_uid;
-				ct->knox_pid = skb->sk->knox_pid;
-				memcpy(ct->process_name,skb->sk->process_name,sizeof(ct->process_name)-1);
-				ct->knox_puid = skb->sk->knox_puid;
-				ct->knox_ppid = skb->sk->knox_ppid;
-				memcpy(ct->parent_process_name,skb->sk->parent_process_name,sizeof(ct->parent_process_name)-1);
-				memcpy(ct->domain_name,skb->sk->domain_name,sizeof(ct->domain_name)-1);
-				if ( (skb->dev) ) {
-					memcpy(ct->interface_name,skb->dev->name,sizeof(ct->interface_name)-1);
-				} else {
-					sprintf(ct->interface_name,"%s","null");
-				}
+				knox_attach_flow_attr(ct, skb->sk, skb);
 				ip_header = (struct iphdr *)skb_network_header(skb);
 				if ( (ip_header) && (ip_header->protocol == IPPROTO_UDP) ) {
 					udp_header = (struct udphdr *)skb_transport_header(skb);
@@ -382,8 +535,6 @@ static unsigned int hook_func_ipv6_out_conntrack(void *priv, struct sk_buff *skb
 	struct nf_conn *ct = NULL;
 	enum ip_conntrack_info ctinfo;
 	struct nf_conntrack_tuple *tuple = NULL;
-	char srcaddr[INET6_ADDRSTRLEN_NAP];
-	char dstaddr[INET6_ADDRSTRLEN_NAP];
 
 	if ( (skb) && (skb->sk) ) {
 		if ( (skb->sk->knox_pid == INIT_PID_NAP) && (skb->sk->knox_uid == INIT_UID_NAP) && (skb->sk->sk_protocol == IPPROTO_TCP) ) {
@@ -394,9 +545,7 @@ static unsigned int hook_func_ipv6_out_conntrack(void *priv, struct sk_buff *skb
 			if ( (ct) && (!atomic_read(&ct->startFlow)) && (!nf_ct_is_dying(ct)) ) {
 				tuple = &ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple;
 				if (tuple) {
-					sprintf(srcaddr,"%pI6",(void *)&tuple->src.u3.ip6);
-					sprintf(dstaddr,"%pI6",(void *)&tuple->dst.u3.ip6);
-					if ( isIpv6AddressEqualsNull(srcaddr, dstaddr) ) {
+					if ( knox_ipv6_tuple_is_null(tuple) ) {
 						return NF_ACCEPT;
 					}
 				} else {
@@ -415,18 +564,7 @@ static unsigned int hook_func_ipv6_out_conntrack(void *priv, struct sk_buff *skb
 							}'
 					if struct nf_conn->timeout is of type struct timer_list; */
 				}
-				ct->knox_uid = skb->sk->knox_uid;
-				ct->knox_pid = skb->sk->knox_pid;
-				memcpy(ct->process_name,skb->sk->process_name,sizeof(ct->process_name)-1);
-				ct->knox_puid = skb->sk->knox_puid;
-				ct->knox_ppid = skb->sk->knox_ppid;
-				memcpy(ct->parent_process_name,skb->sk->parent_process_name,sizeof(ct->parent_process_name)-1);
-				memcpy(ct->domain_name,skb->sk->domain_name,sizeof(ct->domain_name)-1);
-				if ( (skb->dev) ) {
-					memcpy(ct->interface_name,skb->dev->name,sizeof(ct->interface_name)-1);
-				} else {
-					sprintf(ct->interface_name,"%s","null");
-				}
+				knox_attach_flow_attr(ct, skb->sk, skb);
 				ipv6_header = (struct ipv6hdr *)skb_network_header(skb);
 				if ( (ipv6_header) && (ipv6_header->nexthdr == IPPROTO_UDP) ) {
 					udp_header = (struct udphdr *)skb_transport_header(skb);
@@ -617,14 +755,18 @@ static void unregisterNetFilterHooks(void) {
 /* Function to collect the conntrack meta-data information. This function is called from ncm.c during the flows first send data and nf_conntrack_core.c when flow is removed. */
 void knox_collect_conntrack_data(struct nf_conn *ct, int startStop, int where) {
 	if ( check_ncm_flag() && (ncm_activated_type == startStop || ncm_activated_type == NCM_FLOW_TYPE_ALL) ) {
-		struct knox_socket_metadata *ksm = kzalloc(sizeof(struct knox_socket_metadata), GFP_ATOMIC);
+		struct knox_user_socket_metadata *ksm;
 		struct nf_conntrack_tuple *tuple = NULL;
 		struct timespec close_timespec;
+		unsigned long flags;
 
+		local_irq_save(flags);
+		ksm = ncm_ring_reserve(this_cpu_ptr(&ncm_rings));
 		if (ksm == NULL) {
-			printk("kzalloc atomic memory allocation failed\n");
+			local_irq_restore(flags);
 			return;
 		}
+		memset(ksm, 0, sizeof(*ksm));
 
 		ksm->knox_uid = ct->knox_uid;
 		ksm->knox_pid = ct->knox_pid;
@@ -690,7 +832,9 @@ void knox_collect_conntrack_data(struct nf_conn *ct, int startStop, int where) {
 			ksm->flow_type = 0;
 		}
 
-		insert_data_kfifo_kthread(ksm);
+		ncm_ring_commit(this_cpu_ptr(&ncm_rings));
+		local_irq_restore(flags);
+		ncm_wake_reader();
 	}
 }
 EXPORT_SYMBOL(knox_collect_conntrack_data);
@@ -721,110 +865,54 @@ static int ncm_open(struct inode *inode, struct file *file) {
 	return SUCCESS;
 }
 
-#ifdef CONFIG_64BIT
-static ssize_t ncm_copy_data_user_64(char __user *buf, size_t count)
-{
-	struct knox_socket_metadata kcm = {0};
-	struct knox_user_socket_metadata user_copy = {0};
-
-	unsigned long copied;
-	int read = 0;
-
-	if (mutex_lock_interruptible(&ncm_lock)) {
-		NCM_LOGE("ncm_copy_data_user failed:Signal interuption \n");
-		return 0;
-	}
-	read = kfifo_out(&knox_sock_info, &kcm, 1);
-	mutex_unlock(&ncm_lock);
-	if (read == 0) {
-		return 0;
-	}
-
-	user_copy.srcport = kcm.srcport;
-	user_copy.dstport = kcm.dstport;
-	user_copy.trans_proto = kcm.trans_proto;
-	user_copy.knox_sent = kcm.knox_sent;
-	user_copy.knox_recv = kcm.knox_recv;
-	user_copy.knox_uid = kcm.knox_uid;
-	user_copy.knox_pid = kcm.knox_pid;
-	user_copy.knox_puid = kcm.knox_puid;
-	user_copy.open_time = kcm.open_time;
-	user_copy.close_time = kcm.close_time;
-	user_copy.knox_uid_dns = kcm.knox_uid_dns;
-	user_copy.knox_ppid = kcm.knox_ppid;
-	user_copy.flow_type = kcm.flow_type;
-
-	memcpy(user_copy.srcaddr, kcm.srcaddr, sizeof(user_copy.srcaddr));
-	memcpy(user_copy.dstaddr, kcm.dstaddr, sizeof(user_copy.dstaddr));
-
-	memcpy(user_copy.process_name, kcm.process_name, sizeof(user_copy.process_name));
-	memcpy(user_copy.parent_process_name, kcm.parent_process_name, sizeof(user_copy.parent_process_name));
-
-	memcpy(user_copy.domain_name, kcm.domain_name, sizeof(user_copy.domain_name)-1);
-
-	memcpy(user_copy.interface_name, kcm.interface_name, sizeof(user_copy.interface_name)-1);
-
-	copied = copy_to_user(buf, &user_copy, sizeof(struct knox_user_socket_metadata));
-	return count;
-}
-#else
+/** The function copies as many whole records as fit into the user buffer;
+ *  The rings are visited round robin starting after the cpu which was read last;
+ */
 static ssize_t ncm_copy_data_user(char __user *buf, size_t count)
 {
-	struct knox_socket_metadata *kcm = NULL;
-	struct knox_user_socket_metadata user_copy = {0};
+	const size_t rec = sizeof(struct knox_user_socket_metadata);
+	size_t copied = 0;
+	bool fault = false;
+	int cpu, i;
 
-	unsigned long copied;
-	int read = 0;
+	if (count < rec)
+		return -EINVAL;
 
 	if (mutex_lock_interruptible(&ncm_lock)) {
 		NCM_LOGE("ncm_copy_data_user failed:Signal interuption \n");
 		return 0;
 	}
 
-	kcm = kzalloc(sizeof (struct knox_socket_metadata), GFP_KERNEL);
-	if (kcm == NULL) {
-		mutex_unlock(&ncm_lock);
-		return 0;
+	cpu = ncm_next_cpu;
+	for (i = 0; i < nr_cpu_ids && !fault && count - copied >= rec; i++, cpu = (cpu + 1) % nr_cpu_ids) {
+		struct ncm_ring *ring;
+		unsigned int head, tail;
+
+		if (!cpu_possible(cpu))
+			continue;
+		ring = per_cpu_ptr(&ncm_rings, cpu);
+		if (!ring->slots)
+			continue;
+
+		tail = ring->tail;
+		head = smp_load_acquire(&ring->head);
+		while (tail != head && count - copied >= rec) {
+			if (copy_to_user(buf + copied, &ring->slots[tail & (NCM_RING_SIZE - 1)], rec)) {
+				fault = true;
+				break;
+			}
+			copied += rec;
+			tail++;
+		}
+		smp_store_release(&ring->tail, tail);
+		ncm_next_cpu = (cpu + 1) % nr_cpu_ids;
 	}
-
-	read = kfifo_out(&knox_sock_info, kcm, 1);
 	mutex_unlock(&ncm_lock);
-	if (read == 0) {
-		kfree(kcm);
-		return 0;
-	}
-
-	user_copy.srcport = kcm->srcport;
-	user_copy.dstport = kcm->dstport;
-	user_copy.trans_proto = kcm->trans_proto;
-	user_copy.knox_sent = kcm->knox_sent;
-	user_copy.knox_recv = kcm->knox_recv;
-	user_copy.knox_uid = kcm->knox_uid;
-	user_copy.knox_pid = kcm->knox_pid;
-	user_copy.knox_puid = kcm->knox_puid;
-	user_copy.open_time = kcm->open_time;
-	user_copy.close_time = kcm->close_time;
-	user_copy.knox_uid_dns = kcm->knox_uid_dns;
-	user_copy.knox_ppid = kcm->knox_ppid;
-	user_copy.flow_type = kcm->flow_type;
 
-	memcpy(user_copy.srcaddr, kcm->srcaddr, sizeof(user_copy.srcaddr));
-	memcpy(user_copy.dstaddr, kcm->dstaddr, sizeof(user_copy.dstaddr));
-
-	memcpy(user_copy.process_name, kcm->process_name, sizeof(user_copy.process_name));
-	memcpy(user_copy.parent_process_name, kcm->parent_process_name, sizeof(user_copy.parent_process_name));
-
-	memcpy(user_copy.domain_name, kcm->domain_name, sizeof(user_copy.domain_name)-1);
-
-	memcpy(user_copy.interface_name, kcm->interface_name, sizeof(user_copy.interface_name)-1);
-
-	copied = copy_to_user(buf, &user_copy, sizeof(struct knox_user_socket_metadata));
-
-	kfree(kcm);
-
-	return count;
+	if (!copied && fault)
+		return -EFAULT;
+	return copied;
 }
-#endif
 
 /* The function writes the socket meta-data to the user-space */
 static ssize_t ncm_read(struct file *file, char __user *buf, size_t count, loff_t *off) {
@@ -833,18 +921,7 @@ static ssize_t ncm_read(struct file *file, char __user *buf, size_t count, loff_
 		return -EACCES;
 	}
 
-	if (!eWq) {
-		NCM_LOGD("ewq..Single Thread created\r\n");
-		eWq = create_workqueue("ncmworkqueue");
-	}
-
-	#ifdef CONFIG_64BIT
-	return ncm_copy_data_user_64(buf, count);
-	#else
 	return ncm_copy_data_user(buf, count);
-	#endif
-
-	return 0;
 }
 
 static ssize_t ncm_write(struct file *file, const char __user *buf, size_t count, loff_t *off) {
@@ -879,8 +956,9 @@ static int ncm_close(struct inode *inode, struct file *file) {
 		return SUCCESS;
 	}
 	update_ncm_flag(ncm_deactivated_flag);
-	free_kfifo();
 	unregisterNetFilterHooks();
+	ncm_drain_rings();
+	knox_flush_attr_cache();
 	return SUCCESS;
 }
 
@@ -895,9 +973,9 @@ static long ncm_ioctl_evt(struct file *file, unsigned int cmd, unsigned long arg
 		NCM_LOGD("ncm_ioctl_evt is being NCM_ACTIVATED with the ioctl command %u \n", cmd);
 		if (check_ncm_flag())
 			return SUCCESS;
+		if (ncm_alloc_rings())
+			return -ENOMEM;
 		registerNetfilterHooks();
-		initialize_kfifo();
-		initialize_ncmworkqueue();
 		update_ncm_flag(ncm_activated_flag);
 		update_ncm_flow_type(NCM_FLOW_TYPE_ALL);
 		break;
@@ -906,11 +984,11 @@ static long ncm_ioctl_evt(struct file *file, unsigned int cmd, unsigned long arg
 		NCM_LOGD("ncm_ioctl_evt is being NCM_ACTIVATED with the ioctl command %u \n", cmd);
 		if (check_ncm_flag())
 			return SUCCESS;
+		if (ncm_alloc_rings())
+			return -ENOMEM;
 		update_intermediate_timeout(0);
 		update_intermediate_flag(intermediate_deactivated_flag);
 		registerNetfilterHooks();
-		initialize_kfifo();
-		initialize_ncmworkqueue();
 		update_ncm_flag(ncm_activated_flag);
 		update_ncm_flow_type(NCM_FLOW_TYPE_OPEN);
 		break;
@@ -919,11 +997,11 @@ static long ncm_ioctl_evt(struct file *file, unsigned int cmd, unsigned long arg
 		NCM_LOGD("ncm_ioctl_evt is being NCM_ACTIVATED with the ioctl command %u \n", cmd);
 		if (check_ncm_flag())
 			return SUCCESS;
+		if (ncm_alloc_rings())
+			return -ENOMEM;
 		update_intermediate_timeout(0);
 		update_intermediate_flag(intermediate_deactivated_flag);
 		registerNetfilterHooks();
-		initialize_kfifo();
-		initialize_ncmworkqueue();
 		update_ncm_flag(ncm_activated_flag);
 		update_ncm_flow_type(NCM_FLOW_TYPE_CLOSE);
 		break;
@@ -935,8 +1013,9 @@ static long ncm_ioctl_evt(struct file *file, unsigned int cmd, unsigned long arg
 		update_intermediate_flag(intermediate_deactivated_flag);
 		update_ncm_flow_type(NCM_FLOW_TYPE_DEFAULT);
 		update_ncm_flag(ncm_deactivated_flag);
-		free_kfifo();
 		unregisterNetFilterHooks();
+		ncm_drain_rings();
+		knox_flush_attr_cache();
 		update_intermediate_timeout(0);
 		break;
 	}
@@ -950,6 +1029,10 @@ static long ncm_ioctl_evt(struct file *file, unsigned int cmd, unsigned long arg
 		return sizeof(struct knox_user_socket_metadata);
 		break;
 	}
+	case NCM_GETDROPPED: {
+		return min_t(unsigned long, ncm_dropped(), INT_MAX);
+		break;
+	}
 	default:
 		break;
 	}
@@ -959,8 +1042,8 @@ static long ncm_ioctl_evt(struct file *file, unsigned int cmd, unsigned long arg
 static unsigned int ncm_poll(struct file *file, poll_table *pt) {
 	int mask = 0;
 	int ret = 0;
-	if (kfifo_is_empty(&knox_sock_info)) {
-		ret = wait_event_interruptible_timeout(ncm_wq, !kfifo_is_empty(&knox_sock_info), msecs_to_jiffies(WAIT_TIMEOUT));
+	if (ncm_rings_empty()) {
+		ret = wait_event_interruptible_timeout(ncm_wq, !ncm_rings_empty(), msecs_to_jiffies(WAIT_TIMEOUT));
 		switch (ret) {
 		case -ERESTARTSYS:
 			mask = -EINTR;
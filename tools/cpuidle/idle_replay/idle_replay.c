@@ -0,0 +1,287 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * idle_replay.c
+ *
+ * Replays recorded idle periods of a cpu through the cpuidle governors on
+ * the host, to compare their choices without a device. The governors are
+ * built from drivers/cpuidle/governors with a minimal kernel environment
+ * in include/.
+ *
+ * The trace is read from stdin, one idle period per line:
+ *
+ *	<entry time us> <sleep length us> <idle us>
+ *
+ * where the sleep length is the time till the next timer event at the
+ * idle entry, as tick_nohz_get_sleep_length() returns it, and the idle
+ * time is how long the cpu stayed idle before it was woken up by a timer,
+ * an interrupt or an IPI. Lines starting with '#' are ignored.
+ *
+ * Every governor is driven with the same periods. If the governor keeps
+ * the tick, the cpu is woken up by it on the next tick boundary and the
+ * governor selects again for the rest of the period. A selection is wrong
+ * if the state differs from the deepest one whose target residency fits
+ * in the time the cpu then stayed in it. It is a miss if the state is
+ * deeper than that, i.e. the entry did not pay off, and it is shallow if
+ * the cpu could have used a deeper state.
+ *
+ * Usage: idle_replay [-z <HZ>] [-s <exit latency us>:<target residency us>]...
+ *		      [-v] < trace
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/cpuidle.h>
+
+#define MAX_GOVERNORS	4
+
+struct period {
+	s64 time;
+	unsigned int sleep_length;
+	unsigned int idle;
+};
+
+struct result {
+	unsigned long entries;
+	unsigned long wrong;
+	unsigned long misses;
+	unsigned long shallow;
+	unsigned long tick_wakeups;
+	unsigned long state_entries[CPUIDLE_STATE_MAX];
+	unsigned long state_misses[CPUIDLE_STATE_MAX];
+};
+
+struct idle_replay_clock replay_clock;
+DEFINE_PER_CPU(struct cpuidle_info, cpuidle_inf);
+
+static struct cpuidle_governor *governors[MAX_GOVERNORS];
+static int nr_governors;
+
+int cpuidle_register_governor(struct cpuidle_governor *gov)
+{
+	if (nr_governors >= MAX_GOVERNORS)
+		return -ENOSPC;
+
+	governors[nr_governors++] = gov;
+	return 0;
+}
+
+/* the state of an exynos cpu: WFI and C2, overridden with -s */
+static struct cpuidle_driver replay_driver = {
+	.name = "idle_replay",
+	.states = {
+		{ .name = "WFI", .exit_latency = 1, .target_residency = 1 },
+		{ .name = "C2", .exit_latency = 100, .target_residency = 2000 },
+	},
+	.state_count = 2,
+};
+
+static struct period *read_trace(int *nr)
+{
+	struct period *p = NULL;
+	char line[256];
+	int n = 0, size = 0;
+
+	while (fgets(line, sizeof(line), stdin)) {
+		long long time;
+		unsigned int sleep_length, idle;
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (sscanf(line, "%lld %u %u", &time, &sleep_length, &idle) != 3) {
+			fprintf(stderr, "bad trace line: %s", line);
+			continue;
+		}
+
+		if (n == size) {
+			size = size ? 2 * size : 1024;
+			p = realloc(p, size * sizeof(*p));
+			if (!p) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+
+		p[n].time = time;
+		p[n].sleep_length = sleep_length;
+		/* nothing wakes the cpu up later than the next timer */
+		p[n].idle = idle < sleep_length ? idle : sleep_length;
+		n++;
+	}
+
+	*nr = n;
+	return p;
+}
+
+/* the deepest state whose target residency fits in @span_us */
+static int ideal_state(struct cpuidle_driver *drv, unsigned int span_us)
+{
+	int i, idx = 0;
+
+	for (i = 1; i < drv->state_count; i++) {
+		if (drv->states[i].target_residency > span_us)
+			break;
+		idx = i;
+	}
+
+	return idx;
+}
+
+static void replay(struct cpuidle_governor *gov, struct cpuidle_driver *drv,
+		   const struct period *p, int nr, struct result *res,
+		   bool verbose)
+{
+	struct cpuidle_device dev;
+	s64 tick_ns = (s64)replay_clock.tick_usec * 1000;
+	int i;
+
+	memset(&dev, 0, sizeof(dev));
+	memset(res, 0, sizeof(*res));
+	gov->enable(drv, &dev);
+
+	for (i = 0; i < nr; i++) {
+		s64 now = p[i].time * 1000;
+		s64 sleep_length = (s64)p[i].sleep_length * 1000;
+		s64 remaining = (s64)p[i].idle * 1000;
+
+		do {
+			s64 tick_next = tick_ns - now % tick_ns;
+			s64 span = remaining;
+			bool stop_tick = true;
+			int idx, ideal;
+
+			replay_clock.now = now;
+			replay_clock.sleep_length = sleep_length;
+			replay_clock.delta_next = min(sleep_length, tick_next);
+
+			idx = gov->select(drv, &dev, &stop_tick);
+
+			replay_clock.got_tick = !stop_tick && tick_next < remaining;
+			if (replay_clock.got_tick) {
+				span = tick_next;
+				res->tick_wakeups++;
+			}
+
+			now += span;
+			replay_clock.now = now;
+			dev.last_residency = span / 1000;
+			gov->reflect(&dev, idx);
+
+			ideal = ideal_state(drv, span / 1000);
+			res->entries++;
+			res->state_entries[idx]++;
+			if (idx != ideal)
+				res->wrong++;
+			if (idx > ideal) {
+				res->misses++;
+				res->state_misses[idx]++;
+			} else if (idx < ideal) {
+				res->shallow++;
+			}
+
+			if (verbose)
+				printf("%s %lld: sleep %lld idle %lld state %d ideal %d%s\n",
+				       gov->name, (long long)(now - span) / 1000,
+				       (long long)sleep_length / 1000,
+				       (long long)span / 1000, idx, ideal,
+				       replay_clock.got_tick ? " tick" : "");
+
+			remaining -= span;
+			sleep_length -= span;
+		} while (remaining > 0);
+	}
+
+	if (gov->disable)
+		gov->disable(drv, &dev);
+}
+
+static double percent(unsigned long n, unsigned long total)
+{
+	return total ? 100.0 * n / total : 0.0;
+}
+
+static void report(struct cpuidle_governor *gov, struct cpuidle_driver *drv,
+		   const struct result *res)
+{
+	int i;
+
+	printf("%-6s entries %lu wrong %.1f%% miss %.1f%% shallow %.1f%% tick wakeups %lu\n",
+	       gov->name, res->entries, percent(res->wrong, res->entries),
+	       percent(res->misses, res->entries),
+	       percent(res->shallow, res->entries), res->tick_wakeups);
+
+	for (i = 0; i < drv->state_count; i++)
+		printf("       %-6s entries %lu miss %.1f%%\n", drv->states[i].name,
+		       res->state_entries[i],
+		       percent(res->state_misses[i], res->state_entries[i]));
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-z <HZ>] [-s <exit latency us>:<target residency us>]... [-v] < trace\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	struct cpuidle_driver *drv = &replay_driver;
+	struct period *p;
+	struct result res;
+	unsigned int hz = 250;
+	bool verbose = false;
+	int opt, nr, nr_states = 0, i;
+
+	while ((opt = getopt(argc, argv, "z:s:v")) != -1) {
+		switch (opt) {
+		case 'z':
+			hz = strtoul(optarg, NULL, 0);
+			break;
+		case 's': {
+			struct cpuidle_state *s;
+
+			if (nr_states >= CPUIDLE_STATE_MAX)
+				usage(argv[0]);
+
+			s = &drv->states[nr_states];
+			memset(s, 0, sizeof(*s));
+			if (sscanf(optarg, "%u:%u", &s->exit_latency,
+				   &s->target_residency) != 2)
+				usage(argv[0]);
+			snprintf(s->name, sizeof(s->name), "C%d", ++nr_states);
+			break;
+		}
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!hz)
+		usage(argv[0]);
+	replay_clock.tick_usec = (1000000 + hz / 2) / hz;
+
+	if (nr_states)
+		drv->state_count = nr_states;
+
+	p = read_trace(&nr);
+	if (!nr) {
+		fprintf(stderr, "empty trace\n");
+		return 1;
+	}
+
+	for (i = 0; i < nr_governors; i++) {
+		replay(governors[i], drv, p, nr, &res, verbose);
+		report(governors[i], drv, &res);
+	}
+
+	free(p);
+	return 0;
+}
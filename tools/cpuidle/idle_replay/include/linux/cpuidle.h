@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * The parts of include/linux/cpuidle.h used by the governors.
+ */
+#ifndef _IDLE_REPLAY_CPUIDLE_H
+#define _IDLE_REPLAY_CPUIDLE_H
+
+#include <linux/kernel.h>
+
+#define CPUIDLE_STATE_MAX	10
+#define CPUIDLE_NAME_LEN	16
+
+#define CPUIDLE_FLAG_POLLING	(0x01)
+
+struct cpuidle_state {
+	char		name[CPUIDLE_NAME_LEN];
+	unsigned int	flags;
+	unsigned int	exit_latency; /* in US */
+	unsigned int	target_residency; /* in US */
+	bool		disabled;
+};
+
+struct cpuidle_state_usage {
+	unsigned long long	disable;
+};
+
+struct cpuidle_device {
+	unsigned int		cpu;
+	int			last_residency;
+	struct cpuidle_state_usage	states_usage[CPUIDLE_STATE_MAX];
+};
+
+struct cpuidle_driver {
+	const char		*name;
+	struct cpuidle_state	states[CPUIDLE_STATE_MAX];
+	int			state_count;
+};
+
+struct cpuidle_info {
+	unsigned int	predicted_us;
+	unsigned int	latency_req;
+	int		bfirst_idx;
+	int		bUse_GovDecision;
+};
+
+struct cpuidle_governor {
+	char		name[CPUIDLE_NAME_LEN];
+	unsigned int	rating;
+	int  (*enable)		(struct cpuidle_driver *drv,
+				 struct cpuidle_device *dev);
+	void (*disable)		(struct cpuidle_driver *drv,
+				 struct cpuidle_device *dev);
+	int  (*select)		(struct cpuidle_driver *drv,
+				 struct cpuidle_device *dev,
+				 bool *stop_tick);
+	void (*reflect)		(struct cpuidle_device *dev, int index);
+};
+
+static inline int cpuidle_get_last_residency(struct cpuidle_device *dev)
+{
+	return dev->last_residency;
+}
+
+extern int cpuidle_register_governor(struct cpuidle_governor *gov);
+extern ktime_t cpuidle_predicted_wakeup(int cpu);
+
+#endif /* _IDLE_REPLAY_CPUIDLE_H */
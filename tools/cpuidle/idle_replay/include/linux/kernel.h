@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Minimal kernel environment for building the cpuidle governors on the
+ * host. There is one cpu, time is driven by the replay and the tick is
+ * never stopped before the governor decides to.
+ */
+#ifndef _IDLE_REPLAY_KERNEL_H
+#define _IDLE_REPLAY_KERNEL_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint64_t u64;
+typedef uint32_t u32;
+typedef int64_t s64;
+typedef s64 ktime_t;
+
+#define U64_MAX		UINT64_MAX
+#define KTIME_MAX	INT64_MAX
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+#define __init
+
+#define READ_ONCE(x)		(x)
+#define WRITE_ONCE(x, val)	((x) = (val))
+
+#define min(x, y) ({ __typeof__(x) _x = (x); __typeof__(y) _y = (y); \
+		     _x < _y ? _x : _y; })
+#define max(x, y) ({ __typeof__(x) _x = (x); __typeof__(y) _y = (y); \
+		     _x > _y ? _x : _y; })
+#define min_t(type, x, y) ({ type _x = (x); type _y = (y); \
+			     _x < _y ? _x : _y; })
+#define max_t(type, x, y) ({ type _x = (x); type _y = (y); \
+			     _x > _y ? _x : _y; })
+
+#define DIV_ROUND_CLOSEST_ULL(x, d) \
+	({ unsigned long long _d = (d); ((unsigned long long)(x) + _d / 2) / _d; })
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+#define do_div(n, base) ({ u32 __rem = (n) % (base); (n) /= (base); __rem; })
+
+/* per-cpu data of the only cpu */
+#define DEFINE_PER_CPU(type, name)	__typeof__(type) name
+#define DECLARE_PER_CPU(type, name)	extern __typeof__(type) name
+#define per_cpu(var, cpu)		(var)
+#define per_cpu_ptr(ptr, cpu)		(ptr)
+#define this_cpu_ptr(ptr)		(ptr)
+#define for_each_possible_cpu(cpu)	for ((cpu) = 0; (cpu) < 1; (cpu)++)
+
+/* governors are registered from constructors before main() */
+#define postcore_initcall(fn) \
+	static void __attribute__((constructor)) __initcall_##fn(void) \
+	{ fn(); }
+
+/* state of the replay, see idle_replay.c */
+struct idle_replay_clock {
+	ktime_t now;
+	ktime_t sleep_length;
+	ktime_t delta_next;
+	unsigned int tick_usec;
+	bool got_tick;
+};
+
+extern struct idle_replay_clock replay_clock;
+
+#define TICK_USEC	(replay_clock.tick_usec)
+
+static inline ktime_t ktime_get(void)
+{
+	return replay_clock.now;
+}
+
+static inline s64 ktime_to_us(ktime_t kt)
+{
+	return kt / 1000;
+}
+
+static inline ktime_t ktime_add_us(ktime_t kt, u64 usec)
+{
+	return kt + usec * 1000;
+}
+
+static inline ktime_t ktime_sub(ktime_t a, ktime_t b)
+{
+	return a - b;
+}
+
+static inline ktime_t tick_nohz_get_sleep_length(ktime_t *delta_next)
+{
+	*delta_next = replay_clock.delta_next;
+	return replay_clock.sleep_length;
+}
+
+/* a wakeup always restarts the tick in the replay */
+static inline bool tick_nohz_tick_stopped(void)
+{
+	return false;
+}
+
+static inline bool tick_nohz_idle_got_tick(void)
+{
+	return replay_clock.got_tick;
+}
+
+static inline void get_iowait_load(unsigned long *nr_waiters,
+				   unsigned long *load)
+{
+	*nr_waiters = 0;
+	*load = 0;
+}
+
+#define PM_QOS_CPU_DMA_LATENCY	1
+#define PM_QOS_DEFAULT_VALUE	(2000 * 1000 * 1000)
+
+static inline int pm_qos_request(int pm_qos_class)
+{
+	return PM_QOS_DEFAULT_VALUE;
+}
+
+struct device;
+
+static inline struct device *get_cpu_device(unsigned int cpu)
+{
+	return NULL;
+}
+
+static inline int dev_pm_qos_raw_read_value(struct device *dev)
+{
+	return 0;
+}
+
+#endif /* _IDLE_REPLAY_KERNEL_H */
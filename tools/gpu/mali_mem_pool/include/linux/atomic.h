@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _MEM_POOL_TEST_ATOMIC_H
+#define _MEM_POOL_TEST_ATOMIC_H
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+typedef struct {
+	long counter;
+} atomic_long_t;
+
+#define atomic_read(v)			((v)->counter)
+#define atomic_set(v, i)		((v)->counter = (i))
+#define atomic_add(i, v)		((v)->counter += (i))
+#define atomic_xchg(v, new) \
+	({ int _old = (v)->counter; (v)->counter = (new); _old; })
+
+#define atomic_long_read(v)		((v)->counter)
+#define atomic_long_set(v, i)		((v)->counter = (i))
+#define atomic_long_add(i, v)		((v)->counter += (i))
+#define atomic_long_inc(v)		((v)->counter++)
+
+#endif
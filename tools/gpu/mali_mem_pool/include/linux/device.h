@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _MEM_POOL_TEST_DEVICE_H
+#define _MEM_POOL_TEST_DEVICE_H
+
+#include <linux/kernel.h>
+
+struct device {
+	const char *name;
+};
+
+/* not printed, but the format is still checked */
+#define dev_dbg(dev, fmt, ...) do {					\
+	if (0)								\
+		fprintf(stderr, fmt, ##__VA_ARGS__);			\
+} while (0)
+
+#define dev_warn(dev, fmt, ...) \
+	fprintf(stderr, "%s: " fmt, (dev)->name, ##__VA_ARGS__)
+
+#endif
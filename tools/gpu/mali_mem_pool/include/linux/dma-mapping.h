@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * The device sees the physical address of a page, and needs no cache
+ * maintenance.
+ */
+#ifndef _MEM_POOL_TEST_DMA_MAPPING_H
+#define _MEM_POOL_TEST_DMA_MAPPING_H
+
+#include <linux/device.h>
+#include <linux/mm.h>
+
+enum dma_data_direction {
+	DMA_BIDIRECTIONAL = 0,
+};
+
+static inline dma_addr_t dma_map_page(struct device *dev, struct page *page,
+				      size_t offset, size_t size,
+				      enum dma_data_direction dir)
+{
+	return page_to_phys(page) + offset;
+}
+
+static inline int dma_mapping_error(struct device *dev, dma_addr_t dma_addr)
+{
+	return 0;
+}
+
+static inline void dma_unmap_page(struct device *dev, dma_addr_t dma_addr,
+				  size_t size, enum dma_data_direction dir)
+{
+}
+
+static inline void dma_sync_single_for_device(struct device *dev,
+					      dma_addr_t dma_addr, size_t size,
+					      enum dma_data_direction dir)
+{
+}
+
+#endif
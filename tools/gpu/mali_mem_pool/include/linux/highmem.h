@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _MEM_POOL_TEST_HIGHMEM_H
+#define _MEM_POOL_TEST_HIGHMEM_H
+
+#include <linux/mm.h>
+
+/* the fake pages have no memory behind them */
+static inline void clear_highpage(struct page *page)
+{
+}
+
+#endif
@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * jiffies is defined by the test, which moves it forward by hand.
+ */
+#ifndef _MEM_POOL_TEST_JIFFIES_H
+#define _MEM_POOL_TEST_JIFFIES_H
+
+#include <linux/kernel.h>
+
+#define HZ	250
+
+extern unsigned long jiffies;
+
+#define time_before(a, b)	((long)((a) - (b)) < 0)
+
+static inline unsigned long msecs_to_jiffies(unsigned int m)
+{
+	return DIV_ROUND_UP(m * HZ, 1000);
+}
+
+#endif
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Minimal kernel environment for building the kbase memory pools on the host.
+ */
+#ifndef _MEM_POOL_TEST_KERNEL_H
+#define _MEM_POOL_TEST_KERNEL_H
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/types.h>
+
+#define READ_ONCE(x)		(x)
+#define WRITE_ONCE(x, val)	((x) = (val))
+
+#define unlikely(x)		(x)
+
+#define min(x, y) ({ typeof(x) _x = (x); typeof(y) _y = (y); _x < _y ? _x : _y; })
+#define max(x, y) ({ typeof(x) _x = (x); typeof(y) _y = (y); _x > _y ? _x : _y; })
+
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define ALIGN(x, a)		(((x) + (a) - 1) & ~((typeof(x))(a) - 1))
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define WARN_ON(cond) ({						\
+	int _c = !!(cond);						\
+	if (_c)								\
+		fprintf(stderr, "WARNING at %s:%d\n", __FILE__, __LINE__); \
+	_c;								\
+})
+
+#endif
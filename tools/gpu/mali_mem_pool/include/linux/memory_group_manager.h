@@ -0,0 +1,3 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* the interface of the tree, the test provides a stub manager */
+#include "../../../../../include/linux/memory_group_manager.h"
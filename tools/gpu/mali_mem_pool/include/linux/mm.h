@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * A struct page is its own physical address, so that the pages the stub
+ * memory group manager allocates can be tagged and looked up again.
+ */
+#ifndef _MEM_POOL_TEST_MM_H
+#define _MEM_POOL_TEST_MM_H
+
+#include <linux/kernel.h>
+#include <linux/list.h>
+
+#define PAGE_SHIFT	12
+#define PAGE_SIZE	(1UL << PAGE_SHIFT)
+#define PAGE_MASK	(~(PAGE_SIZE - 1))
+
+#define PG_private	(1UL << 0)
+
+struct page {
+	unsigned long flags;
+	unsigned long private;
+	struct list_head lru;
+};
+
+#define page_private(page)		((page)->private)
+#define set_page_private(page, v)	((page)->private = (v))
+#define SetPagePrivate(page)		((page)->flags |= PG_private)
+#define ClearPagePrivate(page)		((page)->flags &= ~PG_private)
+
+#define page_to_phys(page)	((phys_addr_t)(uintptr_t)(page))
+#define phys_to_page(phys)	((struct page *)(uintptr_t)(phys))
+
+#define __GFP_HIGHMEM		0x02u
+#define __GFP_IO		0x40u
+#define __GFP_FS		0x80u
+#define __GFP_NOWARN		0x200u
+#define __GFP_ZERO		0x8000u
+#define __GFP_HARDWALL		0x100000u
+#define __GFP_DIRECT_RECLAIM	0x400000u
+#define __GFP_KSWAPD_RECLAIM	0x2000000u
+#define __GFP_RECLAIM		(__GFP_DIRECT_RECLAIM | __GFP_KSWAPD_RECLAIM)
+
+#define GFP_USER	(__GFP_RECLAIM | __GFP_IO | __GFP_FS | __GFP_HARDWALL)
+#define GFP_HIGHUSER	(GFP_USER | __GFP_HIGHMEM)
+
+typedef struct {
+	unsigned long pgprot;
+} pgprot_t;
+
+struct vm_area_struct;
+struct module;
+struct dma_buf;
+
+#endif
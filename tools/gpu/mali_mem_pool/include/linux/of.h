@@ -0,0 +1,5 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _MEM_POOL_TEST_OF_H
+#define _MEM_POOL_TEST_OF_H
+
+#endif
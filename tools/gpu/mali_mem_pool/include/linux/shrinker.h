@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _MEM_POOL_TEST_SHRINKER_H
+#define _MEM_POOL_TEST_SHRINKER_H
+
+#include <linux/types.h>
+
+struct shrink_control {
+	gfp_t gfp_mask;
+	unsigned long nr_to_scan;
+};
+
+struct shrinker {
+	unsigned long (*count_objects)(struct shrinker *,
+				       struct shrink_control *sc);
+	unsigned long (*scan_objects)(struct shrinker *,
+				      struct shrink_control *sc);
+	int seeks;
+	long batch;
+};
+
+#define DEFAULT_SEEKS	2
+
+/* the test calls the shrinker itself */
+static inline int register_shrinker(struct shrinker *shrinker)
+{
+	return 0;
+}
+
+static inline void unregister_shrinker(struct shrinker *shrinker)
+{
+}
+
+#endif
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Delayed work is only marked pending, the test runs it when it wants to.
+ */
+#ifndef _MEM_POOL_TEST_WORKQUEUE_H
+#define _MEM_POOL_TEST_WORKQUEUE_H
+
+#include <linux/jiffies.h>
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	work_func_t func;
+};
+
+struct delayed_work {
+	struct work_struct work;
+	bool pending;
+	unsigned long delay;
+};
+
+struct workqueue_struct;
+
+#define system_freezable_power_efficient_wq	((struct workqueue_struct *)NULL)
+
+static inline void INIT_DELAYED_WORK(struct delayed_work *dwork,
+				     work_func_t func)
+{
+	dwork->work.func = func;
+	dwork->pending = false;
+	dwork->delay = 0;
+}
+
+static inline bool queue_delayed_work(struct workqueue_struct *wq,
+				      struct delayed_work *dwork,
+				      unsigned long delay)
+{
+	if (dwork->pending)
+		return false;
+
+	dwork->pending = true;
+	dwork->delay = delay;
+	return true;
+}
+
+static inline bool cancel_delayed_work_sync(struct delayed_work *dwork)
+{
+	bool pending = dwork->pending;
+
+	dwork->pending = false;
+	return pending;
+}
+
+#endif
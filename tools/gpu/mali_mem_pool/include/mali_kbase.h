@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Minimal kbase environment for building mali_kbase_mem_pool.c on the host.
+ * The pool structures are those of mali_kbase_defs.h, and the helpers those
+ * of mali_kbase_mem.h, which cannot be built without the rest of the driver.
+ * kbase_mem_pool_warm_target() is taken from mali_kbase_mem.h by the
+ * Makefile, as it is what the test checks.
+ */
+#ifndef _KBASE_H_
+#define _KBASE_H_
+
+#include <linux/atomic.h>
+#include <linux/device.h>
+#include <linux/list.h>
+#include <linux/memory_group_manager.h>
+#include <linux/mm.h>
+#include <linux/shrinker.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#include <mali_kbase_mem_lowlevel.h>
+
+#include "mali_kbase_mem_warm.h"
+
+#define KBASE_EXPORT_TEST_API(func)
+
+#define KBASE_MEM_POOL_2MB_PAGE_TABLE_ORDER	9
+#define KBASE_MEM_POOL_4KB_PAGE_TABLE_ORDER	0
+
+struct kbase_mem_pool {
+	struct kbase_device *kbdev;
+	size_t              cur_size;
+	size_t              max_size;
+	u8                  order;
+	u8                  group_id;
+	spinlock_t          pool_lock;
+	struct list_head    page_list;
+	struct shrinker     reclaim;
+
+	struct kbase_mem_pool *next_pool;
+
+	bool dying;
+	bool dont_reclaim;
+
+	size_t warm_target;
+	unsigned long last_reclaim;
+	atomic_t nr_missed;
+	atomic_long_t nr_kernel;
+	atomic_long_t nr_warmed;
+	atomic_long_t nr_hits;
+};
+
+struct kbase_mem_pool_group {
+	struct kbase_mem_pool small[MEMORY_GROUP_MANAGER_NR_GROUPS];
+	struct kbase_mem_pool large[MEMORY_GROUP_MANAGER_NR_GROUPS];
+};
+
+struct kbase_mem_pool_config {
+	size_t max_size;
+};
+
+struct kbase_device {
+	struct device *dev;
+	struct memory_group_manager_device *mgm_dev;
+	struct kbase_mem_pool_group mem_pools;
+	struct delayed_work mem_pool_warm_work;
+};
+
+static inline size_t kbase_mem_pool_config_get_max_size(
+	const struct kbase_mem_pool_config *const config)
+{
+	return READ_ONCE(config->max_size);
+}
+
+static inline size_t kbase_mem_pool_size(struct kbase_mem_pool *pool)
+{
+	return READ_ONCE(pool->cur_size);
+}
+
+static inline size_t kbase_mem_pool_max_size(struct kbase_mem_pool *pool)
+{
+	return pool->max_size;
+}
+
+static inline void kbase_mem_pool_lock(struct kbase_mem_pool *pool)
+{
+	spin_lock(&pool->pool_lock);
+}
+
+static inline void kbase_mem_pool_unlock(struct kbase_mem_pool *pool)
+{
+	spin_unlock(&pool->pool_lock);
+}
+
+static inline void kbase_set_dma_addr(struct page *p, dma_addr_t dma_addr)
+{
+	SetPagePrivate(p);
+	set_page_private(p, dma_addr);
+}
+
+static inline dma_addr_t kbase_dma_addr(struct page *p)
+{
+	return (dma_addr_t)page_private(p);
+}
+
+static inline void kbase_clear_dma_addr(struct page *p)
+{
+	ClearPagePrivate(p);
+}
+
+struct page *kbase_mem_alloc_page(struct kbase_mem_pool *pool);
+int kbase_mem_pool_init(struct kbase_mem_pool *pool,
+		const struct kbase_mem_pool_config *config,
+		unsigned int order,
+		int group_id,
+		struct kbase_device *kbdev,
+		struct kbase_mem_pool *next_pool);
+void kbase_mem_pool_term(struct kbase_mem_pool *pool);
+struct page *kbase_mem_pool_alloc(struct kbase_mem_pool *pool);
+void kbase_mem_pool_free(struct kbase_mem_pool *pool, struct page *page,
+		bool dirty);
+int kbase_mem_pool_alloc_pages(struct kbase_mem_pool *pool, size_t nr_4k_pages,
+		struct tagged_addr *pages, bool partial_allowed);
+void kbase_mem_pool_free_pages(struct kbase_mem_pool *pool, size_t nr_pages,
+		struct tagged_addr *pages, bool dirty, bool reclaimed);
+int kbase_mem_pool_grow(struct kbase_mem_pool *pool, size_t nr_to_grow);
+void kbase_mem_pool_warm_init(struct kbase_device *kbdev);
+void kbase_mem_pool_warm_term(struct kbase_device *kbdev);
+
+#endif
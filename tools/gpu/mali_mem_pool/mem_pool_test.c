@@ -0,0 +1,302 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * mem_pool_test.c
+ *
+ * Unit test of the kbase memory pools on the host. mali_kbase_mem_pool.c is
+ * built with the minimal kernel environment in include/, against a stub
+ * memory group manager that hands out fake pages and counts them. The
+ * background warmer is run by hand, with a fake jiffies clock.
+ */
+
+#include "../../../drivers/gpu/arm/bv_r32p1/mali_kbase_mem_pool.c"
+
+unsigned long jiffies;
+
+static int failed;
+
+#define CHECK(cond) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: %s failed\n", __FILE__,		\
+			__LINE__, #cond);				\
+		failed++;						\
+	}								\
+} while (0)
+
+/* allocations left before the stub manager fails them, or -1 */
+static int mgm_fail_after = -1;
+static long mgm_nr_allocated;
+static long mgm_nr_freed;
+static gfp_t mgm_last_gfp;
+
+static struct page *stub_alloc_page(struct memory_group_manager_device *mgm_dev,
+				    int group_id, gfp_t gfp_mask,
+				    unsigned int order)
+{
+	size_t size = ALIGN(sizeof(struct page) << order, PAGE_SIZE);
+	struct page *p;
+
+	mgm_last_gfp = gfp_mask;
+	if (mgm_fail_after == 0)
+		return NULL;
+	if (mgm_fail_after > 0)
+		mgm_fail_after--;
+
+	/* aligned, as the page is its own physical address */
+	p = aligned_alloc(PAGE_SIZE, size);
+	if (!p)
+		return NULL;
+	memset(p, 0, size);
+	mgm_nr_allocated++;
+
+	return p;
+}
+
+static void stub_free_page(struct memory_group_manager_device *mgm_dev,
+			   int group_id, struct page *page, unsigned int order)
+{
+	free(page);
+	mgm_nr_freed++;
+}
+
+static struct device test_dev = { .name = "mali" };
+
+static struct memory_group_manager_device test_mgm_dev = {
+	.ops = {
+		.mgm_alloc_page = stub_alloc_page,
+		.mgm_free_page = stub_free_page,
+	},
+};
+
+static struct kbase_device test_kbdev = {
+	.dev = &test_dev,
+	.mgm_dev = &test_mgm_dev,
+};
+
+static void pool_init(struct kbase_mem_pool *pool, size_t max_size,
+		      unsigned int order, int group_id,
+		      struct kbase_mem_pool *next_pool)
+{
+	const struct kbase_mem_pool_config config = { .max_size = max_size };
+
+	CHECK(!kbase_mem_pool_init(pool, &config, order, group_id,
+				   &test_kbdev, next_pool));
+}
+
+static void device_init(void)
+{
+	int gid;
+
+	for (gid = 0; gid < MEMORY_GROUP_MANAGER_NR_GROUPS; gid++) {
+		pool_init(&test_kbdev.mem_pools.small[gid], 64,
+			  KBASE_MEM_POOL_4KB_PAGE_TABLE_ORDER, gid, NULL);
+		pool_init(&test_kbdev.mem_pools.large[gid], 0,
+			  KBASE_MEM_POOL_2MB_PAGE_TABLE_ORDER, gid, NULL);
+	}
+	kbase_mem_pool_warm_init(&test_kbdev);
+}
+
+static void device_term(void)
+{
+	int gid;
+
+	kbase_mem_pool_warm_term(&test_kbdev);
+	for (gid = 0; gid < MEMORY_GROUP_MANAGER_NR_GROUPS; gid++) {
+		kbase_mem_pool_term(&test_kbdev.mem_pools.small[gid]);
+		kbase_mem_pool_term(&test_kbdev.mem_pools.large[gid]);
+	}
+
+	/* every page went back to the manager */
+	CHECK(mgm_nr_allocated == mgm_nr_freed);
+}
+
+/* Runs the warmer as the workqueue would once its delay has expired */
+static bool run_warmer(void)
+{
+	struct delayed_work *dwork = &test_kbdev.mem_pool_warm_work;
+
+	if (!dwork->pending)
+		return false;
+
+	dwork->pending = false;
+	dwork->work.func(&dwork->work);
+
+	return true;
+}
+
+static void test_warm_target(void)
+{
+	size_t target = 1000;
+	int i;
+
+	/* a quarter is dropped every period, rounded up so 1 decays to 0 */
+	CHECK(kbase_mem_pool_warm_target(100, 0, 1024) == 75);
+	CHECK(kbase_mem_pool_warm_target(3, 0, 1024) == 2);
+	CHECK(kbase_mem_pool_warm_target(1, 0, 1024) == 0);
+	CHECK(kbase_mem_pool_warm_target(0, 0, 1024) == 0);
+
+	for (i = 0; i < 64 && target; i++)
+		target = kbase_mem_pool_warm_target(target, 0, 1024);
+	CHECK(target == 0);
+
+	/* covers twice the pages missed in the last period */
+	CHECK(kbase_mem_pool_warm_target(0, 10, 1024) == 20);
+	CHECK(kbase_mem_pool_warm_target(100, 30, 1024) == 75);
+	CHECK(kbase_mem_pool_warm_target(100, 50, 1024) == 100);
+	CHECK(kbase_mem_pool_warm_target(100, 60, 1024) == 120);
+
+	/* and never more than the pool can hold */
+	CHECK(kbase_mem_pool_warm_target(0, 1000, 512) == 512);
+	CHECK(kbase_mem_pool_warm_target(1024, 0, 512) == 512);
+	CHECK(kbase_mem_pool_warm_target(100, 10, 0) == 0);
+}
+
+static void test_warm_after_shrink(void)
+{
+	struct kbase_mem_pool *pool = &test_kbdev.mem_pools.small[0];
+	const unsigned long period =
+		msecs_to_jiffies(KBASE_MEM_POOL_WARM_PERIOD_MS);
+	struct shrink_control sc = { .nr_to_scan = 64 };
+	struct tagged_addr pages[4];
+	struct page *used[8];
+	long allocated;
+	int i;
+
+	jiffies = 1000;
+	device_init();
+
+	/* the pool allocates from the kernel, which kicks the warmer */
+	CHECK(!kbase_mem_pool_grow(pool, 8));
+	CHECK(atomic_long_read(&pool->nr_kernel) == 8);
+	CHECK(atomic_read(&pool->nr_missed) == 8);
+	CHECK(test_kbdev.mem_pool_warm_work.pending);
+	CHECK(test_kbdev.mem_pool_warm_work.delay == 0);
+
+	for (i = 0; i < 8; i++)
+		used[i] = kbase_mem_pool_alloc(pool);
+	CHECK(kbase_mem_pool_size(pool) == 0);
+
+	/* twice the misses, from free memory only */
+	CHECK(run_warmer());
+	CHECK(READ_ONCE(pool->warm_target) == 16);
+	CHECK(atomic_read(&pool->nr_missed) == 0);
+	CHECK(kbase_mem_pool_size(pool) == 16);
+	CHECK(atomic_long_read(&pool->nr_warmed) == 16);
+	CHECK(!(mgm_last_gfp & __GFP_RECLAIM));
+	CHECK(mgm_last_gfp & __GFP_ZERO);
+	/* it keeps running while there is a target */
+	CHECK(test_kbdev.mem_pool_warm_work.pending);
+	CHECK(test_kbdev.mem_pool_warm_work.delay == period);
+
+	/* the shrinker takes all of it back */
+	CHECK(pool->reclaim.scan_objects(&pool->reclaim, &sc) == 16);
+	CHECK(kbase_mem_pool_size(pool) == 0);
+
+	/* and the pool misses again */
+	CHECK(kbase_mem_pool_alloc_pages(pool, 4, pages, false) == 4);
+	CHECK(atomic_read(&pool->nr_missed) == 4);
+
+	/* the target adapts, but nothing is refilled within the period */
+	jiffies += period - 1;
+	allocated = mgm_nr_allocated;
+	CHECK(run_warmer());
+	CHECK(READ_ONCE(pool->warm_target) == 12);
+	CHECK(kbase_mem_pool_size(pool) == 0);
+	CHECK(mgm_nr_allocated == allocated);
+	CHECK(atomic_long_read(&pool->nr_warmed) == 16);
+	CHECK(test_kbdev.mem_pool_warm_work.pending);
+
+	/* the period after the shrink is over */
+	jiffies += 1;
+	CHECK(run_warmer());
+	CHECK(READ_ONCE(pool->warm_target) == 9);
+	CHECK(kbase_mem_pool_size(pool) == 9);
+	CHECK(atomic_long_read(&pool->nr_warmed) == 25);
+
+	/* without misses the target decays and the warmer stops */
+	for (i = 0; i < 64 && run_warmer(); i++)
+		jiffies += period;
+	CHECK(READ_ONCE(pool->warm_target) == 0);
+	CHECK(!test_kbdev.mem_pool_warm_work.pending);
+	CHECK(kbase_mem_pool_size(pool) == 9);
+
+	kbase_mem_pool_free_pages(pool, 4, pages, false, false);
+	for (i = 0; i < 8; i++)
+		kbase_mem_pool_free(pool, used[i], false);
+
+	device_term();
+}
+
+static void test_grow_from_next(void)
+{
+	struct kbase_mem_pool *dev_pool = &test_kbdev.mem_pools.small[1];
+	struct kbase_mem_pool ctx_pool;
+	long allocated;
+
+	device_init();
+	pool_init(&ctx_pool, 64, KBASE_MEM_POOL_4KB_PAGE_TABLE_ORDER, 1,
+		  dev_pool);
+
+	CHECK(!kbase_mem_pool_grow(dev_pool, 4));
+	atomic_long_set(&dev_pool->nr_kernel, 0);
+	atomic_set(&dev_pool->nr_missed, 0);
+	cancel_delayed_work_sync(&test_kbdev.mem_pool_warm_work);
+	allocated = mgm_nr_allocated;
+
+	/* the device pool serves what it has, the kernel the rest */
+	CHECK(!kbase_mem_pool_grow(&ctx_pool, 10));
+	CHECK(kbase_mem_pool_size(&ctx_pool) == 10);
+	CHECK(kbase_mem_pool_size(dev_pool) == 0);
+	CHECK(mgm_nr_allocated - allocated == 6);
+	CHECK(atomic_long_read(&dev_pool->nr_hits) == 4);
+	CHECK(atomic_long_read(&dev_pool->nr_kernel) == 6);
+	CHECK(atomic_read(&dev_pool->nr_missed) == 6);
+	CHECK(test_kbdev.mem_pool_warm_work.pending);
+
+	/* all of it is accounted to the device pool */
+	CHECK(atomic_long_read(&ctx_pool.nr_hits) == 0);
+	CHECK(atomic_long_read(&ctx_pool.nr_kernel) == 0);
+	CHECK(atomic_read(&ctx_pool.nr_missed) == 0);
+
+	/* a grow served by the device pool alone misses nothing */
+	CHECK(!kbase_mem_pool_grow(dev_pool, 2));
+	atomic_long_set(&dev_pool->nr_kernel, 6);
+	atomic_set(&dev_pool->nr_missed, 6);
+	cancel_delayed_work_sync(&test_kbdev.mem_pool_warm_work);
+
+	CHECK(!kbase_mem_pool_grow(&ctx_pool, 2));
+	CHECK(kbase_mem_pool_size(&ctx_pool) == 12);
+	CHECK(atomic_long_read(&dev_pool->nr_hits) == 6);
+	CHECK(atomic_long_read(&dev_pool->nr_kernel) == 6);
+	CHECK(atomic_read(&dev_pool->nr_missed) == 6);
+	CHECK(!test_kbdev.mem_pool_warm_work.pending);
+
+	/* a failed grow accounts the pages it did get from the kernel */
+	mgm_fail_after = 2;
+	CHECK(kbase_mem_pool_grow(&ctx_pool, 4) == -ENOMEM);
+	mgm_fail_after = -1;
+	CHECK(kbase_mem_pool_size(&ctx_pool) == 14);
+	CHECK(atomic_long_read(&dev_pool->nr_kernel) == 8);
+	CHECK(atomic_read(&dev_pool->nr_missed) == 8);
+	CHECK(test_kbdev.mem_pool_warm_work.pending);
+
+	/* the context pool spills to the device pool on termination */
+	kbase_mem_pool_term(&ctx_pool);
+	CHECK(kbase_mem_pool_size(dev_pool) == 14);
+
+	device_term();
+}
+
+int main(void)
+{
+	test_warm_target();
+	test_warm_after_shrink();
+	test_grow_from_next();
+
+	if (failed) {
+		printf("mem_pool_test: %d checks failed\n", failed);
+		return 1;
+	}
+
+	printf("mem_pool_test: all checks passed\n");
+	return 0;
+}
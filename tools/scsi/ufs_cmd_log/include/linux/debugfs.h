@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * debugfs entries are kept in a flat table so that the test can look up the
+ * files of a host and open them through their file_operations.
+ */
+#ifndef _UFS_CMD_LOG_DEBUGFS_H
+#define _UFS_CMD_LOG_DEBUGFS_H
+
+#include <linux/kernel.h>
+
+struct inode {
+	void *i_private;
+};
+
+struct file {
+	struct inode *f_inode;
+	void *private_data;
+};
+
+static inline struct inode *file_inode(const struct file *file)
+{
+	return file->f_inode;
+}
+
+struct file_operations {
+	int (*open)(struct inode *, struct file *);
+	ssize_t (*read)(struct file *, char *, size_t, loff_t *);
+	ssize_t (*write)(struct file *, const char *, size_t, loff_t *);
+	loff_t (*llseek)(struct file *, loff_t, int);
+	int (*release)(struct inode *, struct file *);
+};
+
+#define default_llseek	NULL
+
+struct dentry {
+	const char *name;
+	struct dentry *parent;
+	const struct file_operations *fops;
+	struct inode inode;
+	bool used;
+};
+
+#define MAX_DENTRIES	64
+extern struct dentry test_dentries[MAX_DENTRIES];
+
+static inline struct dentry *debugfs_create_file(const char *name, int mode,
+				struct dentry *parent, void *data,
+				const struct file_operations *fops)
+{
+	int i;
+
+	for (i = 0; i < MAX_DENTRIES; i++) {
+		struct dentry *d = &test_dentries[i];
+
+		if (d->used)
+			continue;
+		d->used = true;
+		d->name = name;
+		d->parent = parent;
+		d->fops = fops;
+		d->inode.i_private = data;
+		return d;
+	}
+
+	return NULL;
+}
+
+static inline struct dentry *debugfs_create_dir(const char *name,
+						struct dentry *parent)
+{
+	return debugfs_create_file(name, 0, parent, NULL, NULL);
+}
+
+static inline struct dentry *debugfs_create_bool(const char *name, int mode,
+						 struct dentry *parent,
+						 bool *value)
+{
+	return debugfs_create_file(name, mode, parent, value, NULL);
+}
+
+static inline void debugfs_remove(struct dentry *dentry)
+{
+	if (dentry)
+		dentry->used = false;
+}
+
+static inline void debugfs_remove_recursive(struct dentry *dentry)
+{
+	int i;
+
+	for (i = 0; i < MAX_DENTRIES; i++)
+		if (test_dentries[i].used && test_dentries[i].parent == dentry)
+			debugfs_remove_recursive(&test_dentries[i]);
+	debugfs_remove(dentry);
+}
+
+#endif
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Minimal kernel environment for building the UFS command log on the host.
+ * The clock and the current cpu are set by the test.
+ */
+#ifndef _UFS_CMD_LOG_KERNEL_H
+#define _UFS_CMD_LOG_KERNEL_H
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/types.h>
+
+#define U8_MAX		((u8)~0U)
+#define U32_MAX		((u32)~0U)
+#define NSEC_PER_USEC	1000L
+
+#define READ_ONCE(x)		(x)
+#define WRITE_ONCE(x, val)	((x) = (val))
+
+#define min_t(type, x, y) ({ type _x = (x); type _y = (y); _x < _y ? _x : _y; })
+
+#define WARN_ON(cond) ({						\
+	int _c = !!(cond);						\
+	if (_c)								\
+		fprintf(stderr, "WARNING at %s:%d\n", __FILE__, __LINE__); \
+	_c;								\
+})
+
+static inline int fls(unsigned int x)
+{
+	return x ? 32 - __builtin_clz(x) : 0;
+}
+
+#define IS_ERR_OR_NULL(ptr)	(!(ptr))
+
+#define NR_CPUS		4
+extern int test_cpu;
+#define smp_processor_id()	(test_cpu)
+
+#endif
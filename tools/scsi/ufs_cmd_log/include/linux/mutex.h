@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _UFS_CMD_LOG_MUTEX_H
+#define _UFS_CMD_LOG_MUTEX_H
+
+struct mutex {
+	int locked;
+};
+
+#define DEFINE_MUTEX(name)	struct mutex name
+#define mutex_lock(lock)	((lock)->locked++)
+#define mutex_unlock(lock)	((lock)->locked--)
+
+#endif
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _UFS_CMD_LOG_PERCPU_H
+#define _UFS_CMD_LOG_PERCPU_H
+
+#include <linux/kernel.h>
+
+#define __percpu
+#define alloc_percpu(type)	((type *)calloc(NR_CPUS, sizeof(type)))
+#define free_percpu(ptr)	free(ptr)
+#define per_cpu_ptr(ptr, cpu)	(&(ptr)[cpu])
+#define this_cpu_ptr(ptr)	per_cpu_ptr(ptr, smp_processor_id())
+
+#define num_possible_cpus()	NR_CPUS
+#define for_each_possible_cpu(cpu) for ((cpu) = 0; (cpu) < NR_CPUS; (cpu)++)
+
+#endif
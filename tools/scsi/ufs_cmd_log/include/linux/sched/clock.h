@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _UFS_CMD_LOG_CLOCK_H
+#define _UFS_CMD_LOG_CLOCK_H
+
+#include <linux/types.h>
+
+extern u64 test_clock;
+
+static inline u64 local_clock(void)
+{
+	return test_clock;
+}
+
+#endif
@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _UFS_CMD_LOG_SEQ_FILE_H
+#define _UFS_CMD_LOG_SEQ_FILE_H
+
+#include <stdarg.h>
+
+#include <linux/debugfs.h>
+#include <linux/uaccess.h>
+
+struct seq_file {
+	char buf[8192];
+	size_t count;
+	void *private;
+};
+
+static inline void seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	m->count += vsnprintf(m->buf + m->count, sizeof(m->buf) - m->count,
+			      fmt, args);
+	va_end(args);
+}
+
+static inline void seq_putc(struct seq_file *m, char c)
+{
+	seq_printf(m, "%c", c);
+}
+
+static inline int single_open(struct file *file,
+			      int (*show)(struct seq_file *, void *),
+			      void *data)
+{
+	struct seq_file *m = calloc(1, sizeof(*m));
+
+	m->private = data;
+	show(m, NULL);
+	file->private_data = m;
+
+	return 0;
+}
+
+static inline ssize_t seq_read(struct file *file, char *buf, size_t size,
+			       loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+
+	return simple_read_from_buffer(buf, size, ppos, m->buf, m->count);
+}
+
+static inline int single_release(struct inode *inode, struct file *file)
+{
+	free(file->private_data);
+	return 0;
+}
+
+#define seq_lseek	NULL
+
+#endif
@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _UFS_CMD_LOG_SLAB_H
+#define _UFS_CMD_LOG_SLAB_H
+
+#include <linux/kernel.h>
+
+#define GFP_KERNEL		0
+#define kzalloc(size, gfp)	calloc(1, size)
+#define kfree(ptr)		free(ptr)
+
+#endif
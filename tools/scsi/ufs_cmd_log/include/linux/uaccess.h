@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _UFS_CMD_LOG_UACCESS_H
+#define _UFS_CMD_LOG_UACCESS_H
+
+#include <linux/kernel.h>
+
+#define __user
+
+static inline ssize_t simple_read_from_buffer(void __user *to, size_t count,
+					      loff_t *ppos, const void *from,
+					      size_t available)
+{
+	loff_t pos = *ppos;
+
+	if (pos < 0)
+		return -1;
+	if (pos >= (loff_t)available || !count)
+		return 0;
+	if (count > available - pos)
+		count = available - pos;
+	memcpy(to, (const char *)from + pos, count);
+	*ppos = pos + count;
+
+	return count;
+}
+
+#endif
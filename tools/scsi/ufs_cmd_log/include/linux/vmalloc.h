@@ -0,0 +1,10 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _UFS_CMD_LOG_VMALLOC_H
+#define _UFS_CMD_LOG_VMALLOC_H
+
+#include <linux/kernel.h>
+
+#define vmalloc(size)	malloc(size)
+#define vfree(ptr)	free(ptr)
+
+#endif
@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _UFS_CMD_LOG_SCSI_PROTO_H
+#define _UFS_CMD_LOG_SCSI_PROTO_H
+
+#define READ_6			0x08
+#define WRITE_6			0x0a
+#define READ_10			0x28
+#define WRITE_10		0x2a
+#define SYNCHRONIZE_CACHE	0x35
+#define UNMAP			0x42
+#define READ_16			0x88
+#define WRITE_16		0x8a
+
+#endif
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Decoder of the binary UFS command log read from
+ * debugfs/ufs_cmd_log/<host>/ring, see drivers/scsi/ufs/ufs-cmd-log.h.
+ *
+ * The ring is a sequence of 32 byte entries in the byte order of the cpu,
+ * little endian on the Exynos SoCs:
+ *
+ *	 0  u64 submit time, ns
+ *	 8  u64 LBA, 512 byte sectors
+ *	16  u32 dispatch time after submission, ns
+ *	20  u32 complete time after submission, ns
+ *	24  u32 length, bytes
+ *	28  u8  SCSI opcode
+ *	29  u8  tag
+ *	30  u8  outstanding commands at dispatch
+ *	31  u8  cpu that completed the command
+ */
+#ifndef _UFS_CMD_LOG_DECODE_H
+#define _UFS_CMD_LOG_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define UFS_CMD_LOG_ENTRY_SIZE	32
+
+struct ufs_cmd_log_record {
+	uint64_t submit;
+	uint64_t lba;
+	uint32_t dispatch;
+	uint32_t complete;
+	uint32_t len;
+	uint8_t opcode;
+	uint8_t tag;
+	uint8_t qdepth;
+	uint8_t cpu;
+};
+
+static inline uint64_t ufs_cmd_log_le(const unsigned char *p, int bytes)
+{
+	uint64_t val = 0;
+
+	while (bytes--)
+		val = (val << 8) | p[bytes];
+
+	return val;
+}
+
+/*
+ * Decodes up to @max records from @len bytes of @buf. Returns the number of
+ * records, a trailing partial entry is ignored.
+ */
+static inline size_t ufs_cmd_log_decode(const void *buf, size_t len,
+					struct ufs_cmd_log_record *rec,
+					size_t max)
+{
+	const unsigned char *p = buf;
+	size_t nr;
+
+	for (nr = 0; nr < max && len >= UFS_CMD_LOG_ENTRY_SIZE; nr++) {
+		rec[nr].submit = ufs_cmd_log_le(p, 8);
+		rec[nr].lba = ufs_cmd_log_le(p + 8, 8);
+		rec[nr].dispatch = ufs_cmd_log_le(p + 16, 4);
+		rec[nr].complete = ufs_cmd_log_le(p + 20, 4);
+		rec[nr].len = ufs_cmd_log_le(p + 24, 4);
+		rec[nr].opcode = p[28];
+		rec[nr].tag = p[29];
+		rec[nr].qdepth = p[30];
+		rec[nr].cpu = p[31];
+
+		p += UFS_CMD_LOG_ENTRY_SIZE;
+		len -= UFS_CMD_LOG_ENTRY_SIZE;
+	}
+
+	return nr;
+}
+
+#endif /* _UFS_CMD_LOG_DECODE_H */
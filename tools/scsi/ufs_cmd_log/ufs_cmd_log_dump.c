@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * ufs_cmd_log_dump.c
+ *
+ * Prints the binary UFS command log of a host, one command per line, oldest
+ * first on each cpu.
+ *
+ * Usage: ufs_cmd_log_dump <debugfs>/ufs_cmd_log/<host>/ring
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ufs_cmd_log.h"
+
+int main(int argc, char *argv[])
+{
+	unsigned char buf[UFS_CMD_LOG_ENTRY_SIZE * 64];
+	struct ufs_cmd_log_record rec[64];
+	size_t len, nr, i;
+	FILE *f;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <debugfs>/ufs_cmd_log/<host>/ring\n",
+			argv[0]);
+		return 1;
+	}
+
+	f = fopen(argv[1], "rb");
+	if (!f) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	printf("%3s %3s %4s %12s %8s %3s %16s %10s %10s\n", "cpu", "tag",
+	       "op", "lba", "len", "qd", "submit(ns)", "disp(us)", "done(us)");
+
+	while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+		nr = ufs_cmd_log_decode(buf, len, rec, 64);
+		for (i = 0; i < nr; i++)
+			printf("%3u %3u 0x%02x %12" PRIu64 " %8u %3u %16" PRIu64
+			       " %10.1f %10.1f\n", rec[i].cpu, rec[i].tag,
+			       rec[i].opcode, rec[i].lba, rec[i].len,
+			       rec[i].qdepth, rec[i].submit,
+			       rec[i].dispatch / 1000.0,
+			       rec[i].complete / 1000.0);
+	}
+
+	fclose(f);
+
+	return 0;
+}
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * ufs_cmd_log_test.c
+ *
+ * Unit test of the UFS command log on the host. drivers/scsi/ufs/ufs-cmd-log.c
+ * is built with the minimal kernel environment in include/, commands are
+ * recorded with a fake clock and cpu, and the ring is read back through its
+ * debugfs file_operations and decoded with ufs_cmd_log.h.
+ */
+
+#include "../../../drivers/scsi/ufs/ufs-cmd-log.c"
+
+#include "ufs_cmd_log.h"
+
+u64 test_clock;
+int test_cpu;
+struct dentry test_dentries[MAX_DENTRIES];
+
+static int failed;
+
+#define CHECK(cond) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: %s failed\n", __FILE__,		\
+			__LINE__, #cond);				\
+		failed++;						\
+	}								\
+} while (0)
+
+static struct dentry *lookup(struct dentry *parent, const char *name)
+{
+	int i;
+
+	for (i = 0; i < MAX_DENTRIES; i++) {
+		struct dentry *d = &test_dentries[i];
+
+		if (d->used && d->parent == parent && !strcmp(d->name, name))
+			return d;
+	}
+
+	return NULL;
+}
+
+static void record(struct ufs_cmd_log *log, unsigned int tag, u8 opcode,
+		   u64 lba, u32 len, unsigned int qdepth,
+		   u64 submit, u64 dispatch, u64 complete)
+{
+	test_clock = submit;
+	ufs_cmd_log_submit(log, tag, opcode, lba, len);
+	test_clock = dispatch;
+	ufs_cmd_log_dispatch(log, tag, qdepth);
+	test_clock = complete;
+	ufs_cmd_log_complete(log, tag);
+}
+
+/* Reads the ring of @host in odd sized chunks, as a reader may do */
+static size_t read_ring(const char *host, struct ufs_cmd_log_record *rec,
+			size_t max)
+{
+	struct dentry *dir = lookup(lookup(NULL, "ufs_cmd_log"), host);
+	struct dentry *ring = lookup(dir, "ring");
+	static unsigned char buf[UFS_CMD_LOG_ENTRY_SIZE *
+				 UFS_CMD_LOG_RING_SIZE * NR_CPUS];
+	struct file file = { .f_inode = &ring->inode };
+	size_t len = 0;
+	loff_t pos = 0;
+	ssize_t ret;
+
+	ring->fops->open(&ring->inode, &file);
+	while ((ret = ring->fops->read(&file, (char *)buf + len, 7, &pos)) > 0)
+		len += ret;
+	ring->fops->release(&ring->inode, &file);
+
+	CHECK(len % UFS_CMD_LOG_ENTRY_SIZE == 0);
+
+	return ufs_cmd_log_decode(buf, len, rec, max);
+}
+
+static const char *read_latency(const char *host)
+{
+	struct dentry *dir = lookup(lookup(NULL, "ufs_cmd_log"), host);
+	struct dentry *latency = lookup(dir, "latency");
+	struct file file = { .f_inode = &latency->inode };
+	static char buf[8192];
+	loff_t pos = 0;
+	ssize_t len;
+
+	latency->fops->open(&latency->inode, &file);
+	len = latency->fops->read(&file, buf, sizeof(buf) - 1, &pos);
+	latency->fops->release(&latency->inode, &file);
+	buf[len > 0 ? len : 0] = '\0';
+
+	return buf;
+}
+
+static void test_layout(void)
+{
+	CHECK(sizeof(struct ufs_cmd_log_entry) == UFS_CMD_LOG_ENTRY_SIZE);
+	CHECK(offsetof(struct ufs_cmd_log_entry, lba) == 8);
+	CHECK(offsetof(struct ufs_cmd_log_entry, dispatch) == 16);
+	CHECK(offsetof(struct ufs_cmd_log_entry, complete) == 20);
+	CHECK(offsetof(struct ufs_cmd_log_entry, len) == 24);
+	CHECK(offsetof(struct ufs_cmd_log_entry, opcode) == 28);
+	CHECK(offsetof(struct ufs_cmd_log_entry, tag) == 29);
+	CHECK(offsetof(struct ufs_cmd_log_entry, qdepth) == 30);
+	CHECK(offsetof(struct ufs_cmd_log_entry, cpu) == 31);
+}
+
+static void test_hosts(void)
+{
+	struct ufs_cmd_log *a = ufs_cmd_log_create("13100000.ufs", 32);
+	struct ufs_cmd_log *b = ufs_cmd_log_create("13200000.ufs", 32);
+	struct dentry *root = lookup(NULL, "ufs_cmd_log");
+
+	CHECK(root && lookup(root, "13100000.ufs") &&
+	      lookup(root, "13200000.ufs"));
+	CHECK(lookup(lookup(root, "13200000.ufs"), "ring"));
+
+	ufs_cmd_log_destroy(a);
+	CHECK(lookup(NULL, "ufs_cmd_log") && !lookup(root, "13100000.ufs"));
+	ufs_cmd_log_destroy(b);
+	CHECK(!lookup(NULL, "ufs_cmd_log"));
+}
+
+static void test_encoding(void)
+{
+	struct ufs_cmd_log *log = ufs_cmd_log_create("ufs", 32);
+	struct ufs_cmd_log_record rec[4];
+
+	test_cpu = 1;
+	record(log, 5, WRITE_10, 0x123456789ULL, 4096, 3,
+	       1000000, 1000500, 1040500);
+	/* saturated queue depth and latency */
+	record(log, 31, READ_16, 8, 512 * 1024, 1000,
+	       2000000, 2000000, 2000000 + 5000000000ULL);
+	/* never submitted, or submitted while the log was disabled */
+	ufs_cmd_log_complete(log, 7);
+	log->enabled = false;
+	record(log, 6, READ_10, 0, 4096, 1, 3000000, 3000100, 3000200);
+	log->enabled = true;
+	/* out of range tag */
+	record(log, 32, READ_10, 0, 4096, 1, 4000000, 4000100, 4000200);
+
+	CHECK(read_ring("ufs", rec, 4) == 2);
+
+	CHECK(rec[0].submit == 1000000);
+	CHECK(rec[0].lba == 0x123456789ULL);
+	CHECK(rec[0].dispatch == 500);
+	CHECK(rec[0].complete == 40500);
+	CHECK(rec[0].len == 4096);
+	CHECK(rec[0].opcode == WRITE_10);
+	CHECK(rec[0].tag == 5);
+	CHECK(rec[0].qdepth == 3);
+	CHECK(rec[0].cpu == 1);
+
+	CHECK(rec[1].tag == 31);
+	CHECK(rec[1].opcode == READ_16);
+	CHECK(rec[1].len == 512 * 1024);
+	CHECK(rec[1].dispatch == 0);
+	CHECK(rec[1].complete == U32_MAX);
+	CHECK(rec[1].qdepth == U8_MAX);
+
+	/* 40.5us write at depth 3, 4.29s+ read at depth 255 */
+	CHECK(this_cpu_ptr(log->cpu)->hist[UFS_CMD_LOG_WRITE][2][2] == 1);
+	CHECK(this_cpu_ptr(log->cpu)->hist[UFS_CMD_LOG_READ]
+	      [UFS_CMD_LOG_QD_BUCKETS - 1][UFS_CMD_LOG_LAT_BUCKETS - 1] == 1);
+	/* the row of the write, with one command in the 32-64us column */
+	CHECK(strstr(read_latency("ufs"),
+		     "\nwrite      4         0         0         1 "));
+
+	ufs_cmd_log_destroy(log);
+}
+
+static void test_wrap(void)
+{
+	struct ufs_cmd_log *log = ufs_cmd_log_create("ufs", 32);
+	static struct ufs_cmd_log_record rec[UFS_CMD_LOG_RING_SIZE * NR_CPUS];
+	unsigned int i, extra = 44;
+	size_t nr;
+
+	test_cpu = 0;
+	for (i = 0; i < UFS_CMD_LOG_RING_SIZE + extra; i++)
+		record(log, i % 32, READ_10, i, 4096, 1,
+		       (i + 1) * 1000, (i + 1) * 1000, (i + 1) * 1000 + 100);
+	test_cpu = 2;
+	record(log, 0, UNMAP, 0, 0, 1, 10000000, 10000000, 10000100);
+
+	nr = read_ring("ufs", rec, UFS_CMD_LOG_RING_SIZE * NR_CPUS);
+	CHECK(nr == UFS_CMD_LOG_RING_SIZE + 1);
+
+	/* the oldest entries of cpu 0 were overwritten */
+	for (i = 0; i < UFS_CMD_LOG_RING_SIZE; i++) {
+		CHECK(rec[i].cpu == 0);
+		CHECK(rec[i].lba == i + extra);
+	}
+	CHECK(rec[nr - 1].cpu == 2 && rec[nr - 1].opcode == UNMAP);
+
+	ufs_cmd_log_destroy(log);
+}
+
+int main(void)
+{
+	test_layout();
+	test_hosts();
+	test_encoding();
+	test_wrap();
+
+	if (failed) {
+		printf("ufs_cmd_log_test: %d checks failed\n", failed);
+		return 1;
+	}
+
+	printf("ufs_cmd_log_test: all checks passed\n");
+	return 0;
+}
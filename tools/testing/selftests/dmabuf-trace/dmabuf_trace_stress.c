@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Stress test of the dma-buf trace hash tables.
+ *
+ * The parent allocates ION buffers and tracks them. In every round, a group
+ * of children inherits the buffers, tracks them all and meets the parent at
+ * a barrier, where the proportional sizes reported by
+ * DMABUF_TRACE_IOCTL_GET_MEMORY are checked exactly. Then the children keep
+ * untracking and tracking the shared buffers, allocating and releasing their
+ * own, and exit with or without untracking first. Meanwhile, reader threads
+ * of the parent query the memory of the children without pause, so that the
+ * RCU lookups race with the task, reference and buffer updates and with the
+ * release of the exiting tasks. After each round, the children must report
+ * nothing and the parent its whole buffers again.
+ *
+ * Has to run as root or system. Skipped if /dev/ion or /dev/dmabuf_trace
+ * does not exist or no system heap is found.
+ *
+ * Usage: dmabuf_trace_stress [-r <rounds>] [-p <processes>]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+/* from include/uapi/linux/ion.h */
+#define ION_HEAP_TYPE_SYSTEM	0
+
+struct ion_allocation_data {
+	uint64_t len;
+	uint32_t heap_id_mask;
+	uint32_t flags;
+	uint32_t fd;
+	uint32_t unused;
+};
+
+struct ion_heap_data {
+	char name[32];
+	uint32_t type;
+	uint32_t heap_id;
+	uint32_t reserved0;
+	uint32_t reserved1;
+	uint32_t reserved2;
+};
+
+struct ion_heap_query {
+	uint32_t cnt;
+	uint32_t reserved0;
+	uint64_t heaps;
+	uint32_t reserved1;
+	uint32_t reserved2;
+};
+
+#define ION_IOC_MAGIC		'I'
+#define ION_IOC_ALLOC		_IOWR(ION_IOC_MAGIC, 0, struct ion_allocation_data)
+#define ION_IOC_HEAP_QUERY	_IOWR(ION_IOC_MAGIC, 8, struct ion_heap_query)
+
+/* from include/uapi/linux/dma-buf.h */
+#define DMA_BUF_BASE		'b'
+#define DMA_BUF_IOCTL_TRACK	_IO(DMA_BUF_BASE, 8)
+#define DMA_BUF_IOCTL_UNTRACK	_IO(DMA_BUF_BASE, 9)
+
+/* from drivers/dma-buf/dma-buf-trace.c */
+struct dmabuf_trace_memory {
+	uint32_t version;
+	uint32_t pid;
+	uint32_t count;
+	uint32_t type;
+	uint32_t *flags;
+	uint32_t *size_in_bytes;
+	uint32_t reserved[2];
+};
+
+#define DMABUF_TRACE_IOCTL_GET_MEMORY \
+	_IOWR('t', 0, struct dmabuf_trace_memory)
+
+#define MEMTRACK_TYPE_OTHER	0
+/* buffers of the system heap without flags */
+#define MEMTRACK_SYSTEM_FLAGS	((1 << 2) | (1 << 4) | (1 << 6) | (1 << 8))
+
+#define NR_BUFS		16
+#define BUF_SIZE	(64 * 1024)
+#define NR_READERS	4
+#define NR_CHURN	2000
+#define MAX_PROCS	64
+
+struct shared {
+	pthread_barrier_t tracked;
+	pthread_barrier_t checked;
+	pid_t pids[MAX_PROCS];
+};
+
+static int ion_fd;
+static int trace_fd;
+static unsigned int heap_mask;
+static int bufs[NR_BUFS];
+static int nr_rounds = 20;
+static int nr_procs = 8;
+static struct shared *shared;
+
+static volatile bool readers_done;
+static unsigned long nr_queries;
+static unsigned long nr_bad;
+static pthread_mutex_t stat_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int find_system_heap(void)
+{
+	struct ion_heap_data heaps[32];
+	struct ion_heap_query query = {
+		.cnt = 32,
+		.heaps = (uintptr_t)heaps,
+	};
+	unsigned int i;
+
+	if (ioctl(ion_fd, ION_IOC_HEAP_QUERY, &query))
+		return -1;
+
+	for (i = 0; i < query.cnt; i++) {
+		if (heaps[i].type == ION_HEAP_TYPE_SYSTEM) {
+			heap_mask = 1 << heaps[i].heap_id;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static int alloc_buf(void)
+{
+	struct ion_allocation_data data = {
+		.len = BUF_SIZE,
+		.heap_id_mask = heap_mask,
+	};
+
+	if (ioctl(ion_fd, ION_IOC_ALLOC, &data))
+		return -1;
+
+	return data.fd;
+}
+
+static int get_memory(pid_t pid, uint32_t *size)
+{
+	uint32_t flags = MEMTRACK_SYSTEM_FLAGS;
+	struct dmabuf_trace_memory mem = {
+		.pid = pid,
+		.count = 1,
+		.type = MEMTRACK_TYPE_OTHER,
+		.flags = &flags,
+		.size_in_bytes = size,
+	};
+
+	*size = 0;
+	return ioctl(trace_fd, DMABUF_TRACE_IOCTL_GET_MEMORY, &mem);
+}
+
+static void *reader_fn(void *arg)
+{
+	unsigned long queries = 0, bad = 0;
+	unsigned int seed = (uintptr_t)arg;
+	uint32_t size;
+
+	while (!readers_done) {
+		pid_t pid = shared->pids[rand_r(&seed) % nr_procs];
+
+		if (!pid)
+			continue;
+
+		if (get_memory(pid, &size)) {
+			perror("DMABUF_TRACE_IOCTL_GET_MEMORY");
+			bad++;
+			break;
+		}
+		queries++;
+
+		/* a child never holds more than the shared and its own buffer */
+		if (size > (NR_BUFS + 1) * BUF_SIZE) {
+			printf("[FAIL]\tpid %d reported %u bytes\n", pid, size);
+			bad++;
+		}
+	}
+
+	pthread_mutex_lock(&stat_lock);
+	nr_queries += queries;
+	nr_bad += bad;
+	pthread_mutex_unlock(&stat_lock);
+
+	return NULL;
+}
+
+static void child_fn(unsigned int seed)
+{
+	bool failed = false;
+	int i, fd;
+
+	for (i = 0; i < NR_BUFS; i++)
+		if (ioctl(bufs[i], DMA_BUF_IOCTL_TRACK))
+			failed = true;
+
+	/* the parent waits for everyone at the barriers */
+	pthread_barrier_wait(&shared->tracked);
+	pthread_barrier_wait(&shared->checked);
+	if (failed)
+		_exit(KSFT_FAIL);
+
+	for (i = 0; i < NR_CHURN; i++) {
+		int buf = bufs[rand_r(&seed) % NR_BUFS];
+
+		switch (rand_r(&seed) % 4) {
+		case 0:
+			/* a buffer of its own, freed while others query */
+			fd = alloc_buf();
+			if (fd < 0 || ioctl(fd, DMA_BUF_IOCTL_TRACK))
+				_exit(KSFT_FAIL);
+			close(fd);
+			break;
+		default:
+			if (ioctl(buf, DMA_BUF_IOCTL_UNTRACK) ||
+			    ioctl(buf, DMA_BUF_IOCTL_TRACK))
+				_exit(KSFT_FAIL);
+			break;
+		}
+	}
+
+	/* half of them leave the references to the release of the task */
+	if (seed & 1) {
+		for (i = 0; i < NR_BUFS; i++)
+			if (ioctl(bufs[i], DMA_BUF_IOCTL_UNTRACK))
+				_exit(KSFT_FAIL);
+	}
+
+	_exit(KSFT_PASS);
+}
+
+static int check_sizes(int nr_sharers)
+{
+	uint32_t expected = NR_BUFS * (BUF_SIZE / nr_sharers);
+	uint32_t size;
+	int i, ret = 0;
+
+	if (get_memory(getpid(), &size) || size != expected) {
+		printf("[FAIL]\tparent: %u bytes, expected %u\n", size, expected);
+		ret = -1;
+	}
+
+	if (nr_sharers == 1)
+		return ret;
+
+	for (i = 0; i < nr_procs; i++) {
+		if (get_memory(shared->pids[i], &size) || size != expected) {
+			printf("[FAIL]\tchild %d: %u bytes, expected %u\n",
+			       shared->pids[i], size, expected);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+static int run_round(int round)
+{
+	int i, status, ret = 0;
+	uint32_t size;
+
+	for (i = 0; i < nr_procs; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("fork");
+			exit(KSFT_FAIL);
+		}
+		if (!pid)
+			child_fn(round * MAX_PROCS + i);
+		shared->pids[i] = pid;
+	}
+
+	pthread_barrier_wait(&shared->tracked);
+	if (check_sizes(nr_procs + 1))
+		ret = -1;
+	pthread_barrier_wait(&shared->checked);
+
+	for (i = 0; i < nr_procs; i++) {
+		if (waitpid(shared->pids[i], &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status)) {
+			printf("[FAIL]\tchild %d failed\n", shared->pids[i]);
+			ret = -1;
+		}
+	}
+
+	/* the readers keep querying the exited children, which is fine */
+	for (i = 0; i < nr_procs; i++) {
+		if (get_memory(shared->pids[i], &size) || size) {
+			printf("[FAIL]\texited child %d: %u bytes\n",
+			       shared->pids[i], size);
+			ret = -1;
+		}
+	}
+
+	if (check_sizes(1))
+		ret = -1;
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t readers[NR_READERS];
+	pthread_barrierattr_t attr;
+	int opt, i, ret = KSFT_PASS;
+
+	while ((opt = getopt(argc, argv, "r:p:")) != -1) {
+		switch (opt) {
+		case 'r':
+			nr_rounds = atoi(optarg);
+			break;
+		case 'p':
+			nr_procs = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-r <rounds>] [-p <processes>]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+	if (nr_procs < 1 || nr_procs > MAX_PROCS) {
+		fprintf(stderr, "processes must be 1 to %d\n", MAX_PROCS);
+		return KSFT_FAIL;
+	}
+
+	ion_fd = open("/dev/ion", O_RDONLY);
+	trace_fd = open("/dev/dmabuf_trace", O_RDONLY);
+	if (ion_fd < 0 || trace_fd < 0) {
+		if (errno == ENOENT || errno == EACCES) {
+			printf("[SKIP]\t/dev/ion or /dev/dmabuf_trace: %s\n",
+			       strerror(errno));
+			return KSFT_SKIP;
+		}
+		perror("open");
+		return KSFT_FAIL;
+	}
+
+	if (find_system_heap()) {
+		printf("[SKIP]\tno ION system heap\n");
+		return KSFT_SKIP;
+	}
+
+	for (i = 0; i < NR_BUFS; i++) {
+		bufs[i] = alloc_buf();
+		if (bufs[i] < 0 || ioctl(bufs[i], DMA_BUF_IOCTL_TRACK)) {
+			perror("ION_IOC_ALLOC");
+			return KSFT_FAIL;
+		}
+	}
+
+	shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		perror("mmap");
+		return KSFT_FAIL;
+	}
+	pthread_barrierattr_init(&attr);
+	pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(&shared->tracked, &attr, nr_procs + 1);
+	pthread_barrier_init(&shared->checked, &attr, nr_procs + 1);
+
+	if (check_sizes(1))
+		return KSFT_FAIL;
+
+	for (i = 0; i < NR_READERS; i++)
+		pthread_create(&readers[i], NULL, reader_fn,
+			       (void *)(uintptr_t)i);
+
+	for (i = 0; i < nr_rounds; i++) {
+		if (run_round(i)) {
+			ret = KSFT_FAIL;
+			break;
+		}
+	}
+
+	readers_done = true;
+	for (i = 0; i < NR_READERS; i++)
+		pthread_join(readers[i], NULL);
+
+	printf("%d rounds of %d processes, %lu queries\n",
+	       i, nr_procs, nr_queries);
+
+	if (nr_bad)
+		ret = KSFT_FAIL;
+	if (ret == KSFT_PASS)
+		printf("[OK]\tdma-buf trace sizes consistent\n");
+
+	return ret;
+}
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * rm -rf throughput with the unlink logging of fs/dlog_hook.c.
+ *
+ * Creates a tree of empty media files, which dlog_hook() logs one by one,
+ * removes it depth first as rm -rf does and reports the deletes per second.
+ * Run it on a kernel with and without CONFIG_PROC_DLOG, or before and after
+ * a change to the hook, to compare. The directory has to be on /data or an
+ * sdcard volume for the hook to log anything.
+ *
+ * Skipped if the directory does not exist.
+ *
+ * Usage: dlog_rmrf [-d <dir>] [-n <files>] [-f <files per directory>]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+static const char *base_dir = "/data/local/tmp";
+static int nr_files = 100000;
+static int files_per_dir = 1000;
+static long nr_removed;
+
+static int make_tree(const char *root)
+{
+	/* leaves room for the names below the root */
+	char path[PATH_MAX + 32];
+	int i, fd;
+
+	if (mkdir(root, 0700)) {
+		perror(root);
+		return -1;
+	}
+
+	for (i = 0; i < nr_files; i++) {
+		if (i % files_per_dir == 0) {
+			snprintf(path, sizeof(path), "%s/d%04d", root,
+				 i / files_per_dir);
+			if (mkdir(path, 0700)) {
+				perror(path);
+				return -1;
+			}
+		}
+
+		snprintf(path, sizeof(path), "%s/d%04d/IMG_%06d.jpg", root,
+			 i / files_per_dir, i);
+		fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+		if (fd < 0) {
+			perror(path);
+			return -1;
+		}
+		close(fd);
+	}
+
+	return 0;
+}
+
+static int remove_fn(const char *path, const struct stat *st, int flag,
+		     struct FTW *ftw)
+{
+	if (remove(path)) {
+		perror(path);
+		return -1;
+	}
+
+	if (flag != FTW_DP)
+		nr_removed++;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec start, end;
+	char root[PATH_MAX];
+	int len;
+	struct stat st;
+	double secs;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:n:f:")) != -1) {
+		switch (opt) {
+		case 'd':
+			base_dir = optarg;
+			break;
+		case 'n':
+			nr_files = atoi(optarg);
+			break;
+		case 'f':
+			files_per_dir = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-d <dir>] [-n <files>] [-f <files per directory>]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (nr_files <= 0 || files_per_dir <= 0) {
+		fprintf(stderr, "invalid number of files\n");
+		return KSFT_FAIL;
+	}
+
+	if (stat(base_dir, &st) || !S_ISDIR(st.st_mode)) {
+		printf("[SKIP]\t%s: not a directory\n", base_dir);
+		return KSFT_SKIP;
+	}
+
+	len = snprintf(root, sizeof(root), "%s/dlog_rmrf.%d", base_dir, getpid());
+	if (len >= (int)sizeof(root)) {
+		fprintf(stderr, "%s: name too long\n", base_dir);
+		return KSFT_FAIL;
+	}
+	if (make_tree(root)) {
+		nftw(root, remove_fn, 16, FTW_DEPTH | FTW_PHYS);
+		return KSFT_FAIL;
+	}
+	sync();
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (nftw(root, remove_fn, 16, FTW_DEPTH | FTW_PHYS)) {
+		printf("[FAIL]\tremoving %s\n", root);
+		return KSFT_FAIL;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	secs = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%ld files in %d directories removed in %.3fs (%.0f files/s)\n",
+	       nr_removed, (nr_files + files_per_dir - 1) / files_per_dir,
+	       secs, nr_removed / secs);
+
+	if (nr_removed != nr_files) {
+		printf("[FAIL]\t%ld files removed, expected %d\n", nr_removed,
+		       nr_files);
+		return KSFT_FAIL;
+	}
+
+	printf("[OK]\trm -rf done\n");
+	return KSFT_PASS;
+}
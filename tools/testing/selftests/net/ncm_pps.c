@@ -0,0 +1,356 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Loopback packet rate through the Network Context Metadata hooks.
+ *
+ * Drives UDP and TCP flows between local sockets from several threads and
+ * reports the packets per second, with NCM activated through /dev/ncm_dev
+ * and a reader draining the flow records as the framework does. Every
+ * packet passes the conntrack output hooks of net/ncm/ncm.c. Run it once
+ * more with -n, which leaves NCM off, for the baseline.
+ *
+ * UDP counts the datagrams received. TCP sends small messages with
+ * TCP_NODELAY and counts the segments from the OutSegs of /proc/net/snmp,
+ * so other TCP traffic of the system is counted as well.
+ *
+ * Has to run as root or system. Skipped if the device does not exist,
+ * unless -n is given.
+ *
+ * Usage: ncm_pps [-t <seconds>] [-f <flows>] [-s <payload bytes>] [-n]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+/* from include/net/ncm.h */
+#define __NCMIOC		0x120
+#define NCM_DEACTIVATED		_IO(__NCMIOC, 4)
+#define NCM_ACTIVATED_ALL	_IO(__NCMIOC, 16)
+#define NCM_MATCH_VERSION	_IO(__NCMIOC, 64)
+
+#define READ_BATCH	64
+#define MAX_PAYLOAD	1400
+
+static int ncm_fd = -1;
+static long rec_size;
+static int duration = 5;
+static int nr_flows = 2;
+static int payload = 64;
+static bool no_ncm;
+
+static volatile bool stop;
+static volatile bool reader_stop;
+static unsigned long udp_packets;
+static pthread_mutex_t count_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct flow {
+	int tx, rx;
+	pthread_t sender, receiver;
+};
+
+static void *reader_fn(void *arg)
+{
+	struct pollfd pfd = { .fd = ncm_fd, .events = POLLIN };
+	char *buf = malloc(rec_size * READ_BATCH);
+
+	if (!buf)
+		return NULL;
+
+	while (!reader_stop) {
+		poll(&pfd, 1, 100);
+		if (read(ncm_fd, buf, rec_size * READ_BATCH) <= 0)
+			usleep(10 * 1000);
+	}
+
+	free(buf);
+	return NULL;
+}
+
+static void *sender_fn(void *arg)
+{
+	struct flow *flow = arg;
+	char buf[MAX_PAYLOAD] = { 0 };
+
+	while (!stop) {
+		/* loopback drops UDP once the receiver is behind */
+		if (send(flow->tx, buf, payload, 0) < 0 &&
+		    errno != ENOBUFS && errno != EAGAIN && errno != ECONNREFUSED &&
+		    errno != EINTR) {
+			perror("send");
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void *udp_receiver_fn(void *arg)
+{
+	struct flow *flow = arg;
+	char buf[MAX_PAYLOAD];
+	unsigned long packets = 0;
+
+	while (!stop) {
+		if (recv(flow->rx, buf, sizeof(buf), 0) > 0)
+			packets++;
+	}
+
+	pthread_mutex_lock(&count_lock);
+	udp_packets += packets;
+	pthread_mutex_unlock(&count_lock);
+
+	return NULL;
+}
+
+static void *tcp_receiver_fn(void *arg)
+{
+	struct flow *flow = arg;
+	char buf[64 * 1024];
+
+	while (!stop) {
+		if (recv(flow->rx, buf, sizeof(buf), 0) <= 0 && errno != EINTR &&
+		    errno != EAGAIN)
+			break;
+	}
+
+	return NULL;
+}
+
+/* Connects @flow to a listener on the loopback, returns 0 on success */
+static int setup_flow(struct flow *flow, int type)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	struct timeval tv = { .tv_sec = 0, .tv_usec = 100 * 1000 };
+	socklen_t len = sizeof(addr);
+	int lfd, one = 1;
+
+	lfd = socket(AF_INET, type, 0);
+	if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    getsockname(lfd, (struct sockaddr *)&addr, &len) ||
+	    (type == SOCK_STREAM && listen(lfd, 1))) {
+		perror("listener");
+		return -1;
+	}
+
+	flow->tx = socket(AF_INET, type, 0);
+	if (flow->tx < 0 ||
+	    connect(flow->tx, (struct sockaddr *)&addr, sizeof(addr))) {
+		perror("connect");
+		return -1;
+	}
+
+	if (type == SOCK_STREAM) {
+		flow->rx = accept(lfd, NULL, NULL);
+		close(lfd);
+		if (flow->rx < 0) {
+			perror("accept");
+			return -1;
+		}
+		setsockopt(flow->tx, IPPROTO_TCP, TCP_NODELAY, &one,
+			   sizeof(one));
+	} else {
+		flow->rx = lfd;
+	}
+
+	/* the receivers have to notice the end of the run */
+	setsockopt(flow->rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(flow->tx, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	return 0;
+}
+
+/* Reads the OutSegs counter of the Tcp line of /proc/net/snmp */
+static long tcp_out_segs(void)
+{
+	char names[1024], values[1024];
+	char *name, *value, *sn, *sv;
+	FILE *f = fopen("/proc/net/snmp", "r");
+	long segs = -1;
+
+	if (!f)
+		return -1;
+
+	while (fgets(names, sizeof(names), f)) {
+		if (strncmp(names, "Tcp:", 4))
+			continue;
+		if (!fgets(values, sizeof(values), f))
+			break;
+
+		name = strtok_r(names, " \n", &sn);
+		value = strtok_r(values, " \n", &sv);
+		while (name && value) {
+			if (!strcmp(name, "OutSegs")) {
+				segs = atol(value);
+				break;
+			}
+			name = strtok_r(NULL, " \n", &sn);
+			value = strtok_r(NULL, " \n", &sv);
+		}
+		break;
+	}
+	fclose(f);
+
+	return segs;
+}
+
+/* Runs all flows of @type for the duration, returns the packets per second */
+static double run(int type)
+{
+	struct flow *flows = calloc(nr_flows, sizeof(*flows));
+	struct timespec start, end;
+	long segs = 0;
+	double secs;
+	int i;
+
+	if (!flows)
+		return -1;
+
+	for (i = 0; i < nr_flows; i++) {
+		if (setup_flow(&flows[i], type)) {
+			free(flows);
+			return -1;
+		}
+	}
+
+	stop = false;
+	udp_packets = 0;
+	if (type == SOCK_STREAM)
+		segs = tcp_out_segs();
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nr_flows; i++) {
+		pthread_create(&flows[i].receiver, NULL,
+			       type == SOCK_STREAM ? tcp_receiver_fn :
+			       udp_receiver_fn, &flows[i]);
+		pthread_create(&flows[i].sender, NULL, sender_fn, &flows[i]);
+	}
+
+	sleep(duration);
+	stop = true;
+
+	for (i = 0; i < nr_flows; i++) {
+		pthread_join(flows[i].sender, NULL);
+		pthread_join(flows[i].receiver, NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (type == SOCK_STREAM)
+		segs = tcp_out_segs() - segs;
+
+	for (i = 0; i < nr_flows; i++) {
+		close(flows[i].tx);
+		close(flows[i].rx);
+	}
+	free(flows);
+
+	secs = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+	if (type == SOCK_STREAM)
+		return segs < 0 ? -1 : segs / secs;
+
+	return udp_packets / secs;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t reader;
+	double udp_pps, tcp_pps;
+	int opt, ret = KSFT_PASS;
+
+	while ((opt = getopt(argc, argv, "t:f:s:n")) != -1) {
+		switch (opt) {
+		case 't':
+			duration = atoi(optarg);
+			break;
+		case 'f':
+			nr_flows = atoi(optarg);
+			break;
+		case 's':
+			payload = atoi(optarg);
+			break;
+		case 'n':
+			no_ncm = true;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-t <seconds>] [-f <flows>] [-s <payload bytes>] [-n]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (duration < 1 || nr_flows < 1 || payload < 1 ||
+	    payload > MAX_PAYLOAD) {
+		fprintf(stderr, "invalid arguments\n");
+		return KSFT_FAIL;
+	}
+
+	if (!no_ncm) {
+		ncm_fd = open("/dev/ncm_dev", O_RDWR);
+		if (ncm_fd < 0) {
+			if (errno == ENOENT || errno == EACCES) {
+				printf("[SKIP]\t/dev/ncm_dev: %s\n",
+				       strerror(errno));
+				return KSFT_SKIP;
+			}
+			perror("/dev/ncm_dev");
+			return KSFT_FAIL;
+		}
+
+		rec_size = ioctl(ncm_fd, NCM_MATCH_VERSION);
+		if (rec_size <= 0) {
+			perror("NCM_MATCH_VERSION");
+			return KSFT_FAIL;
+		}
+
+		if (ioctl(ncm_fd, NCM_ACTIVATED_ALL)) {
+			perror("NCM_ACTIVATED_ALL");
+			return KSFT_FAIL;
+		}
+
+		pthread_create(&reader, NULL, reader_fn, NULL);
+	}
+
+	udp_pps = run(SOCK_DGRAM);
+	tcp_pps = run(SOCK_STREAM);
+
+	if (!no_ncm) {
+		reader_stop = true;
+		pthread_join(reader, NULL);
+		ioctl(ncm_fd, NCM_DEACTIVATED);
+		close(ncm_fd);
+	}
+
+	printf("ncm %s, %d flows, %d byte payload\n", no_ncm ? "off" : "on",
+	       nr_flows, payload);
+	printf("udp: %.0f packets/s\n", udp_pps);
+	printf("tcp: %.0f segments/s\n", tcp_pps);
+
+	if (udp_pps <= 0 || tcp_pps <= 0) {
+		printf("[FAIL]\tno packets\n");
+		ret = KSFT_FAIL;
+	} else {
+		printf("[OK]\tdone\n");
+	}
+
+	return ret;
+}
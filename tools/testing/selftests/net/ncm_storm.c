@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Loopback connection storm against the Network Context Metadata module.
+ *
+ * Activates NCM through /dev/ncm_dev, opens and closes many TCP
+ * connections to a local listener from several threads while a reader
+ * drains the flow records, and then checks that every connection was
+ * reported as an open flow and that no record was dropped by the per-cpu
+ * rings (NCM_GETDROPPED).
+ *
+ * Has to run as root or system. Skipped if the device does not exist.
+ *
+ * Usage: ncm_storm [-c <connections>] [-t <threads>]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+/* from include/net/ncm.h */
+#define __NCMIOC		0x120
+#define NCM_DEACTIVATED		_IO(__NCMIOC, 4)
+#define NCM_ACTIVATED_ALL	_IO(__NCMIOC, 16)
+#define NCM_MATCH_VERSION	_IO(__NCMIOC, 64)
+#define NCM_GETDROPPED		_IO(__NCMIOC, 128)
+
+#define NCM_FLOW_TYPE_OPEN	1
+
+#define INET6_ADDRSTRLEN_NAP	48
+#define PROCESS_NAME_LEN_NAP	128
+#define DOMAIN_NAME_LEN_NAP	255
+#define IFNAMSIZ		16
+
+/* struct knox_user_socket_metadata */
+struct ncm_record {
+	uint16_t srcport;
+	uint16_t dstport;
+	uint16_t trans_proto;
+	uint64_t knox_sent;
+	uint64_t knox_recv;
+	uint32_t knox_uid;
+	int32_t knox_pid;
+	uint32_t knox_puid;
+	uint64_t open_time;
+	uint64_t close_time;
+	char srcaddr[INET6_ADDRSTRLEN_NAP];
+	char dstaddr[INET6_ADDRSTRLEN_NAP];
+	char process_name[PROCESS_NAME_LEN_NAP];
+	char parent_process_name[PROCESS_NAME_LEN_NAP];
+	char domain_name[DOMAIN_NAME_LEN_NAP];
+	uint32_t knox_uid_dns;
+	int32_t knox_ppid;
+	char interface_name[IFNAMSIZ];
+	int flow_type;
+};
+
+#define READ_BATCH	64
+/* the reader stops after the rings stayed empty this long */
+#define DRAIN_IDLE_MS	1000
+
+static int ncm_fd;
+static int listen_fd;
+static uint16_t listen_port;
+static int nr_conns = 10000;
+static int nr_threads = 4;
+
+static volatile bool storm_done;
+static volatile bool accept_done;
+static unsigned long records;
+static unsigned long opens;
+static int conns_made;
+static pthread_mutex_t conns_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *reader_fn(void *arg)
+{
+	struct ncm_record buf[READ_BATCH];
+	struct pollfd pfd = { .fd = ncm_fd, .events = POLLIN };
+	int idle_ms = 0;
+
+	while (!storm_done || idle_ms < DRAIN_IDLE_MS) {
+		ssize_t len;
+		int i;
+
+		/* ncm_poll() waits by itself, but never returns an error */
+		poll(&pfd, 1, 100);
+
+		len = read(ncm_fd, buf, sizeof(buf));
+		if (len <= 0) {
+			if (len < 0 && errno != EINTR && errno != EAGAIN) {
+				perror("read");
+				break;
+			}
+			usleep(10 * 1000);
+			idle_ms += 10;
+			continue;
+		}
+
+		idle_ms = 0;
+		for (i = 0; i < len / (ssize_t)sizeof(buf[0]); i++) {
+			records++;
+			if (buf[i].flow_type == NCM_FLOW_TYPE_OPEN &&
+			    buf[i].dstport == listen_port)
+				opens++;
+		}
+	}
+
+	return NULL;
+}
+
+static void *accept_fn(void *arg)
+{
+	while (!accept_done) {
+		int fd = accept(listen_fd, NULL, NULL);
+
+		if (fd >= 0)
+			close(fd);
+	}
+
+	return NULL;
+}
+
+static void *storm_fn(void *arg)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(listen_port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+
+	for (;;) {
+		int fd;
+
+		pthread_mutex_lock(&conns_lock);
+		if (conns_made >= nr_conns) {
+			pthread_mutex_unlock(&conns_lock);
+			break;
+		}
+		conns_made++;
+		pthread_mutex_unlock(&conns_lock);
+
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			perror("socket");
+			exit(KSFT_FAIL);
+		}
+		if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+			perror("connect");
+			exit(KSFT_FAIL);
+		}
+		close(fd);
+	}
+
+	return NULL;
+}
+
+static int setup_listener(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(addr);
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(fd, 1024) ||
+	    getsockname(fd, (struct sockaddr *)&addr, &len)) {
+		perror("listener");
+		return -1;
+	}
+
+	listen_fd = fd;
+	listen_port = ntohs(addr.sin_port);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t reader, acceptor, *storm;
+	long rec_size, dropped;
+	struct timespec start, end;
+	double secs;
+	int opt, i, ret = KSFT_PASS;
+
+	while ((opt = getopt(argc, argv, "c:t:")) != -1) {
+		switch (opt) {
+		case 'c':
+			nr_conns = atoi(optarg);
+			break;
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-c <connections>] [-t <threads>]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	ncm_fd = open("/dev/ncm_dev", O_RDWR);
+	if (ncm_fd < 0) {
+		if (errno == ENOENT || errno == EACCES) {
+			printf("[SKIP]\t/dev/ncm_dev: %s\n", strerror(errno));
+			return KSFT_SKIP;
+		}
+		perror("/dev/ncm_dev");
+		return KSFT_FAIL;
+	}
+
+	rec_size = ioctl(ncm_fd, NCM_MATCH_VERSION);
+	if (rec_size != sizeof(struct ncm_record)) {
+		printf("[FAIL]\trecord size %ld, expected %zu\n", rec_size,
+		       sizeof(struct ncm_record));
+		return KSFT_FAIL;
+	}
+
+	if (setup_listener())
+		return KSFT_FAIL;
+
+	if (ioctl(ncm_fd, NCM_ACTIVATED_ALL)) {
+		perror("NCM_ACTIVATED_ALL");
+		return KSFT_FAIL;
+	}
+
+	/* records of earlier flows are not part of the test */
+	dropped = ioctl(ncm_fd, NCM_GETDROPPED);
+
+	storm = calloc(nr_threads, sizeof(*storm));
+	if (!storm)
+		return KSFT_FAIL;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_create(&reader, NULL, reader_fn, NULL);
+	pthread_create(&acceptor, NULL, accept_fn, NULL);
+	for (i = 0; i < nr_threads; i++)
+		pthread_create(&storm[i], NULL, storm_fn, NULL);
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(storm[i], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	storm_done = true;
+	pthread_join(reader, NULL);
+
+	dropped = ioctl(ncm_fd, NCM_GETDROPPED) - dropped;
+	ioctl(ncm_fd, NCM_DEACTIVATED);
+
+	accept_done = true;
+	shutdown(listen_fd, SHUT_RDWR);
+	pthread_join(acceptor, NULL);
+	close(listen_fd);
+	close(ncm_fd);
+
+	secs = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%d connections in %.2fs (%.0f/s), %lu records, %lu opens, %ld dropped\n",
+	       nr_conns, secs, nr_conns / secs, records, opens, dropped);
+
+	if (dropped) {
+		printf("[FAIL]\t%ld records dropped by the rings\n", dropped);
+		ret = KSFT_FAIL;
+	}
+	if (opens < (unsigned long)nr_conns) {
+		printf("[FAIL]\t%lu connections not reported\n",
+		       nr_conns - opens);
+		ret = KSFT_FAIL;
+	}
+	if (ret == KSFT_PASS)
+		printf("[OK]\tall flows reported\n");
+
+	free(storm);
+	return ret;
+}
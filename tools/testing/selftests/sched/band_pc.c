@@ -0,0 +1,447 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Producer/consumer benchmark of the EMS task bands.
+ *
+ * Every group is a process with pairs of producer and consumer threads. A
+ * producer fills a buffer and wakes its consumer, which sums the buffer and
+ * wakes the producer again, so the pairs keep waking each other up on data
+ * that is hot in the cache of the other side. The groups are put into a
+ * schedtune cgroup with schedtune.band set, so that each forms a task band.
+ * /sys/kernel/ems/band_stat is sampled before and after the run, and the
+ * wakeup, cross-cpu, migration and co-location counts of the bands of the
+ * groups are reported next to the handoffs per second.
+ *
+ * With -n the groups stay out of the band, for a baseline. Bands only
+ * restrict the playable cpus of 32-bit tasks, build with -m32 or for arm
+ * to exercise that part.
+ *
+ * Has to run as root. Skipped if band_stat or the schedtune cgroup does not
+ * exist.
+ *
+ * Usage: band_pc [-g <groups>] [-p <pairs per group>] [-s <buffer KiB>]
+ *                [-t <seconds>] [-c <schedtune mount>] [-n]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+#define BAND_STAT	"/sys/kernel/ems/band_stat"
+#define MAX_GROUPS	16
+
+struct band_row {
+	int tgid;
+	int members;
+	char playable[32];
+	unsigned long wakeups;
+	unsigned long cross_cpu;
+	unsigned long migrations;
+	unsigned long colocated;
+};
+
+/* shared between the parent and the groups */
+struct shared {
+	volatile int ready;
+	volatile int done;
+	volatile bool start;
+	volatile bool stop;
+	volatile bool sampled;
+	volatile int failed;
+	unsigned long handoffs[MAX_GROUPS];
+};
+
+struct pair {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool full;
+	unsigned long handoffs;
+	unsigned char *buf;
+	pthread_t producer, consumer;
+};
+
+static int nr_groups = 4;
+static int nr_pairs = 2;
+static size_t buf_size = 64 * 1024;
+static int duration = 5;
+static const char *stune = "/dev/stune";
+static bool no_band;
+
+static struct shared *shared;
+static char cgroup_dir[PATH_MAX];
+
+static int write_file(const char *path, const char *val)
+{
+	int fd = open(path, O_WRONLY);
+	ssize_t ret;
+
+	if (fd < 0)
+		return -1;
+
+	ret = write(fd, val, strlen(val));
+	close(fd);
+
+	return ret < 0 ? -1 : 0;
+}
+
+/* Parses the rows of band_stat, returns the number of rows */
+static int read_band_stat(struct band_row *rows, int max)
+{
+	char line[256];
+	FILE *f = fopen(BAND_STAT, "r");
+	int nr = 0;
+
+	if (!f)
+		return -1;
+
+	/* header */
+	if (!fgets(line, sizeof(line), f)) {
+		fclose(f);
+		return 0;
+	}
+
+	while (nr < max && fgets(line, sizeof(line), f)) {
+		struct band_row *row = &rows[nr];
+		int id, sse;
+		unsigned long util;
+
+		if (sscanf(line, "%d %d %d %d %lu %31s %lu %lu %lu %lu",
+			   &id, &row->tgid, &sse, &row->members, &util,
+			   row->playable, &row->wakeups, &row->cross_cpu,
+			   &row->migrations, &row->colocated) == 10)
+			nr++;
+	}
+	fclose(f);
+
+	return nr;
+}
+
+static struct band_row *find_row(struct band_row *rows, int nr, int tgid)
+{
+	int i;
+
+	for (i = 0; i < nr; i++)
+		if (rows[i].tgid == tgid)
+			return &rows[i];
+
+	return NULL;
+}
+
+static void *producer_fn(void *arg)
+{
+	struct pair *pair = arg;
+	unsigned char val = 0;
+
+	while (!shared->start && !shared->stop)
+		usleep(1000);
+
+	while (!shared->stop) {
+		pthread_mutex_lock(&pair->lock);
+		while (pair->full && !shared->stop)
+			pthread_cond_wait(&pair->cond, &pair->lock);
+		pthread_mutex_unlock(&pair->lock);
+
+		memset(pair->buf, ++val, buf_size);
+
+		pthread_mutex_lock(&pair->lock);
+		pair->full = true;
+		pthread_cond_signal(&pair->cond);
+		pthread_mutex_unlock(&pair->lock);
+	}
+
+	return NULL;
+}
+
+static void *consumer_fn(void *arg)
+{
+	struct pair *pair = arg;
+	unsigned long sum = 0;
+	size_t i;
+
+	while (!shared->stop) {
+		pthread_mutex_lock(&pair->lock);
+		while (!pair->full && !shared->stop)
+			pthread_cond_wait(&pair->cond, &pair->lock);
+		pthread_mutex_unlock(&pair->lock);
+
+		for (i = 0; i < buf_size; i += 64)
+			sum += pair->buf[i];
+
+		pthread_mutex_lock(&pair->lock);
+		pair->full = false;
+		pair->handoffs++;
+		pthread_cond_signal(&pair->cond);
+		pthread_mutex_unlock(&pair->lock);
+	}
+
+	return (void *)sum;
+}
+
+static void wake_pairs(struct pair *pairs)
+{
+	int i;
+
+	for (i = 0; i < nr_pairs; i++) {
+		pthread_mutex_lock(&pairs[i].lock);
+		pthread_cond_broadcast(&pairs[i].cond);
+		pthread_mutex_unlock(&pairs[i].lock);
+	}
+}
+
+static void group_failed(void)
+{
+	__sync_fetch_and_add(&shared->failed, 1);
+	__sync_fetch_and_add(&shared->ready, 1);
+	__sync_fetch_and_add(&shared->done, 1);
+	_exit(KSFT_FAIL);
+}
+
+static void run_group(int group)
+{
+	struct pair *pairs = calloc(nr_pairs, sizeof(*pairs));
+	int i;
+
+	if (!pairs)
+		group_failed();
+
+	/* threads created from now on join the band of the leader */
+	for (i = 0; i < nr_pairs; i++) {
+		struct pair *pair = &pairs[i];
+
+		pthread_mutex_init(&pair->lock, NULL);
+		pthread_cond_init(&pair->cond, NULL);
+		pair->buf = malloc(buf_size);
+		if (!pair->buf ||
+		    pthread_create(&pair->producer, NULL, producer_fn, pair) ||
+		    pthread_create(&pair->consumer, NULL, consumer_fn, pair)) {
+			__sync_fetch_and_add(&shared->failed, 1);
+			shared->stop = true;
+			break;
+		}
+	}
+
+	__sync_fetch_and_add(&shared->ready, 1);
+	while (!shared->stop)
+		usleep(10 * 1000);
+	wake_pairs(pairs);
+
+	for (i = 0; i < nr_pairs; i++) {
+		if (!pairs[i].consumer)
+			break;
+		pthread_join(pairs[i].producer, NULL);
+		pthread_join(pairs[i].consumer, NULL);
+		shared->handoffs[group] += pairs[i].handoffs;
+	}
+	__sync_fetch_and_add(&shared->done, 1);
+
+	/* the band splits up when the group exits, stay until it is sampled */
+	while (!shared->sampled)
+		usleep(10 * 1000);
+
+	_exit(KSFT_PASS);
+}
+
+static int setup_cgroup(void)
+{
+	char path[PATH_MAX + 32];
+
+	snprintf(cgroup_dir, sizeof(cgroup_dir), "%s/band_pc.%d", stune,
+		 getpid());
+	if (mkdir(cgroup_dir, 0755)) {
+		perror(cgroup_dir);
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%s/schedtune.band", cgroup_dir);
+	if (write_file(path, "1")) {
+		perror(path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int join_cgroup(pid_t pid)
+{
+	char path[PATH_MAX + 32], val[16];
+
+	snprintf(path, sizeof(path), "%s/cgroup.procs", cgroup_dir);
+	snprintf(val, sizeof(val), "%d", pid);
+
+	return write_file(path, val);
+}
+
+int main(int argc, char *argv[])
+{
+	struct band_row before[32], after[32];
+	pid_t pids[MAX_GROUPS];
+	unsigned long total = 0;
+	int nr_before, nr_after;
+	struct stat st;
+	int opt, i, status, ret = KSFT_PASS;
+
+	while ((opt = getopt(argc, argv, "g:p:s:t:c:n")) != -1) {
+		switch (opt) {
+		case 'g':
+			nr_groups = atoi(optarg);
+			break;
+		case 'p':
+			nr_pairs = atoi(optarg);
+			break;
+		case 's':
+			buf_size = (size_t)atoi(optarg) * 1024;
+			break;
+		case 't':
+			duration = atoi(optarg);
+			break;
+		case 'c':
+			stune = optarg;
+			break;
+		case 'n':
+			no_band = true;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-g <groups>] [-p <pairs per group>] [-s <buffer KiB>] [-t <seconds>] [-c <schedtune mount>] [-n]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (nr_groups < 1 || nr_groups > MAX_GROUPS || nr_pairs < 1 ||
+	    buf_size < 64 || duration < 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return KSFT_FAIL;
+	}
+
+	if (access(BAND_STAT, R_OK)) {
+		printf("[SKIP]\t%s: %s\n", BAND_STAT, strerror(errno));
+		return KSFT_SKIP;
+	}
+
+	if (!no_band) {
+		if (stat(stune, &st) || !S_ISDIR(st.st_mode)) {
+			printf("[SKIP]\t%s: no schedtune cgroup\n", stune);
+			return KSFT_SKIP;
+		}
+		if (setup_cgroup())
+			return KSFT_FAIL;
+	}
+
+	shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		perror("mmap");
+		return KSFT_FAIL;
+	}
+
+	for (i = 0; i < nr_groups; i++) {
+		int pipefd[2];
+		char c;
+
+		/* the group joins the band before it creates its threads */
+		if (pipe(pipefd)) {
+			perror("pipe");
+			shared->stop = true;
+			nr_groups = i;
+			ret = KSFT_FAIL;
+			break;
+		}
+
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			perror("fork");
+			shared->stop = true;
+			nr_groups = i;
+			ret = KSFT_FAIL;
+			break;
+		}
+		if (!pids[i]) {
+			close(pipefd[1]);
+			if (read(pipefd[0], &c, 1) != 1)
+				group_failed();
+			run_group(i);
+		}
+
+		close(pipefd[0]);
+		if (!no_band && join_cgroup(pids[i])) {
+			perror("cgroup.procs");
+			ret = KSFT_FAIL;
+		}
+		if (write(pipefd[1], "", 1) != 1)
+			ret = KSFT_FAIL;
+		close(pipefd[1]);
+	}
+
+	while (shared->ready < nr_groups)
+		usleep(10 * 1000);
+
+	nr_before = read_band_stat(before, 32);
+	shared->start = true;
+	sleep(duration);
+	shared->stop = true;
+
+	/* the handoffs are final once a group waits for the sample */
+	while (shared->done < nr_groups)
+		usleep(10 * 1000);
+	nr_after = read_band_stat(after, 32);
+	shared->sampled = true;
+
+	for (i = 0; i < nr_groups; i++) {
+		if (waitpid(pids[i], &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status) != KSFT_PASS)
+			ret = KSFT_FAIL;
+	}
+
+	if (shared->failed) {
+		printf("[FAIL]\t%d groups failed to start\n", shared->failed);
+		ret = KSFT_FAIL;
+	}
+
+	printf("group tgid   handoffs/s members playable wakeups  cross_cpu migrations colocated\n");
+	for (i = 0; i < nr_groups; i++) {
+		struct band_row *b = find_row(before, nr_before, pids[i]);
+		struct band_row *a = find_row(after, nr_after, pids[i]);
+
+		total += shared->handoffs[i];
+		printf("%-5d %-6d %-10lu ", i, pids[i],
+		       shared->handoffs[i] / duration);
+		if (!a || !b) {
+			printf("-\n");
+			if (!no_band) {
+				printf("[FAIL]\tgroup %d has no band\n", i);
+				ret = KSFT_FAIL;
+			}
+			continue;
+		}
+		printf("%-7d %-8s %-8lu %-9lu %-10lu %lu\n",
+		       a->members, a->playable, a->wakeups - b->wakeups,
+		       a->cross_cpu - b->cross_cpu,
+		       a->migrations - b->migrations,
+		       a->colocated - b->colocated);
+	}
+	printf("total %lu handoffs/s\n", total / duration);
+
+	if (!no_band)
+		rmdir(cgroup_dir);
+
+	if (ret == KSFT_PASS)
+		printf("[OK]\tdone\n");
+
+	return ret;
+}
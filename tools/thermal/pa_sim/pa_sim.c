@@ -0,0 +1,307 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * pa_sim.c
+ *
+ * Replays a recorded temperature and power trace of a thermal zone through
+ * the power allocator on the host, to tune the model predictive mode
+ * without a device.
+ *
+ * The trace is read from stdin, one sample per polling period:
+ *
+ *	<time ms> <temperature mC> <power mW> [<fps>]
+ *
+ * where the power is what the actors requested, e.g. total_req_power of
+ * the thermal_power_allocator trace event. Lines starting with '#' are
+ * ignored.
+ *
+ * The thermal model of the zone is first fitted from the whole trace with
+ * the same code the kernel uses. The fitted zone is then driven with the
+ * recorded demand in closed loop, once by the PID controller and once by
+ * the model predictive controller, and for each the temperature, the
+ * power, the oscillation of the budget and the frame rate scaled by the
+ * granted power are reported.
+ *
+ * Usage: pa_sim -t <control mC> -w <switch on mC> -s <sustainable mW>
+ *		 -m <max mW> [-H <horizon ms>] [-v] < trace
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef int64_t s64;
+typedef int32_t s32;
+typedef uint32_t u32;
+
+static inline s64 div64_s64(s64 dividend, s64 divisor)
+{
+	return dividend / divisor;
+}
+
+#include "../../../drivers/thermal/power_allocator_mpc.h"
+
+struct sample {
+	double time;
+	int temp;
+	unsigned int power;
+	double fps;
+};
+
+struct config {
+	int control_temp;
+	int switch_on_temp;
+	unsigned int sustainable_power;
+	unsigned int max_power;
+	int horizon;
+	int period;
+	bool verbose;
+};
+
+struct result {
+	double energy;		/* mJ */
+	double fps_sum;
+	double budget_swing;	/* sum of |budget change| in mW */
+	int max_temp;
+	int nr_over;		/* periods above the control temperature */
+	int nr_mpc;		/* periods the model predictive mode was used */
+};
+
+static struct sample *read_trace(int *nr)
+{
+	struct sample *s = NULL;
+	char line[256];
+	int n = 0, size = 0;
+
+	while (fgets(line, sizeof(line), stdin)) {
+		struct sample cur = { .fps = 0 };
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (sscanf(line, "%lf %d %u %lf", &cur.time, &cur.temp,
+			   &cur.power, &cur.fps) < 3) {
+			fprintf(stderr, "Malformed line: %s", line);
+			continue;
+		}
+
+		if (n == size) {
+			size = size ? size * 2 : 1024;
+			s = realloc(s, size * sizeof(*s));
+			if (!s) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+		s[n++] = cur;
+	}
+
+	*nr = n;
+	return s;
+}
+
+/* the PID controller of drivers/thermal/power_allocator.c, in floating point */
+struct pid {
+	double k_po, k_pu, k_i;
+	double err_integral;
+	double integral_max;
+};
+
+static void pid_init(struct pid *pid, const struct config *cfg)
+{
+	double threshold = (cfg->control_temp - cfg->switch_on_temp) / 1000.0;
+
+	pid->k_po = cfg->sustainable_power / threshold;
+	pid->k_pu = 2 * cfg->sustainable_power / threshold;
+	pid->k_i = 10 / 1000.0;
+	pid->integral_max = cfg->sustainable_power;
+	pid->err_integral = 0;
+}
+
+static double pid_power(struct pid *pid, const struct config *cfg, int temp)
+{
+	double err = (cfg->control_temp - temp) / 1000.0;
+	double p = (err < 0 ? pid->k_po : pid->k_pu) * err;
+	double i = pid->k_i * pid->err_integral;
+	double i_next = i + pid->k_i * err;
+
+	if (err < 0) {
+		if (i_next > pid->integral_max)
+			i_next = pid->integral_max;
+		else if (i_next < -(double)cfg->sustainable_power)
+			i_next = -(double)cfg->sustainable_power;
+		pid->err_integral = i_next / pid->k_i;
+		i = i_next;
+	}
+
+	return fmin(fmax(cfg->sustainable_power + p + i, 0), cfg->max_power);
+}
+
+static void run(const char *name, const struct sample *s, int nr,
+		const struct config *cfg, const struct pa_mpc_model *plant,
+		bool mpc)
+{
+	struct pa_mpc_model model;
+	struct result r = { .max_temp = s[0].temp };
+	struct pid pid;
+	double temp = s[0].temp, prev_budget = -1;
+	double a = (double)plant->a / PA_MPC_ONE;
+	double b = (double)plant->b / PA_MPC_ONE;
+	double c = (double)plant->c / (1 << PA_MPC_IN_BITS);
+	int prev_temp = INT32_MIN, k;
+	unsigned int drawn = 0;
+
+	pa_mpc_reset(&model);
+	pid_init(&pid, cfg);
+
+	for (k = 0; k < nr; k++) {
+		unsigned int demand = s[k].power ? s[k].power : 1;
+		double budget = -1;
+		int t = (int)temp;
+
+		if (t < cfg->switch_on_temp) {
+			/* the governor is off and the actors run freely */
+			prev_temp = INT32_MIN;
+			pid.err_integral = pid.integral_max / pid.k_i;
+			budget = cfg->max_power;
+		} else {
+			if (mpc) {
+				unsigned int steps = (cfg->horizon + cfg->period - 1) /
+						     cfg->period;
+
+				if (prev_temp != INT32_MIN)
+					pa_mpc_update(&model, drawn,
+						      prev_temp - cfg->control_temp,
+						      t - cfg->control_temp);
+				prev_temp = t;
+
+				budget = pa_mpc_power(&model, t - cfg->control_temp,
+						      steps);
+				if (budget >= 0) {
+					budget = fmin(budget, cfg->max_power);
+					r.nr_mpc++;
+				}
+			}
+			if (budget < 0)
+				budget = pid_power(&pid, cfg, t);
+		}
+
+		drawn = budget < demand ? (unsigned int)budget : demand;
+
+		if (prev_budget >= 0)
+			r.budget_swing += fabs(budget - prev_budget);
+		prev_budget = budget;
+
+		r.energy += drawn * cfg->period / 1000.0;
+		r.fps_sum += s[k].fps * drawn / demand;
+		if (t > r.max_temp)
+			r.max_temp = t;
+		if (t > cfg->control_temp)
+			r.nr_over++;
+
+		if (cfg->verbose)
+			printf("%s %d %d %.0f %u\n", name, k * cfg->period, t,
+			       budget, drawn);
+
+		/* advance the fitted zone by one period */
+		temp += 1000 * (a * drawn / 1000 -
+				b * (temp - cfg->control_temp) / 1000 + c);
+	}
+
+	printf("%-4s max %6.1fC  over %5.1f%%  avg %6.0fmW  swing %6.0fmW",
+	       name, r.max_temp / 1000.0, 100.0 * r.nr_over / nr,
+	       r.energy * 1000 / (nr * cfg->period),
+	       r.budget_swing / (nr > 1 ? nr - 1 : 1));
+	if (r.fps_sum > 0)
+		printf("  fps %5.1f  fps/W %5.2f", r.fps_sum / nr,
+		       r.fps_sum / nr / (r.energy / (nr * cfg->period)));
+	if (mpc)
+		printf("  model %5.1f%%", 100.0 * r.nr_mpc / nr);
+	printf("\n");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s -t <control mC> -w <switch on mC> -s <sustainable mW>\n"
+		"          -m <max mW> [-H <horizon ms>] [-v] < trace\n", prog);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	struct config cfg = { .horizon = 5000 };
+	struct pa_mpc_model plant;
+	struct sample *s;
+	int opt, nr, k;
+
+	while ((opt = getopt(argc, argv, "t:w:s:m:H:v")) != -1) {
+		switch (opt) {
+		case 't':
+			cfg.control_temp = atoi(optarg);
+			break;
+		case 'w':
+			cfg.switch_on_temp = atoi(optarg);
+			break;
+		case 's':
+			cfg.sustainable_power = atoi(optarg);
+			break;
+		case 'm':
+			cfg.max_power = atoi(optarg);
+			break;
+		case 'H':
+			cfg.horizon = atoi(optarg);
+			break;
+		case 'v':
+			cfg.verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!cfg.control_temp || cfg.switch_on_temp >= cfg.control_temp ||
+	    !cfg.sustainable_power || !cfg.max_power)
+		usage(argv[0]);
+
+	s = read_trace(&nr);
+	if (nr < 2) {
+		fprintf(stderr, "The trace needs at least two samples\n");
+		return 1;
+	}
+
+	cfg.period = (int)(s[1].time - s[0].time);
+	if (cfg.period <= 0) {
+		fprintf(stderr, "Invalid polling period %d\n", cfg.period);
+		return 1;
+	}
+
+	/* fit the zone from the recording the way the governor would */
+	pa_mpc_reset(&plant);
+	for (k = 1; k < nr; k++)
+		pa_mpc_update(&plant, s[k].power,
+			      s[k - 1].temp - cfg.control_temp,
+			      s[k].temp - cfg.control_temp);
+
+	if (!plant.valid) {
+		fprintf(stderr, "The trace does not fit a thermal model\n");
+		return 1;
+	}
+
+	printf("period %dms  a %.6fC/W  b %.6f  tau %.1fs  c %.4fC\n",
+	       cfg.period, (double)plant.a / PA_MPC_ONE,
+	       (double)plant.b / PA_MPC_ONE,
+	       cfg.period / 1000.0 * PA_MPC_ONE / plant.b,
+	       (double)plant.c / (1 << PA_MPC_IN_BITS));
+
+	run("pid", s, nr, &cfg, &plant, false);
+	run("mpc", s, nr, &cfg, &plant, true);
+
+	free(s);
+
+	return 0;
+}